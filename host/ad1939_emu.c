@@ -0,0 +1,323 @@
+/*
+ * NAME:     ad1939_emu.c
+ * PURPOSE:  Functional model of the SPI port, its DMA channel and the AD1939
+ *           control port on slave select 0.
+ * USAGE:    Time advances one core cycle per emu_step(), so per NOP() of the
+ *           project sources. A word takes 8*SPIBAUD cycles per bit, the SPI
+ *           clock being PCLK/(4*SPIBAUD) with PCLK at half the core clock.
+ *           Words come from TXSPI when TIMOD1 is set or from the DMA when
+ *           TIMOD2 and SPIDEN are; RXSPI gets what the codec drove back.
+ *
+ *           The codec sees a transaction from the falling to the rising edge
+ *           of its select. That is SPIFLG0 when CPHASE leaves the select to
+ *           software, or every single word when it is clear and the port
+ *           drives the select itself. Like the AD1939, the model latches the
+ *           last 24 bits of a frame on the rising edge, so longer frames work
+ *           with the surplus bits in front, and answers a read in the third
+ *           byte of the frame. CLKCTRL1 reads back the PLL lock bit, set
+ *           ad1939_emu_lock_cycles after CLKCTRL0 powers the PLL up.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include "ADDS_21479_EzKit.h"
+#include "sharc_emu.h"
+
+/* TXSPI as the model leaves it once it has taken the word */
+#define TXSPI_EMPTY         INTPTR_MIN
+
+/* Bytes of a frame kept, the longest the model decodes */
+#define FRAME_BYTES         (4)
+
+ad1939_emu_stats ad1939_emu_statistics;
+unsigned char ad1939_emu_regs[AD1939_EMU_REGS];
+unsigned long long ad1939_emu_lock_cycles = 133000;     /* 0.5 ms at 266 MHz */
+int ad1939_emu_fault_reg = -1;
+
+static struct {
+    int tx_full;                /* word taken from TXSPI or the DMA, not shifted yet */
+    unsigned int tx;
+    int busy;                   /* word in the shift register */
+    unsigned int shift;
+    int shift_bits;
+    long long remaining;        /* cycles until the word is out */
+    int done;                   /* a word was shifted since the last start */
+
+    int selected;               /* select line of the codec low */
+    int hardware_select;        /* held low by the port for the word in flight */
+    unsigned char frame[FRAME_BYTES];
+    int frame_bytes;            /* bytes since the falling edge */
+
+    int pll_on;
+    unsigned long long pll_start;
+} spi;
+
+void ad1939_emu_reset(void)
+{
+    memset(&spi, 0, sizeof(spi));
+    memset(ad1939_emu_regs, 0, sizeof(ad1939_emu_regs));
+    memset(&ad1939_emu_statistics, 0, sizeof(ad1939_emu_statistics));
+    emu_mmr[EMU_TXSPI] = TXSPI_EMPTY;
+}
+
+static int pll_locked(void)
+{
+    return spi.pll_on && ad1939_emu_lock_cycles != ~0ull &&
+           ad1939_emu_statistics.cycles - spi.pll_start >= ad1939_emu_lock_cycles;
+}
+
+/*-------------------------------------------------------------------------------*/
+/* Codec */
+
+static void frame_begin(void)
+{
+    spi.frame_bytes = 0;
+}
+
+/* Rising edge of the select: the last three bytes are the command */
+static void frame_end(void)
+{
+    unsigned char b[3];
+    int i, n = spi.frame_bytes < FRAME_BYTES ? spi.frame_bytes : FRAME_BYTES;
+
+    if(spi.frame_bytes == 0)
+        return;
+
+    ad1939_emu_statistics.frames++;
+
+    if(spi.frame_bytes < 3)
+    {
+        ad1939_emu_statistics.ignored++;
+        return;
+    }
+
+    for(i = 0; i < 3; i++)
+        b[i] = spi.frame[(n - 3 + i)];
+
+    if(b[0] == RD(AD1939_ADDR))
+        return;
+
+    if(b[0] != WR(AD1939_ADDR) || b[1] >= AD1939_EMU_REGS)
+    {
+        ad1939_emu_statistics.ignored++;
+        return;
+    }
+
+    ad1939_emu_statistics.writes++;
+    if(b[1] == ad1939_emu_fault_reg)
+        return;
+
+    ad1939_emu_regs[b[1]] = b[2];
+
+    if(b[1] == CLKCTRL0)
+    {
+        if(b[2] & PLL_PWR_DWN)
+            spi.pll_on = 0;
+        else if(!spi.pll_on)
+        {
+            spi.pll_on = 1;
+            spi.pll_start = ad1939_emu_statistics.cycles;
+            if(ad1939_emu_statistics.power_cycle == 0)
+                ad1939_emu_statistics.power_cycle = spi.pll_start;
+        }
+    }
+}
+
+/* Byte shifted into the codec while it drives the returned one */
+static unsigned char frame_byte(unsigned char in)
+{
+    unsigned char out = 0;
+
+    if(spi.frame_bytes == 2 && spi.frame[0] == RD(AD1939_ADDR) && spi.frame[1] < AD1939_EMU_REGS)
+    {
+        out = ad1939_emu_regs[spi.frame[1]];
+        if(spi.frame[1] == CLKCTRL1 && pll_locked())
+            out |= AD1938_PLL_LOCK;
+        ad1939_emu_statistics.reads++;
+    }
+
+    /* Only the leading bytes are decoded for reads and the trailing ones
+     * for writes, a frame longer than FRAME_BYTES keeps its last bytes */
+    if(spi.frame_bytes < FRAME_BYTES)
+        spi.frame[spi.frame_bytes] = in;
+    else
+    {
+        memmove(&spi.frame[0], &spi.frame[1], FRAME_BYTES - 1);
+        spi.frame[FRAME_BYTES - 1] = in;
+    }
+    spi.frame_bytes++;
+
+    return out;
+}
+
+/*-------------------------------------------------------------------------------*/
+/* SPI port */
+
+static int word_bits(void)
+{
+    switch(emu_mmr[EMU_SPICTL] & WL_MASK)
+    {
+    case WL16:
+        return 16;
+    case WL32:
+        return 32;
+    default:
+        return 8;
+    }
+}
+
+static void update_status(void)
+{
+    emu_reg stat = emu_mmr[EMU_SPISTAT] & (SPIF | RXS);
+
+    if(spi.tx_full)
+        stat |= TXS;
+    if(spi.busy)
+        stat &= ~SPIF;
+    else if(spi.done)
+        stat |= SPIF;
+    if(!spi.tx_full && !spi.busy)
+        stat |= SPIFE;
+
+    emu_mmr[EMU_SPISTAT] = stat;
+}
+
+/* Select line as software or the port leaves it */
+static void update_select(void)
+{
+    emu_reg flg = emu_mmr[EMU_SPIFLG];
+    int selected;
+
+    if(!(flg & DS0EN))
+        selected = 0;
+    else if(emu_mmr[EMU_SPICTL] & CPHASE)
+        selected = !(flg & SPIFLG0);
+    else
+        selected = spi.hardware_select;
+
+    if(selected && !spi.selected)
+        frame_begin();
+    else if(!selected && spi.selected)
+        frame_end();
+    spi.selected = selected;
+}
+
+/* Takes a word the core wrote to TXSPI, or one the DMA can feed */
+static void load_tx(void)
+{
+    emu_reg ctl = emu_mmr[EMU_SPICTL];
+    emu_reg dmac = emu_mmr[EMU_SPIDMAC];
+
+    if(ctl & (TXFLSH | RXFLSH))
+    {
+        spi.tx_full = 0;
+        emu_mmr[EMU_TXSPI] = TXSPI_EMPTY;
+        emu_mmr[EMU_SPISTAT] &= ~(TXS | RXS);
+    }
+
+    if(emu_mmr[EMU_TXSPI] != TXSPI_EMPTY)
+    {
+        spi.tx = (unsigned int)emu_mmr[EMU_TXSPI];
+        spi.tx_full = 1;
+        emu_mmr[EMU_TXSPI] = TXSPI_EMPTY;
+    }
+
+    if((ctl & SPIEN) && (ctl & TIMOD2) && (dmac & SPIDEN) && !(dmac & SPIRCV) &&
+       emu_mmr[EMU_CSPI] > 0)
+    {
+        dmac |= SPIDMAS;
+        if(!spi.tx_full)
+        {
+            const int *ii = (const int *)emu_mmr[EMU_IISPI];
+
+            spi.tx = (unsigned int)*ii;
+            spi.tx_full = 1;
+            emu_mmr[EMU_IISPI] = (emu_reg)(ii + emu_mmr[EMU_IMSPI]);
+            emu_mmr[EMU_CSPI]--;
+            ad1939_emu_statistics.dma_words++;
+        }
+    }
+
+    /* Done once the last word is handed to the port */
+    if(emu_mmr[EMU_CSPI] <= 0 || !(dmac & SPIDEN))
+        dmac &= ~SPIDMAS;
+    emu_mmr[EMU_SPIDMAC] = dmac;
+}
+
+volatile emu_reg *emu_spi_sync(int reg)
+{
+    update_select();
+    load_tx();
+    update_status();
+
+    /* Reading RXSPI empties it */
+    if(reg == EMU_RXSPI)
+        emu_mmr[EMU_SPISTAT] &= ~RXS;
+
+    return &emu_mmr[reg];
+}
+
+static void word_end(void)
+{
+    unsigned int rx = 0;
+    int i;
+
+    for(i = spi.shift_bits - 8; i >= 0; i -= 8)
+        rx = (rx << 8) | frame_byte((unsigned char)(spi.shift >> i));
+
+    emu_mmr[EMU_RXSPI] = (emu_reg)rx;
+    emu_mmr[EMU_SPISTAT] |= RXS;
+    ad1939_emu_statistics.words++;
+    ad1939_emu_statistics.bits += spi.shift_bits;
+
+    spi.busy = 0;
+    spi.done = 1;
+    spi.hardware_select = 0;
+}
+
+void ad1939_emu_step(void)
+{
+    emu_reg ctl = emu_mmr[EMU_SPICTL];
+    int baud;
+
+    ad1939_emu_statistics.cycles++;
+
+    if(!(ctl & SPIEN) || !(ctl & SPIMS))
+    {
+        spi.busy = 0;
+        spi.hardware_select = 0;
+        if(ctl & (TXFLSH | RXFLSH))
+            load_tx();
+        update_select();
+        update_status();
+        return;
+    }
+
+    load_tx();
+
+    if(spi.busy && --spi.remaining <= 0)
+        word_end();
+
+    /* A select the port drives goes high after every word and low again
+     * for the next, so each word is a frame of its own */
+    update_select();
+
+    if(!spi.busy && spi.tx_full)
+    {
+        baud = (int)emu_mmr[EMU_SPIBAUD] > 1 ? (int)emu_mmr[EMU_SPIBAUD] : 1;
+
+        spi.shift = spi.tx;
+        spi.shift_bits = word_bits();
+        spi.remaining = (long long)spi.shift_bits * 8 * baud;
+        spi.tx_full = 0;
+        spi.busy = 1;
+        spi.done = 0;
+        spi.hardware_select = 1;
+        update_select();
+    }
+
+    update_status();
+
+    if(spi.pll_on && ad1939_emu_statistics.lock_cycle == 0 && pll_locked())
+        ad1939_emu_statistics.lock_cycle = ad1939_emu_statistics.cycles;
+}
@@ -0,0 +1,369 @@
+/*
+ * NAME:     audio_io.c
+ * PURPOSE:  Interleaved audio files for the host tools.
+ * USAGE:    See audio_io.h. Samples are little-endian, PCM of 16, 24 or 32
+ *           bits or IEEE float; WAVE_FORMAT_EXTENSIBLE headers are read like
+ *           their sub-format. Data chunks that claim 0 or 0xFFFFFFFF bytes,
+ *           as written by tools that stream, run to the end of the file.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <builtins.h>
+#include "audio_io.h"
+
+#define WAV_PCM             1
+#define WAV_FLOAT           3
+#define WAV_EXTENSIBLE      0xFFFE
+
+/* Frames converted per fread()/fwrite() */
+#define AUDIO_CHUNK_FRAMES  4096
+
+static unsigned int get16(const unsigned char *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static unsigned int get32(const unsigned char *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+static void put16(unsigned char *p, unsigned int v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+}
+
+static void put32(unsigned char *p, unsigned int v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+int audio_sample_bytes(audio_format format)
+{
+    return format == AUDIO_S16 ? 2 : format == AUDIO_S24 ? 3 : 4;
+}
+
+int audio_parse_format(const char *name)
+{
+    static const char *names[] = { "s16", "s24", "s32", "f32" };
+    int i;
+
+    for(i = 0; i < 4; i++)
+    {
+        if(strcmp(name, names[i]) == 0)
+            return i;
+    }
+    return -1;
+}
+
+static int allocate(audio_file *a)
+{
+    a->buffer_frames = AUDIO_CHUNK_FRAMES;
+    a->buffer = malloc((size_t)a->buffer_frames * a->channels * audio_sample_bytes(a->format));
+    if(a->buffer == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        return -1;
+    }
+    return 0;
+}
+
+/*-------------------------------------------------------------------------------*/
+/* Reading */
+
+/* Chunks up to and including the data chunk header */
+static int read_wav_header(audio_file *a, const char *path)
+{
+    unsigned char h[40];
+    unsigned int size, tag = 0, bits = 0;
+    int fmt = 0;
+
+    for(;;)
+    {
+        if(fread(h, 1, 8, a->file) != 8)
+        {
+            fprintf(stderr, "%s: no data chunk\n", path);
+            return -1;
+        }
+        size = get32(&h[4]);
+
+        if(memcmp(h, "data", 4) == 0)
+            break;
+
+        if(memcmp(h, "fmt ", 4) == 0 && size >= 16)
+        {
+            if(fread(h, 1, size < sizeof(h) ? size : sizeof(h), a->file) < 16)
+                return -1;
+            tag = get16(&h[0]);
+            a->channels = get16(&h[2]);
+            a->rate = get32(&h[4]);
+            bits = get16(&h[14]);
+            if(tag == WAV_EXTENSIBLE && size >= 26)
+                tag = get16(&h[24]);
+            size = size > sizeof(h) ? size - sizeof(h) : 0;
+            fmt = 1;
+        }
+
+        /* Chunks are padded to an even size */
+        for(size += size & 1; size > 0; size--)
+        {
+            if(fgetc(a->file) == EOF)
+                return -1;
+        }
+    }
+
+    if(!fmt)
+    {
+        fprintf(stderr, "%s: data before the fmt chunk\n", path);
+        return -1;
+    }
+
+    if(tag == WAV_PCM && (bits == 16 || bits == 24 || bits == 32))
+        a->format = bits == 16 ? AUDIO_S16 : bits == 24 ? AUDIO_S24 : AUDIO_S32;
+    else if(tag == WAV_FLOAT && bits == 32)
+        a->format = AUDIO_F32;
+    else
+    {
+        fprintf(stderr, "%s: format %u with %u bits not supported\n", path, tag, bits);
+        return -1;
+    }
+
+    if(a->channels < 1)
+        return -1;
+
+    a->data_frames = size == 0 || size == 0xFFFFFFFFu ? -1 :
+                     (long long)(size / (a->channels * audio_sample_bytes(a->format)));
+    return 0;
+}
+
+int audio_open_read(audio_file *a, const char *path)
+{
+    size_t n;
+
+    a->file = strcmp(path, "-") == 0 ? stdin : fopen(path, "rb");
+    if(a->file == NULL)
+    {
+        fprintf(stderr, "cannot open %s\n", path);
+        return -1;
+    }
+    a->frames = 0;
+    a->data_frames = -1;
+    a->data_start = -1;
+    a->buffer = NULL;
+    a->prefix_bytes = 0;
+
+    /* Raw data keeps what was read as its first samples, so that pipes work
+     * without seeking back */
+    n = fread(a->prefix, 1, sizeof(a->prefix), a->file);
+    a->wav = n == sizeof(a->prefix) && memcmp(a->prefix, "RIFF", 4) == 0 &&
+             memcmp(&a->prefix[8], "WAVE", 4) == 0;
+
+    if(!a->wav)
+        a->prefix_bytes = (int)n;
+    else if(read_wav_header(a, path) != 0)
+    {
+        fprintf(stderr, "%s: broken WAV header\n", path);
+        return -1;
+    }
+
+    return allocate(a);
+}
+
+static int to_fixed(audio_format format, const unsigned char *p)
+{
+    float f;
+
+    switch(format)
+    {
+    case AUDIO_S16:
+        return (int)(get16(p) << 16);
+    case AUDIO_S24:
+        return (int)((p[0] << 8) | (p[1] << 16) | ((unsigned int)p[2] << 24));
+    case AUDIO_S32:
+        return (int)get32(p);
+    default:
+        {
+            unsigned int u = get32(p);
+            memcpy(&f, &u, sizeof(f));
+        }
+        return __builtin_conv_FtoR(f);
+    }
+}
+
+int audio_read(audio_file *a, int *frames, int count)
+{
+    int bytes = a->channels * audio_sample_bytes(a->format);
+    int done = 0, n, i;
+
+    if(a->data_frames >= 0 && count > a->data_frames - a->frames)
+        count = (int)(a->data_frames - a->frames);
+
+    while(done < count)
+    {
+        n = count - done < a->buffer_frames ? count - done : a->buffer_frames;
+
+        /* A partial frame at the end of the data is dropped */
+        memcpy(a->buffer, a->prefix, a->prefix_bytes);
+        n = (int)((a->prefix_bytes + fread(&a->buffer[a->prefix_bytes], 1, n * bytes - a->prefix_bytes,
+                                           a->file)) / bytes);
+        a->prefix_bytes = 0;
+        if(n == 0)
+            break;
+
+        for(i = 0; i < n * a->channels; i++)
+            frames[done * a->channels + i] = to_fixed(a->format, &a->buffer[i * audio_sample_bytes(a->format)]);
+        done += n;
+    }
+
+    if(done == 0 && ferror(a->file))
+    {
+        perror("read");
+        return -1;
+    }
+
+    a->frames += done;
+    return done;
+}
+
+/*-------------------------------------------------------------------------------*/
+/* Writing */
+
+static void write_wav_header(audio_file *a, unsigned char *h, unsigned int data_bytes)
+{
+    int bytes = audio_sample_bytes(a->format);
+
+    memcpy(&h[0], "RIFF", 4);
+    put32(&h[4], data_bytes == 0xFFFFFFFFu ? data_bytes : 36 + data_bytes);
+    memcpy(&h[8], "WAVEfmt ", 8);
+    put32(&h[16], 16);
+    put16(&h[20], a->format == AUDIO_F32 ? WAV_FLOAT : WAV_PCM);
+    put16(&h[22], a->channels);
+    put32(&h[24], a->rate);
+    put32(&h[28], a->rate * a->channels * bytes);
+    put16(&h[32], a->channels * bytes);
+    put16(&h[34], 8 * bytes);
+    memcpy(&h[36], "data", 4);
+    put32(&h[40], data_bytes);
+}
+
+int audio_open_write(audio_file *a, const char *path, int wav)
+{
+    unsigned char h[44];
+
+    a->file = strcmp(path, "-") == 0 ? stdout : fopen(path, "wb");
+    if(a->file == NULL)
+    {
+        fprintf(stderr, "cannot create %s\n", path);
+        return -1;
+    }
+    a->wav = wav;
+    a->frames = 0;
+    a->data_frames = -1;
+    a->data_start = -1;
+    a->buffer = NULL;
+
+    if(wav)
+    {
+        /* Sizes unknown until audio_close(), which patches them in */
+        write_wav_header(a, h, 0xFFFFFFFFu);
+        if(fwrite(h, 1, sizeof(h), a->file) != sizeof(h))
+            return -1;
+        a->data_start = a->file == stdout ? -1 : (long)sizeof(h);
+    }
+
+    return allocate(a);
+}
+
+static void from_fixed(audio_format format, int x, unsigned char *p)
+{
+    long long r;
+    float f;
+    unsigned int u;
+
+    switch(format)
+    {
+    case AUDIO_S16:
+    case AUDIO_S24:
+        /* Round to nearest, saturating at the top */
+        r = ((long long)x + (format == AUDIO_S16 ? 0x8000 : 0x80)) >> (format == AUDIO_S16 ? 16 : 8);
+        if(format == AUDIO_S16)
+        {
+            put16(p, r > SHRT_MAX ? SHRT_MAX : (int)r);
+        }
+        else
+        {
+            r = r > 0x7FFFFF ? 0x7FFFFF : r;
+            p[0] = r;
+            p[1] = r >> 8;
+            p[2] = r >> 16;
+        }
+        break;
+    case AUDIO_S32:
+        put32(p, (unsigned int)x);
+        break;
+    default:
+        f = __builtin_conv_RtoF(x);
+        memcpy(&u, &f, sizeof(u));
+        put32(p, u);
+        break;
+    }
+}
+
+int audio_write(audio_file *a, const int *frames, int count)
+{
+    int bytes = audio_sample_bytes(a->format);
+    int done = 0, n, i;
+
+    while(done < count)
+    {
+        n = count - done < a->buffer_frames ? count - done : a->buffer_frames;
+
+        for(i = 0; i < n * a->channels; i++)
+            from_fixed(a->format, frames[done * a->channels + i], &a->buffer[i * bytes]);
+
+        if(fwrite(a->buffer, bytes * a->channels, n, a->file) != (size_t)n)
+        {
+            perror("write");
+            return -1;
+        }
+        done += n;
+    }
+
+    a->frames += count;
+    return 0;
+}
+
+int audio_close(audio_file *a)
+{
+    unsigned char h[44];
+    long long data_bytes = a->frames * a->channels * audio_sample_bytes(a->format);
+    int failed = 0;
+
+    /* Written files larger than a RIFF chunk keep the streaming sizes */
+    if(a->wav && a->data_start >= 0 && data_bytes < 0xFFFFFFFFll - 36)
+    {
+        write_wav_header(a, h, (unsigned int)data_bytes);
+        if(fseek(a->file, 0, SEEK_SET) != 0 || fwrite(h, 1, sizeof(h), a->file) != sizeof(h))
+            failed = 1;
+    }
+
+    free(a->buffer);
+    a->buffer = NULL;
+
+    if(a->file != stdin && a->file != stdout)
+        failed |= fclose(a->file) != 0;
+    else
+        failed |= fflush(a->file) != 0;
+    a->file = NULL;
+
+    if(failed)
+        fprintf(stderr, "cannot complete the output file\n");
+    return failed ? -1 : 0;
+}
@@ -0,0 +1,64 @@
+/*
+ * NAME:     audio_io.h
+ * PURPOSE:  Interleaved audio files for the host tools: WAV or headerless
+ *           raw samples, read and written in chunks as 1.31 frames.
+ * USAGE:    audio_open_read() a file or "-" for stdin, audio_read() frames
+ *           until it returns 0, audio_close(). Writing mirrors it; a WAV
+ *           header is completed on audio_close() when the file can seek.
+ */
+#ifndef _audio_io_H_
+#define _audio_io_H_
+
+#include <stdio.h>
+
+typedef enum {
+    AUDIO_S16,
+    AUDIO_S24,
+    AUDIO_S32,
+    AUDIO_F32
+} audio_format;
+
+typedef struct {
+    FILE *file;
+    int wav;                    /* RIFF/WAVE header, otherwise raw */
+    audio_format format;
+    int channels;
+    int rate;
+    long long frames;           /* frames read or written so far */
+    long long data_frames;      /* frames in the WAV data chunk, -1 if unknown */
+    long data_start;            /* offset of the data chunk, -1 if unseekable */
+    unsigned char *buffer;
+    int buffer_frames;
+    unsigned char prefix[12];   /* raw samples read while looking for a header */
+    int prefix_bytes;
+} audio_file;
+
+/* Bytes per sample of a format */
+int audio_sample_bytes(audio_format format);
+
+/* Format of a name as given on the command line: s16, s24, s32 or f32.
+ * Returns -1 for an unknown name. */
+int audio_parse_format(const char *name);
+
+/* Opens path for reading, "-" for stdin. A RIFF/WAVE header sets the format,
+ * channels and rate; otherwise the data is raw and they are taken from a.
+ * Returns 0, or -1 with a message on stderr. */
+int audio_open_read(audio_file *a, const char *path);
+
+/* Creates path, "-" for stdout, with the format, channels and rate in a;
+ * wav selects a WAVE header. Returns 0, or -1 with a message on stderr. */
+int audio_open_write(audio_file *a, const char *path, int wav);
+
+/* Reads up to count frames of a->channels 1.31 samples into frames.
+ * Returns the frames read, 0 at the end of the data, -1 on error. */
+int audio_read(audio_file *a, int *frames, int count);
+
+/* Writes count frames of a->channels 1.31 samples, rounded and saturated to
+ * the format. Returns 0, or -1 on error. */
+int audio_write(audio_file *a, const int *frames, int count);
+
+/* Completes the WAV header of a written file and closes it. Returns 0, or -1
+ * on error. */
+int audio_close(audio_file *a);
+
+#endif /* _audio_io_H_ */
@@ -0,0 +1,137 @@
+/*
+ * NAME:     emu_blocksize.c
+ * PURPOSE:  fir_emu blocksize mode.
+ * USAGE:    fir_emu blocksize [data directory] [samples]
+ *
+ *           Streams the same number of samples of noise through the codec
+ *           path at every power of two block size from MIN_BLOCK_SAMPLES to
+ *           MAX_BLOCK_SAMPLES and reports the time per block and per sample.
+ *           A least squares line through the block times splits them into
+ *           a fixed overhead per block and a cost per sample; the table shows
+ *           the share of the overhead at each size next to the buffering
+ *           latency at 48 kHz.
+ *
+ *           Each size runs in a child process, like a fresh boot of the
+ *           target, since the block size is chosen once by initBlockMemory().
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "ADDS_21479_EzKit.h"
+#include "sharc_emu.h"
+#include "emu_codec.h"
+#include "emu_util.h"
+#include "fir_emu.h"
+
+#define WARMUP_BLOCKS   16
+#define MAX_SIZES       16
+
+/* Seconds per block of one block size */
+static double time_blocks(int samples, long total)
+{
+    static int rx[RX_BLOCK_MAX], txa[TX_BLOCK_MAX], txb[TX_BLOCK_MAX];
+    long blocks = total / samples;
+    unsigned int seed = 1;
+    double t0, t1;
+    long b;
+    int i;
+
+    emu_codec_init(samples);
+
+    for(i = 0; i < RX_BLOCK_SIZE; i++)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        rx[i] = (int)seed >> 2;
+    }
+
+    for(b = 0; b < WARMUP_BLOCKS; b++)
+        emu_codec_block(rx, txa, txb);
+
+    t0 = emu_seconds();
+    for(b = 0; b < blocks; b++)
+        emu_codec_block(rx, txa, txb);
+    t1 = emu_seconds();
+
+    return (t1 - t0) / blocks;
+}
+
+/* Runs time_blocks() in a child process, -1 when it fails */
+static double time_boot(int samples, long total)
+{
+    double t = -1.0;
+    int fd[2], status;
+    pid_t pid;
+
+    if(pipe(fd) != 0)
+        return -1.0;
+
+    pid = fork();
+    if(pid == 0)
+    {
+        close(fd[0]);
+        t = time_blocks(samples, total);
+        _exit(write(fd[1], &t, sizeof(t)) == sizeof(t) ? 0 : 1);
+    }
+
+    close(fd[1]);
+    if(pid > 0 && read(fd[0], &t, sizeof(t)) != sizeof(t))
+        t = -1.0;
+    close(fd[0]);
+
+    if(pid > 0)
+        waitpid(pid, &status, 0);
+
+    return t;
+}
+
+int emu_blocksize(const char *dir, int argc, char *argv[])
+{
+    long total = argc > 0 ? atol(argv[0]) : 1L << 19;
+    double seconds[MAX_SIZES];
+    int sizes[MAX_SIZES];
+    double sx = 0, sy = 0, sxx = 0, sxy = 0, overhead, per_sample;
+    int count = 0, n, i;
+
+    (void)dir;
+
+    for(n = MIN_BLOCK_SAMPLES; n <= MAX_BLOCK_SAMPLES && count < MAX_SIZES; n *= 2)
+    {
+        sizes[count] = n;
+        seconds[count] = time_boot(n, total);
+        if(seconds[count] < 0)
+        {
+            printf("block size %d failed\n", n);
+            return 1;
+        }
+        count++;
+    }
+
+    /* block time = overhead + n * per_sample */
+    for(i = 0; i < count; i++)
+    {
+        sx += sizes[i];
+        sy += seconds[i];
+        sxx += (double)sizes[i] * sizes[i];
+        sxy += sizes[i] * seconds[i];
+    }
+    per_sample = (count * sxy - sx * sy) / (count * sxx - sx * sx);
+    overhead = (sy - per_sample * sx) / count;
+
+    printf("%ld samples per size, %s processing, %d SPORT DMA buffers\n", total,
+           FFT_CONVOLUTION ? "FFT convolution" : PIPELINED_PROCESSING ? "pipelined" : "sequential",
+           SPORT_DMA_BUFFERS);
+    printf("%7s %12s %12s %10s %12s\n", "block", "us/block", "ns/sample", "overhead", "latency ms");
+
+    for(i = 0; i < count; i++)
+    {
+        printf("%7d %12.2f %12.2f %9.1f%% %12.2f\n", sizes[i], seconds[i] * 1e6,
+               seconds[i] / sizes[i] * 1e9, overhead > 0 ? 100.0 * overhead / seconds[i] : 0.0,
+               1e3 * (SPORT_DMA_BUFFERS + EMU_CODEC_LATENCY) * sizes[i] / 48000.0);
+    }
+
+    printf("per block overhead %.2f us, per sample %.2f ns\n", overhead * 1e6, per_sample * 1e9);
+
+    return 0;
+}
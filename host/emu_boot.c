@@ -0,0 +1,174 @@
+/*
+ * NAME:     emu_boot.c
+ * PURPOSE:  fir_emu boot mode.
+ * USAGE:    fir_emu boot [data directory] [csv file]
+ *
+ *           Boots the way main() does, initPLL() to initIIR(), against the
+ *           emulated registers, SPI port and AD1939, then streams blocks of
+ *           noise until the first one is out of handleCodecData(), and prints
+ *           bootTimeline: the start and length of each phase and the time to
+ *           the first block, with the NOP() cycles the emulation ran in each.
+ *           Given a file name, it writes the same timeline there as CSV.
+ *           Checks that the timeline is complete and its phases in order.
+ *           Times are time stamp counter ticks on the host; the NOP() cycles
+ *           are the waits the target spends in the peripherals, the SPI and
+ *           PLL waits of the codec and, with FAST_BOOT, of initPLL(). Build
+ *           with -DFAST_BOOT=1 for the fast boot.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "ADDS_21479_EzKit.h"
+#include "sharc_emu.h"
+#include "emu_codec.h"
+#include "fir_emu.h"
+
+/* Blocks streamed at most before the first has to be out */
+#define BOOT_MAX_BLOCKS     4
+
+static const char *phase_names[BOOT_PHASES] = {
+    "pll", "extmem", "dai", "codec", "memory", "sport", "filters", "first_block"
+};
+
+/* NOP() cycles of the emulation at the end of each phase */
+static unsigned long long nops[BOOT_PHASES];
+
+static void phase_end(int p)
+{
+    bootPhaseEnd(p);
+    nops[p] = ad1939_emu_statistics.cycles;
+}
+
+int emu_boot(const char *dir, int argc, char *argv[])
+{
+    static int rx[RX_BLOCK_MAX], txa[TX_BLOCK_MAX], txb[TX_BLOCK_MAX];
+    const char *csv = argc > 0 ? argv[0] : NULL;
+    unsigned long long last_nops = 0;
+    unsigned int seed = 1, end = 0;
+    FILE *f = NULL;
+    int failed = 0;
+    int b, i, p;
+
+    (void)dir;
+
+    emu_reset();
+
+    /* main() */
+    bootStart();
+
+    bootPhaseBegin(BOOT_PLL);
+    initPLL();
+    phase_end(BOOT_PLL);
+
+    bootPhaseBegin(BOOT_EXTMEM);
+    initExternalMemory();
+    phase_end(BOOT_EXTMEM);
+
+    bootPhaseBegin(BOOT_DAI);
+    initDAI();
+    phase_end(BOOT_DAI);
+
+    bootPhaseBegin(BOOT_CODEC);
+    if(init1939viaSPI() != 0)
+    {
+        bootPhaseFallback(BOOT_CODEC);
+        if(init1939Polled() != 0)
+        {
+            // main() would halt here
+            printf("init1939viaSPI and init1939Polled failed\n");
+            bootTimeline.halted = BOOT_CODEC;
+            failed = 1;
+        }
+    }
+    phase_end(BOOT_CODEC);
+
+    bootPhaseBegin(BOOT_MEMORY);
+    if(initBlockMemory(NUM_SAMPLES) != 0)
+    {
+        fprintf(stderr, "block size %d not supported\n", NUM_SAMPLES);
+        return 2;
+    }
+    phase_end(BOOT_MEMORY);
+
+    bootPhaseBegin(BOOT_SPORT);
+    initSPORT();
+    phase_end(BOOT_SPORT);
+
+    bootPhaseBegin(BOOT_FILTERS);
+    adi_int_InstallHandler(ADI_CID_P3I, TalkThroughISR, 0, true);
+    if(initFIR() != 0)
+    {
+        // main() would halt here
+        printf("initFIR failed\n");
+        bootTimeline.halted = BOOT_FILTERS;
+        return 1;
+    }
+    initIIR();
+    phase_end(BOOT_FILTERS);
+
+    bootPhaseBegin(BOOT_FIRST_BLOCK);
+    for(b = 0; b < BOOT_MAX_BLOCKS && !(bootTimeline.ended & (1 << BOOT_FIRST_BLOCK)); b++)
+    {
+        for(i = 0; i < RX_BLOCK_SIZE; i++)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            rx[i] = (int)seed >> 2;
+        }
+        emu_codec_block(rx, txa, txb);
+    }
+    nops[BOOT_FIRST_BLOCK] = ad1939_emu_statistics.cycles;
+
+    if(csv != NULL && (f = fopen(csv, "w")) == NULL)
+    {
+        perror(csv);
+        return 2;
+    }
+
+    printf("%s boot, %d samples per block, time stamp counter ticks\n",
+           bootTimeline.fast ? "fast" : "original", NUM_SAMPLES);
+    printf("%-12s %12s %12s %12s\n", "phase", "begin", "ticks", "NOP cycles");
+    if(f != NULL)
+        fprintf(f, "phase,begin,ticks,nop_cycles\n");
+
+    for(p = 0; p < BOOT_PHASES; p++)
+    {
+        const boot_phase *ph = &bootTimeline.phase[p];
+
+        printf("%-12s %12u %12u %12llu\n", phase_names[p], ph->begin, ph->cycles, nops[p] - last_nops);
+        if(f != NULL)
+            fprintf(f, "%s,%u,%u,%llu\n", phase_names[p], ph->begin, ph->cycles, nops[p] - last_nops);
+
+        /* Each phase starts after the last one ended */
+        if(!(bootTimeline.ended & (1 << p)) || ph->begin < end)
+        {
+            printf("phase %s %s\n", phase_names[p],
+                   bootTimeline.ended & (1 << p) ? "out of order" : "never ended");
+            failed = 1;
+        }
+        end = ph->begin + ph->cycles;
+        last_nops = nops[p];
+    }
+
+    printf("%-12s %12u %12s %12llu\n", "to_audio", bootTimeline.to_audio, "", last_nops);
+    if(f != NULL)
+    {
+        fprintf(f, "to_audio,0,%u,%llu\n", bootTimeline.to_audio, last_nops);
+        failed |= fclose(f) != 0;
+    }
+
+    for(p = 0; p < BOOT_PHASES; p++)
+    {
+        if(bootTimeline.fallback & (1 << p))
+            printf("phase %s fell back to its slower path\n", phase_names[p]);
+    }
+
+    if(bootTimeline.to_audio != end || bootTimeline.fast != FAST_BOOT)
+    {
+        printf("time to the first block %u, last phase ended at %u\n", bootTimeline.to_audio, end);
+        failed = 1;
+    }
+
+    if(failed)
+        printf("FAILED\n");
+    return failed;
+}
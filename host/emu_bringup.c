@@ -0,0 +1,131 @@
+/*
+ * NAME:     emu_bringup.c
+ * PURPOSE:  fir_emu bringup mode.
+ * USAGE:    fir_emu bringup [data directory] [lock us]
+ *
+ *           Codec bring-up of init1939viaSPI.c against the SPI port and AD1939
+ *           model of ad1939_emu.c, with a PLL that locks lock us (default
+ *           500) after its power-up: the original polled bring-up, and the
+ *           fast one with and without the read-back. Prints the emulated time
+ *           each takes at the core clock, to the PLL power-up and in all, the
+ *           SPI transactions, reads, writes and words, and the PLL lock
+ *           polls, and checks the codec's registers against the table. The
+ *           fast bring-up then has to fail on a codec that loses the writes
+ *           to one register when it reads back, and within CODEC_LOCK_TIMEOUT
+ *           on a PLL that never locks, the original one after
+ *           CODEC_POLLED_LOCK_POLLS polls.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ADDS_21479_EzKit.h"
+#include "sharc_emu.h"
+#include "fir_emu.h"
+
+/* Core clock initPLL() sets */
+#define BRINGUP_CCLK_MHZ    266.0
+
+/* Register the faulty codec loses */
+#define BRINGUP_FAULT_REG   ADCCTRL2
+
+/* Registers the codec should end up with */
+static unsigned char expected[AD1939_EMU_REGS];
+
+/* One bring-up from reset, returns 1 when its result, its registers or its
+ * transaction count is not what is expected */
+static int run(const char *name, int fast, bool verify, int expect_result, int expect_regs,
+               double *us)
+{
+    ad1939_emu_stats s;
+    unsigned long long frames;
+    int result, regs, bad;
+
+    emu_reset();
+    LockCount = 0;
+
+    result = fast ? init1939Batched(verify) : init1939Polled();
+
+    s = ad1939_emu_statistics;
+    regs = memcmp(ad1939_emu_regs, expected, sizeof(expected)) == 0;
+    *us = s.cycles / BRINGUP_CCLK_MHZ;
+
+    /* Every register written, read back or polled once, except that a
+     * failing bring-up stops early */
+    if(fast)
+        frames = ConfigEntries1939 + (verify ? ConfigEntries1939 : 0) + 1 + LockCount;
+    else
+        frames = 2 * ConfigEntries1939 + 1 + LockCount;
+
+    bad = result != expect_result || regs != expect_regs || s.ignored != 0 ||
+          s.frames != s.reads + s.writes || (result == 0 && s.frames != frames);
+
+    printf("%-24s %6d %9.1f %9.1f %7llu %6llu %6llu %6llu %6d %5s%s\n", name, result,
+           s.power_cycle / BRINGUP_CCLK_MHZ, *us, s.frames, s.reads, s.writes, s.words, LockCount + 1,
+           regs ? "ok" : "diff", bad ? "  FAILED" : "");
+
+    return bad;
+}
+
+int emu_bringup(const char *dir, int argc, char *argv[])
+{
+    double lock_us = argc > 0 ? atof(argv[0]) : 500.0;
+    double polled, fast, fast_verify, us;
+    unsigned long long cycles;
+    int failed = 0;
+    int i;
+
+    (void)dir;
+
+    if(lock_us < 0.0)
+    {
+        fprintf(stderr, "usage: fir_emu bringup [dir] [lock us]\n");
+        return 2;
+    }
+
+    memset(expected, 0, sizeof(expected));
+    for(i = 0; i < ConfigEntries1939; i++)
+        expected[ConfigParam1939[3*i+1]] = ConfigParam1939[3*i+2];
+
+    ad1939_emu_lock_cycles = (unsigned long long)(lock_us * BRINGUP_CCLK_MHZ);
+    ad1939_emu_fault_reg = -1;
+
+    printf("%d register writes, PLL lock %.0f us, %.0f MHz core clock\n", ConfigEntries1939, lock_us,
+           BRINGUP_CCLK_MHZ);
+    printf("%-24s %6s %9s %9s %7s %6s %6s %6s %6s %5s\n", "bring-up", "result", "PLL up us", "us",
+           "frames", "reads", "writes", "words", "polls", "regs");
+
+    failed |= run("polled", 0, true, 0, 1, &polled);
+    failed |= run("batched", 1, false, 0, 1, &fast);
+    failed |= run("batched, read back", 1, true, 0, 1, &fast_verify);
+
+    /* The read-back is what catches a lost write */
+    ad1939_emu_fault_reg = BRINGUP_FAULT_REG;
+    failed |= run("lost write", 1, false, 0, 0, &us);
+    failed |= run("lost write, read back", 1, true, -1, 0, &us);
+    ad1939_emu_fault_reg = -1;
+
+    /* Nothing is enabled without the lock, and the wait ends on time */
+    ad1939_emu_lock_cycles = ~0ull;
+    failed |= run("no PLL lock", 1, false, -1, 0, &us);
+    cycles = ad1939_emu_statistics.cycles;
+    failed |= run("polled, no PLL lock", 0, true, -1, 0, &us);
+    ad1939_emu_lock_cycles = (unsigned long long)(lock_us * BRINGUP_CCLK_MHZ);
+
+    /* The timeout plus the SPI traffic and at most one more backoff */
+    if(cycles > CODEC_LOCK_TIMEOUT + CODEC_LOCK_BACKOFF_MAX +
+                8ull * AD1939_SPIBAUD_FAST * ad1939_emu_statistics.bits +
+                64ull * ad1939_emu_statistics.frames)
+    {
+        printf("lock timeout took %llu cycles, more than CODEC_LOCK_TIMEOUT %d allows\n", cycles,
+               CODEC_LOCK_TIMEOUT);
+        failed = 1;
+    }
+
+    printf("batched %.1fx faster than polled, %.1fx with the read-back\n", polled / fast,
+           polled / fast_verify);
+
+    if(failed)
+        printf("FAILED\n");
+    return failed;
+}
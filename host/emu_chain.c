@@ -0,0 +1,237 @@
+/*
+ * NAME:     emu_chain.c
+ * PURPOSE:  fir_emu chain mode.
+ * USAGE:    fir_emu chain
+ *
+ *           Checks the TCB chain builder of firChain.c: the FIRCTL1/FIRCTL2
+ *           values, the configurations it has to refuse, and chains of 1 to
+ *           FIR_MAX_CHANNELS channels of mixed tap counts that are run on the
+ *           emulated accelerator for several iterations, started once per
+ *           iteration or auto-iterating, against a double precision reference.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "ADDS_21479_EzKit.h"
+#include "sharc_emu.h"
+#include "emu_util.h"
+#include "fir_emu.h"
+
+/* Single precision accumulation of up to FIR_MAX_TAPS products */
+#define CHAIN_TOLERANCE     1e-5
+
+typedef struct {
+    const char *name;
+    int channels;
+    int max_taps;           /* the first channel, the others are shorter */
+    int window;
+    int iterations;
+    bool auto_iterate;
+} chain_case;
+
+static const chain_case cases[] = {
+    { "single tap",          1,                1,            1,              3, false },
+    { "largest channel",     1,                FIR_MAX_TAPS, FIR_MAX_WINDOW, 2, false },
+    { "two AIN1 channels",   2,                TAPSIZE2,     NUM_SAMPLES,    3, false },
+    { "four ADC inputs",     4,                FIR_MAX_TAPS, NUM_SAMPLES,    3, false },
+    { "odd channel count",   7,                300,          100,            3, false },
+    { "channel limit",       FIR_MAX_CHANNELS, 128,          64,             3, false },
+    { "auto iterate",        4,                TAPSIZE1,     NUM_SAMPLES,    4, true  },
+};
+
+#define NUM_CASES (int)(sizeof(cases) / sizeof(cases[0]))
+
+/* State of emu_noise() */
+static unsigned int seed = 1;
+
+static int check(const char *what, int ok)
+{
+    if(!ok)
+        printf("  %s FAILED\n", what);
+    return !ok;
+}
+
+static int check_registers(void)
+{
+    static fir_channel_config config[2];
+    static float buf[FIR_MAX_TAPS + FIR_MAX_WINDOW];
+    static fir_chain chain;
+    int failed = 0;
+    int i;
+
+    failed |= check("FIRCTL2 for 65 taps, window 256",
+                    firChainCtl2(65, 256, 1, false) == (64 | (255 << FIRCTL2_WINDOW_SHIFT)));
+    failed |= check("FIRCTL2 for 1 tap, window 1", firChainCtl2(1, 1, 1, false) == 0);
+    failed |= check("FIRCTL2 round trip at the limits",
+                    FIRCTL2_GET_TAPS(firChainCtl2(FIR_MAX_TAPS, FIR_MAX_WINDOW, 1, false)) == FIR_MAX_TAPS &&
+                    FIRCTL2_GET_WINDOW(firChainCtl2(FIR_MAX_TAPS, FIR_MAX_WINDOW, 1, false)) == FIR_MAX_WINDOW);
+    failed |= check("FIRCTL2 refuses 0 or too many taps",
+                    firChainCtl2(0, 256, 1, false) == -1 && firChainCtl2(FIR_MAX_TAPS + 1, 256, 1, false) == -1);
+    failed |= check("FIRCTL2 refuses an empty or too long window",
+                    firChainCtl2(65, 0, 1, false) == -1 && firChainCtl2(65, FIR_MAX_WINDOW + 1, 1, false) == -1);
+
+    failed |= check("FIRCTL1 for 4 channels",
+                    firChainCtl1(4, false) == (FIR_EN | FIR_DMAEN | FIR_CH4));
+    failed |= check("FIRCTL1 for 32 auto-iterating channels",
+                    firChainCtl1(32, true) == (FIR_EN | FIR_DMAEN | FIR_CH32 | FIR_CAI));
+    failed |= check("FIRCTL1 refuses 0 or 33 channels",
+                    firChainCtl1(0, false) == -1 && firChainCtl1(FIR_MAX_CHANNELS + 1, false) == -1);
+
+    for(i = 0; i < 2; i++)
+    {
+        config[i].taps = 65;
+        config[i].window = 256;
+        config[i].coeffs = buf;
+        config[i].in = buf;
+        config[i].in_length = 65 - 1 + 256;
+        config[i].out = buf;
+        config[i].ratio = 1;
+        config[i].upsample = false;
+    }
+
+    chain.channels = -1;
+    failed |= check("build of a valid chain", firChainBuild(&chain, config, 2, false) == 0 &&
+                    chain.channels == 2 && chain.firctl1 == firChainCtl1(2, false));
+
+    config[1].in_length--;
+    chain.channels = -1;
+    failed |= check("build refuses an input buffer without room for the history",
+                    firChainBuild(&chain, config, 2, false) == -1 && chain.channels == -1);
+    config[1].in_length++;
+
+    config[1].taps = FIR_MAX_TAPS + 1;
+    failed |= check("build refuses a channel over the tap limit",
+                    firChainBuild(&chain, config, 2, false) == -1 && chain.channels == -1);
+
+    failed |= check("build refuses 0 channels", firChainBuild(&chain, config, 0, false) == -1);
+
+    printf("register values and refused configurations %s\n", failed ? "FAILED" : "ok");
+    return failed;
+}
+
+static int run_case(const chain_case *tc)
+{
+    static fir_channel_config config[FIR_MAX_CHANNELS];
+    static fir_chain chain;
+    float *coeffs[FIR_MAX_CHANNELS], *in[FIR_MAX_CHANNELS], *out[FIR_MAX_CHANNELS];
+    float *x;
+    double *ref;
+    double err = 0.0, e;
+    unsigned long long iterations;
+    int failed = 0;
+    int min_taps = FIR_MAX_TAPS;
+    int c, k, n;
+
+    for(c = 0; c < tc->channels; c++)
+    {
+        fir_channel_config *cfg = &config[c];
+        int taps = c == 0 ? tc->max_taps : 1 + (int)((emu_noise(&seed) + 1.0f) * 0.5f * (tc->max_taps - 1));
+        int length = tc->iterations * tc->window;
+
+        /* The windows of every iteration, then the zero history */
+        coeffs[c] = malloc(taps * sizeof(float));
+        in[c] = calloc(length + taps - 1, sizeof(float));
+        out[c] = malloc(length * sizeof(float));
+
+        for(n = 0; n < taps; n++)
+            coeffs[c][n] = emu_noise(&seed) * 0.5f / sqrtf((float)taps);
+        for(n = 0; n < length; n++)
+            in[c][n] = emu_noise(&seed) * 0.5f;
+
+        cfg->taps = taps;
+        cfg->window = tc->window;
+        cfg->coeffs = coeffs[c];
+        cfg->in = in[c];
+        cfg->in_length = length + taps - 1;
+        cfg->out = out[c];
+        cfg->ratio = 1;
+        cfg->upsample = false;
+
+        if(taps < min_taps)
+            min_taps = taps;
+    }
+
+    emu_reset();
+    *pPMCTL1 |= FIRACCSEL;
+    emu_completion_init();
+
+    failed |= check("build", firChainBuild(&chain, config, tc->channels, tc->auto_iterate) == 0);
+    failed |= check("ring", chain.tcb[tc->channels - 1][FIR_TCB_CP] == FIR_TCB_LINK(chain.tcb[0]));
+    if(failed)
+        return 1;
+
+    iterations = fir_accel_statistics.iterations;
+
+    if(tc->auto_iterate)
+    {
+        /* One kick, the outputs of every pass land in the same window */
+        firChainStart(&chain);
+        emu_completion_wait(tc->iterations);
+    }
+    else
+    {
+        for(k = 0; k < tc->iterations; k++)
+        {
+            for(c = 0; c < tc->channels; c++)
+                firChainSetOutput(&chain, c, out[c] + k * tc->window);
+
+            firChainStart(&chain);
+            emu_completion_wait(k + 1);
+        }
+    }
+
+    failed |= check("one completion interrupt per iteration",
+                    emu_completions == tc->iterations &&
+                    fir_accel_statistics.iterations - iterations == (unsigned long long)tc->iterations);
+    failed |= check("chain pointer back at the first channel", *pCPFIR == FIR_TCB_LINK(chain.tcb[0]));
+
+    for(c = 0; c < tc->channels; c++)
+    {
+        int taps = config[c].taps;
+        int length = tc->iterations * tc->window;
+        int first = tc->auto_iterate ? length - tc->window : 0;
+
+        /* History of zeros in front of the stream */
+        x = calloc(length + taps - 1, sizeof(float));
+        ref = malloc(length * sizeof(double));
+        for(n = 0; n < length; n++)
+            x[taps - 1 + n] = in[c][n];
+
+        emu_reference_fir(x, coeffs[c], taps, ref, length);
+        e = emu_max_error(tc->auto_iterate ? out[c] : out[c] + first, ref + first, length - first);
+        if(e > err)
+            err = e;
+
+        free(x);
+        free(ref);
+        free(coeffs[c]);
+        free(in[c]);
+        free(out[c]);
+    }
+
+    failed |= check("output", err <= CHAIN_TOLERANCE);
+
+    printf("%-18s %2d channels, %4d..%4d taps, window %4d, %d %s: max error %.3g %s\n",
+           tc->name, tc->channels, min_taps, tc->max_taps, tc->window, tc->iterations,
+           tc->auto_iterate ? "auto iterations" : "starts", err, failed ? "FAILED" : "ok");
+
+    return failed;
+}
+
+int emu_chain(const char *dir, int argc, char *argv[])
+{
+    int failed = 0;
+    int i;
+
+    (void)dir;
+    (void)argc;
+    (void)argv;
+
+    failed |= check_registers();
+
+    for(i = 0; i < NUM_CASES; i++)
+        failed |= run_case(&cases[i]);
+
+    return failed;
+}
@@ -0,0 +1,62 @@
+/*
+ * NAME:     emu_codec.c
+ * PURPOSE:  AD1939 side of the host emulation.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ADDS_21479_EzKit.h"
+#include "sharc_emu.h"
+#include "emu_codec.h"
+
+long emu_codec_current = -1;
+
+static long emu_codec_blocks = 0;
+
+void emu_codec_init(int samples)
+{
+    emu_reset();
+    if(initBlockMemory(samples) != 0)
+    {
+        fprintf(stderr, "block size %d not supported\n", samples);
+        exit(2);
+    }
+    initSPORT();
+    adi_int_InstallHandler(ADI_CID_P3I, TalkThroughISR, 0, true);
+    if(initFIR() != 0)
+    {
+        fprintf(stderr, "initFIR failed\n");
+        exit(2);
+    }
+    initIIR();
+
+    emu_codec_current = -1;
+    emu_codec_blocks = 0;
+}
+
+void emu_codec_block(const int *rx, int *txa, int *txb)
+{
+    /* SPORT1 DMA fills the buffer after the last completed one */
+    int buffer = blockRing.head % SPORT_DMA_BUFFERS;
+    int last;
+
+    memcpy(RxBlock_A[buffer], rx, RX_BLOCK_SIZE * sizeof(int));
+    emu_raise(ADI_CID_P3I);
+
+    /* Body of the main loop, until the ring is empty */
+    last = -1;
+    while((buffer = blockRingNext()) >= 0)
+    {
+        emu_codec_current = emu_codec_blocks;
+        handleCodecData(buffer);
+        emu_codec_current = -1;
+        last = buffer;
+    }
+    if(last < 0)
+        last = (blockRing.head - 1) % SPORT_DMA_BUFFERS;
+    emu_codec_blocks++;
+
+    memcpy(txa, TxBlock_A[last], TX_BLOCK_SIZE * sizeof(int));
+    memcpy(txb, TxBlock_B[last], TX_BLOCK_SIZE * sizeof(int));
+}
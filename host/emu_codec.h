@@ -0,0 +1,25 @@
+/*
+ * NAME:     emu_codec.h
+ * PURPOSE:  AD1939 side of the host emulation: feeds RX frames through the
+ *           SPORT interrupt and the main loop body, returns the TX frames.
+ * USAGE:    Include after ADDS_21479_EzKit.h, which has no include guard.
+ */
+#ifndef _emu_codec_H_
+#define _emu_codec_H_
+
+/* Blocks between an input block and the output block that carries it */
+#define EMU_CODEC_LATENCY   (PIPELINED_PROCESSING ? 1 : 0)
+
+/* Emulator reset, buffers for blocks of samples per channel, SPORT, SPORT1
+ * interrupt and FIR setup as in main() */
+void emu_codec_init(int samples);
+
+/* One SPORT frame period: rx holds blockSamples frames of NUM_RX_SLOTS
+ * interleaved 1.31 samples, txa/txb receive the SPORT0 A/B TX DMA blocks
+ * that handleCodecData() prepared last in the same period. */
+void emu_codec_block(const int *rx, int *txa, int *txb);
+
+/* Block index inside handleCodecData(), -1 outside */
+extern long emu_codec_current;
+
+#endif /* _emu_codec_H_ */
@@ -0,0 +1,177 @@
+/*
+ * NAME:     emu_convert.c
+ * PURPOSE:  fir_emu convert mode.
+ * USAGE:    fir_emu convert [data directory] [blocks]
+ *
+ *           Times the conversion of one SPORT block period both ways: the
+ *           former per-slot floatData()/fixData() calls, one strided pass per
+ *           slot, against the single pass deinterleaveBlock()/interleaveBlock()
+ *           of convertData.c. Both must give bit-identical results, including
+ *           saturation, and the slot energies deinterleaveBlock() sums for
+ *           silenceGate.c must match a double precision sum. Reports time stamp counter cycles per converted sample
+ *           where the host has one, nanoseconds otherwise.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "ADDS_21479_EzKit.h"
+#include "emu_util.h"
+#include "fir_emu.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define CONVERT_UNIT        "cycles"
+static double convert_clock(void) { return (double)__rdtsc(); }
+#else
+#define CONVERT_UNIT        "ns"
+static double convert_clock(void) { return emu_seconds() * 1e9; }
+#endif
+
+#define TX_SLOTS_TOTAL      (2*NUM_TX_SLOTS)
+#define ENERGY_TOLERANCE    1e-5    /* relative */
+
+static int rx_block[RX_BLOCK_MAX];
+static int tx_old[2][TX_BLOCK_MAX], tx_new[2][TX_BLOCK_MAX];
+static float rx_old[NUM_RX_SLOTS][NUM_SAMPLES], rx_new[NUM_RX_SLOTS][NUM_SAMPLES];
+static float tx_data[TX_SLOTS_TOTAL][NUM_SAMPLES];
+static float rx_energy[NUM_RX_SLOTS];
+
+/* The conversion handleCodecData() used before: one call per slot */
+static void floatData(float *output, int *input, unsigned int instep, unsigned int length)
+{
+    unsigned int i;
+
+    for(i = 0; i < length; i++)
+        output[i] = __builtin_conv_RtoF(input[instep*i]);
+}
+
+static void fixData(int *output, float *input, unsigned int outstep, unsigned int length)
+{
+    unsigned int i;
+
+    for(i = 0; i < length; i++)
+        output[outstep*i] = __builtin_conv_FtoR(input[i]);
+}
+
+static void old_rx(void)
+{
+    int s;
+
+    for(s = 0; s < NUM_RX_SLOTS; s++)
+        floatData(rx_old[s], rx_block + s, NUM_RX_SLOTS, NUM_SAMPLES);
+}
+
+static void old_tx(void)
+{
+    int s;
+
+    for(s = 0; s < TX_SLOTS_TOTAL; s++)
+        fixData(tx_old[s / NUM_TX_SLOTS] + s % NUM_TX_SLOTS, tx_data[s], NUM_TX_SLOTS, NUM_SAMPLES);
+}
+
+static void new_rx(void)
+{
+    float *outputs[NUM_RX_SLOTS] = { rx_new[0], rx_new[1], rx_new[2], rx_new[3] };
+
+    deinterleaveBlock(outputs, rx_block, NUM_RX_SLOTS, NUM_SAMPLES, rx_energy);
+}
+
+static void new_tx(void)
+{
+    float *a[NUM_TX_SLOTS] = { tx_data[0], tx_data[1], tx_data[2], tx_data[3] };
+    float *b[NUM_TX_SLOTS] = { tx_data[4], tx_data[5], tx_data[6], tx_data[7] };
+
+    interleaveBlock(tx_new[0], a, NUM_TX_SLOTS, NUM_SAMPLES);
+    interleaveBlock(tx_new[1], b, NUM_TX_SLOTS, NUM_SAMPLES);
+}
+
+/* Clock units per converted sample, best of a few runs */
+static double time_path(void (*convert)(void), long blocks, int samples)
+{
+    double best = 0.0, t;
+    int run;
+    long b;
+
+    for(run = 0; run < 5; run++)
+    {
+        t = convert_clock();
+        for(b = 0; b < blocks; b++)
+            convert();
+        t = (convert_clock() - t) / ((double)blocks * samples);
+
+        if(run == 0 || t < best)
+            best = t;
+    }
+
+    return best;
+}
+
+int emu_convert(const char *dir, int argc, char *argv[])
+{
+    (void)dir;
+
+    /* Out of range and rounding edge cases first, then noise */
+    static const float edges[] = { 1.0f, -1.0f, 1.5f, -1.5f, 0.99999994f, -0.99999994f,
+                                   1e30f, -1e30f, 0.5f / 2147483648.0f, 1.5f / 2147483648.0f };
+    unsigned int seed = 1;
+    long blocks = argc > 0 ? atol(argv[0]) : 20000;
+    double rx_before, rx_after, tx_before, tx_after;
+    double sum;
+    int s, i, exact, energy = 1;
+
+    for(i = 0; i < RX_BLOCK_SIZE; i++)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        rx_block[i] = (int)seed;
+    }
+    rx_block[0] = INT_MIN;
+    rx_block[1] = INT_MAX;
+
+    for(s = 0; s < TX_SLOTS_TOTAL; s++)
+    {
+        for(i = 0; i < NUM_SAMPLES; i++)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            tx_data[s][i] = (float)(int)seed / 1073741824.0f;   /* [-2, 2) */
+        }
+    }
+    for(i = 0; i < (int)(sizeof(edges) / sizeof(edges[0])); i++)
+        tx_data[i % TX_SLOTS_TOTAL][i / TX_SLOTS_TOTAL] = edges[i];
+
+    old_rx();
+    new_rx();
+    old_tx();
+    new_tx();
+
+    exact = memcmp(rx_old, rx_new, sizeof(rx_old)) == 0 && memcmp(tx_old, tx_new, sizeof(tx_old)) == 0;
+
+    for(s = 0; s < NUM_RX_SLOTS; s++)
+    {
+        sum = 0.0;
+        for(i = 0; i < NUM_SAMPLES; i++)
+            sum += (double)rx_old[s][i] * rx_old[s][i];
+        if(fabs(rx_energy[s] - sum) > ENERGY_TOLERANCE * sum)
+        {
+            printf("slot %d energy %g, not %g\n", s, rx_energy[s], sum);
+            energy = 0;
+        }
+    }
+
+    rx_before = time_path(old_rx, blocks, RX_BLOCK_SIZE);
+    rx_after = time_path(new_rx, blocks, RX_BLOCK_SIZE);
+    tx_before = time_path(old_tx, blocks, 2 * TX_BLOCK_SIZE);
+    tx_after = time_path(new_tx, blocks, 2 * TX_BLOCK_SIZE);
+
+    printf("%ld blocks of %d frames, %d RX and %d TX slots, %s per sample\n",
+           blocks, NUM_SAMPLES, NUM_RX_SLOTS, TX_SLOTS_TOTAL, CONVERT_UNIT);
+    printf("float RX  %d strided passes %6.2f, one pass %6.2f, %.1fx\n",
+           NUM_RX_SLOTS, rx_before, rx_after, rx_before / rx_after);
+    printf("fix TX    %d strided passes %6.2f, two passes %5.2f, %.1fx\n",
+           TX_SLOTS_TOTAL, tx_before, tx_after, tx_before / tx_after);
+    printf("results %s, energies %s\n", exact ? "bit-exact" : "DIFFER, FAILED",
+           energy ? "match" : "DIFFER, FAILED");
+
+    return exact && energy ? 0 : 1;
+}
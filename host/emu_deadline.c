@@ -0,0 +1,107 @@
+/*
+ * NAME:     emu_deadline.c
+ * PURPOSE:  fir_emu deadline mode.
+ * USAGE:    fir_emu deadline [data directory] [blocks]
+ *
+ *           Streams noise through the codec path and every OVERRUN_INTERVAL
+ *           blocks raises SPORT_DMA_BUFFERS-1 SPORT1 interrupts from the
+ *           accelerator's completion, while handleCodecData is still busy, the
+ *           way a block that misses its deadline looks on the processor. Checks
+ *           that each one is counted once, logged with its block index and a
+ *           lateness, that the blocks completed meanwhile are still processed
+ *           from the ring, and that the system keeps running. Prints deadlineStats; cycles are
+ *           time stamp counter ticks on the host, and the period is the pace
+ *           of this loop rather than a sample clock, so margins are only
+ *           indicative.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "ADDS_21479_EzKit.h"
+#include "sharc_emu.h"
+#include "emu_codec.h"
+#include "fir_emu.h"
+
+#define OVERRUN_INTERVAL    50
+
+static int inject = 0;
+static unsigned int injected = 0;
+static unsigned int expected_block[OVERRUN_LOG_SIZE];
+
+/* A frame boundary passing while the accelerator filters */
+static void overrun_done(fir_word *cp)
+{
+    int i;
+
+    (void)cp;
+
+    if(!inject || !isProcessing)
+        return;
+
+    expected_block[injected % OVERRUN_LOG_SIZE] = blockRing.tail;
+    injected++;
+    inject = 0;
+
+    /* Through every spare buffer up to the one being processed */
+    for(i = 1; i < SPORT_DMA_BUFFERS; i++)
+        emu_raise(ADI_CID_P3I);
+}
+
+int emu_deadline(const char *dir, int argc, char *argv[])
+{
+    static int rx[RX_BLOCK_MAX], txa[TX_BLOCK_MAX], txb[TX_BLOCK_MAX];
+    long blocks = argc > 0 ? atol(argv[0]) : 1000;
+    unsigned int seed = 1;
+    unsigned int n, logged;
+    int failed = 0;
+    long b;
+    int i;
+
+    (void)dir;
+
+    emu_codec_init(NUM_SAMPLES);
+    fir_accel_done_hook = overrun_done;
+
+    for(b = 0; b < blocks; b++)
+    {
+        for(i = 0; i < RX_BLOCK_SIZE; i++)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            rx[i] = (int)seed >> 2;
+        }
+
+        inject = !FFT_CONVOLUTION && b % OVERRUN_INTERVAL == OVERRUN_INTERVAL / 2;
+        emu_codec_block(rx, txa, txb);
+    }
+
+    printf("%ld blocks of %d samples, %s processing, %u overruns injected\n", blocks, NUM_SAMPLES,
+           FFT_CONVOLUTION ? "FFT convolution" : PIPELINED_PROCESSING ? "pipelined" : "sequential",
+           injected);
+    if(FFT_CONVOLUTION)
+        printf("the FFT path does not use the accelerator, no overruns to inject from\n");
+
+    printf("interrupts %u, overruns %u, skipped %u, period %u\n", deadlineStats.blocks,
+           deadlineStats.overruns, deadlineStats.skipped, deadlineStats.period);
+    printf("margin last %u, min %u, latest overrun %u\n", deadlineStats.last_margin,
+           deadlineStats.min_margin, deadlineStats.max_late);
+
+    if(deadlineStats.blocks != (unsigned int)blocks + injected * (SPORT_DMA_BUFFERS - 1))
+        failed = 1;
+    if(deadlineStats.overruns != injected || deadlineStats.skipped != 0)
+        failed = 1;
+    if(deadlineStats.min_margin == ~0u)
+        failed = 1;
+
+    logged = injected < OVERRUN_LOG_SIZE ? injected : OVERRUN_LOG_SIZE;
+    for(n = injected - logged; n < injected; n++)
+    {
+        const overrun_entry *e = &deadlineStats.log[n % OVERRUN_LOG_SIZE];
+
+        printf("overrun %3u  block %6u  late %10u\n", n, e->block, e->late);
+        if(e->block != expected_block[n % OVERRUN_LOG_SIZE] || e->late == 0)
+            failed = 1;
+    }
+
+    printf("%s\n", failed ? "FAILED" : "passed");
+    return failed;
+}
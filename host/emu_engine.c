@@ -0,0 +1,163 @@
+/*
+ * NAME:     emu_engine.c
+ * PURPOSE:  fir_emu engine mode.
+ * USAGE:    fir_emu engine [data directory] [samples] [threads]
+ *
+ *           Scaling of the work-stealing engine of fir_engine.c: 4, 16 and
+ *           64 channels of 1024 taps, samples long (default 16384), in tasks
+ *           of MAX_BLOCK_SAMPLES, on 1, 2, 4 ... threads up to the number of
+ *           online cores or threads. Prints the best of two runs of each
+ *           with the speedup over one thread and the tasks stolen, and
+ *           checks every output bit for bit against the same kernels run
+ *           range by range on one thread.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "ADDS_21479_EzKit.h"
+#include "emu_util.h"
+#include "fir_emu.h"
+#include "fir_engine.h"
+
+#define ENGINE_TAPS         1024
+#define ENGINE_RANGE        MAX_BLOCK_SAMPLES
+#define ENGINE_RUNS         2
+
+/* State of emu_noise() */
+static unsigned int seed = 5;
+
+/* One channel count on every thread count, returns 1 on a mismatch */
+static int run_channels(int count, long length, int max_threads)
+{
+    fir_engine_channel *channels = calloc(count, sizeof(fir_engine_channel));
+    float **ref = calloc(count, sizeof(float *));
+    double t1 = 0.0, best, t;
+    int threads, failed = 0;
+    int ch, i, r;
+    long k;
+
+    for(ch = 0; ch < count; ch++)
+    {
+        float *x = fir_engine_alloc(ENGINE_TAPS - 1 + length);
+        float *c = fir_engine_alloc(ENGINE_TAPS);
+
+        channels[ch].y = fir_engine_alloc(length);
+        ref[ch] = fir_engine_alloc(length);
+        if(x == NULL || c == NULL || channels[ch].y == NULL || ref[ch] == NULL)
+        {
+            fprintf(stderr, "out of memory\n");
+            exit(2);
+        }
+
+        for(k = 0; k < ENGINE_TAPS - 1 + length; k++)
+            x[k] = emu_noise(&seed) * 0.5f;
+        for(i = 0; i < ENGINE_TAPS; i++)
+            c[i] = emu_noise(&seed) * (0.5f / 32.0f);
+
+        channels[ch].x = x;
+        channels[ch].coeffs = c;
+        channels[ch].taps = ENGINE_TAPS;
+
+        for(k = 0; k < length; k += ENGINE_RANGE)
+            coreFirBlock(&x[k], c, ENGINE_TAPS, &ref[ch][k],
+                         length - k < ENGINE_RANGE ? (int)(length - k) : ENGINE_RANGE);
+    }
+
+    for(threads = 1; ; threads = 2 * threads < max_threads ? 2 * threads : max_threads)
+    {
+        fir_engine *e = fir_engine_create(threads);
+        fir_engine_stats stats;
+        unsigned long long tasks = 0, stolen = 0;
+        int bad = 0;
+
+        if(e == NULL)
+        {
+            fprintf(stderr, "cannot start %d threads\n", threads);
+            exit(2);
+        }
+
+        best = 0.0;
+        for(r = 0; r < ENGINE_RUNS; r++)
+        {
+            for(ch = 0; ch < count; ch++)
+                memset(channels[ch].y, 0, length * sizeof(float));
+
+            t = emu_seconds();
+            if(fir_engine_run(e, channels, count, length, ENGINE_RANGE) != 0)
+            {
+                fprintf(stderr, "out of memory\n");
+                exit(2);
+            }
+            t = emu_seconds() - t;
+            if(r == 0 || t < best)
+                best = t;
+        }
+        if(threads == 1)
+            t1 = best;
+
+        for(ch = 0; ch < count; ch++)
+            bad |= memcmp(channels[ch].y, ref[ch], length * sizeof(float)) != 0;
+
+        for(i = 0; i < threads; i++)
+        {
+            fir_engine_statistics(e, i, &stats);
+            tasks += stats.tasks;
+            stolen += stats.stolen;
+        }
+        if(tasks != (unsigned long long)ENGINE_RUNS * count * ((length + ENGINE_RANGE - 1) / ENGINE_RANGE))
+            bad = 1;
+
+        printf("%8d %8d %10.1f %12.1f %8.2f %8.2fx %8llu%s\n", count, threads, best * 1e3,
+               count * (double)length / best * 1e-6,
+               count * (double)length * ENGINE_TAPS / best * 1e-9,
+               t1 / best, stolen / ENGINE_RUNS, bad ? "  FAILED" : "");
+
+        failed |= bad;
+        fir_engine_destroy(e);
+
+        if(threads == max_threads)
+            break;
+    }
+
+    for(ch = 0; ch < count; ch++)
+    {
+        free((void *)channels[ch].x);
+        free((void *)channels[ch].coeffs);
+        free(channels[ch].y);
+        free(ref[ch]);
+    }
+    free(channels);
+    free(ref);
+
+    return failed;
+}
+
+int emu_engine(const char *dir, int argc, char *argv[])
+{
+    static const int counts[] = { 4, 16, 64 };
+    long length = argc > 0 ? atol(argv[0]) : 16384;
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    int max_threads = argc > 1 ? atoi(argv[1]) : (int)(cores > 0 ? cores : 1);
+    int failed = 0;
+    int i;
+
+    (void)dir;
+
+    if(length < 1 || max_threads < 1 || max_threads > FIR_ENGINE_MAX_THREADS)
+    {
+        fprintf(stderr, "usage: fir_emu engine [dir] [samples] [threads, 1 to %d]\n", FIR_ENGINE_MAX_THREADS);
+        return 2;
+    }
+
+    printf("%d taps, %ld samples per channel in tasks of %d, %ld cores online\n", ENGINE_TAPS,
+           length, ENGINE_RANGE, cores);
+    printf("%8s %8s %10s %12s %8s %9s %8s\n", "channels", "threads", "ms", "Msamples/s", "GMAC/s",
+           "speedup", "stolen");
+
+    for(i = 0; i < (int)(sizeof(counts) / sizeof(counts[0])); i++)
+        failed |= run_channels(counts[i], length, max_threads);
+
+    return failed;
+}
@@ -0,0 +1,103 @@
+/*
+ * NAME:     emu_fftconv.c
+ * PURPOSE:  fir_emu fftconv mode.
+ * USAGE:    fir_emu fftconv [data directory] [blocks]
+ *
+ *           Filters the same random blocks with the direct-form reference
+ *           FIR of emu_util.c, the computation the accelerator does, and with
+ *           the partitioned FFT
+ *           engine of fftConvolve.c for 65 to 16384 taps. Prints the time per
+ *           block of both, the largest difference between them and the backend
+ *           FFT_CONV_THRESHOLD selects for FIR_CHANNELS channels of that length.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "ADDS_21479_EzKit.h"
+#include "emu_util.h"
+#include "fir_emu.h"
+
+/* Single precision FFT against direct-form accumulation, relative to a
+ * unit output level */
+#define FFTCONV_TOLERANCE   1e-4
+
+static const int tap_counts[] = { 65, 256, 1024, 4096, 16384 };
+
+#define NUM_TAP_COUNTS (int)(sizeof(tap_counts) / sizeof(tap_counts[0]))
+
+/* State of emu_noise() */
+static unsigned int seed = 1;
+
+int emu_fftconv(const char *dir, int argc, char *argv[])
+{
+    long blocks = argc > 0 ? atol(argv[0]) : 64;
+    int failed = 0;
+    int t, n;
+
+    (void)dir;
+
+    printf("%d samples per block, %ld blocks, FFT_CONV_THRESHOLD %d taps x channels\n",
+           NUM_SAMPLES, blocks, FFT_CONV_THRESHOLD);
+    printf("%6s %11s %11s %8s %10s  %s\n",
+           "taps", "direct us", "fft us", "speedup", "max error", "backend");
+
+    for(t = 0; t < NUM_TAP_COUNTS; t++)
+    {
+        int taps = tap_counts[t];
+        long length = blocks * NUM_SAMPLES;
+        float *coeffs = malloc(taps * sizeof(float));
+        float *x = calloc(taps - 1 + length, sizeof(float));
+        double *direct = malloc(length * sizeof(double));
+        float *fft = malloc(length * sizeof(float));
+        float *storage = malloc(FFT_CONV_STORAGE(taps) * sizeof(float));
+        fft_conv_channel ch;
+        double t0, t1, t2, err = 0.0, d;
+        long b, k;
+
+        if(!coeffs || !x || !direct || !fft || !storage)
+        {
+            fprintf(stderr, "out of memory for %d taps\n", taps);
+            return 2;
+        }
+
+        /* Output level about 1/2 for any length */
+        for(n = 0; n < taps; n++)
+            coeffs[n] = emu_noise(&seed) * 0.5f / sqrtf((float)taps);
+        for(k = 0; k < length; k++)
+            x[taps - 1 + k] = emu_noise(&seed) * 0.5f;
+
+        fftConvInit(&ch, coeffs, taps, storage);
+
+        t0 = emu_seconds();
+        for(b = 0; b < blocks; b++)
+            emu_reference_fir(&x[b * NUM_SAMPLES], coeffs, taps, &direct[b * NUM_SAMPLES], NUM_SAMPLES);
+        t1 = emu_seconds();
+        for(b = 0; b < blocks; b++)
+            fftConvBlock(&ch, &x[taps - 1 + b * NUM_SAMPLES], &fft[b * NUM_SAMPLES]);
+        t2 = emu_seconds();
+
+        for(k = 0; k < length; k++)
+        {
+            d = fabs(fft[k] - direct[k]);
+            if(d > err)
+                err = d;
+        }
+
+        printf("%6d %11.1f %11.1f %7.1fx %10.3g  %s%s\n", taps,
+               (t1 - t0) / blocks * 1e6, (t2 - t1) / blocks * 1e6, (t1 - t0) / (t2 - t1), err,
+               FIR_CHANNELS * taps > FFT_CONV_THRESHOLD ? "fft" : "accelerator",
+               err <= FFTCONV_TOLERANCE ? "" : "  FAILED");
+
+        if(err > FFTCONV_TOLERANCE)
+            failed = 1;
+
+        free(coeffs);
+        free(x);
+        free(direct);
+        free(fft);
+        free(storage);
+    }
+
+    return failed;
+}
@@ -0,0 +1,346 @@
+/*
+ * NAME:     emu_fixed.c
+ * PURPOSE:  fir_emu fixed mode.
+ * USAGE:    fir_emu fixed [data directory] [blocks]
+ *
+ *           Checks the 1.31 FIR of fixedFIR.c bit for bit against a 128 bit
+ *           reference accumulator: block by block with and without a block of
+ *           lag, at two block sizes, and with saturating coefficients. With
+ *           FIXED_POINT_CHANNELS set the fixed-point channels of the codec path
+ *           are checked the same way from the RX frames to the TX frames.
+ *
+ *           Then times one block of the four channels in 1.31 straight from
+ *           the RX block to the TX blocks against the float path: conversion
+ *           into the delay lines, the direct form the accelerator computes,
+ *           from the reference FIR of emu_util.c, conversion back. Reports both errors against
+ *           a double precision reference in 1.31 LSBs.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "ADDS_21479_EzKit.h"
+#include "emu_util.h"
+#include "emu_codec.h"
+#include "fir_emu.h"
+
+extern float Coeff_Buf1[TAPSIZE1];
+extern float Coeff_Buf2[TAPSIZE2];
+
+#define FIXED_SCALE     0.5f
+
+static unsigned int seed = 3;
+
+static int random_fixed(void)
+{
+    seed = seed * 1664525u + 1013904223u;
+    return (int)seed;
+}
+
+/* (sum(c[j] * x[k+taps-1-j]) + 2^30) >> 31, saturated, for k = 0..count-1 */
+static void reference_fixed(const int *x, const int *c, int taps, int *y, long count)
+{
+    __int128 acc;
+    long k;
+    int j;
+
+    for(k = 0; k < count; k++)
+    {
+        acc = (__int128)1 << 30;
+        for(j = 0; j < taps; j++)
+            acc += (__int128)c[j] * x[k + taps - 1 - j];
+        acc >>= 31;
+        y[k] = acc > INT_MAX ? INT_MAX : acc < INT_MIN ? INT_MIN : (int)acc;
+    }
+}
+
+/*-------------------------------------------------------------------------------*/
+/* Kernel against the reference */
+
+/* Streams blocks of length through one channel, returns the mismatches */
+static long check_kernel(const int *c, int taps, int length, int lag, long blocks, int input_scale)
+{
+    long count = blocks * length, k, bad = 0;
+    int *x = calloc(taps - 1 + count, sizeof(int));
+    int *ref = malloc(count * sizeof(int));
+    int *y = malloc(count * sizeof(int));
+    int *line = malloc((taps - 1 + (lag + 1) * length) * sizeof(int));
+    fixed_fir_channel f;
+    long b;
+
+    if(!x || !ref || !y || !line)
+    {
+        fprintf(stderr, "out of memory\n");
+        exit(2);
+    }
+
+    for(k = 0; k < count; k++)
+        x[taps - 1 + k] = input_scale ? random_fixed() / input_scale : (k & 1 ? INT_MIN : INT_MAX);
+
+    reference_fixed(x, c, taps, ref, count);
+
+    fixedFirInit(&f, c, taps, line, length, lag);
+    for(b = 0; b < blocks; b++)
+        fixedFirBlock(&f, &x[taps - 1 + b * length], 1, &y[b * length], 1, length);
+
+    /* Output block b carries input block b-lag */
+    for(k = 0; k < count; k++)
+    {
+        int expect = k < lag * length ? 0 : ref[k - lag * length];
+
+        if(y[k] != expect)
+        {
+            if(bad++ < 4)
+                printf("  %d taps, %d samples, lag %d: output %ld is %d, not %d\n",
+                       taps, length, lag, k, y[k], expect);
+        }
+    }
+
+    free(x);
+    free(ref);
+    free(y);
+    free(line);
+    return bad;
+}
+
+static int run_kernel(void)
+{
+    static int c[COEFF_BANK_TAPS], full[COEFF_BANK_TAPS];
+    static const int lengths[] = { LOW_LATENCY_SAMPLES, NUM_SAMPLES };
+    long bad = 0, runs = 0;
+    int i, l, lag;
+
+    for(i = 0; i < TAPSIZE1; i++)
+    {
+        c[i] = fixedCoeff(Coeff_Buf1[i]);
+        full[i] = i & 1 ? INT_MIN : INT_MAX;
+    }
+
+    for(l = 0; l < 2; l++)
+    {
+        for(lag = 0; lag < 2; lag++)
+        {
+            bad += check_kernel(c, TAPSIZE1, lengths[l], lag, 8, 1);
+            bad += check_kernel(c, TAPSIZE1, lengths[l], lag, 8, 4);
+            runs += 2;
+        }
+    }
+
+    /* Full scale both ways: the sums reach 2^37 and saturate */
+    bad += check_kernel(full, TAPSIZE1, NUM_SAMPLES, 0, 4, 0);
+    bad += check_kernel(full, TAPSIZE1, NUM_SAMPLES, 1, 4, 1);
+    runs += 2;
+
+    printf("kernel: %ld runs against a 128 bit accumulator, %ld mismatched samples %s\n",
+           runs, bad, bad ? "FAILED" : "ok");
+    return bad != 0;
+}
+
+/*-------------------------------------------------------------------------------*/
+/* The fixed-point channels of the codec path */
+
+static int run_codec(long blocks)
+{
+    static int rx[RX_BLOCK_MAX], txa[TX_BLOCK_MAX], txb[TX_BLOCK_MAX];
+    static const int tx_block[FIR_CHANNELS] = { 0, 0, 1, 1 };
+    static const int tx_slot[FIR_CHANNELS] = { 0, 1, 0, 1 };
+    int coeffs[COEFF_BANK_TAPS];
+    long count = blocks * NUM_SAMPLES, bad = 0, b, k;
+    int *x[FIR_CHANNELS], *y[FIR_CHANNELS], *ref;
+    int ch, i, n = 0;
+
+    if(FIXED_POINT_CHANNELS == 0)
+    {
+        printf("codec path: no fixed-point channels, FIXED_POINT_CHANNELS is 0\n");
+        return 0;
+    }
+
+    emu_codec_init(NUM_SAMPLES);
+
+    for(ch = 0; ch < FIR_CHANNELS; ch++)
+    {
+        x[ch] = calloc(FIR_Channels[ch].taps - 1 + count, sizeof(int));
+        y[ch] = malloc(count * sizeof(int));
+        for(k = 0; k < count; k++)
+            x[ch][FIR_Channels[ch].taps - 1 + k] = (int)(random_fixed() * FIXED_SCALE);
+    }
+    ref = malloc(count * sizeof(int));
+
+    for(b = 0; b < blocks + EMU_CODEC_LATENCY; b++)
+    {
+        for(ch = 0; ch < FIR_CHANNELS; ch++)
+        {
+            for(i = 0; i < NUM_SAMPLES; i++)
+                rx[NUM_RX_SLOTS*i + ch] = b < blocks ? x[ch][FIR_Channels[ch].taps - 1 + b * NUM_SAMPLES + i] : 0;
+        }
+
+        emu_codec_block(rx, txa, txb);
+
+        if(b < EMU_CODEC_LATENCY)
+            continue;
+
+        for(ch = 0; ch < FIR_CHANNELS; ch++)
+        {
+            const int *tx = tx_block[ch] ? txb : txa;
+
+            for(i = 0; i < NUM_SAMPLES; i++)
+                y[ch][(b - EMU_CODEC_LATENCY) * NUM_SAMPLES + i] = tx[NUM_TX_SLOTS*i + tx_slot[ch]];
+        }
+    }
+
+    for(ch = 0; ch < FIR_CHANNELS; ch++)
+    {
+        if(FIXED_CHANNEL(ch))
+        {
+            for(i = 0; i < FIR_Channels[ch].taps; i++)
+                coeffs[i] = fixedCoeff(FIR_Channels[ch].coeffs[i]);
+            reference_fixed(x[ch], coeffs, FIR_Channels[ch].taps, ref, count);
+
+            for(k = 0; k < count; k++)
+            {
+                if(y[ch][k] != ref[k] && bad++ < 4)
+                    printf("  channel %d output %ld is %d, not %d\n", ch + 1, k, y[ch][k], ref[k]);
+            }
+            n++;
+        }
+        free(x[ch]);
+        free(y[ch]);
+    }
+    free(ref);
+
+    printf("codec path: %d fixed-point channels, %ld blocks, %ld mismatched samples %s\n",
+           n, blocks, bad, bad ? "FAILED" : "ok");
+    return bad != 0;
+}
+
+/*-------------------------------------------------------------------------------*/
+/* Fixed-point channels against the float path */
+
+static int run_benchmark(long blocks)
+{
+    static const float *coeffs[FIR_CHANNELS] = { Coeff_Buf1, Coeff_Buf2, Coeff_Buf1, Coeff_Buf2 };
+    static const int taps[FIR_CHANNELS] = { TAPSIZE1, TAPSIZE2, TAPSIZE1, TAPSIZE2 };
+    static int fixed_coeffs[FIR_CHANNELS][COEFF_BANK_TAPS];
+    long count = blocks * NUM_SAMPLES, b, k;
+    int *rx = malloc(count * NUM_RX_SLOTS * sizeof(int));
+    int *fixed_out[2], *float_out[2];
+    float *xf[FIR_CHANNELS], *yf[FIR_CHANNELS];
+    static double yd[NUM_SAMPLES];
+    double *ref, t0, t1, t2, err_fixed = 0.0, err_float = 0.0, e;
+    fixed_fir_channel f[FIR_CHANNELS];
+    int *lines[FIR_CHANNELS];
+    int ch, i;
+
+    for(i = 0; i < 2; i++)
+    {
+        fixed_out[i] = malloc(count * NUM_TX_SLOTS * sizeof(int));
+        float_out[i] = malloc(count * NUM_TX_SLOTS * sizeof(int));
+    }
+
+    for(k = 0; k < count * NUM_RX_SLOTS; k++)
+        rx[k] = (int)(random_fixed() * FIXED_SCALE);
+
+    for(ch = 0; ch < FIR_CHANNELS; ch++)
+    {
+        for(i = 0; i < taps[ch]; i++)
+            fixed_coeffs[ch][i] = fixedCoeff(coeffs[ch][i]);
+
+        lines[ch] = malloc((taps[ch] - 1 + NUM_SAMPLES) * sizeof(int));
+        fixedFirInit(&f[ch], fixed_coeffs[ch], taps[ch], lines[ch], NUM_SAMPLES, 0);
+
+        xf[ch] = calloc(taps[ch] - 1 + count, sizeof(float));
+        yf[ch] = malloc(NUM_SAMPLES * sizeof(float));
+    }
+
+    /* 1.31 straight from the RX block into the TX blocks */
+    t0 = emu_seconds();
+    for(b = 0; b < blocks; b++)
+    {
+        const int *in = &rx[b * NUM_SAMPLES * NUM_RX_SLOTS];
+        int *out[2] = { &fixed_out[0][b * NUM_SAMPLES * NUM_TX_SLOTS],
+                        &fixed_out[1][b * NUM_SAMPLES * NUM_TX_SLOTS] };
+
+        for(ch = 0; ch < FIR_CHANNELS; ch++)
+            fixedFirBlock(&f[ch], &in[ch], NUM_RX_SLOTS, &out[ch / 2][ch % 2], NUM_TX_SLOTS, NUM_SAMPLES);
+    }
+    t1 = emu_seconds();
+
+    /* Float the RX block, filter, fix the TX blocks */
+    for(b = 0; b < blocks; b++)
+    {
+        float *in[NUM_RX_SLOTS], *outa[NUM_TX_SLOTS], *outb[NUM_TX_SLOTS];
+
+        for(ch = 0; ch < FIR_CHANNELS; ch++)
+            in[ch] = &xf[ch][taps[ch] - 1 + b * NUM_SAMPLES];
+        deinterleaveBlock(in, &rx[b * NUM_SAMPLES * NUM_RX_SLOTS], NUM_RX_SLOTS, NUM_SAMPLES, NULL);
+
+        for(ch = 0; ch < FIR_CHANNELS; ch++)
+        {
+            emu_reference_fir(&xf[ch][b * NUM_SAMPLES], coeffs[ch], taps[ch], yd, NUM_SAMPLES);
+            for(i = 0; i < NUM_SAMPLES; i++)
+                yf[ch][i] = (float)yd[i];
+        }
+
+        /* The other slots carry the EQ in the codec path, not timed here */
+        outa[0] = yf[0]; outa[1] = yf[1]; outa[2] = yf[0]; outa[3] = yf[1];
+        outb[0] = yf[2]; outb[1] = yf[3]; outb[2] = yf[2]; outb[3] = yf[3];
+        interleaveBlock(&float_out[0][b * NUM_SAMPLES * NUM_TX_SLOTS], outa, NUM_TX_SLOTS, NUM_SAMPLES);
+        interleaveBlock(&float_out[1][b * NUM_SAMPLES * NUM_TX_SLOTS], outb, NUM_TX_SLOTS, NUM_SAMPLES);
+    }
+    t2 = emu_seconds();
+
+    /* Both against the double precision output of the float inputs */
+    ref = malloc(count * sizeof(double));
+    for(ch = 0; ch < FIR_CHANNELS; ch++)
+    {
+        emu_reference_fir(xf[ch], coeffs[ch], taps[ch], ref, count);
+
+        for(k = 0; k < count; k++)
+        {
+            long at = k * NUM_TX_SLOTS + ch % 2;
+
+            e = fabs(fixed_out[ch / 2][at] - ref[k] * 2147483648.0);
+            if(e > err_fixed)
+                err_fixed = e;
+            e = fabs(float_out[ch / 2][at] - ref[k] * 2147483648.0);
+            if(e > err_float)
+                err_float = e;
+        }
+    }
+
+    printf("%d channels of %d and %d taps, %d samples per block, %ld blocks\n",
+           FIR_CHANNELS, TAPSIZE1, TAPSIZE2, NUM_SAMPLES, blocks);
+    printf("%-34s %9.1f us per block, max error %8.1f LSB\n", "1.31 from RX to TX slots",
+           (t1 - t0) / blocks * 1e6, err_fixed);
+    printf("%-34s %9.1f us per block, max error %8.1f LSB\n", "float conversion, FIR, fix",
+           (t2 - t1) / blocks * 1e6, err_float);
+
+    for(ch = 0; ch < FIR_CHANNELS; ch++)
+    {
+        free(lines[ch]);
+        free(xf[ch]);
+        free(yf[ch]);
+    }
+    for(i = 0; i < 2; i++)
+    {
+        free(fixed_out[i]);
+        free(float_out[i]);
+    }
+    free(rx);
+    free(ref);
+    return 0;
+}
+
+int emu_fixed(const char *dir, int argc, char *argv[])
+{
+    long blocks = argc > 0 ? atol(argv[0]) : 256;
+    int failed = 0;
+
+    (void)dir;
+
+    failed |= run_kernel();
+    failed |= run_codec(blocks);
+    failed |= run_benchmark(blocks);
+
+    return failed;
+}
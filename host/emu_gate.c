@@ -0,0 +1,341 @@
+/*
+ * NAME:     emu_gate.c
+ * PURPOSE:  fir_emu gate mode.
+ * USAGE:    fir_emu gate [data directory] [blocks]
+ *
+ *           Streams bursts of noise with silence in between through the
+ *           codec path, once with silenceThreshold at 0, which gates nothing,
+ *           and once at SILENCE_THRESHOLD. Every GATE_PERIOD blocks channel 0
+ *           has a burst in blocks 0..15, channel 1 in 8..23, channel 2 in
+ *           0..15 over a floor of noise at GATE_FLOOR_DB, and channel 3 in
+ *           0..39, so for a few blocks of each period every channel is
+ *           gated and no pass is started.
+ *
+ *           The channels in digital silence have to put out the same samples
+ *           in both runs, through every burst that resumes them; channel 2
+ *           may only lose its filtered floor. The accelerator has to do
+ *           exactly the MACs of the skipped blocks fewer, and no channel the
+ *           core filters may be skipped. Prints the skipped and resumed
+ *           blocks of every channel with the cycles gateStats counts as
+ *           saved, and the host time per block of both runs.
+ *
+ *           The channels of FIXED_POINT_CHANNELS slots are not compared, the
+ *           FFT convolution build must gate nothing.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "ADDS_21479_EzKit.h"
+#include "sharc_emu.h"
+#include "emu_util.h"
+#include "emu_codec.h"
+#include "fir_emu.h"
+
+#define GATE_PERIOD         48
+#define GATE_SCALE          0.25f
+#define GATE_FLOOR_DB       -110.0
+#define GATE_TOLERANCE      1e-6
+
+#define RUN_ALL             0       /* silenceThreshold 0 */
+#define RUN_GATED           1
+#define RUNS                2
+
+static const char *run_names[RUNS] = { "threshold 0", "gated" };
+
+/* Blocks of each period with a burst on each channel */
+static const int burst_begin[FIR_CHANNELS] = { 0, 8, 0, 0 };
+static const int burst_end[FIR_CHANNELS] = { 16, 24, 16, 40 };
+static const int has_floor[FIR_CHANNELS] = { 0, 0, 1, 0 };
+
+/* AOUT channel of each FIR channel, in fBlockA order */
+static const int fir_aout[FIR_CHANNELS] = { 0, 1, 4, 5 };
+
+/* Filled by the children that run the codec path */
+typedef struct {
+    gate_stats stats;
+    int chain[FIR_CHANNELS];            /* firChainIndex[] >= 0 */
+    int taps[FIR_CHANNELS];
+    unsigned long long macs;            /* of the FIR accelerator */
+    unsigned long long skipped_macs;    /* of the skipped blocks */
+    unsigned long long passes;
+    double seconds;
+} gate_run;
+
+static struct {
+    float *x[FIR_CHANNELS];             /* quantised inputs */
+    float *y[RUNS][FIR_CHANNELS];       /* filtered channels */
+    gate_run *run;
+} shared;
+
+/* State of emu_noise() */
+static unsigned int seed = 3;
+
+/* Peak of the floor: uniform noise of GATE_FLOOR_DB RMS */
+static float floor_peak(void)
+{
+    return (float)(sqrt(3.0) * pow(10.0, GATE_FLOOR_DB / 20.0));
+}
+
+static size_t shared_bytes(long blocks)
+{
+    return (FIR_CHANNELS + RUNS*FIR_CHANNELS) * blocks * NUM_SAMPLES * sizeof(float) + RUNS * sizeof(gate_run);
+}
+
+/* The bursts on every channel, once for both runs */
+static int prepare(long blocks)
+{
+    long length = blocks * NUM_SAMPLES;
+    float *p;
+    int c, r, period;
+    long i;
+
+    p = mmap(NULL, shared_bytes(blocks), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if(p == MAP_FAILED)
+        return -1;
+
+    for(c = 0; c < FIR_CHANNELS; c++, p += length)
+    {
+        shared.x[c] = p;
+        for(i = 0; i < length; i++)
+        {
+            float v = 0.0f;
+
+            period = (int)(i / NUM_SAMPLES % GATE_PERIOD);
+            if(period >= burst_begin[c] && period < burst_end[c])
+                v = emu_noise(&seed) * GATE_SCALE;
+            else if(has_floor[c])
+                v = emu_noise(&seed) * floor_peak();
+            p[i] = __builtin_conv_RtoF(__builtin_conv_FtoR(v));
+        }
+    }
+    for(r = 0; r < RUNS; r++)
+    {
+        for(c = 0; c < FIR_CHANNELS; c++, p += length)
+            shared.y[r][c] = p;
+    }
+    shared.run = (gate_run *)p;
+
+    return 0;
+}
+
+static void release(long blocks)
+{
+    munmap(shared.x[0], shared_bytes(blocks));
+}
+
+/* The inputs through the booted codec path into the filtered channels y */
+static void stream(long blocks, float **y)
+{
+    static int rx[RX_BLOCK_MAX], txa[TX_BLOCK_MAX], txb[TX_BLOCK_MAX];
+    long b;
+    int c, i;
+
+    /* The last blocks flush the pipeline */
+    for(b = 0; b < blocks + EMU_CODEC_LATENCY; b++)
+    {
+        for(c = 0; c < NUM_RX_SLOTS; c++)
+        {
+            for(i = 0; i < NUM_SAMPLES; i++)
+                rx[NUM_RX_SLOTS*i + c] = b < blocks ? __builtin_conv_FtoR(shared.x[c][b * NUM_SAMPLES + i]) : 0;
+        }
+
+        emu_codec_block(rx, txa, txb);
+
+        if(b < EMU_CODEC_LATENCY)
+            continue;
+
+        for(c = 0; c < FIR_CHANNELS; c++)
+        {
+            const int *tx = fir_aout[c] < NUM_TX_SLOTS ? txa : txb;
+
+            for(i = 0; i < NUM_SAMPLES; i++)
+                y[c][(b - EMU_CODEC_LATENCY) * NUM_SAMPLES + i] =
+                    __builtin_conv_RtoF(tx[NUM_TX_SLOTS*i + fir_aout[c] % NUM_TX_SLOTS]);
+        }
+    }
+}
+
+/* Runs one threshold in a child, the codec path boots once per process.
+ * Returns the exit status of the child. */
+static int boot(int run, long blocks)
+{
+    gate_run *g = &shared.run[run];
+    unsigned long long macs;
+    double t;
+    int status, ch;
+    pid_t pid;
+
+    fflush(stdout);
+    pid = fork();
+    if(pid == 0)
+    {
+        silenceThreshold = run == RUN_ALL ? 0.0f : SILENCE_THRESHOLD;
+
+        emu_codec_init(NUM_SAMPLES);
+        macs = fir_accel_statistics.macs;
+        g->passes = fir_accel_statistics.iterations;
+
+        t = emu_seconds();
+        stream(blocks, shared.y[run]);
+        g->seconds = emu_seconds() - t;
+
+        // the pass of the last block may still be on the accelerator
+        while(*pFIRCTL1 & FIR_EN)
+            NOP();
+
+        g->stats = gateStats;
+        g->macs = fir_accel_statistics.macs - macs;
+        g->passes = fir_accel_statistics.iterations - g->passes;
+        g->skipped_macs = 0;
+        for(ch = 0; ch < FIR_CHANNELS; ch++)
+        {
+            const fir_channel_config *c = &FIR_Channels[ch];
+
+            g->chain[ch] = firChainIndex[ch] >= 0;
+            g->taps[ch] = c->taps;
+            g->skipped_macs += (unsigned long long)gateStats.skipped[ch] * FIR_OUTPUTS(c) *
+                               (c->taps / (c->upsample ? c->ratio : 1));
+        }
+
+        fflush(stdout);
+        _exit(0);
+    }
+
+    if(pid < 0 || waitpid(pid, &status, 0) != pid || !WIFEXITED(status))
+        return 2;
+    return WEXITSTATUS(status);
+}
+
+/* Largest difference between the runs on channel ch */
+static double channel_error(int ch, long blocks)
+{
+    double err = 0.0, e;
+    long i;
+
+    for(i = 0; i < blocks * NUM_SAMPLES; i++)
+    {
+        e = fabs(shared.y[RUN_GATED][ch][i] - shared.y[RUN_ALL][ch][i]);
+        if(e > err)
+            err = e;
+    }
+    return err;
+}
+
+/* Sum of the coefficient magnitudes, the gain of the filter on the worst
+ * floor */
+static double coeff_gain(int ch)
+{
+    const fir_channel_config *c = &FIR_Channels[ch];
+    double sum = 0.0;
+    int i;
+
+    for(i = 0; i < c->taps; i++)
+        sum += fabs(c->coeffs[i]);
+    return sum;
+}
+
+static int check(long blocks)
+{
+    const gate_run *all = &shared.run[RUN_ALL], *gated = &shared.run[RUN_GATED];
+    unsigned int skipped = 0;
+    double err, bound;
+    int failed = 0;
+    int ch;
+
+    printf("%-3s %5s %5s %8s %8s %8s %12s %10s\n", "ch", "taps", "side", "skipped", "resumed", "of blocks",
+           "saved cycles", "error");
+
+    for(ch = 0; ch < FIR_CHANNELS; ch++)
+    {
+        const char *side = FIXED_CHANNEL(ch) ? "fixed" : SDRAM_CHANNEL(ch) ? "sdram" :
+                           gated->chain[ch] && !FFT_CONVOLUTION ? "acc" : "core";
+        const char *verdict = "";
+
+        err = channel_error(ch, blocks);
+        bound = has_floor[ch] ? floor_peak() * coeff_gain(ch) + GATE_TOLERANCE : 0.0;
+        skipped += gated->stats.skipped[ch];
+
+        if(!FIXED_CHANNEL(ch) && err > bound)
+        {
+            verdict = "  FAILED";
+            failed = 1;
+        }
+        if((!gated->chain[ch] || FFT_CONVOLUTION) && gated->stats.skipped[ch] != 0)
+        {
+            verdict = "  FAILED, not a chain channel";
+            failed = 1;
+        }
+        if(all->stats.skipped[ch] != 0)
+        {
+            verdict = "  FAILED, gated at threshold 0";
+            failed = 1;
+        }
+
+        printf("%-3d %5d %5s %8u %8u %7.1f%% %12llu %10.2e%s\n", ch, gated->taps[ch], side,
+               gated->stats.skipped[ch], gated->stats.resumed[ch], 100.0 * gated->stats.skipped[ch] / blocks,
+               gated->stats.saved[ch], err, verdict);
+
+        // every accelerator channel has silent stretches and bursts that end them
+        if(gated->chain[ch] && !FFT_CONVOLUTION && !FIXED_CHANNEL(ch) &&
+           (gated->stats.skipped[ch] == 0 || (blocks > GATE_PERIOD && gated->stats.resumed[ch] == 0)))
+        {
+            printf("channel %d was never gated and resumed FAILED\n", ch);
+            failed = 1;
+        }
+    }
+
+    printf("accelerator MACs %llu at threshold 0, %llu gated, %llu fewer for %u skipped blocks %s\n",
+           all->macs, gated->macs, all->macs - gated->macs, skipped,
+           all->macs - gated->macs == gated->skipped_macs ? "ok" : "FAILED");
+    if(all->macs - gated->macs != gated->skipped_macs)
+    {
+        printf("the skipped blocks account for %llu MACs\n", gated->skipped_macs);
+        failed = 1;
+    }
+
+    printf("accelerator passes %llu at threshold 0, %llu gated\n", all->passes, gated->passes);
+    printf("host time per block: %s %.1f us, %s %.1f us\n", run_names[RUN_ALL], all->seconds * 1e6 / blocks,
+           run_names[RUN_GATED], gated->seconds * 1e6 / blocks);
+
+    return failed;
+}
+
+int emu_gate(const char *dir, int argc, char *argv[])
+{
+    long blocks = argc > 0 ? atol(argv[0]) : 4 * GATE_PERIOD;
+    int failed = 0;
+    int r;
+
+    (void)dir;
+
+    if(blocks < 1)
+    {
+        fprintf(stderr, "usage: fir_emu gate [dir] [blocks]\n");
+        return 2;
+    }
+
+    if(prepare(blocks) != 0)
+    {
+        printf("cannot map the shared buffers\n");
+        return 2;
+    }
+
+    printf("%ld blocks of %d samples, bursts every %d blocks, silent below %.0f dBFS, floor at %.0f dBFS\n",
+           blocks, NUM_SAMPLES, GATE_PERIOD, 10.0 * log10(SILENCE_THRESHOLD), GATE_FLOOR_DB);
+
+    for(r = 0; r < RUNS; r++)
+        failed |= boot(r, blocks);
+    if(!failed)
+        failed |= check(blocks);
+
+    if(failed)
+        printf("FAILED\n");
+
+    release(blocks);
+    return failed;
+}
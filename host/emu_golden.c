@@ -0,0 +1,421 @@
+/*
+ * NAME:     emu_golden.c
+ * PURPOSE:  fir_emu golden mode.
+ * USAGE:    fir_emu golden [data directory] [baseline file] [record]
+ *
+ *           Regression suite of the filter paths: the FIR accelerator chain
+ *           of firChain.c, the core kernels of coreFIR.c and the FFT
+ *           convolution of fftConvolve.c, each at 65, 256 and 1024 taps and
+ *           every block size from MIN_BLOCK_SAMPLES to MAX_BLOCK_SAMPLES.
+ *           The vector streams through in blocks after taps-1 zeros, so the
+ *           history has to carry over from block to block.
+ *
+ *           expectedoutput<L>.dat is indata<L>.dat filtered with Matlab's
+ *           fir1(L-1, 0.2), a Hamming windowed sinc, which golden_fir1()
+ *           rebuilds; the 256 and 1024 tap runs use it and are checked
+ *           against those files. The 65 tap run uses the project's filter
+ *           on indata1024.dat against a double precision convolution.
+ *
+ *           Prints the largest error, the SNR against the golden output and
+ *           the throughput of every run, and its speedup: the throughput
+ *           against that of coreFirGeneric() on the same taps and blocks,
+ *           timed in turn with it in the same run. Fails when an error
+ *           exceeds GOLDEN_TOLERANCE, or, once a baseline is recorded
+ *           (default host/golden_baseline.txt), when the error, the SNR or
+ *           the speedup of a run falls behind its baseline by more than the
+ *           margins below. The speedup is a ratio of two timings of the
+ *           same build on the same host, so the baseline holds on slower
+ *           machines and in debug builds. "record" writes the baseline of
+ *           this build instead of checking it.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "ADDS_21479_EzKit.h"
+#include "sharc_emu.h"
+#include "emu_util.h"
+#include "fir_emu.h"
+
+extern float Coeff_Buf1[TAPSIZE1];
+
+/* Against the Matlab vectors, "up to few decimal points" as in verify */
+#define GOLDEN_TOLERANCE        1e-4
+
+/* Regression margins against the baseline: the error may grow by a quarter
+ * plus rounding noise and the SNR drop by 1 dB. The speedup over the generic
+ * loop shifts with host load between the two timings and with the
+ * optimisation level, the SSE kernels keep half of theirs at -O0, so it may
+ * fall to a quarter; losing a specialised kernel or the FFT path costs a
+ * factor of 4 to 15. */
+#define GOLDEN_ERROR_MARGIN     1.25
+#define GOLDEN_ERROR_SLACK      1e-9
+#define GOLDEN_SNR_MARGIN       1.0
+#define GOLDEN_SPEED_MARGIN     0.25
+
+/* Throughput of a run and of the generic loop: the best of
+ * GOLDEN_BENCH_RUNS passes of at least GOLDEN_BENCH_SAMPLES each, taken in
+ * turn, which leaves out the passes the host scheduler interrupted */
+#define GOLDEN_BENCH_SAMPLES    16384
+#define GOLDEN_BENCH_RUNS       5
+
+#define GOLDEN_BASELINE         "host/golden_baseline.txt"
+
+#define MAX_VECTOR              4096
+
+typedef enum {
+    PATH_ACCELERATOR,
+    PATH_CORE,
+    PATH_FFT,
+    NUM_PATHS
+} golden_path;
+
+static const char *path_names[NUM_PATHS] = { "accelerator", "core", "fft" };
+
+typedef struct {
+    int taps;
+    const char *indata;
+    const char *expected;       /* NULL for a double precision reference */
+} golden_filter;
+
+static const golden_filter filters[] = {
+    { TAPSIZE1, "indata1024.dat", NULL },
+    { 256,      "indata256.dat",  "expectedoutput256.dat" },
+    { 1024,     "indata1024.dat", "expectedoutput1024.dat" },
+};
+
+#define NUM_FILTERS (int)(sizeof(filters) / sizeof(filters[0]))
+
+typedef struct {
+    int path;
+    int taps;
+    int block;
+    double error;
+    double snr;
+    double msps;
+    double speedup;             /* msps against coreFirGeneric() */
+} golden_result;
+
+#define MAX_RESULTS (NUM_PATHS * NUM_FILTERS * 8)
+
+/*-------------------------------------------------------------------------------*/
+/* Golden data */
+
+/* fir1(taps-1, wn) of Matlab: ideal lowpass with its cutoff at wn times
+ * Nyquist, Hamming window, scaled to unity gain at DC */
+static void golden_fir1(int taps, double wn, float *c)
+{
+    double h[FIR_MAX_TAPS], m, sum = 0.0;
+    int n;
+
+    for(n = 0; n < taps; n++)
+    {
+        m = n - (taps - 1) / 2.0;
+        h[n] = m == 0.0 ? wn : sin(M_PI * wn * m) / (M_PI * m);
+        h[n] *= 0.54 - 0.46 * cos(2.0 * M_PI * n / (taps - 1));
+        sum += h[n];
+    }
+    for(n = 0; n < taps; n++)
+        c[n] = (float)(h[n] / sum);
+}
+
+/*-------------------------------------------------------------------------------*/
+/* Filter paths, each filters length samples of x, which holds taps-1 zeros
+ * before them, in blocks into y. Returns 0, or -1 when the path cannot run
+ * the filter. */
+
+/* One TCB whose delay line holds the whole vector, the history after it as
+ * the accelerator wraps round to it for the first window */
+static int run_accelerator(const float *x, const float *c, int taps, float *y, long length, int block)
+{
+    static fir_channel_config config;
+    static fir_chain chain;
+    float *in = malloc((length + taps - 1) * sizeof(float));
+    long b;
+
+    memcpy(in, &x[taps - 1], length * sizeof(float));
+    memset(&in[length], 0, (taps - 1) * sizeof(float));
+
+    config.taps = taps;
+    config.window = block;
+    config.coeffs = c;
+    config.in = in;
+    config.in_length = length + taps - 1;
+    config.ratio = 1;
+    config.upsample = false;
+
+    emu_reset();
+    *pPMCTL1 |= FIRACCSEL;
+    emu_completion_init();
+
+    config.out = y;
+    if(firChainBuild(&chain, &config, 1, false) != 0)
+    {
+        free(in);
+        return -1;
+    }
+
+    for(b = 0; b < length / block; b++)
+    {
+        firChainSetOutput(&chain, 0, &y[b * block]);
+        firChainStart(&chain);
+        emu_completion_wait((int)b + 1);
+    }
+
+    free(in);
+    return 0;
+}
+
+static int run_core(const float *x, const float *c, int taps, float *y, long length, int block)
+{
+    long b;
+
+    for(b = 0; b < length / block; b++)
+        coreFirBlock(&x[b * block], c, taps, &y[b * block], block);
+    return 0;
+}
+
+static int run_fft(const float *x, const float *c, int taps, float *y, long length, int block)
+{
+    float *storage = malloc(FFT_CONV_STORAGE(taps) * sizeof(float));
+    fft_conv_channel ch;
+    long b;
+
+    fftConvInit(&ch, c, taps, storage);
+    for(b = 0; b < length / block; b++)
+        fftConvBlock(&ch, &x[taps - 1 + b * block], &y[b * block]);
+
+    free(storage);
+    return 0;
+}
+
+/* The yardstick of the speedups: no specialised kernel */
+static void run_generic(const float *x, const float *c, int taps, float *y, long length, int block)
+{
+    long b;
+
+    for(b = 0; b < length / block; b++)
+        coreFirGeneric(&x[b * block], c, taps, &y[b * block], block);
+}
+
+static int (* const paths[NUM_PATHS])(const float *, const float *, int, float *, long, int) = {
+    run_accelerator, run_core, run_fft
+};
+
+/*-------------------------------------------------------------------------------*/
+/* Baseline */
+
+static int load_baseline(const char *name, golden_result *base, int max)
+{
+    FILE *f = fopen(name, "r");
+    char line[256], path[32];
+    int n = 0, p;
+
+    if(f == NULL)
+        return -1;
+
+    while(n < max && fgets(line, sizeof(line), f) != NULL)
+    {
+        golden_result *r = &base[n];
+
+        if(line[0] == '#' ||
+           sscanf(line, "%31s %d %d %lf %lf %lf", path, &r->taps, &r->block, &r->error, &r->snr,
+                  &r->speedup) != 6)
+            continue;
+
+        for(p = 0; p < NUM_PATHS && strcmp(path, path_names[p]) != 0; p++)
+            ;
+        if(p < NUM_PATHS)
+        {
+            r->path = p;
+            n++;
+        }
+    }
+
+    fclose(f);
+    return n;
+}
+
+static int record_baseline(const char *name, const golden_result *results, int n)
+{
+    FILE *f = fopen(name, "w");
+    int i;
+
+    if(f == NULL)
+    {
+        fprintf(stderr, "cannot write %s\n", name);
+        return 2;
+    }
+
+    fprintf(f, "# fir_emu golden baseline: path taps block max_error snr_db speedup_over_generic\n");
+    for(i = 0; i < n; i++)
+        fprintf(f, "%s %d %d %.6g %.2f %.3f\n", path_names[results[i].path], results[i].taps,
+                results[i].block, results[i].error, results[i].snr, results[i].speedup);
+
+    fclose(f);
+    printf("baseline of %d runs written to %s\n", n, name);
+    return 0;
+}
+
+/* Empty when the run keeps up with its baseline, otherwise what regressed */
+static const char *regression(const golden_result *r, const golden_result *base, int n)
+{
+    int i;
+
+    for(i = 0; i < n; i++)
+    {
+        const golden_result *b = &base[i];
+
+        if(b->path != r->path || b->taps != r->taps || b->block != r->block)
+            continue;
+
+        if(r->error > b->error * GOLDEN_ERROR_MARGIN + GOLDEN_ERROR_SLACK)
+            return "  error REGRESSED";
+        if(r->snr < b->snr - GOLDEN_SNR_MARGIN)
+            return "  SNR REGRESSED";
+        if(r->speedup < b->speedup * GOLDEN_SPEED_MARGIN)
+            return "  throughput REGRESSED";
+        return "";
+    }
+
+    return "  no baseline";
+}
+
+/*-------------------------------------------------------------------------------*/
+
+int emu_golden(const char *dir, int argc, char *argv[])
+{
+    static float vector[MAX_VECTOR], expected[MAX_VECTOR], c[FIR_MAX_TAPS];
+    static golden_result results[MAX_RESULTS], base[MAX_RESULTS];
+    const char *baseline = argc > 0 ? argv[0] : GOLDEN_BASELINE;
+    int record = argc > 1 && strcmp(argv[1], "record") == 0;
+    int baselines, n = 0, failed = 0;
+    int f, p, i, block;
+
+    baselines = record ? 0 : load_baseline(baseline, base, MAX_RESULTS);
+    if(baselines < 0)
+        printf("no baseline in %s, record one with fir_emu golden %s %s record\n", baseline, dir, baseline);
+
+    printf("%-12s %5s %5s %11s %8s %11s %8s\n", "path", "taps", "block", "max error", "SNR dB",
+           "Msamples/s", "speedup");
+
+    for(f = 0; f < NUM_FILTERS; f++)
+    {
+        const golden_filter *g = &filters[f];
+        int size = emu_load_dat(dir, g->indata, vector, MAX_VECTOR);
+        int length = (size + 1) / 2;
+        float *x;
+        double *ref;
+        long k;
+
+        /* indata<L>.dat: L-1 zeros, then the L samples */
+        if(size <= 0 || size != 2 * length - 1 ||
+           (g->expected != NULL && emu_load_dat(dir, g->expected, expected, MAX_VECTOR) != length))
+        {
+            fprintf(stderr, "unexpected test vector size in %s\n", dir);
+            return 2;
+        }
+
+        if(g->taps == TAPSIZE1)
+            memcpy(c, Coeff_Buf1, TAPSIZE1 * sizeof(float));
+        else
+            golden_fir1(g->taps, 0.2, c);
+
+        /* Room for the history and the last block of the largest size */
+        x = calloc(g->taps - 1 + length + MAX_BLOCK_SAMPLES, sizeof(float));
+        ref = malloc(length * sizeof(double));
+        memcpy(&x[g->taps - 1], &vector[length - 1], length * sizeof(float));
+
+        if(g->expected != NULL)
+        {
+            for(k = 0; k < length; k++)
+                ref[k] = expected[k];
+        }
+        else
+        {
+            emu_reference_fir(x, c, g->taps, ref, length);
+        }
+
+        for(p = 0; p < NUM_PATHS; p++)
+        {
+            for(block = MIN_BLOCK_SAMPLES; block <= MAX_BLOCK_SAMPLES; block *= 2)
+            {
+                golden_result *r = &results[n];
+                long padded = (length + block - 1) / block * block, done;
+                float *y = malloc(padded * sizeof(float));
+                double signal = 0.0, noise = 0.0, d, t, generic = 0.0;
+
+                r->path = p;
+                r->taps = g->taps;
+                r->block = block;
+
+                /* The FFT tables and storage follow blockSamples */
+                if(initBlockMemory(block) != 0)
+                    return 2;
+
+                /* A path that refuses the filter fails the suite, in release builds too */
+                if(paths[p](x, c, g->taps, y, padded, block) != 0)
+                {
+                    printf("%-12s %5d %5d refused the filter  FAILED\n", path_names[p], g->taps, block);
+                    failed = 1;
+                    free(y);
+                    continue;
+                }
+                n++;
+
+                r->error = 0.0;
+                for(k = 0; k < length; k++)
+                {
+                    d = y[k] - ref[k];
+                    signal += ref[k] * ref[k];
+                    noise += d * d;
+                    if(fabs(d) > r->error)
+                        r->error = fabs(d);
+                }
+                r->snr = noise > 0.0 ? 10.0 * log10(signal / noise) : 999.0;
+
+                r->msps = 0.0;
+                for(i = 0; i < GOLDEN_BENCH_RUNS; i++)
+                {
+                    t = emu_seconds();
+                    for(done = 0; done < GOLDEN_BENCH_SAMPLES; done += padded)
+                        paths[p](x, c, g->taps, y, padded, block);
+                    t = done / (emu_seconds() - t) * 1e-6;
+                    if(t > r->msps)
+                        r->msps = t;
+
+                    t = emu_seconds();
+                    for(done = 0; done < GOLDEN_BENCH_SAMPLES; done += padded)
+                        run_generic(x, c, g->taps, y, padded, block);
+                    t = done / (emu_seconds() - t) * 1e-6;
+                    if(t > generic)
+                        generic = t;
+                }
+                r->speedup = r->msps / generic;
+
+                {
+                    const char *status = r->error > GOLDEN_TOLERANCE ? "  FAILED" :
+                                         baselines > 0 ? regression(r, base, baselines) : "";
+
+                    printf("%-12s %5d %5d %11.3g %8.1f %11.2f %8.2f%s\n", path_names[p], r->taps, block,
+                           r->error, r->snr, r->msps, r->speedup, status);
+                    if(strstr(status, "FAILED") != NULL || strstr(status, "REGRESSED") != NULL)
+                        failed = 1;
+                }
+
+                free(y);
+            }
+        }
+
+        free(x);
+        free(ref);
+    }
+
+    initBlockMemory(NUM_SAMPLES);
+
+    if(record)
+        return failed ? 1 : record_baseline(baseline, results, n);
+
+    return failed;
+}
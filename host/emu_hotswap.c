@@ -0,0 +1,445 @@
+/*
+ * NAME:     emu_hotswap.c
+ * PURPOSE:  fir_emu hotswap mode.
+ * USAGE:    fir_emu hotswap [data directory] [blocks]
+ *
+ *           Swaps the coefficients of the four filtered channels between the
+ *           compiled set A and a set B, the same taps with every odd one
+ *           negated, while noise streams through the codec path, and
+ *           classifies every output block of every channel against the
+ *           double precision outputs of both sets: all of A, all of B, or the
+ *           one block ramp of a crossfade from one to the other. Anything
+ *           else is a torn block.
+ *
+ *           First one hard swap and one crossfade are staged between blocks
+ *           and have to go live within a block. Then a control thread stages
+ *           sets as fast as coeffStage() takes them while the main thread
+ *           keeps processing; the main thread never waits for it, coeffStage()
+ *           refuses a channel whose previous set is still on its way instead.
+ *           The channels of FIXED_POINT_CHANNELS and SDRAM_FIR_CHANNELS keep
+ *           set A.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "ADDS_21479_EzKit.h"
+#include "sharc_emu.h"
+#include "emu_util.h"
+#include "emu_codec.h"
+#include "fir_emu.h"
+
+extern float Coeff_Buf1[TAPSIZE1];
+extern float Coeff_Buf2[TAPSIZE2];
+
+#define HOTSWAP_SCALE       0.25f
+#define HOTSWAP_TOLERANCE   1e-5
+
+/* Blocks of the staged swaps of the first part */
+#define HOTSWAP_HARD_BLOCK  8
+#define HOTSWAP_FADE_BLOCK  24
+#define HOTSWAP_BLOCKS      40
+
+/* Classes of an output block */
+#define CLASS_A             0
+#define CLASS_B             1
+#define CLASS_RAMP_TO_A     2
+#define CLASS_RAMP_TO_B     3
+#define CLASS_TORN          -1
+
+typedef struct {
+    int rx_slot;
+    int tx_block;           /* 0 for SPORT0 A, 1 for SPORT0 B */
+    int tx_slot;
+    const float *coeffs;
+    int taps;
+    float b[COEFF_BANK_TAPS];
+    float *x;               /* taps-1 zeros, then the quantised input */
+    float *y;
+    double *ref[2];         /* outputs of set A and set B */
+} hotswap_channel;
+
+static hotswap_channel channels[FIR_CHANNELS] = {
+    { .rx_slot = 0, .tx_block = 0, .tx_slot = 0, .coeffs = Coeff_Buf1, .taps = TAPSIZE1 },  /* AIN1L -> AOUT1L */
+    { .rx_slot = 1, .tx_block = 0, .tx_slot = 1, .coeffs = Coeff_Buf2, .taps = TAPSIZE2 },  /* AIN1R -> AOUT1R */
+    { .rx_slot = 2, .tx_block = 1, .tx_slot = 0, .coeffs = Coeff_Buf1, .taps = TAPSIZE1 },  /* AIN2L -> AOUT3L */
+    { .rx_slot = 3, .tx_block = 1, .tx_slot = 1, .coeffs = Coeff_Buf2, .taps = TAPSIZE2 },  /* AIN2R -> AOUT3R */
+};
+
+/* State of emu_noise() */
+static unsigned int seed = 5;
+
+static double block_error(const float *y, const double *a, const double *b, int ramp)
+{
+    double err = 0.0, e, g;
+    int i;
+
+    for(i = 0; i < NUM_SAMPLES; i++)
+    {
+        g = ramp ? (float)(i + 1) / NUM_SAMPLES : 1.0;
+        e = fabs(y[i] - (a[i] + g * (b[i] - a[i])));
+        if(e > err)
+            err = e;
+    }
+    return err;
+}
+
+/* What output block n of a channel was filtered with */
+static int classify(const hotswap_channel *ch, long n)
+{
+    const float *y = &ch->y[n * NUM_SAMPLES];
+    const double *a = &ch->ref[0][n * NUM_SAMPLES];
+    const double *b = &ch->ref[1][n * NUM_SAMPLES];
+
+    if(block_error(y, a, a, 0) <= HOTSWAP_TOLERANCE)
+        return CLASS_A;
+    if(block_error(y, b, b, 0) <= HOTSWAP_TOLERANCE)
+        return CLASS_B;
+    if(block_error(y, a, b, 1) <= HOTSWAP_TOLERANCE)
+        return CLASS_RAMP_TO_B;
+    if(block_error(y, b, a, 1) <= HOTSWAP_TOLERANCE)
+        return CLASS_RAMP_TO_A;
+    return CLASS_TORN;
+}
+
+/* Noise inputs, set B and the codec path */
+static void prepare(long blocks)
+{
+    long length = blocks * NUM_SAMPLES;
+    int c, i;
+
+    for(c = 0; c < FIR_CHANNELS; c++)
+    {
+        hotswap_channel *ch = &channels[c];
+
+        ch->x = calloc(ch->taps - 1 + length, sizeof(float));
+        ch->y = malloc(length * sizeof(float));
+        ch->ref[0] = malloc(length * sizeof(double));
+        ch->ref[1] = malloc(length * sizeof(double));
+
+        for(i = 0; i < length; i++)
+            ch->x[ch->taps - 1 + i] = __builtin_conv_RtoF(__builtin_conv_FtoR(emu_noise(&seed) * HOTSWAP_SCALE));
+        for(i = 0; i < ch->taps; i++)
+            ch->b[i] = i % 2 ? -ch->coeffs[i] : ch->coeffs[i];
+    }
+
+    emu_codec_init(NUM_SAMPLES);
+}
+
+/* The inputs through the codec path, then both references */
+static void stream(long blocks, void (*before_block)(long))
+{
+    static int rx[RX_BLOCK_MAX], txa[TX_BLOCK_MAX], txb[TX_BLOCK_MAX];
+    long length = blocks * NUM_SAMPLES, b;
+    int c, i;
+
+    /* The last blocks flush the pipeline */
+    for(b = 0; b < blocks + EMU_CODEC_LATENCY; b++)
+    {
+        if(before_block != NULL)
+            before_block(b);
+
+        for(c = 0; c < FIR_CHANNELS; c++)
+        {
+            hotswap_channel *ch = &channels[c];
+
+            for(i = 0; i < NUM_SAMPLES; i++)
+                rx[NUM_RX_SLOTS*i + ch->rx_slot] = b < blocks ?
+                    __builtin_conv_FtoR(ch->x[ch->taps - 1 + b * NUM_SAMPLES + i]) : 0;
+        }
+
+        emu_codec_block(rx, txa, txb);
+
+        if(b < EMU_CODEC_LATENCY)
+            continue;
+
+        for(c = 0; c < FIR_CHANNELS; c++)
+        {
+            hotswap_channel *ch = &channels[c];
+            const int *tx = ch->tx_block ? txb : txa;
+
+            for(i = 0; i < NUM_SAMPLES; i++)
+                ch->y[(b - EMU_CODEC_LATENCY) * NUM_SAMPLES + i] =
+                    __builtin_conv_RtoF(tx[NUM_TX_SLOTS*i + ch->tx_slot]);
+        }
+    }
+
+    for(c = 0; c < FIR_CHANNELS; c++)
+    {
+        hotswap_channel *ch = &channels[c];
+
+        emu_reference_fir(ch->x, ch->coeffs, ch->taps, ch->ref[0], length);
+        emu_reference_fir(ch->x, ch->b, ch->taps, ch->ref[1], length);
+    }
+}
+
+static void release(void)
+{
+    int c;
+
+    for(c = 0; c < FIR_CHANNELS; c++)
+    {
+        free(channels[c].x);
+        free(channels[c].y);
+        free(channels[c].ref[0]);
+        free(channels[c].ref[1]);
+    }
+}
+
+/* Walks the classes of every block of every channel. Returns the number of
+ * torn blocks or of blocks that are not the current set or a swap from it,
+ * counts the swaps and remembers the first block of each channel in the
+ * other set. */
+static long check_blocks(long blocks, long *swaps, long *fades, long *first_b, long *first_a)
+{
+    long bad = 0, n;
+    int c, cls, current;
+
+    *swaps = *fades = 0;
+
+    for(c = 0; c < FIR_CHANNELS; c++)
+    {
+        current = CLASS_A;
+        first_b[c] = first_a[c] = -1;
+
+        for(n = 0; n < blocks; n++)
+        {
+            cls = classify(&channels[c], n);
+
+            if(cls == current)
+                continue;
+
+            if(cls == CLASS_A || cls == CLASS_B)
+            {
+                (*swaps)++;
+                current = cls;
+            }
+            else if((cls == CLASS_RAMP_TO_B && current == CLASS_A) ||
+                    (cls == CLASS_RAMP_TO_A && current == CLASS_B))
+            {
+                (*swaps)++;
+                (*fades)++;
+                current = cls == CLASS_RAMP_TO_B ? CLASS_B : CLASS_A;
+            }
+            else
+            {
+                if(bad++ < 4)
+                    printf("  channel %d block %ld: %s\n", c + 1, n,
+                           cls == CLASS_TORN ? "torn" : "ramp from the wrong set");
+                continue;
+            }
+
+            if(current == CLASS_B && first_b[c] < 0)
+                first_b[c] = n;
+            if(current == CLASS_A && first_b[c] >= 0 && first_a[c] < 0)
+                first_a[c] = n;
+        }
+    }
+
+    return bad;
+}
+
+/*-------------------------------------------------------------------------------*/
+/* Part one: one hard swap to B, one crossfade back to A */
+
+static void stage_between_blocks(long b)
+{
+    int c;
+
+    for(c = 0; c < FIR_CHANNELS && (b == HOTSWAP_HARD_BLOCK || b == HOTSWAP_FADE_BLOCK); c++)
+    {
+        hotswap_channel *ch = &channels[c];
+        int temp;
+
+        if(FIXED_CHANNEL(c) || SDRAM_CHANNEL(c))
+            continue;
+
+        temp = b == HOTSWAP_HARD_BLOCK ? coeffStage(c, ch->b, ch->taps, false)
+                                       : coeffStage(c, ch->coeffs, ch->taps, true);
+        if(temp != 0)
+            printf("  channel %d refused the set staged before block %ld\n", c + 1, b);
+    }
+}
+
+static int run_staged(long blocks)
+{
+    long swaps, fades, first_b[FIR_CHANNELS], first_a[FIR_CHANNELS];
+    long bad;
+    int failed = 0, swapped = 0;
+    int c, shown = -1;
+
+    prepare(blocks);
+    stream(blocks, stage_between_blocks);
+    bad = check_blocks(blocks, &swaps, &fades, first_b, first_a);
+
+    for(c = 0; c < FIR_CHANNELS; c++)
+    {
+        if(FIXED_CHANNEL(c) || SDRAM_CHANNEL(c))
+            continue;
+        if(shown < 0)
+            shown = c;
+        swapped++;
+
+        /* Live with the block staged before, or with the next one when the
+         * pass of the block was already started */
+        if(first_b[c] < HOTSWAP_HARD_BLOCK || first_b[c] > HOTSWAP_HARD_BLOCK + 1 ||
+           first_a[c] < HOTSWAP_FADE_BLOCK || first_a[c] > HOTSWAP_FADE_BLOCK + 1)
+        {
+            printf("  channel %d: set B from block %ld, ramp back from block %ld\n",
+                   c + 1, first_b[c], first_a[c]);
+            failed = 1;
+        }
+    }
+
+    if(bad != 0 || swaps != 2 * swapped || fades != swapped)
+        failed = 1;
+
+    printf("staged swaps: B before block %d live at block %ld, crossfade to A before block %d "
+           "ramped at block %ld, %ld bad blocks %s\n", HOTSWAP_HARD_BLOCK, first_b[shown],
+           HOTSWAP_FADE_BLOCK, first_a[shown], bad, failed ? "FAILED" : "ok");
+
+    release();
+    return failed;
+}
+
+/*-------------------------------------------------------------------------------*/
+/* Part two: a control thread stages sets while the main thread processes */
+
+static volatile int control_stop;
+static long staged, refused;
+static double stage_max;
+
+static void *control_thread(void *arg)
+{
+    unsigned int r = 11;
+    int set[FIR_CHANNELS] = { 0 };
+    double t0, t;
+    int c;
+
+    (void)arg;
+
+    while(!control_stop)
+    {
+        for(c = 0; c < FIR_CHANNELS; c++)
+        {
+            hotswap_channel *ch = &channels[c];
+
+            if(FIXED_CHANNEL(c) || SDRAM_CHANNEL(c))
+                continue;
+
+            r = r * 1664525u + 1013904223u;
+
+            t0 = emu_seconds();
+            if(coeffStage(c, set[c] ? ch->coeffs : ch->b, ch->taps, (r >> 16) & 1) == 0)
+            {
+                set[c] ^= 1;
+                staged++;
+            }
+            else
+            {
+                refused++;
+            }
+            t = emu_seconds() - t0;
+            if(t > stage_max)
+                stage_max = t;
+        }
+        sched_yield();
+    }
+
+    return NULL;
+}
+
+static pthread_t control;
+static double block_max;
+static double block_last;
+
+static void time_block(long b)
+{
+    double now = emu_seconds();
+
+    if(b > 0 && now - block_last > block_max)
+        block_max = now - block_last;
+    block_last = now;
+}
+
+static int run_threaded(long blocks)
+{
+    long swaps, fades, first_b[FIR_CHANNELS], first_a[FIR_CHANNELS];
+    long bad;
+    int failed = 0;
+
+    control_stop = 0;
+    staged = refused = 0;
+
+    /* The thread only starts staging once the codec path is set up */
+    prepare(blocks);
+
+    if(pthread_create(&control, NULL, control_thread, NULL) != 0)
+    {
+        printf("cannot start the control thread\n");
+        return 2;
+    }
+
+    stream(blocks, time_block);
+
+    control_stop = 1;
+    pthread_join(control, NULL);
+
+    bad = check_blocks(blocks, &swaps, &fades, first_b, first_a);
+
+    if(bad != 0 || swaps == 0 || fades == 0)
+        failed = 1;
+
+    printf("control thread: %ld sets staged, %ld refused while one was on its way, "
+           "longest coeffStage() %.1f us\n", staged, refused, stage_max * 1e6);
+    printf("processing: %ld blocks, %ld swaps of which %ld crossfades, %ld bad blocks, "
+           "longest block %.1f us %s\n", blocks, swaps, fades, bad, block_max * 1e6,
+           failed ? "FAILED" : "ok");
+
+    release();
+    return failed;
+}
+
+/* The codec path boots once per process, so every part runs in a child like
+ * the block sizes of emu_blocksize.c. Returns the exit status of the part. */
+static int boot(int (*part)(long), long blocks)
+{
+    int status;
+    pid_t pid;
+
+    fflush(stdout);
+    pid = fork();
+    if(pid == 0)
+    {
+        status = part(blocks);
+        fflush(stdout);
+        _exit(status);
+    }
+
+    if(pid < 0 || waitpid(pid, &status, 0) != pid || !WIFEXITED(status))
+        return 2;
+    return WEXITSTATUS(status);
+}
+
+int emu_hotswap(const char *dir, int argc, char *argv[])
+{
+    long blocks = argc > 0 ? atol(argv[0]) : 1000;
+    int failed = 0;
+
+    (void)dir;
+
+    if(FFT_CONVOLUTION)
+    {
+        printf("coefficient banks are not used by the FFT convolution build\n");
+        return coeffStage(0, Coeff_Buf1, TAPSIZE1, false) == -1 ? 0 : 1;
+    }
+
+    failed |= boot(run_staged, HOTSWAP_BLOCKS);
+    failed |= boot(run_threaded, blocks);
+
+    return failed;
+}
@@ -0,0 +1,286 @@
+/*
+ * NAME:     emu_hybrid.c
+ * PURPOSE:  fir_emu hybrid mode.
+ * USAGE:    fir_emu hybrid [data directory] [blocks]
+ *
+ *           Sweeps the core cost of hybridModel and prints the split
+ *           hybridPlan() picks for each value, checking that the fixed-point
+ *           and multirate channels stay off the core, one channel stays in the
+ *           chain and no split is slower than leaving every channel on the
+ *           accelerator.
+ *
+ *           With HYBRID_SCHEDULING set, streams noise through the codec path
+ *           and checks every float channel, wherever it was filtered, against
+ *           a double precision convolution. Then prints the end of the
+ *           decision log and the cycles per MAC of both sides fitted from it.
+ *           The emulated accelerator only runs while the core waits in NOP(),
+ *           so on the host its cycles include the core's and only the core
+ *           side of the fit means anything.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "ADDS_21479_EzKit.h"
+#include "emu_util.h"
+#include "emu_codec.h"
+#include "fir_emu.h"
+
+#define HYBRID_SCALE        0.25f
+#define HYBRID_TOLERANCE    1e-5
+
+/* Entries of the log printed after the run */
+#define HYBRID_SHOWN        8
+
+/* State of emu_noise() */
+static unsigned int seed = 11;
+
+/* Same cost as hybridSchedule.c with every channel on the accelerator */
+static unsigned int all_on_accelerator(const hybrid_cost_model *m)
+{
+    unsigned int a = 0;
+    int ch;
+
+    for(ch = 0; ch < FIR_CHANNELS; ch++)
+    {
+        if(!FIXED_CHANNEL(ch))
+            a += (unsigned int)(m->acc_cycles_per_mac * FIR_Channels[ch].taps * FIR_OUTPUTS(&FIR_Channels[ch])) +
+                 m->acc_cycles_per_channel;
+    }
+    return a;
+}
+
+static void print_mask(unsigned int mask)
+{
+    char text[3 * FIR_CHANNELS + 1];
+    int ch, n = 0;
+
+    for(ch = 0; ch < FIR_CHANNELS; ch++)
+    {
+        if((mask >> ch) & 1)
+            n += sprintf(&text[n], "%s%d", n ? "," : "", ch + 1);
+    }
+    printf(" %-10s", n ? text : "-");
+}
+
+/*-------------------------------------------------------------------------------*/
+/* Plans */
+
+static int run_plans(void)
+{
+    static const float core_costs[] = { 0.25f, 0.5f, 1.0f, 2.0f, 4.0f, 8.0f };
+    unsigned int float_mask = 0, multirate_mask = 0, mask, acc, core, all;
+    int failed = 0;
+    int ch, i;
+
+    for(ch = 0; ch < FIR_CHANNELS; ch++)
+    {
+        if(!FIXED_CHANNEL(ch))
+            float_mask |= 1u << ch;
+        if(FIR_Channels[ch].ratio != 1)
+            multirate_mask |= 1u << ch;
+    }
+
+    printf("plans for %d samples per block, %.2f accelerator cycles per MAC\n",
+           blockSamples, hybridModel.acc_cycles_per_mac);
+    printf("%10s %-10s %10s %10s %10s\n", "core/MAC", " core", "acc", "core", "acc only");
+
+    for(i = 0; i < (int)(sizeof(core_costs) / sizeof(core_costs[0])); i++)
+    {
+        hybrid_cost_model m = hybridModel;
+        int bad;
+
+        m.core_cycles_per_mac = core_costs[i];
+        mask = hybridPlan(&m, &acc, &core);
+        all = all_on_accelerator(&m);
+
+        bad = (mask & ~float_mask) != 0 || (mask & multirate_mask) != 0 ||
+              mask == float_mask || (acc > core ? acc : core) > all;
+
+        printf("%10.2f", m.core_cycles_per_mac);
+        print_mask(mask);
+        printf(" %10u %10u %10u%s\n", acc, core, all, bad ? "  FAILED" : "");
+
+        failed |= bad;
+    }
+
+    return failed;
+}
+
+/*-------------------------------------------------------------------------------*/
+/* Codec path and decision log */
+
+static double reference(const float *x, const float *c, int taps, long k)
+{
+    double acc = 0.0;
+    int j;
+
+    for(j = 0; j < taps; j++)
+        acc += (double)c[j] * x[k + taps - 1 - j];
+    return acc;
+}
+
+static int run_codec(long blocks)
+{
+    static int rx[RX_BLOCK_MAX], txa[TX_BLOCK_MAX], txb[TX_BLOCK_MAX];
+    static const int tx_block[FIR_CHANNELS] = { 0, 0, 1, 1 };
+    static const int tx_slot[FIR_CHANNELS] = { 0, 1, 0, 1 };
+    long count = blocks * NUM_SAMPLES, b, k;
+    float *x[FIR_CHANNELS];
+    double err[FIR_CHANNELS] = { 0.0 }, d;
+    double acc_cycles = 0.0, core_cycles = 0.0, acc_macs = 0.0, core_macs = 0.0;
+    unsigned int first, n, logged = 0, mismatched = 0;
+    int failed = 0;
+    int ch, i;
+
+    for(ch = 0; ch < FIR_CHANNELS; ch++)
+    {
+        int taps = FIR_Channels[ch].taps;
+
+        x[ch] = calloc(taps - 1 + count, sizeof(float));
+        for(k = 0; k < count; k++)
+            x[ch][taps - 1 + k] = __builtin_conv_RtoF(__builtin_conv_FtoR(emu_noise(&seed) * HYBRID_SCALE));
+    }
+
+    for(b = 0; b < blocks + EMU_CODEC_LATENCY; b++)
+    {
+        for(ch = 0; ch < FIR_CHANNELS; ch++)
+        {
+            for(i = 0; i < NUM_SAMPLES; i++)
+                rx[NUM_RX_SLOTS*i + ch] = b < blocks ?
+                    __builtin_conv_FtoR(x[ch][FIR_Channels[ch].taps - 1 + b * NUM_SAMPLES + i]) : 0;
+        }
+
+        emu_codec_block(rx, txa, txb);
+
+        if(b < EMU_CODEC_LATENCY)
+            continue;
+
+        for(ch = 0; ch < FIR_CHANNELS; ch++)
+        {
+            const int *tx = tx_block[ch] ? txb : txa;
+
+            if(FIXED_CHANNEL(ch) || FIR_Channels[ch].ratio != 1)
+                continue;
+
+            for(i = 0; i < NUM_SAMPLES; i++)
+            {
+                k = (b - EMU_CODEC_LATENCY) * NUM_SAMPLES + i;
+                d = fabs(__builtin_conv_RtoF(tx[NUM_TX_SLOTS*i + tx_slot[ch]]) -
+                         reference(x[ch], FIR_Channels[ch].coeffs, FIR_Channels[ch].taps, k));
+                if(d > err[ch])
+                    err[ch] = d;
+            }
+        }
+    }
+
+    for(ch = 0; ch < FIR_CHANNELS; ch++)
+    {
+        const char *where = (hybridStats.core_mask >> ch) & 1 ? "core" :
+                            FIXED_CHANNEL(ch) ? "core, 1.31" : "accelerator";
+
+        if(FIXED_CHANNEL(ch) || FIR_Channels[ch].ratio != 1)
+        {
+            printf("channel %d: %-11s  not checked here\n", ch + 1, where);
+        }
+        else
+        {
+            printf("channel %d: %-11s  max error %.3g %s\n", ch + 1, where, err[ch],
+                   err[ch] <= HYBRID_TOLERANCE ? "ok" : "FAILED");
+            if(err[ch] > HYBRID_TOLERANCE)
+                failed = 1;
+        }
+        if(((hybridStats.core_mask >> ch) & 1) && firChainIndex[ch] >= 0)
+        {
+            printf("channel %d: also in the TCB chain FAILED\n", ch + 1);
+            failed = 1;
+        }
+        free(x[ch]);
+    }
+
+    /* The log holds the last HYBRID_LOG_SIZE blocks either side started,
+     * complete up to the ones both sides finished */
+    n = hybridStats.blocks > hybridStats.passes ? hybridStats.blocks : hybridStats.passes;
+    first = n > HYBRID_LOG_SIZE ? n - HYBRID_LOG_SIZE : 0;
+    n = hybridStats.blocks < hybridStats.passes ? hybridStats.blocks : hybridStats.passes;
+
+    printf("\n%u blocks on the core, %u chains on the accelerator\n", hybridStats.blocks,
+           hybridStats.passes);
+    printf("%8s %-10s %12s %12s %12s %12s\n", "block", " core", "acc pred", "acc", "core pred", "core");
+
+    for(; first < n; first++)
+    {
+        const hybrid_entry *e = &hybridStats.log[first % HYBRID_LOG_SIZE];
+
+        if(e->block != first || e->core_mask != hybridStats.core_mask)
+            mismatched++;
+
+        acc_cycles += e->acc_cycles;
+        core_cycles += e->core_cycles;
+        logged++;
+
+        if(n - first <= HYBRID_SHOWN)
+        {
+            printf("%8u", e->block);
+            print_mask(e->core_mask);
+            printf(" %12u %12u %12u %12u\n", e->predicted_acc, e->acc_cycles, e->predicted_core,
+                   e->core_cycles);
+        }
+    }
+
+    if(hybridStats.blocks != blocks + EMU_CODEC_LATENCY || logged == 0 || mismatched != 0)
+    {
+        printf("decision log: %u entries, %u out of place FAILED\n", logged, mismatched);
+        failed = 1;
+    }
+
+    for(ch = 0; ch < FIR_CHANNELS; ch++)
+    {
+        const fir_channel_config *c = &FIR_Channels[ch];
+
+        if((hybridStats.core_mask >> ch) & 1)
+            core_macs += (double)c->taps * c->window;
+        else if(!FIXED_CHANNEL(ch))
+            acc_macs += (double)c->taps * FIR_OUTPUTS(c);
+    }
+
+    if(logged != 0)
+    {
+        acc_cycles /= logged;
+        core_cycles /= logged;
+        printf("average: accelerator %.0f cycles, predicted %u; core %.0f cycles, predicted %u\n",
+               acc_cycles, hybridStats.predicted_acc, core_cycles, hybridStats.predicted_core);
+        printf("fitted cycles per MAC: accelerator %.3f (model %.3f), core %.3f (model %.3f)\n",
+               acc_macs ? acc_cycles / acc_macs : 0.0, hybridModel.acc_cycles_per_mac,
+               core_macs ? core_cycles / core_macs : 0.0, hybridModel.core_cycles_per_mac);
+    }
+
+    return failed;
+}
+
+int emu_hybrid(const char *dir, int argc, char *argv[])
+{
+    long blocks = argc > 0 ? atol(argv[0]) : 200;
+    int failed;
+
+    (void)dir;
+
+    emu_codec_init(NUM_SAMPLES);
+
+    failed = run_plans();
+
+    if(!HYBRID_SCHEDULING)
+    {
+        printf("\ncodec path: every channel on the accelerator, HYBRID_SCHEDULING is 0\n");
+        return failed;
+    }
+
+    printf("\nboot plan:");
+    print_mask(hybridStats.core_mask);
+    printf(" on the core, %u accelerator and %u core cycles predicted\n",
+           hybridStats.predicted_acc, hybridStats.predicted_core);
+
+    failed |= run_codec(blocks);
+
+    return failed;
+}
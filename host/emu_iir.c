@@ -0,0 +1,353 @@
+/*
+ * NAME:     emu_iir.c
+ * PURPOSE:  fir_emu iir mode.
+ * USAGE:    fir_emu iir [data directory] [blocks]
+ *
+ *           Checks the IIR accelerator path: the IIRCTL1/IIRCTL2 values and the
+ *           configurations iirChain.c has to refuse, chains of biquad
+ *           cascades run for several windows against a double precision
+ *           reference, which only matches when the states carry over, and
+ *           the EQ channels streamed through the codec path, where the engine
+ *           is switched from the FIR chain to the IIR chain and back every
+ *           block. Ends with the cost of the EQ cascade per sample next to
+ *           the FIR that would match its impulse response.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "ADDS_21479_EzKit.h"
+#include "sharc_emu.h"
+#include "emu_util.h"
+#include "emu_codec.h"
+#include "fir_emu.h"
+
+extern float EQ_Biquads[EQ_BIQUADS*IIR_BIQUAD_COEFFS];
+
+/* Single precision states against double, through poles close to z = 1 */
+#define IIR_TOLERANCE       1e-4
+
+/* Impulse response energy left out by the equivalent FIR */
+#define IIR_FIR_TAIL        1e-6
+#define IIR_FIR_MAX_TAPS    (1 << 16)
+
+#define IIR_ITERATIONS      4
+#define IIR_SCALE           0.25f
+
+typedef struct {
+    const char *name;
+    int channels;
+    int biquads;            /* 0 for the EQ cascade */
+    int window;
+} iir_case;
+
+static const iir_case cases[] = {
+    { "single biquad",       1,                1,               1 },
+    { "EQ cascade",          IIR_CHANNELS,     0,               NUM_SAMPLES },
+    { "longest cascade",     3,                IIR_MAX_BIQUADS, IIR_MAX_WINDOW },
+    { "channel limit",       IIR_MAX_CHANNELS, 2,               64 },
+};
+
+#define NUM_CASES (int)(sizeof(cases) / sizeof(cases[0]))
+
+/* State of emu_noise() */
+static unsigned int seed = 3;
+
+static int check(const char *what, int ok)
+{
+    if(!ok)
+        printf("  %s FAILED\n", what);
+    return !ok;
+}
+
+static int check_registers(void)
+{
+    static iir_channel_config config[2];
+    static float buf[IIR_MAX_WINDOW], state[2][IIR_BIQUAD_STATES];
+    static iir_chain chain;
+    int failed = 0;
+    int i;
+
+    failed |= check("IIRCTL2 for 8 biquads, window 256",
+                    iirChainCtl2(8, 256) == (7 | (255 << IIRCTL2_WINDOW_SHIFT)));
+    failed |= check("IIRCTL2 round trip at the limits",
+                    IIRCTL2_GET_BIQUADS(iirChainCtl2(IIR_MAX_BIQUADS, IIR_MAX_WINDOW)) == IIR_MAX_BIQUADS &&
+                    IIRCTL2_GET_WINDOW(iirChainCtl2(IIR_MAX_BIQUADS, IIR_MAX_WINDOW)) == IIR_MAX_WINDOW);
+    failed |= check("IIRCTL2 refuses 0 or too many biquads",
+                    iirChainCtl2(0, 256) == -1 && iirChainCtl2(IIR_MAX_BIQUADS + 1, 256) == -1);
+    failed |= check("IIRCTL2 refuses an empty or too long window",
+                    iirChainCtl2(8, 0) == -1 && iirChainCtl2(8, IIR_MAX_WINDOW + 1) == -1);
+
+    failed |= check("IIRCTL1 for 4 channels", iirChainCtl1(4) == (IIR_EN | IIR_DMAEN | IIR_CH(4)));
+    failed |= check("IIRCTL1 refuses 0 or 25 channels",
+                    iirChainCtl1(0) == -1 && iirChainCtl1(IIR_MAX_CHANNELS + 1) == -1);
+
+    for(i = 0; i < 2; i++)
+    {
+        config[i].biquads = 1;
+        config[i].window = 256;
+        config[i].coeffs = buf;
+        config[i].state = state[i];
+        config[i].in = buf;
+        config[i].in_length = 256;
+        config[i].out = buf;
+        state[i][0] = state[i][1] = 1.0f;
+    }
+
+    chain.channels = -1;
+    failed |= check("build of a valid chain clears the states",
+                    iirChainBuild(&chain, config, 2) == 0 && chain.channels == 2 &&
+                    chain.iirctl1 == iirChainCtl1(2) && state[1][0] == 0.0f && state[1][1] == 0.0f);
+
+    config[1].in_length--;
+    chain.channels = -1;
+    failed |= check("build refuses an input buffer shorter than the window",
+                    iirChainBuild(&chain, config, 2) == -1 && chain.channels == -1);
+    config[1].in_length++;
+
+    config[1].biquads = IIR_MAX_BIQUADS + 1;
+    failed |= check("build refuses a channel over the biquad limit",
+                    iirChainBuild(&chain, config, 2) == -1 && chain.channels == -1);
+
+    printf("register values and refused configurations %s\n", failed ? "FAILED" : "ok");
+    return failed;
+}
+
+/* Stable random biquad: poles and zeros inside the unit circle */
+static void random_biquad(float *c)
+{
+    double r = 0.5 + 0.45 * (emu_noise(&seed) + 1.0f) * 0.5, w = 3.1 * (emu_noise(&seed) + 1.0f) * 0.5;
+    double rz = 0.9 * (emu_noise(&seed) + 1.0f) * 0.5, wz = 3.1 * (emu_noise(&seed) + 1.0f) * 0.5;
+    double g = 0.5 + 0.25 * emu_noise(&seed);
+
+    c[0] = (float)g;
+    c[1] = (float)(-2.0 * rz * cos(wz) * g);
+    c[2] = (float)(rz * rz * g);
+    c[3] = (float)(-2.0 * r * cos(w));
+    c[4] = (float)(r * r);
+}
+
+static int run_case(const iir_case *tc)
+{
+    static iir_channel_config config[IIR_MAX_CHANNELS];
+    static iir_chain chain;
+    float *coeffs[IIR_MAX_CHANNELS], *in[IIR_MAX_CHANNELS], *out[IIR_MAX_CHANNELS];
+    int length = IIR_ITERATIONS * tc->window;
+    double *ref, err = 0.0, e;
+    unsigned long long biquads;
+    int failed = 0;
+    int c, k, n;
+
+    for(c = 0; c < tc->channels; c++)
+    {
+        iir_channel_config *cfg = &config[c];
+        int count = tc->biquads ? tc->biquads : EQ_BIQUADS;
+
+        coeffs[c] = malloc(count * IIR_BIQUAD_COEFFS * sizeof(float));
+        in[c] = malloc(length * sizeof(float));
+        out[c] = malloc(length * sizeof(float));
+
+        for(n = 0; n < count; n++)
+        {
+            if(tc->biquads)
+                random_biquad(&coeffs[c][n * IIR_BIQUAD_COEFFS]);
+            else
+                for(k = 0; k < IIR_BIQUAD_COEFFS; k++)
+                    coeffs[c][n * IIR_BIQUAD_COEFFS + k] = EQ_Biquads[n * IIR_BIQUAD_COEFFS + k];
+        }
+        for(n = 0; n < length; n++)
+            in[c][n] = emu_noise(&seed) * IIR_SCALE;
+
+        cfg->biquads = count;
+        cfg->window = tc->window;
+        cfg->coeffs = coeffs[c];
+        cfg->state = malloc(count * IIR_BIQUAD_STATES * sizeof(float));
+        cfg->in = in[c];
+        cfg->in_length = length;
+        cfg->out = out[c];
+    }
+
+    emu_reset();
+    selectAccelerator(IIRACCSEL);
+    emu_completion_init();
+
+    failed |= check("build", iirChainBuild(&chain, config, tc->channels) == 0);
+    failed |= check("ring", chain.tcb[tc->channels - 1][IIR_TCB_CP] == IIR_TCB_LINK(chain.tcb[0]));
+    if(failed)
+        return 1;
+
+    biquads = iir_accel_statistics.biquads;
+
+    for(k = 0; k < IIR_ITERATIONS; k++)
+    {
+        for(c = 0; c < tc->channels; c++)
+            iirChainSetOutput(&chain, c, out[c] + k * tc->window);
+
+        iirChainStart(&chain);
+        emu_completion_wait(k + 1);
+    }
+
+    failed |= check("chain pointer back at the first channel", *pCPIIR == IIR_TCB_LINK(chain.tcb[0]));
+    failed |= check("every biquad of every sample once",
+                    iir_accel_statistics.biquads - biquads ==
+                    (unsigned long long)length * config[0].biquads * tc->channels);
+
+    ref = malloc(length * sizeof(double));
+    for(c = 0; c < tc->channels; c++)
+    {
+        emu_reference_biquads(in[c], coeffs[c], config[c].biquads, ref, length);
+        e = emu_max_error(out[c], ref, length);
+        if(e > err)
+            err = e;
+
+        free(coeffs[c]);
+        free(config[c].state);
+        free(in[c]);
+        free(out[c]);
+    }
+    free(ref);
+
+    failed |= check("output", err <= IIR_TOLERANCE);
+
+    printf("%-16s %2d channels, %2d biquads, window %4d, %d starts: max error %.3g %s\n",
+           tc->name, tc->channels, config[0].biquads, tc->window, IIR_ITERATIONS, err,
+           failed ? "FAILED" : "ok");
+
+    return failed;
+}
+
+/* FIR passes per block: the chain, then every tile of the SDRAM channels */
+static unsigned long long fir_passes(void)
+{
+    unsigned long long passes = 1;
+    int ch;
+
+    for(ch = 0; ch < FIR_CHANNELS; ch++)
+    {
+        if(SDRAM_CHANNEL(ch))
+            passes += (unsigned long long)Sdram_Channels[ch].tiles;
+    }
+    return passes;
+}
+
+/* EQ channels through handleCodecData, TX slots 2 and 3 of both SPORT0 blocks */
+static int run_codec(long blocks)
+{
+    static int rx[RX_BLOCK_MAX], txa[TX_BLOCK_MAX], txb[TX_BLOCK_MAX];
+    long length = blocks * NUM_SAMPLES, b;
+    float *x[IIR_CHANNELS], *y[IIR_CHANNELS];
+    double *ref, err = 0.0, e;
+    unsigned long long fir_iterations, iir_iterations;
+    int failed = 0;
+    int c, i;
+
+    for(c = 0; c < IIR_CHANNELS; c++)
+    {
+        x[c] = malloc(length * sizeof(float));
+        y[c] = malloc(length * sizeof(float));
+        for(i = 0; i < length; i++)
+            x[c][i] = __builtin_conv_RtoF(__builtin_conv_FtoR(emu_noise(&seed) * IIR_SCALE));
+    }
+
+    emu_codec_init(NUM_SAMPLES);
+
+    /* The last blocks flush the pipeline */
+    for(b = 0; b < blocks + EMU_CODEC_LATENCY; b++)
+    {
+        for(i = 0; i < NUM_SAMPLES; i++)
+            for(c = 0; c < IIR_CHANNELS; c++)
+                rx[NUM_RX_SLOTS*i + c] = b < blocks ? __builtin_conv_FtoR(x[c][b * NUM_SAMPLES + i]) : 0;
+
+        emu_codec_block(rx, txa, txb);
+
+        if(b < EMU_CODEC_LATENCY)
+            continue;
+
+        for(i = 0; i < NUM_SAMPLES; i++)
+        {
+            long n = (b - EMU_CODEC_LATENCY) * NUM_SAMPLES + i;
+
+            y[0][n] = __builtin_conv_RtoF(txa[NUM_TX_SLOTS*i + 2]);
+            y[1][n] = __builtin_conv_RtoF(txa[NUM_TX_SLOTS*i + 3]);
+            y[2][n] = __builtin_conv_RtoF(txb[NUM_TX_SLOTS*i + 2]);
+            y[3][n] = __builtin_conv_RtoF(txb[NUM_TX_SLOTS*i + 3]);
+        }
+    }
+
+    fir_iterations = fir_accel_statistics.iterations;
+    iir_iterations = iir_accel_statistics.iterations;
+
+    ref = malloc(length * sizeof(double));
+    for(c = 0; c < IIR_CHANNELS; c++)
+    {
+        emu_reference_biquads(x[c], EQ_Biquads, EQ_BIQUADS, ref, length);
+        e = emu_max_error(y[c], ref, length);
+        if(e > err)
+            err = e;
+
+        free(x[c]);
+        free(y[c]);
+    }
+    free(ref);
+
+    failed |= check("EQ outputs", err <= IIR_TOLERANCE);
+    /* The last block of the pipeline may still be on the engine */
+    failed |= check("one IIR pass per block", iir_iterations >= (unsigned long long)blocks);
+    failed |= check("one FIR pass and the SDRAM tiles before every IIR pass",
+                    FFT_CONVOLUTION ? fir_iterations == 0 : fir_iterations == fir_passes() * iir_iterations);
+
+    printf("codec path       %ld blocks, %llu FIR and %llu IIR passes on one engine: max error %.3g %s\n",
+           blocks, fir_iterations, iir_iterations, err, failed ? "FAILED" : "ok");
+
+    return failed;
+}
+
+/* Taps of the FIR that keeps all but IIR_FIR_TAIL of the energy of the EQ
+ * impulse response */
+static int equivalent_taps(void)
+{
+    static float impulse[IIR_FIR_MAX_TAPS];
+    static double h[IIR_FIR_MAX_TAPS];
+    double total = 0.0, tail = 0.0;
+    int n;
+
+    impulse[0] = 1.0f;
+    emu_reference_biquads(impulse, EQ_Biquads, EQ_BIQUADS, h, IIR_FIR_MAX_TAPS);
+
+    for(n = 0; n < IIR_FIR_MAX_TAPS; n++)
+        total += h[n] * h[n];
+
+    for(n = IIR_FIR_MAX_TAPS - 1; n > 0; n--)
+    {
+        tail += h[n] * h[n];
+        if(tail > IIR_FIR_TAIL * total)
+            break;
+    }
+
+    return n + 1;
+}
+
+int emu_iir(const char *dir, int argc, char *argv[])
+{
+    long blocks = argc > 0 ? atol(argv[0]) : 64;
+    int taps, macs;
+    int failed = 0;
+    int i;
+
+    (void)dir;
+
+    failed |= check_registers();
+
+    for(i = 0; i < NUM_CASES; i++)
+        failed |= run_case(&cases[i]);
+
+    failed |= run_codec(blocks);
+
+    taps = equivalent_taps();
+    macs = EQ_BIQUADS * IIR_BIQUAD_COEFFS;
+    printf("EQ cascade: %d biquads, %d MACs per sample; FIR to %.0f dB of its impulse response: "
+           "%d taps, %.0fx the MACs\n", EQ_BIQUADS, macs, 10.0 * log10(IIR_FIR_TAIL), taps,
+           (double)taps / macs);
+
+    return failed;
+}
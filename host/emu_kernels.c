@@ -0,0 +1,131 @@
+/*
+ * NAME:     emu_kernels.c
+ * PURPOSE:  fir_emu kernels mode.
+ * USAGE:    fir_emu kernels [data directory] [blocks]
+ *
+ *           Filters the same noise with every specialised kernel of
+ *           Core_Fir_Kernels[] and with coreFirGeneric(): the 65 tap filter
+ *           of coeffs*.dat and the 256 and 1024 tap lengths the indata*.dat
+ *           vectors were made for, with random coefficients, at 64, 256 and
+ *           1024 samples per block. Prints the time per block of both and the
+ *           largest difference, which has to be nothing beyond rounding. Also
+ *           checks that a pair without a kernel falls back to the generic loop.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "ADDS_21479_EzKit.h"
+#include "emu_util.h"
+#include "fir_emu.h"
+
+extern float Coeff_Buf1[TAPSIZE1];
+
+/* Same products in the same order, only FMA contraction could differ */
+#define KERNELS_TOLERANCE   1e-6
+
+#define MAX_KERNEL_TAPS     1024
+
+/* State of emu_noise() */
+static unsigned int seed = 7;
+
+static double max_difference(const float *a, const float *b, long count)
+{
+    double err = 0.0, d;
+    long k;
+
+    for(k = 0; k < count; k++)
+    {
+        d = fabs((double)a[k] - b[k]);
+        if(d > err)
+            err = d;
+    }
+    return err;
+}
+
+/* The project's filter for its tap count, otherwise noise with an output
+ * level of about 1/2 */
+static void make_coeffs(int taps, float *c)
+{
+    int i;
+
+    for(i = 0; i < taps; i++)
+        c[i] = taps == TAPSIZE1 ? Coeff_Buf1[i] : emu_noise(&seed) * 0.5f / sqrtf((float)taps);
+}
+
+int emu_kernels(const char *dir, int argc, char *argv[])
+{
+    static float c[MAX_KERNEL_TAPS];
+    long blocks = argc > 0 ? atol(argv[0]) : 64;
+    int failed = 0;
+    int e;
+
+    (void)dir;
+
+    printf("%ld blocks per run\n", blocks);
+    printf("%6s %6s %12s %12s %8s %10s\n", "taps", "block", "generic us", "kernel us",
+           "speedup", "max diff");
+
+    for(e = 0; e < CORE_FIR_KERNELS; e++)
+    {
+        const core_fir_entry *k = &Core_Fir_Kernels[e];
+        long length = blocks * k->length, n, b;
+        float *x = calloc(k->taps - 1 + length, sizeof(float));
+        float *generic = malloc(length * sizeof(float));
+        float *special = malloc(length * sizeof(float));
+        core_fir_kernel kernel = coreFirSelect(k->taps, k->length);
+        double t0, t1, t2, err;
+
+        if(!x || !generic || !special)
+        {
+            fprintf(stderr, "out of memory\n");
+            return 2;
+        }
+        make_coeffs(k->taps, c);
+
+        for(n = 0; n < length; n++)
+            x[k->taps - 1 + n] = emu_noise(&seed) * 0.5f;
+
+        t0 = emu_seconds();
+        for(b = 0; b < blocks; b++)
+            coreFirGeneric(&x[b * k->length], c, k->taps, &generic[b * k->length], k->length);
+        t1 = emu_seconds();
+        for(b = 0; b < blocks; b++)
+            kernel(&x[b * k->length], c, &special[b * k->length]);
+        t2 = emu_seconds();
+
+        err = max_difference(special, generic, length);
+
+        printf("%6d %6d %12.1f %12.1f %7.1fx %10.3g%s\n", k->taps, k->length,
+               (t1 - t0) / blocks * 1e6, (t2 - t1) / blocks * 1e6, (t1 - t0) / (t2 - t1), err,
+               kernel == k->kernel && err <= KERNELS_TOLERANCE ? "" : "  FAILED");
+
+        if(kernel != k->kernel || err > KERNELS_TOLERANCE)
+            failed = 1;
+
+        free(x);
+        free(generic);
+        free(special);
+    }
+
+    /* A pair without a kernel goes through the generic loop */
+    {
+        float x[TAPSIZE1 - 1 + MIN_BLOCK_SAMPLES], y[MIN_BLOCK_SAMPLES], ref[MIN_BLOCK_SAMPLES];
+        int n;
+
+        for(n = 0; n < TAPSIZE1 - 1 + MIN_BLOCK_SAMPLES; n++)
+            x[n] = emu_noise(&seed);
+
+        coreFirGeneric(x, Coeff_Buf1, TAPSIZE1, ref, MIN_BLOCK_SAMPLES);
+        coreFirBlock(x, Coeff_Buf1, TAPSIZE1, y, MIN_BLOCK_SAMPLES);
+
+        if(coreFirSelect(TAPSIZE1, MIN_BLOCK_SAMPLES) != NULL ||
+           max_difference(y, ref, MIN_BLOCK_SAMPLES) != 0.0)
+        {
+            printf("%d taps at %d samples: generic fallback FAILED\n", TAPSIZE1, MIN_BLOCK_SAMPLES);
+            failed = 1;
+        }
+    }
+
+    return failed;
+}
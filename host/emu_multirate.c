@@ -0,0 +1,220 @@
+/*
+ * NAME:     emu_multirate.c
+ * PURPOSE:  fir_emu multirate mode.
+ * USAGE:    fir_emu multirate
+ *
+ *           Checks the decimating and interpolating channels of firChain.c:
+ *           the FIRCTL2 ratio and UPSAMP fields, the configurations that have
+ *           to be refused, and single channel chains run on the emulated
+ *           accelerator for several windows against a double precision
+ *           reference, every ratio-th output of the direct form for
+ *           decimation and the direct form of the zero stuffed input for
+ *           interpolation. Also checks that a channel only spends the
+ *           multiply-accumulates of the outputs it keeps.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "ADDS_21479_EzKit.h"
+#include "sharc_emu.h"
+#include "emu_util.h"
+#include "fir_emu.h"
+
+/* Single precision accumulation of up to FIR_MAX_TAPS products */
+#define MULTIRATE_TOLERANCE     1e-5
+
+#define MULTIRATE_ITERATIONS    3
+
+typedef struct {
+    const char *name;
+    int taps;
+    int window;
+    int ratio;
+    bool upsample;
+} multirate_case;
+
+static const multirate_case cases[] = {
+    { "decimate by 2",       TAPSIZE1,     NUM_SAMPLES,    2,             false },
+    { "decimate by 4",       256,          NUM_SAMPLES,    4,             false },
+    { "decimate by 16",      FIR_MAX_TAPS, FIR_MAX_WINDOW, FIR_MAX_RATIO, false },
+    { "interpolate by 2",    64,           128,            2,             true  },
+    { "interpolate by 4",    256,          64,             4,             true  },
+    { "interpolate by 16",   FIR_MAX_TAPS, 16,             FIR_MAX_RATIO, true  },
+};
+
+#define NUM_CASES (int)(sizeof(cases) / sizeof(cases[0]))
+
+/* State of emu_noise() */
+static unsigned int seed = 7;
+
+static int check(const char *what, int ok)
+{
+    if(!ok)
+        printf("  %s FAILED\n", what);
+    return !ok;
+}
+
+static int check_registers(void)
+{
+    static fir_channel_config config;
+    static float buf[FIR_MAX_TAPS + FIR_MAX_WINDOW];
+    static fir_chain chain;
+    int v, failed = 0;
+
+    v = firChainCtl2(64, 256, 4, false);
+    failed |= check("FIRCTL2 round trip of a decimating channel",
+                    FIRCTL2_GET_RATIO(v) == 4 && !(v & FIRCTL2_UPSAMP) &&
+                    FIRCTL2_GET_TAPS(v) == 64 && FIRCTL2_GET_WINDOW(v) == 256);
+    v = firChainCtl2(FIR_MAX_TAPS, 64, FIR_MAX_RATIO, true);
+    failed |= check("FIRCTL2 round trip of an interpolating channel",
+                    FIRCTL2_GET_RATIO(v) == FIR_MAX_RATIO && (v & FIRCTL2_UPSAMP) &&
+                    FIRCTL2_GET_TAPS(v) == FIR_MAX_TAPS);
+    failed |= check("FIRCTL2 of ratio 1 is the single rate value",
+                    firChainCtl2(65, 256, 1, true) == firChainCtl2(65, 256, 1, false) &&
+                    firChainCtl2(65, 256, 1, false) == (64 | (255 << FIRCTL2_WINDOW_SHIFT)));
+    failed |= check("FIRCTL2 refuses ratio 0 or over the field",
+                    firChainCtl2(64, 256, 0, false) == -1 &&
+                    firChainCtl2(64, 256, FIR_MAX_RATIO + 1, false) == -1);
+    failed |= check("FIRCTL2 refuses a window that is no multiple of the decimation",
+                    firChainCtl2(64, 250, 4, false) == -1);
+    failed |= check("FIRCTL2 refuses taps that do not split into equal branches",
+                    firChainCtl2(65, 256, 4, true) == -1);
+
+    config.taps = 64;
+    config.window = 256;
+    config.coeffs = buf;
+    config.in = buf;
+    config.out = buf;
+    config.ratio = 4;
+    config.upsample = true;
+
+    /* 15 samples of history for branches of 16 taps */
+    config.in_length = 64 / 4 - 1 + 256;
+    chain.channels = -1;
+    failed |= check("build of an interpolating channel with its branch history",
+                    firChainBuild(&chain, &config, 1, false) == 0 &&
+                    chain.tcb[0][FIR_TCB_OL] == 256 * 4 &&
+                    chain.tcb[0][FIR_TCB_II] == FIR_ADDR(buf + config.in_length - 15));
+
+    config.upsample = false;
+    chain.channels = -1;
+    failed |= check("build refuses a decimating channel without the full history",
+                    firChainBuild(&chain, &config, 1, false) == -1 && chain.channels == -1);
+
+    config.in_length = 64 - 1 + 256;
+    failed |= check("build of a decimating channel",
+                    firChainBuild(&chain, &config, 1, false) == 0 &&
+                    chain.tcb[0][FIR_TCB_OL] == 256 / 4);
+
+    printf("register values and refused configurations %s\n", failed ? "FAILED" : "ok");
+    return failed;
+}
+
+static int run_case(const multirate_case *tc)
+{
+    static fir_channel_config config;
+    static fir_chain chain;
+    int length = MULTIRATE_ITERATIONS * tc->window;
+    int history, outputs, phases, ref_length;
+    float *coeffs, *in, *out, *x;
+    double *ref, err = 0.0, e;
+    unsigned long long macs, expected;
+    int failed = 0;
+    int k, n;
+
+    config.taps = tc->taps;
+    config.window = tc->window;
+    config.ratio = tc->ratio;
+    config.upsample = tc->upsample;
+
+    history = FIR_HISTORY(&config);
+    outputs = FIR_OUTPUTS(&config);
+    phases = tc->upsample ? tc->ratio : 1;
+
+    /* The windows of every iteration, then the zero history */
+    coeffs = malloc(tc->taps * sizeof(float));
+    in = calloc(length + history, sizeof(float));
+    out = malloc(MULTIRATE_ITERATIONS * outputs * sizeof(float));
+
+    for(n = 0; n < tc->taps; n++)
+        coeffs[n] = emu_noise(&seed) * 0.5f / sqrtf((float)(tc->taps / phases));
+    for(n = 0; n < length; n++)
+        in[n] = emu_noise(&seed) * 0.5f;
+
+    config.coeffs = coeffs;
+    config.in = in;
+    config.in_length = length + history;
+    config.out = out;
+
+    emu_reset();
+    *pPMCTL1 |= FIRACCSEL;
+    emu_completion_init();
+
+    failed |= check("build", firChainBuild(&chain, &config, 1, false) == 0);
+    if(failed)
+        return 1;
+
+    macs = fir_accel_statistics.macs;
+
+    for(k = 0; k < MULTIRATE_ITERATIONS; k++)
+    {
+        firChainSetOutput(&chain, 0, out + k * outputs);
+        firChainStart(&chain);
+        emu_completion_wait(k + 1);
+    }
+
+    /* Direct form at the output rate: the input itself for decimation, zero
+     * stuffed by the ratio for interpolation, behind taps-1 zeros */
+    ref_length = tc->upsample ? length * tc->ratio : length;
+    x = calloc(tc->taps - 1 + ref_length, sizeof(float));
+    ref = malloc(ref_length * sizeof(double));
+    for(n = 0; n < length; n++)
+        x[tc->taps - 1 + n * (tc->upsample ? tc->ratio : 1)] = in[n];
+
+    emu_reference_fir(x, coeffs, tc->taps, ref, ref_length);
+
+    for(n = 0; n < MULTIRATE_ITERATIONS * outputs; n++)
+    {
+        e = fabs(out[n] - ref[tc->upsample ? n : n * tc->ratio]);
+        if(e > err)
+            err = e;
+    }
+
+    macs = fir_accel_statistics.macs - macs;
+    expected = (unsigned long long)MULTIRATE_ITERATIONS * outputs * (tc->taps / phases);
+
+    failed |= check("output", err <= MULTIRATE_TOLERANCE);
+    failed |= check("multiply-accumulates of the kept outputs only", macs == expected);
+
+    /* Single rate at the output rate would spend taps per output */
+    printf("%-18s %4d taps, window %4d -> %4d outputs: %6.1f MACs per input sample, "
+           "%2dx fewer than single rate, max error %.3g %s\n",
+           tc->name, tc->taps, tc->window, outputs, (double)macs / length,
+           tc->ratio, err, failed ? "FAILED" : "ok");
+
+    free(x);
+    free(ref);
+    free(coeffs);
+    free(in);
+    free(out);
+
+    return failed;
+}
+
+int emu_multirate(const char *dir, int argc, char *argv[])
+{
+    int failed = 0;
+    int i;
+
+    (void)dir;
+    (void)argc;
+    (void)argv;
+
+    failed |= check_registers();
+
+    for(i = 0; i < NUM_CASES; i++)
+        failed |= run_case(&cases[i]);
+
+    return failed;
+}
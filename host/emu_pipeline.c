@@ -0,0 +1,185 @@
+/*
+ * NAME:     emu_pipeline.c
+ * PURPOSE:  fir_emu pipeline mode.
+ * USAGE:    fir_emu pipeline [data directory] [blocks]
+ *
+ *           Runs the target's main loop body against emulated SPORT blocks:
+ *           fills the RX DMA buffer, raises the SPORT1 interrupt, calls
+ *           handleCodecData() and checks the TX DMA buffer against the
+ *           continuous convolution of the input, delayed by the pipeline latency. The order in which the
+ *           accelerator completes blocks relative to handleCodecData() is
+ *           printed for the first blocks and checked for every block.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "ADDS_21479_EzKit.h"
+#include "sharc_emu.h"
+#include "emu_util.h"
+#include "emu_codec.h"
+#include "fir_emu.h"
+
+extern float Coeff_Buf1[TAPSIZE1];
+extern float Coeff_Buf2[TAPSIZE2];
+
+#define LATENCY             EMU_CODEC_LATENCY
+
+/* 1.31 round trip and single precision accumulation */
+#define PIPELINE_TOLERANCE  1e-5
+
+/* Blocks whose schedule is printed */
+#define TRACE_BLOCKS        4
+
+#define MAX_VECTOR 4096
+
+static float signal1[MAX_VECTOR];
+static float signal2[MAX_VECTOR];
+static int signal1_length;
+static int signal2_length;
+
+/* Filtered channels: input signal and slot, output block and slot */
+typedef struct {
+    const float *signal;
+    const int *length;
+    int rx_slot;
+    int tx_block;                   /* 0 for SPORT0 A, 1 for SPORT0 B */
+    int tx_slot;
+    const float *coeffs;
+    int taps;
+} pipeline_channel;
+
+static const pipeline_channel channels[FIR_CHANNELS] = {
+    { signal1, &signal1_length, 0, 0, 0, Coeff_Buf1, TAPSIZE1 },   /* AIN1L -> AOUT1L */
+    { signal2, &signal2_length, 1, 0, 1, Coeff_Buf2, TAPSIZE2 },   /* AIN1R -> AOUT1R */
+    { signal2, &signal2_length, 2, 1, 0, Coeff_Buf1, TAPSIZE1 },   /* AIN2L -> AOUT3L */
+    { signal1, &signal1_length, 3, 1, 1, Coeff_Buf2, TAPSIZE2 },   /* AIN2R -> AOUT3R */
+};
+
+/* Blocks in submission order, to name the one the accelerator completes */
+static long filtered_blocks = 0;
+static long late_completions = 0;
+
+static void fir_done(fir_word *cp)
+{
+    int set;
+
+    (void)cp;
+
+    /* The tiles of the SDRAM channels are passes of the same block */
+    if(sdramTileRunning())
+        return;
+
+    for(set = 0; set < FIR_BUFFER_SETS; set++)
+    {
+        if(FIR_Chain.tcb[0][FIR_TCB_OB] == FIR_ADDR(fBlockA[set].Tx_L1))
+            break;
+    }
+
+    if(filtered_blocks < TRACE_BLOCKS)
+    {
+        if(emu_codec_current < 0)
+            printf("  FIR   block %ld filtered in set %d while the core idles\n", filtered_blocks, set);
+        else
+            printf("  FIR   block %ld filtered in set %d during handleCodecData(block %ld)\n",
+                   filtered_blocks, set, emu_codec_current);
+    }
+
+    /* A pipelined block must not hold up its own handleCodecData() */
+    if(PIPELINED_PROCESSING && emu_codec_current == filtered_blocks)
+        late_completions++;
+
+    filtered_blocks++;
+}
+
+/* Input sample n of a channel, 1.31 with headroom, silence before the start */
+static int input_sample(const float *signal, int length, long n)
+{
+    if(n < 0)
+        return 0;
+    return __builtin_conv_FtoR(0.25f * signal[n % length]);
+}
+
+/* Output expected for a block: the continuous convolution of the stream */
+static void expected_block(const float *signal, int length, const float *coeffs, int taps,
+                           long block, double *y)
+{
+    static float x[NUM_SAMPLES + 1024];
+    long first = block * NUM_SAMPLES - (taps - 1);
+    int i;
+
+    for(i = 0; i < NUM_SAMPLES + taps - 1; i++)
+        x[i] = __builtin_conv_RtoF(input_sample(signal, length, first + i));
+
+    emu_reference_fir(x, coeffs, taps, y, NUM_SAMPLES);
+}
+
+int emu_pipeline(const char *dir, int argc, char *argv[])
+{
+    static int rx[RX_BLOCK_MAX], txa[TX_BLOCK_MAX], txb[TX_BLOCK_MAX];
+    static float tx[NUM_SAMPLES];
+    static double ref[NUM_SAMPLES];
+    long blocks = argc > 0 ? atol(argv[0]) : 1000;
+    double err, max_err = 0.0;
+    long b;
+    int c, i;
+
+    signal1_length = emu_load_dat(dir, "indata256.dat", signal1, MAX_VECTOR);
+    signal2_length = emu_load_dat(dir, "indata1024.dat", signal2, MAX_VECTOR);
+    if(signal1_length <= 0 || signal2_length <= 0)
+        return 2;
+
+    emu_codec_init(NUM_SAMPLES);
+    fir_accel_done_hook = fir_done;
+
+    printf("%s processing, %d samples per block, latency %d block(s)\n",
+           FFT_CONVOLUTION ? "FFT convolution" : PIPELINED_PROCESSING ? "pipelined" : "sequential",
+           NUM_SAMPLES, LATENCY);
+
+    for(b = 0; b < blocks; b++)
+    {
+        for(c = 0; c < FIR_CHANNELS; c++)
+        {
+            const pipeline_channel *ch = &channels[c];
+
+            for(i = 0; i < NUM_SAMPLES; i++)
+                rx[NUM_RX_SLOTS*i + ch->rx_slot] = input_sample(ch->signal, *ch->length, b * NUM_SAMPLES + i);
+        }
+
+        if(b < TRACE_BLOCKS)
+            printf("  SPORT block %ld received\n", b);
+
+        emu_codec_block(rx, txa, txb);
+
+        if(b < TRACE_BLOCKS && b >= LATENCY)
+            printf("  core  block %ld written back\n", b - LATENCY);
+
+        if(b < LATENCY)
+            continue;
+
+        for(c = 0; c < FIR_CHANNELS; c++)
+        {
+            const pipeline_channel *ch = &channels[c];
+            const int *out = ch->tx_block ? txb : txa;
+
+            for(i = 0; i < NUM_SAMPLES; i++)
+                tx[i] = __builtin_conv_RtoF(out[NUM_TX_SLOTS*i + ch->tx_slot]);
+
+            expected_block(ch->signal, *ch->length, ch->coeffs, ch->taps, b - LATENCY, ref);
+            err = emu_max_error(tx, ref, NUM_SAMPLES);
+            if(err > max_err)
+                max_err = err;
+        }
+    }
+
+    printf("%ld blocks, %ld filtered, max output error %.3g, %ld blocks waited on themselves\n",
+           blocks, filtered_blocks, max_err, late_completions);
+
+    if(max_err > PIPELINE_TOLERANCE || late_completions > 0)
+    {
+        printf("FAILED\n");
+        return 1;
+    }
+
+    printf("ok\n");
+    return 0;
+}
@@ -0,0 +1,97 @@
+/*
+ * NAME:     emu_profile.c
+ * PURPOSE:  fir_emu profile mode.
+ * USAGE:    fir_emu profile [data directory] [blocks]
+ *
+ *           Streams noise through the codec path and prints blockProfile, the
+ *           statistics the target keeps of each block processing stage: count,
+ *           min, mean and max and the occupied histogram bins. On the host the
+ *           filter stage is the emulated accelerator and the unit is the time
+ *           stamp counter instead of core cycles.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "ADDS_21479_EzKit.h"
+#include "sharc_emu.h"
+#include "emu_codec.h"
+#include "fir_emu.h"
+
+#if STAGE_PROFILING
+
+static const char *stage_names[STAGE_COUNT] = {
+    "float", "process", "filter", "fix", "block"
+};
+
+/* Blocks run before the statistics are cleared */
+#define WARMUP_BLOCKS   8
+
+static void print_stage(int stage)
+{
+    const stage_stats *s = &blockProfile.stage[stage];
+    int bin;
+
+    printf("%-8s %7u %10u %12.0f %10u  ", stage_names[stage], s->count, s->min,
+           s->count ? (double)s->total / s->count : 0.0, s->max);
+
+    for(bin = 0; bin < STAGE_HISTOGRAM_BINS; bin++)
+    {
+        if(s->histogram[bin])
+            printf(" 2^%d:%u", bin, s->histogram[bin]);
+    }
+    printf("\n");
+}
+
+int emu_profile(const char *dir, int argc, char *argv[])
+{
+    static int rx[RX_BLOCK_MAX], txa[TX_BLOCK_MAX], txb[TX_BLOCK_MAX];
+    long blocks = argc > 0 ? atol(argv[0]) : 2000;
+    unsigned int seed = 1;
+    long b;
+    int i, stage;
+
+    (void)dir;
+
+    emu_codec_init(NUM_SAMPLES);
+
+    for(b = 0; b < WARMUP_BLOCKS + blocks; b++)
+    {
+        if(b == WARMUP_BLOCKS)
+            stageReset();
+
+        for(i = 0; i < RX_BLOCK_SIZE; i++)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            rx[i] = (int)seed >> 2;
+        }
+
+        emu_codec_block(rx, txa, txb);
+    }
+
+    printf("%ld blocks of %d samples, %s processing, time stamp counter ticks\n", blocks, NUM_SAMPLES,
+           FFT_CONVOLUTION ? "FFT convolution" : PIPELINED_PROCESSING ? "pipelined" : "sequential");
+    printf("%-8s %7s %10s %12s %10s   %s\n", "stage", "count", "min", "mean", "max", "histogram");
+
+    for(stage = 0; stage < STAGE_COUNT; stage++)
+        print_stage(stage);
+
+    /* No margins: emu_codec_block() raises the interrupt right before each
+     * block, the deadline and ring modes pace it */
+    printf("deadline overruns %u, skipped %u\n", deadlineStats.overruns, deadlineStats.skipped);
+
+    return 0;
+}
+
+#else
+
+int emu_profile(const char *dir, int argc, char *argv[])
+{
+    (void)dir;
+    (void)argc;
+    (void)argv;
+
+    printf("stage profiling is compiled out of this build (STAGE_PROFILING 0)\n");
+    return 0;
+}
+
+#endif /* STAGE_PROFILING */
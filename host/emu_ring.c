@@ -0,0 +1,185 @@
+/*
+ * NAME:     emu_ring.c
+ * PURPOSE:  fir_emu ring mode.
+ * USAGE:    fir_emu ring [data directory] [blocks] [period in us]
+ *
+ *           Runs the SPORT side on a timer thread: every period it fills the
+ *           next RX DMA buffer with a pattern of the block number and calls
+ *           TalkThroughISR, while the main thread runs the main loop of the
+ *           target, blockRingNext() and handleCodecData(), concurrently. Every
+ *           STALL_INTERVAL blocks the main thread stalls for STALL_PERIODS
+ *           block periods before processing, like a block that takes too long.
+ *
+ *           Checks that no block is taken after the DMA started to reuse its
+ *           buffer, that every block whose buffer was reused while it was being
+ *           processed is counted as an overrun, that every block is either
+ *           processed or counted as skipped, and that no block is lost at all
+ *           when SPORT_DMA_BUFFERS leaves room for the stalls. Build with
+ *           -DSPORT_DMA_BUFFERS=4 to see them absorbed.
+ *
+ *           The ISR is called straight from the thread rather than through
+ *           emu_raise(), whose interrupt table belongs to the main thread.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include "ADDS_21479_EzKit.h"
+#include "sharc_emu.h"
+#include "emu_codec.h"
+#include "fir_emu.h"
+
+#define STALL_INTERVAL  25
+#define STALL_PERIODS   1.5
+
+static long ring_blocks;
+static long period_ns;
+static volatile int sport_done = 0;
+
+/* Word of the RX pattern of a block */
+static int block_word(long block)
+{
+    return (int)((unsigned int)(block + 1) * 2654435761u) >> 2;
+}
+
+static int block_intact(int buffer, long block)
+{
+    return RxBlock_A[buffer][0] == block_word(block) &&
+           RxBlock_A[buffer][RX_BLOCK_SIZE - 1] == block_word(block);
+}
+
+static void add_ns(struct timespec *t, long ns)
+{
+    t->tv_nsec += ns;
+    while(t->tv_nsec >= 1000000000L)
+    {
+        t->tv_nsec -= 1000000000L;
+        t->tv_sec++;
+    }
+}
+
+static long ns_between(const struct timespec *a, const struct timespec *b)
+{
+    return (b->tv_sec - a->tv_sec) * 1000000000L + (b->tv_nsec - a->tv_nsec);
+}
+
+/* SPORT1 RX DMA and its interrupt at a fixed block rate */
+static void *sport_thread(void *arg)
+{
+    struct timespec t, now;
+    long b;
+    int i;
+
+    (void)arg;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+
+    for(b = 0; b < ring_blocks; b++)
+    {
+        int *rx = RxBlock_A[b % SPORT_DMA_BUFFERS];
+
+        for(i = 0; i < RX_BLOCK_SIZE; i++)
+            rx[i] = block_word(b);
+
+        add_ns(&t, period_ns);
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &t, NULL);
+
+        /* A frame clock does not catch up; when the host scheduled the
+         * thread late, keep the period from here instead of firing a burst */
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if(ns_between(&t, &now) > period_ns / 2)
+            t = now;
+
+        TalkThroughISR(ADI_CID_P3I, NULL);
+    }
+
+    sport_done = 1;
+    return NULL;
+}
+
+int emu_ring(const char *dir, int argc, char *argv[])
+{
+    long period_us = argc > 1 ? atol(argv[1]) : 500;
+    long stall_ns, processed = 0, stalls = 0, stale = 0, reused = 0;
+    int absorbed = STALL_PERIODS <= SPORT_DMA_BUFFERS - 2;
+    struct timespec stall;
+    pthread_t sport;
+    unsigned int block;
+    int buffer, failed = 0;
+
+    (void)dir;
+
+    ring_blocks = argc > 0 ? atol(argv[0]) : 1000;
+    period_ns = period_us * 1000L;
+    stall_ns = (long)(STALL_PERIODS * period_ns);
+    stall.tv_sec = stall_ns / 1000000000L;
+    stall.tv_nsec = stall_ns % 1000000000L;
+
+    emu_codec_init(NUM_SAMPLES);
+
+    if(pthread_create(&sport, NULL, sport_thread, NULL) != 0)
+    {
+        printf("cannot start the SPORT thread\n");
+        return 2;
+    }
+
+    /* The main loop of the target */
+    while(!sport_done || blockRing.head != blockRing.tail)
+    {
+        buffer = blockRingNext();
+        if(buffer < 0)
+        {
+            sched_yield();
+            continue;
+        }
+
+        block = blockRing.tail;
+        if(!block_intact(buffer, block))
+            stale++;
+
+        if(block % STALL_INTERVAL == STALL_INTERVAL / 2)
+        {
+            nanosleep(&stall, NULL);
+            stalls++;
+        }
+
+        handleCodecData(buffer);
+        processed++;
+
+        if(!block_intact(buffer, block))
+            reused++;
+    }
+
+    pthread_join(sport, NULL);
+
+    printf("%d SPORT DMA buffers, %ld blocks every %ld us, %ld stalls of %.1f periods\n",
+           SPORT_DMA_BUFFERS, ring_blocks, period_us, stalls, STALL_PERIODS);
+    printf("processed %ld, skipped %u, overruns %u, reused while processing %ld\n",
+           processed, deadlineStats.skipped, deadlineStats.overruns, reused);
+    printf("margin min %u, latest overrun %u\n", deadlineStats.min_margin, deadlineStats.max_late);
+
+    if(stale != 0)
+    {
+        printf("%ld blocks taken from a reused buffer\n", stale);
+        failed = 1;
+    }
+    if(reused > (long)deadlineStats.overruns)
+        failed = 1;
+    if(processed + (long)deadlineStats.skipped != ring_blocks)
+        failed = 1;
+    if(absorbed && (deadlineStats.skipped != 0 || deadlineStats.overruns != 0))
+    {
+        printf("stalls should fit into %d buffers\n", SPORT_DMA_BUFFERS);
+        failed = 1;
+    }
+    if(SPORT_DMA_BUFFERS == 2 && deadlineStats.overruns == 0)
+    {
+        printf("stalls longer than a period should overrun the ping-pong pair\n");
+        failed = 1;
+    }
+
+    printf("%s\n", failed ? "FAILED" : "passed");
+    return failed;
+}
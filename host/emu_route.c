@@ -0,0 +1,537 @@
+/*
+ * NAME:     emu_route.c
+ * PURPOSE:  fir_emu route mode.
+ * USAGE:    fir_emu route [data directory] [blocks]
+ *
+ *           Streams noise on all four RX slots through the codec path with
+ *           the routing matrix of routeMatrix.c. A first run with the default
+ *           matrix records what the filtered channels put out; every matrix
+ *           of the list below then maps those and the raw inputs onto the
+ *           AOUT channels, and every output block of a second run has to be
+ *           the output of one matrix on all AOUT channels at once. Anything
+ *           else is a torn block.
+ *
+ *           The second run first stages each matrix between two blocks, and
+ *           each has to go live with the next output block. Then a control
+ *           thread stages matrices as fast as routeStage() takes them while
+ *           the main thread keeps processing blocks.
+ *
+ *           Ends with the time routeBlock() takes per block for each matrix
+ *           next to copying the eight AOUT channels: the default matrix and a
+ *           permutation have to take less than the copies, a diagonal of
+ *           gains at most twice as long.
+ *
+ *           The filtered channels of FIXED_POINT_CHANNELS slots are never
+ *           written and fixedChannelsBlock() overwrites their AOUT channels,
+ *           so neither takes part.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "ADDS_21479_EzKit.h"
+#include "sharc_emu.h"
+#include "emu_util.h"
+#include "emu_codec.h"
+#include "fir_emu.h"
+
+#define ROUTE_SCALE         0.25f
+#define ROUTE_TOLERANCE     1e-5
+
+/* Blocks of the staged matrices of the first part */
+#define ROUTE_STAGE_EVERY   8
+
+#define ROUTE_BENCH_CALLS   500
+#define ROUTE_BENCH_TRIALS  40
+
+#define MATRIX_IDENTITY     0
+#define MATRIX_PERMUTATION  1
+#define MATRIX_DIAGONAL     2
+#define MATRIX_SPARSE       3
+#define MATRIX_DENSE        4
+#define MATRICES            5
+
+#define CLASS_TORN          -1
+
+static const char *matrix_names[MATRICES] = { "identity", "permutation", "diagonal", "sparse", "dense" };
+
+static float matrices[MATRICES][ROUTE_OUTPUTS][ROUTE_SOURCES];
+
+/* AOUT channel of each FIR channel, in fBlockA order */
+static const int fir_aout[FIR_CHANNELS] = { 0, 1, 4, 5 };
+
+/* Shared with the children that run the codec path */
+static struct {
+    float *x[NUM_RX_SLOTS];         /* quantised inputs */
+    float *f[ROUTE_OUTPUTS];        /* filtered channels, from the default matrix */
+    float *y[ROUTE_OUTPUTS];        /* AOUT channels of the run under test */
+} shared;
+
+/* State of emu_noise() */
+static unsigned int seed = 7;
+
+/* An AOUT channel written by fixedChannelsBlock() */
+static int fixed_aout(int out)
+{
+    int ch;
+
+    for(ch = 0; ch < FIR_CHANNELS; ch++)
+    {
+        if(fir_aout[ch] == out && FIXED_CHANNEL(ch))
+            return 1;
+    }
+    return 0;
+}
+
+static void build_matrices(void)
+{
+    int m, out, src, row;
+
+    memset(matrices, 0, sizeof(matrices));
+
+    for(out = 0; out < ROUTE_OUTPUTS; out++)
+    {
+        matrices[MATRIX_IDENTITY][out][ROUTE_FILTERED(out)] = 1.0f;
+
+        // left and right swapped, the raw inputs of AIN2 on AOUT4
+        if(out < ROUTE_OUTPUTS - 2)
+            matrices[MATRIX_PERMUTATION][out][ROUTE_FILTERED(out ^ 1)] = 1.0f;
+        else
+            matrices[MATRIX_PERMUTATION][out][ROUTE_INPUT(out - ROUTE_OUTPUTS + NUM_RX_SLOTS)] = 1.0f;
+
+        matrices[MATRIX_DIAGONAL][out][ROUTE_FILTERED(out)] = 0.5f;
+
+        // each channel with a little of the next pair, AOUT2R silent
+        if(out != 3)
+        {
+            matrices[MATRIX_SPARSE][out][ROUTE_FILTERED(out)] = 0.7f;
+            matrices[MATRIX_SPARSE][out][ROUTE_FILTERED((out + 2) % ROUTE_OUTPUTS)] = 0.3f;
+        }
+
+        for(src = 0; src < ROUTE_SOURCES; src++)
+            matrices[MATRIX_DENSE][out][src] = (float)((out + 2*src) % 5 - 2) / (2.0f * ROUTE_SOURCES);
+    }
+
+    // nothing from the filtered channels that are never written
+    for(m = 0; m < MATRICES; m++)
+    {
+        for(out = 0; out < ROUTE_OUTPUTS; out++)
+        {
+            if(fixed_aout(out))
+            {
+                for(row = 0; row < ROUTE_OUTPUTS; row++)
+                    matrices[m][row][ROUTE_FILTERED(out)] = 0.0f;
+            }
+        }
+    }
+}
+
+/* Noise on every RX slot, once for both runs */
+static int prepare(long blocks)
+{
+    long length = blocks * NUM_SAMPLES;
+    size_t bytes = (NUM_RX_SLOTS + 2*ROUTE_OUTPUTS) * length * sizeof(float);
+    float *p;
+    int c;
+    long i;
+
+    p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if(p == MAP_FAILED)
+        return -1;
+
+    for(c = 0; c < NUM_RX_SLOTS; c++, p += length)
+    {
+        shared.x[c] = p;
+        for(i = 0; i < length; i++)
+            p[i] = __builtin_conv_RtoF(__builtin_conv_FtoR(emu_noise(&seed) * ROUTE_SCALE));
+    }
+    for(c = 0; c < ROUTE_OUTPUTS; c++, p += length)
+        shared.f[c] = p;
+    for(c = 0; c < ROUTE_OUTPUTS; c++, p += length)
+        shared.y[c] = p;
+
+    return 0;
+}
+
+static void release(long blocks)
+{
+    munmap(shared.x[0], (NUM_RX_SLOTS + 2*ROUTE_OUTPUTS) * blocks * NUM_SAMPLES * sizeof(float));
+}
+
+/* The inputs through the booted codec path into the AOUT channels y */
+static void stream(long blocks, float **y, void (*before_block)(long))
+{
+    static int rx[RX_BLOCK_MAX], txa[TX_BLOCK_MAX], txb[TX_BLOCK_MAX];
+    long b;
+    int c, i;
+
+    /* The last blocks flush the pipeline */
+    for(b = 0; b < blocks + EMU_CODEC_LATENCY; b++)
+    {
+        if(before_block != NULL)
+            before_block(b);
+
+        for(c = 0; c < NUM_RX_SLOTS; c++)
+        {
+            for(i = 0; i < NUM_SAMPLES; i++)
+                rx[NUM_RX_SLOTS*i + c] = b < blocks ? __builtin_conv_FtoR(shared.x[c][b * NUM_SAMPLES + i]) : 0;
+        }
+
+        emu_codec_block(rx, txa, txb);
+
+        if(b < EMU_CODEC_LATENCY)
+            continue;
+
+        for(c = 0; c < ROUTE_OUTPUTS; c++)
+        {
+            const int *tx = c < NUM_TX_SLOTS ? txa : txb;
+
+            for(i = 0; i < NUM_SAMPLES; i++)
+                y[c][(b - EMU_CODEC_LATENCY) * NUM_SAMPLES + i] =
+                    __builtin_conv_RtoF(tx[NUM_TX_SLOTS*i + c % NUM_TX_SLOTS]);
+        }
+    }
+}
+
+/* Largest error of output block n against matrix m */
+static double block_error(int m, long n)
+{
+    double err = 0.0, e, acc;
+    long k;
+    int out, src, i;
+
+    for(out = 0; out < ROUTE_OUTPUTS; out++)
+    {
+        if(fixed_aout(out))
+            continue;
+
+        for(i = 0; i < NUM_SAMPLES; i++)
+        {
+            k = n * NUM_SAMPLES + i;
+            acc = 0.0;
+            for(src = 0; src < ROUTE_SOURCES; src++)
+            {
+                float g = matrices[m][out][src];
+
+                if(g != 0.0f)
+                    acc += g * (src < NUM_RX_SLOTS ? shared.x[src][k] : shared.f[src - NUM_RX_SLOTS][k]);
+            }
+            e = fabs(shared.y[out][k] - acc);
+            if(e > err)
+                err = e;
+        }
+    }
+    return err;
+}
+
+/* The matrix of output block n, preferring the current one where two match */
+static int classify(long n, int current)
+{
+    int m;
+
+    if(current >= 0 && block_error(current, n) <= ROUTE_TOLERANCE)
+        return current;
+    for(m = 0; m < MATRICES; m++)
+    {
+        if(m != current && block_error(m, n) <= ROUTE_TOLERANCE)
+            return m;
+    }
+    return CLASS_TORN;
+}
+
+/* Runs a part in a child, the codec path boots once per process. Returns
+ * the exit status of the part. */
+static int boot(int (*part)(long), long blocks)
+{
+    int status;
+    pid_t pid;
+
+    fflush(stdout);
+    pid = fork();
+    if(pid == 0)
+    {
+        status = part(blocks);
+        fflush(stdout);
+        _exit(status);
+    }
+
+    if(pid < 0 || waitpid(pid, &status, 0) != pid || !WIFEXITED(status))
+        return 2;
+    return WEXITSTATUS(status);
+}
+
+static int run_identity(long blocks)
+{
+    emu_codec_init(NUM_SAMPLES);
+    stream(blocks, shared.f, NULL);
+    return 0;
+}
+
+/*-------------------------------------------------------------------------------*/
+/* Part one: every matrix staged between two blocks */
+
+static void stage_between_blocks(long b)
+{
+    int m = (int)(b / ROUTE_STAGE_EVERY) % MATRICES;
+
+    if(b == 0 || b % ROUTE_STAGE_EVERY != 0)
+        return;
+
+    if(routeStage((const float (*)[ROUTE_SOURCES])matrices[m]) != 0)
+        printf("  the matrix staged before block %ld was refused\n", b);
+}
+
+static int run_staged(long blocks)
+{
+    emu_codec_init(NUM_SAMPLES);
+    stream(blocks, shared.y, stage_between_blocks);
+    return 0;
+}
+
+static int check_staged(long blocks)
+{
+    long n, bad = 0;
+    int expected, cls;
+
+    for(n = 0; n < blocks; n++)
+    {
+        expected = (int)((n + EMU_CODEC_LATENCY) / ROUTE_STAGE_EVERY) % MATRICES;
+        cls = classify(n, expected);
+        if(cls != expected && bad++ < 4)
+            printf("  block %ld: %s%s, not %s\n", n, cls == CLASS_TORN ? "torn" : matrix_names[cls],
+                   cls == CLASS_TORN ? "" : " matrix", matrix_names[expected]);
+    }
+
+    printf("staged matrices: each live from the block it was staged before, %ld bad blocks %s\n",
+           bad, bad ? "FAILED" : "ok");
+    return bad != 0;
+}
+
+/*-------------------------------------------------------------------------------*/
+/* Part two: a control thread stages matrices while the main thread processes */
+
+static volatile int control_stop;
+
+static void *control_thread(void *arg)
+{
+    long *counts = arg;
+    int m = MATRIX_DENSE;
+
+    while(!control_stop)
+    {
+        if(routeStage((const float (*)[ROUTE_SOURCES])matrices[m]) == 0)
+        {
+            m = (m + 1) % MATRICES;
+            counts[0]++;
+        }
+        else
+            counts[1]++;
+        sched_yield();
+    }
+
+    return NULL;
+}
+
+static int run_threaded(long blocks)
+{
+    static long counts[2];
+    pthread_t control;
+
+    control_stop = 0;
+
+    // the thread only stages once the codec path is set up
+    emu_codec_init(NUM_SAMPLES);
+    if(pthread_create(&control, NULL, control_thread, counts) != 0)
+    {
+        printf("cannot start the control thread\n");
+        return 2;
+    }
+
+    stream(blocks, shared.y, NULL);
+
+    control_stop = 1;
+    pthread_join(control, NULL);
+
+    printf("control thread: %ld matrices staged, %ld refused while one was on its way, "
+           "%u swaps in %ld blocks\n", counts[0], counts[1], routeStats.swaps, blocks);
+    return 0;
+}
+
+static int check_threaded(long blocks)
+{
+    long n, bad = 0, changes = 0;
+    int current = MATRIX_IDENTITY, cls;
+
+    for(n = 0; n < blocks; n++)
+    {
+        cls = classify(n, current);
+        if(cls == CLASS_TORN)
+        {
+            if(bad++ < 4)
+                printf("  block %ld: torn\n", n);
+            continue;
+        }
+        if(cls != current)
+            changes++;
+        current = cls;
+    }
+
+    printf("processing: %ld blocks, %ld matrix changes, %ld torn blocks %s\n", blocks, changes, bad,
+           bad || changes == 0 ? "FAILED" : "ok");
+    return bad != 0 || changes == 0;
+}
+
+/*-------------------------------------------------------------------------------*/
+/* Part three: routeBlock() against copies */
+
+static float bench_sink;
+static int bench_refused;
+
+/* Seconds per call of matrix m, or of the copies for -1 */
+static double bench_once(int m, float * const *inputs, float * const *filtered, float **copies)
+{
+    float *tx[ROUTE_OUTPUTS];
+    double t0;
+    int n, out;
+
+    if(m >= 0)
+    {
+        if(routeStage((const float (*)[ROUTE_SOURCES])matrices[m]) != 0)
+            bench_refused++;
+        routeSwap();
+    }
+
+    t0 = emu_seconds();
+    for(n = 0; n < ROUTE_BENCH_CALLS; n++)
+    {
+        if(m >= 0)
+            routeBlock(inputs, filtered, tx);
+        else
+        {
+            for(out = 0; out < ROUTE_OUTPUTS; out++)
+                memcpy(copies[out], filtered[out], NUM_SAMPLES * sizeof(float));
+            tx[0] = copies[0];
+        }
+        bench_sink += tx[0][n % NUM_SAMPLES];
+    }
+    return (emu_seconds() - t0) / ROUTE_BENCH_CALLS;
+}
+
+static int compare_doubles(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+static int run_bench(long blocks)
+{
+    float *inputs[NUM_RX_SLOTS], *filtered[ROUTE_OUTPUTS], *copies[ROUTE_OUTPUTS];
+    static double ratios[MATRICES][ROUTE_BENCH_TRIALS];
+    double t[MATRICES + 1], e[MATRICES + 1], ratio[MATRICES];
+    int cells[MATRICES], passes[MATRICES];
+    int failed = 0;
+    int trial, m, c;
+
+    (void)blocks;
+    bench_refused = 0;
+
+    // blockSamples and the mixing buffers
+    emu_codec_init(NUM_SAMPLES);
+
+    for(c = 0; c < NUM_RX_SLOTS; c++)
+        inputs[c] = shared.x[c];
+    for(c = 0; c < ROUTE_OUTPUTS; c++)
+    {
+        filtered[c] = shared.f[c];
+        copies[c] = shared.y[c];
+    }
+
+    // the copies and every matrix in turn, so load on the host hits them alike
+    for(m = 0; m <= MATRICES; m++)
+        t[m] = 1e9;
+    for(trial = 0; trial < ROUTE_BENCH_TRIALS; trial++)
+    {
+        e[MATRICES] = bench_once(-1, inputs, filtered, copies);
+        for(m = 0; m < MATRICES; m++)
+        {
+            e[m] = bench_once(m, inputs, filtered, copies);
+            cells[m] = routeStats.cells;
+            passes[m] = routeStats.passes;
+            ratios[m][trial] = e[m] / e[MATRICES];
+        }
+        for(m = 0; m <= MATRICES; m++)
+        {
+            if(e[m] < t[m])
+                t[m] = e[m];
+        }
+    }
+
+    // against the copies of the same trial, the median shrugs off a busy host
+    for(m = 0; m < MATRICES; m++)
+    {
+        qsort(ratios[m], ROUTE_BENCH_TRIALS, sizeof(double), compare_doubles);
+        ratio[m] = ratios[m][ROUTE_BENCH_TRIALS / 2];
+    }
+
+    printf("%-12s %6s %6s %10s %8s\n", "matrix", "cells", "passes", "ns/block", "copies");
+    printf("%-12s %6d %6s %10.1f %8.2f\n", "copies", ROUTE_OUTPUTS, "", t[MATRICES] * 1e9, 1.0);
+    for(m = 0; m < MATRICES; m++)
+        printf("%-12s %6d %6d %10.1f %8.2f\n", matrix_names[m], cells[m], passes[m], t[m] * 1e9, ratio[m]);
+
+    if(ratio[MATRIX_IDENTITY] > 1.0 || ratio[MATRIX_PERMUTATION] > 1.0 || ratio[MATRIX_DIAGONAL] > 2.0)
+    {
+        printf("routeBlock() slower than the copies it replaces FAILED\n");
+        failed = 1;
+    }
+    if(bench_refused != 0)
+    {
+        printf("routeStage() refused %d matrices between blocks FAILED\n", bench_refused);
+        failed = 1;
+    }
+
+    return failed;
+}
+
+int emu_route(const char *dir, int argc, char *argv[])
+{
+    long blocks = argc > 0 ? atol(argv[0]) : 1000;
+    long staged = ROUTE_STAGE_EVERY * (MATRICES + 1);
+    int failed = 0;
+
+    (void)dir;
+
+    if(blocks < staged)
+        blocks = staged;
+
+    build_matrices();
+    if(prepare(blocks) != 0)
+    {
+        printf("cannot map the shared buffers\n");
+        return 2;
+    }
+
+    printf("block of %d samples, %d sources onto %d AOUT channels, at most %d sources per pass\n",
+           NUM_SAMPLES, ROUTE_SOURCES, ROUTE_OUTPUTS, ROUTE_PASS_SOURCES);
+
+    failed |= boot(run_identity, blocks);
+
+    failed |= boot(run_staged, staged);
+    if(!failed)
+        failed |= check_staged(staged);
+
+    failed |= boot(run_threaded, blocks);
+    if(!failed)
+        failed |= check_threaded(blocks);
+
+    failed |= boot(run_bench, blocks);
+
+    release(blocks);
+    return failed;
+}
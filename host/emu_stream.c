@@ -0,0 +1,134 @@
+/*
+ * NAME:     emu_stream.c
+ * PURPOSE:  fir_emu stream mode.
+ * USAGE:    fir_emu stream [data directory]
+ *
+ *           Feeds indata256.dat and indata1024.dat on the four filtered inputs
+ *           through handleCodecData() in NUM_SAMPLES chunks and compares the filtered
+ *           DAC data with a one-shot convolution of the whole vector, which
+ *           only matches when the filter history carries over between blocks.
+ *           The vectors are scaled by 1/4 to fit the 1.31 codec data.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "ADDS_21479_EzKit.h"
+#include "sharc_emu.h"
+#include "emu_util.h"
+#include "emu_codec.h"
+#include "fir_emu.h"
+
+extern float Coeff_Buf1[TAPSIZE1];
+extern float Coeff_Buf2[TAPSIZE2];
+
+#define STREAM_SCALE        0.25f
+#define STREAM_TOLERANCE    1e-5
+#define MAX_VECTOR          4096
+
+typedef struct {
+    const char *indata;
+    int rx_slot;
+    int tx_block;                   /* 0 for SPORT0 A, 1 for SPORT0 B */
+    int tx_slot;
+    const float *coeffs;
+    int taps;
+    int length;
+    float x[MAX_VECTOR + 1024];     /* TAPSIZE-1 zeros, then the quantised vector */
+    float y[MAX_VECTOR + NUM_SAMPLES];
+    double ref[MAX_VECTOR];
+} stream_channel;
+
+static stream_channel channels[] = {
+    /* AIN1L -> AOUT1L */
+    { .indata = "indata256.dat",  .rx_slot = 0, .tx_block = 0, .tx_slot = 0, .coeffs = Coeff_Buf1, .taps = TAPSIZE1 },
+    /* AIN1R -> AOUT1R */
+    { .indata = "indata1024.dat", .rx_slot = 1, .tx_block = 0, .tx_slot = 1, .coeffs = Coeff_Buf2, .taps = TAPSIZE2 },
+    /* AIN2L -> AOUT3L */
+    { .indata = "indata1024.dat", .rx_slot = 2, .tx_block = 1, .tx_slot = 0, .coeffs = Coeff_Buf1, .taps = TAPSIZE1 },
+    /* AIN2R -> AOUT3R */
+    { .indata = "indata256.dat",  .rx_slot = 3, .tx_block = 1, .tx_slot = 1, .coeffs = Coeff_Buf2, .taps = TAPSIZE2 },
+};
+
+#define NUM_CHANNELS (int)(sizeof(channels) / sizeof(channels[0]))
+
+int emu_stream(const char *dir, int argc, char *argv[])
+{
+    static float vector[MAX_VECTOR];
+    static int rx[RX_BLOCK_MAX], txa[TX_BLOCK_MAX], txb[TX_BLOCK_MAX];
+    long blocks = 0, b;
+    int failed = 0;
+    int c, i;
+
+    (void)argc;
+    (void)argv;
+
+    for(c = 0; c < NUM_CHANNELS; c++)
+    {
+        stream_channel *ch = &channels[c];
+
+        ch->length = emu_load_dat(dir, ch->indata, vector, MAX_VECTOR);
+        if(ch->length <= 0)
+            return 2;
+
+        for(i = 0; i < ch->taps - 1; i++)
+            ch->x[i] = 0.0f;
+        for(i = 0; i < ch->length; i++)
+            ch->x[ch->taps - 1 + i] = __builtin_conv_RtoF(__builtin_conv_FtoR(STREAM_SCALE * vector[i]));
+
+        if((ch->length + NUM_SAMPLES - 1) / NUM_SAMPLES > blocks)
+            blocks = (ch->length + NUM_SAMPLES - 1) / NUM_SAMPLES;
+    }
+
+    emu_codec_init(NUM_SAMPLES);
+
+    /* The last blocks flush the pipeline */
+    for(b = 0; b < blocks + EMU_CODEC_LATENCY; b++)
+    {
+        for(i = 0; i < RX_BLOCK_SIZE; i++)
+            rx[i] = 0;
+
+        for(c = 0; c < NUM_CHANNELS; c++)
+        {
+            stream_channel *ch = &channels[c];
+
+            for(i = 0; i < NUM_SAMPLES; i++)
+            {
+                long n = b * NUM_SAMPLES + i;
+                if(n < ch->length)
+                    rx[NUM_RX_SLOTS*i + ch->rx_slot] = __builtin_conv_FtoR(ch->x[ch->taps - 1 + n]);
+            }
+        }
+
+        emu_codec_block(rx, txa, txb);
+
+        if(b < EMU_CODEC_LATENCY)
+            continue;
+
+        for(c = 0; c < NUM_CHANNELS; c++)
+        {
+            stream_channel *ch = &channels[c];
+            const int *tx = ch->tx_block ? txb : txa;
+
+            for(i = 0; i < NUM_SAMPLES; i++)
+                ch->y[(b - EMU_CODEC_LATENCY) * NUM_SAMPLES + i] =
+                    __builtin_conv_RtoF(tx[NUM_TX_SLOTS*i + ch->tx_slot]);
+        }
+    }
+
+    for(c = 0; c < NUM_CHANNELS; c++)
+    {
+        stream_channel *ch = &channels[c];
+        double err;
+
+        emu_reference_fir(ch->x, ch->coeffs, ch->taps, ch->ref, ch->length);
+        err = emu_max_error(ch->y, ch->ref, ch->length);
+
+        printf("channel %d, %s: %d samples in %ld blocks of %d, max error vs one-shot convolution %.3g %s\n",
+               c + 1, ch->indata, ch->length, blocks, NUM_SAMPLES, err,
+               err <= STREAM_TOLERANCE ? "ok" : "FAILED");
+        if(err > STREAM_TOLERANCE)
+            failed = 1;
+    }
+
+    return failed;
+}
@@ -0,0 +1,270 @@
+/*
+ * NAME:     emu_tiles.c
+ * PURPOSE:  fir_emu tiles mode.
+ * USAGE:    fir_emu tiles [data directory] [taps] [latency] [cycles per word]
+ *
+ *           Filters noise through two SDRAM-resident filters of sdramTiles.c,
+ *           one of taps (default 4096) and one of half as many plus a partial
+ *           tile, in one pass per block driven from the accelerator
+ *           interrupt as ChannelscompISR drives SDRAM_FIR_CHANNELS, at 64, 256
+ *           and 1024 samples per block, against the external port DMA and
+ *           SDRAM model of extmem_emu.c with latency core cycles per transfer
+ *           (default 20) and cycles per word (default 4, SDRAM at 133 MHz on a
+ *           16-bit bus). The accelerator takes
+ *           TILES_MACS_PER_CYCLE per core cycle. Checks the outputs against
+ *           a double precision convolution and the SDRAM words of every block
+ *           against SDRAM_BLOCK_WORDS() and the model, and prints the SDRAM
+ *           bandwidth per block and at 48 kHz, the emulated cycles per block
+ *           and the stalls for tiles the DMA had not fetched in time. A tile
+ *           whose DMA takes less time than the accelerator must not stall.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "ADDS_21479_EzKit.h"
+#include "sharc_emu.h"
+#include "emu_util.h"
+#include "fir_emu.h"
+
+#define TILES_FILTERS           2
+#define TILES_MACS_PER_CYCLE    2.0     /* 4 MACs per PCLK, at half the core clock */
+#define TILES_RATE              48000.0
+#define TILES_CCLK_MHZ          266.0
+#define TILES_TOLERANCE         1e-4    /* of the RMS of the output */
+#define TILES_MARGIN            64      /* cycles of the core between a tile start and its fetch */
+
+static const int tile_windows[] = { LOW_LATENCY_SAMPLES, NUM_SAMPLES, MAX_BLOCK_SAMPLES };
+
+/* State of emu_noise() */
+static unsigned int seed = 1;
+
+/* Core cycles a tile of taps takes on the accelerator and its fetch */
+static double acc_tile(int taps, int window)
+{
+    return ceil((double)taps * window / TILES_MACS_PER_CYCLE);
+}
+
+/* Fetch of a tile of taps: coefficients, history and, but for the first
+ * tile of a filter, the window */
+static double dma_tile(int taps, int window, int first)
+{
+    return (first ? 2.0 : 3.0) * extmem_emu_latency +
+           (2.0 * taps - 1 + (first ? 0 : window)) * extmem_emu_cycles_per_word;
+}
+
+static int tile_taps(int taps, int t)
+{
+    return taps - t * SDRAM_TILE_TAPS < SDRAM_TILE_TAPS ? taps - t * SDRAM_TILE_TAPS : SDRAM_TILE_TAPS;
+}
+
+static volatile int pass_done;
+
+/* The completion interrupt of the accelerator, as ChannelscompISR runs the
+ * tiles of SDRAM_FIR_CHANNELS */
+static void tiles_isr(uint32_t iid, void *arg)
+{
+    (void)iid;
+    (void)arg;
+
+    *pFIRDMASTAT = 0;
+    *pFIRCTL1 = 0;
+
+    if(!sdramTilesNext())
+        pass_done = 1;
+}
+
+/* All blocks of one block size, returns 1 on a failed check */
+static int run(const int *taps, int window)
+{
+    static sdram_fir_channel f[TILES_FILTERS];
+    static float out[TILES_FILTERS][MAX_BLOCK_SAMPLES];
+    sdram_fir_channel *filters[TILES_FILTERS];
+    float *c[TILES_FILTERS], *x;
+    double *ref[TILES_FILTERS];
+    int longest = taps[0] > taps[1] ? taps[0] : taps[1];
+    int blocks = longest / window + 2;
+    int samples = blocks * window;
+    unsigned long long cycles, model_words, words = 0;
+    unsigned int stalls = 0, timeouts = 0, block_words = 0;
+    double peak = 4.0 * TILES_CCLK_MHZ / extmem_emu_cycles_per_word;
+    double err = 0.0, rms = 0.0, acc = 0.0, mbps;
+    int failed = 0, hidden = 1;
+    int i, b, k, t;
+
+    emu_reset();
+    initSdramTiles();
+
+    adi_int_InstallHandler(ADI_CID_P0I, tiles_isr, 0, true);
+    *pPICR0 = (*pPICR0 & 0xFFFFFFE0) | DMAIntrSource;
+    selectAccelerator(FIRACCSEL);
+    sysreg_bit_set(sysreg_MODE1, IRPTEN);
+
+    x = calloc(longest - 1 + samples, sizeof(float));
+    for(i = 0; i < samples; i++)
+        x[longest - 1 + i] = emu_noise(&seed);
+
+    for(k = 0; k < TILES_FILTERS; k++)
+    {
+        c[k] = malloc(taps[k] * sizeof(float));
+        ref[k] = malloc(samples * sizeof(double));
+        for(i = 0; i < taps[k]; i++)
+            c[k][i] = emu_noise(&seed) / sqrtf((float)taps[k]);
+
+        if(sdramFirInit(&f[k], c[k], taps[k], window) != 0)
+        {
+            printf("sdramFirInit failed for %d taps\n", taps[k]);
+            return 1;
+        }
+        emu_reference_fir(&x[longest - taps[k]], c[k], taps[k], ref[k], samples);
+        filters[k] = &f[k];
+        f[k].out = out[k];
+
+        /* The DMA stays behind the accelerator unless the fetch of the next
+         * tile, of this filter or the first of the next, is longer */
+        for(t = 0; t < f[k].tiles; t++)
+        {
+            int n = tile_taps(taps[k], t);
+
+            acc += acc_tile(n, window);
+            if(t + 1 < f[k].tiles &&
+               dma_tile(tile_taps(taps[k], t + 1), window, 0) + TILES_MARGIN >= acc_tile(n, window))
+                hidden = 0;
+            if(t + 1 == f[k].tiles && k + 1 < TILES_FILTERS &&
+               dma_tile(tile_taps(taps[k + 1], 0), window, 1) + TILES_MARGIN >= acc_tile(n, window))
+                hidden = 0;
+        }
+    }
+
+    cycles = extmem_emu_statistics.cycles;
+    model_words = extmem_emu_statistics.read_words + extmem_emu_statistics.write_words;
+
+    for(b = 0; b < blocks; b++)
+    {
+        for(k = 0; k < TILES_FILTERS; k++)
+            f[k].in = &x[longest - 1 + b * window];
+
+        /* The first tile is fetched while the chain of the block runs */
+        pass_done = 0;
+        sdramTilesStart(filters, TILES_FILTERS);
+        while(*pDMAC0 & DMAS)
+            NOP();
+
+        if(!sdramTilesNext())
+            pass_done = 1;
+        while(!pass_done)
+            NOP();
+
+        block_words = 0;
+        for(k = 0; k < TILES_FILTERS; k++)
+        {
+            for(i = 0; i < window; i++)
+            {
+                double e = fabs(out[k][i] - ref[k][b * window + i]);
+
+                err = e > err ? e : err;
+                rms += ref[k][b * window + i] * ref[k][b * window + i];
+            }
+
+            if(f[k].block_words != (unsigned int)SDRAM_BLOCK_WORDS(taps[k], window))
+            {
+                printf("%d taps moved %u SDRAM words in block %d, not %d\n", taps[k], f[k].block_words, b,
+                       SDRAM_BLOCK_WORDS(taps[k], window));
+                failed = 1;
+            }
+            block_words += f[k].block_words;
+            words += f[k].block_words;
+        }
+    }
+
+    for(k = 0; k < TILES_FILTERS; k++)
+    {
+        stalls += f[k].stalls;
+        timeouts += f[k].timeouts;
+    }
+
+    cycles = extmem_emu_statistics.cycles - cycles;
+    model_words = extmem_emu_statistics.read_words + extmem_emu_statistics.write_words - model_words;
+    rms = sqrt(rms / (TILES_FILTERS * samples));
+    mbps = 4.0 * block_words * TILES_RATE / window / 1e6;
+
+    printf("%6d %5d %9u %9.1f %6.1f%% %10llu %10.0f %7u %4s %10.2e%s\n", window, blocks, block_words, mbps,
+           100.0 * mbps / peak, cycles / blocks, acc, stalls, hidden ? "yes" : "no", err / rms,
+           err > TILES_TOLERANCE * rms ? "  FAILED" : "");
+
+    if(err > TILES_TOLERANCE * rms)
+        failed = 1;
+    if(model_words != words)
+    {
+        printf("the SDRAM model moved %llu words, the filters counted %llu\n", model_words, words);
+        failed = 1;
+    }
+    if(timeouts != 0)
+    {
+        printf("%u SDRAM transfers timed out\n", timeouts);
+        failed = 1;
+    }
+    if(hidden && stalls != 0)
+    {
+        printf("%u stalls on tiles the DMA should have fetched in time\n", stalls);
+        failed = 1;
+    }
+
+    free(x);
+    for(k = 0; k < TILES_FILTERS; k++)
+    {
+        free(c[k]);
+        free(ref[k]);
+    }
+    return failed;
+}
+
+int emu_tiles(const char *dir, int argc, char *argv[])
+{
+    int taps = argc > 0 ? atoi(argv[0]) : 4096;
+    unsigned int latency = extmem_emu_latency;
+    double cycles_per_word = extmem_emu_cycles_per_word;
+    double macs_per_cycle = fir_accel_macs_per_cycle;
+    int filters[TILES_FILTERS];
+    int failed = 0;
+    int i;
+
+    (void)dir;
+
+    if(argc > 1)
+        extmem_emu_latency = (unsigned int)atoi(argv[1]);
+    if(argc > 2)
+        extmem_emu_cycles_per_word = atof(argv[2]);
+
+    filters[0] = taps;
+    filters[1] = taps / 2 + SDRAM_TILE_TAPS / 3;
+
+    if(taps < 2 || extmem_emu_cycles_per_word <= 0.0 ||
+       2 * (filters[0] + filters[1] + MAX_BLOCK_SAMPLES) > SDRAM_POOL_WORDS)
+    {
+        fprintf(stderr, "usage: fir_emu tiles [dir] [taps] [latency] [cycles per word]\n");
+        return 2;
+    }
+
+    fir_accel_macs_per_cycle = TILES_MACS_PER_CYCLE;
+
+    printf("filters of %d and %d taps from SDRAM, tiles of %d taps, %u cycles latency, "
+           "%.2f cycles per word\n", filters[0], filters[1], SDRAM_TILE_TAPS, extmem_emu_latency,
+           extmem_emu_cycles_per_word);
+    printf("SDRAM words per block of both filters, MB/s at %.0f kHz and of the %.0f MB/s peak; "
+           "emulated and accelerator cycles per block at %.0f MHz\n", TILES_RATE / 1000.0,
+           4.0 * TILES_CCLK_MHZ / extmem_emu_cycles_per_word, TILES_CCLK_MHZ);
+    printf("%6s %5s %9s %9s %7s %10s %10s %7s %4s %10s\n", "window", "blocks", "words", "MB/s", "peak",
+           "cycles", "acc", "stalls", "hid", "error");
+
+    for(i = 0; i < (int)(sizeof(tile_windows) / sizeof(tile_windows[0])); i++)
+        failed |= run(filters, tile_windows[i]);
+
+    extmem_emu_latency = latency;
+    extmem_emu_cycles_per_word = cycles_per_word;
+    fir_accel_macs_per_cycle = macs_per_cycle;
+
+    if(failed)
+        printf("FAILED\n");
+    return failed;
+}
@@ -0,0 +1,144 @@
+/*
+ * NAME:     emu_util.c
+ * PURPOSE:  Helpers shared by the host emulation tools.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include "ADDS_21479_EzKit.h"
+#include "sharc_emu.h"
+#include "emu_util.h"
+
+volatile int emu_completions;
+static int completions_wanted;
+
+int emu_load_dat(const char *dir, const char *name, float *buf, int max)
+{
+    char path[512];
+    FILE *f;
+    int n = 0;
+    int c;
+
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    f = fopen(path, "r");
+    if(f == NULL)
+    {
+        fprintf(stderr, "cannot open %s\n", path);
+        return -1;
+    }
+
+    while(n < max && fscanf(f, " %f", &buf[n]) == 1)
+    {
+        n++;
+        /* skip the separator */
+        while((c = fgetc(f)) != EOF && c != ',' && c != '\n')
+            ;
+    }
+
+    fclose(f);
+    return n;
+}
+
+float emu_noise(unsigned int *seed)
+{
+    *seed = *seed * 1664525u + 1013904223u;
+    return (float)(int)*seed / 2147483648.0f;
+}
+
+void emu_reference_fir(const float *x, const float *c, int taps, double *y, int count)
+{
+    int j, k;
+
+    for(k = 0; k < count; k++)
+    {
+        double acc = 0.0;
+        for(j = 0; j < taps; j++)
+            acc += (double)c[j] * x[k + taps - 1 - j];
+        y[k] = acc;
+    }
+}
+
+void emu_reference_biquads(const float *x, const float *c, int biquads, double *y, int count)
+{
+    double d[IIR_MAX_BIQUADS][2] = { { 0.0 } };
+    int j, k;
+
+    for(k = 0; k < count; k++)
+    {
+        double v = x[k];
+
+        for(j = 0; j < biquads; j++)
+        {
+            const float *b = &c[j * IIR_BIQUAD_COEFFS];
+            double out = b[0] * v + d[j][0];
+
+            d[j][0] = b[1] * v - b[3] * out + d[j][1];
+            d[j][1] = b[2] * v - b[4] * out;
+            v = out;
+        }
+
+        y[k] = v;
+    }
+}
+
+double emu_max_error(const float *a, const double *b, int count)
+{
+    double err = 0.0;
+    int i;
+
+    for(i = 0; i < count; i++)
+    {
+        double d = fabs(a[i] - b[i]);
+        if(d > err)
+            err = d;
+    }
+    return err;
+}
+
+static void completion_isr(uint32_t iid, void *arg)
+{
+    (void)iid;
+    (void)arg;
+
+    emu_completions++;
+    if(*pPMCTL1 & IIRACCSEL)
+    {
+        *pIIRDMASTAT = 0;
+        if(emu_completions >= completions_wanted)
+            *pIIRCTL1 = 0;
+    }
+    else
+    {
+        *pFIRDMASTAT = 0;
+        if(emu_completions >= completions_wanted)
+            *pFIRCTL1 = 0;
+    }
+}
+
+void emu_completion_init(void)
+{
+    sysreg_bit_set(sysreg_MODE1, IRPTEN);
+    adi_int_InstallHandler(ADI_CID_P0I, completion_isr, 0, true);
+    *pPICR0 = (*pPICR0 & 0xFFFFFFE0) | DMAIntrSource;
+
+    emu_completions = 0;
+    completions_wanted = 0;
+}
+
+void emu_completion_wait(int wanted)
+{
+    completions_wanted = wanted;
+    while(emu_completions < wanted){
+        NOP();
+    }
+}
+
+double emu_seconds(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
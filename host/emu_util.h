@@ -0,0 +1,44 @@
+/*
+ * NAME:     emu_util.h
+ * PURPOSE:  Helpers shared by the host emulation tools: test vector loading,
+ *           test noise, reference filtering, accelerator completions and
+ *           timing.
+ */
+#ifndef _emu_util_H_
+#define _emu_util_H_
+
+/* Reads a comma separated .dat vector as used by the project's #include
+ * initialisers. Returns the number of values read, or -1 on error. */
+int emu_load_dat(const char *dir, const char *name, float *buf, int max);
+
+/* Uniform in [-1, 1) from a linear congruential generator, repeatable
+ * across runs: every mode keeps its own seed */
+float emu_noise(unsigned int *seed);
+
+/* Direct-form reference in double precision:
+ * y[k] = sum(c[j] * x[k+taps-1-j]) for k = 0..count-1 */
+void emu_reference_fir(const float *x, const float *c, int taps, double *y, int count);
+
+/* Biquad cascade reference in double precision from zero states, with the
+ * b0, b1, b2, a1, a2 coefficients of iir_tcb.h */
+void emu_reference_biquads(const float *x, const float *c, int biquads, double *y, int count);
+
+/* Largest absolute difference between two vectors */
+double emu_max_error(const float *a, const double *b, int count);
+
+/* Completion interrupts of the FIR or IIR accelerator, for the modes that
+ * drive a chain without ChannelscompISR. emu_completion_init() installs a
+ * handler on the accelerator interrupt that counts them in emu_completions
+ * and clears the DMA status of the selected accelerator, and clears the
+ * count. emu_completion_wait() runs the emulation until wanted completions
+ * are counted; the handler disables the accelerator at the last one, which
+ * stops an auto-iterating chain. */
+extern volatile int emu_completions;
+
+void emu_completion_init(void);
+void emu_completion_wait(int wanted);
+
+/* Monotonic time in seconds */
+double emu_seconds(void);
+
+#endif /* _emu_util_H_ */
@@ -0,0 +1,180 @@
+/*
+ * NAME:     emu_verify.c
+ * PURPOSE:  fir_emu verify mode.
+ * USAGE:    fir_emu verify [data directory] [iterations]
+ *
+ *           Builds the TCB chain with the target's initFIR(), loads the input
+ *           vectors into the filter delay lines, runs the chain once and
+ *           checks the filtered outputs against a double precision reference and against
+ *           the Matlab generated expectedoutput*.dat vectors. It then re-runs the
+ *           chain for the given number of iterations to measure throughput.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "ADDS_21479_EzKit.h"
+#include "sharc_emu.h"
+#include "emu_util.h"
+#include "fir_emu.h"
+
+extern float Coeff_Buf1[TAPSIZE1];
+extern float Coeff_Buf2[TAPSIZE2];
+
+extern volatile bool iteration_done;
+
+/* Largest error tolerated against the double precision reference */
+#define REFERENCE_TOLERANCE 1e-5
+
+/* Largest error tolerated against the Matlab vectors, "up to few decimal points" */
+#define GOLDEN_TOLERANCE    1e-4
+
+/* Each indata<L>.dat holds L-1 leading zeros followed by L samples and the
+ * matching expectedoutput<L>.dat was generated with an L-tap filter. */
+typedef struct {
+    const char *name;
+    int length;
+    const char *indata;
+    const char *expected;
+    fir_word *tcb;          /* set after initFIR(), NULL for a fixed-point channel */
+    float *coeffs;
+    int taps;
+} emu_channel;
+
+static emu_channel channels[] = {
+    { "channel 1", 256,  "indata256.dat",  "expectedoutput256.dat",  NULL, Coeff_Buf1, TAPSIZE1 },
+    { "channel 2", 1024, "indata1024.dat", "expectedoutput1024.dat", NULL, Coeff_Buf2, TAPSIZE2 },
+    { "channel 3", 256,  "indata256.dat",  "expectedoutput256.dat",  NULL, Coeff_Buf1, TAPSIZE1 },
+    { "channel 4", 1024, "indata1024.dat", "expectedoutput1024.dat", NULL, Coeff_Buf2, TAPSIZE2 },
+};
+
+#define NUM_CHANNELS (int)(sizeof(channels) / sizeof(channels[0]))
+
+#define MAX_VECTOR 4096
+
+static float indata[NUM_CHANNELS][MAX_VECTOR];
+static float expected[NUM_CHANNELS][MAX_VECTOR];
+
+/* Start the chain on the first buffer set and wait for it */
+static void run_chain(void)
+{
+    startFIR(0);
+
+    while(!iteration_done){
+        NOP();
+    }
+
+    iteration_done = false;
+}
+
+/* Input buffer window whose first output is the first sample of the vector */
+static const float *first_window(emu_channel *ch, const float *x)
+{
+    return &x[ch->length - 1 - (ch->taps - 1)];
+}
+
+static int verify(void)
+{
+    static double reference[NUM_SAMPLES];
+    int failed = 0;
+    int i;
+
+    for(i = 0; i < NUM_CHANNELS; i++)
+    {
+        emu_channel *ch = &channels[i];
+        double err;
+
+        if(ch->tcb == NULL)
+        {
+            printf("%s: filtered on the core, see fir_emu %s\n", ch->name,
+                   FIXED_CHANNEL(i) ? "fixed" : "hybrid");
+            continue;
+        }
+
+        emu_reference_fir(first_window(ch, indata[i]), ch->coeffs, ch->taps, reference, NUM_SAMPLES);
+        err = emu_max_error((float *)ch->tcb[FIR_TCB_OB], reference, NUM_SAMPLES);
+        printf("%s: %d taps, max error vs reference %.3g %s\n", ch->name, ch->taps, err,
+               err <= REFERENCE_TOLERANCE ? "ok" : "FAILED");
+        if(err > REFERENCE_TOLERANCE)
+            failed = 1;
+
+        if(ch->taps == ch->length)
+        {
+            for(int k = 0; k < NUM_SAMPLES; k++)
+                reference[k] = expected[i][k];
+            err = emu_max_error((float *)ch->tcb[FIR_TCB_OB], reference, NUM_SAMPLES);
+            printf("%s: max error vs %s %.3g %s\n", ch->name, ch->expected, err,
+                   err <= GOLDEN_TOLERANCE ? "ok" : "FAILED");
+            if(err > GOLDEN_TOLERANCE)
+                failed = 1;
+        }
+        else
+        {
+            printf("%s: %s skipped, it was generated for %d taps\n", ch->name, ch->expected, ch->length);
+        }
+    }
+
+    return failed;
+}
+
+int emu_verify(const char *dir, int argc, char *argv[])
+{
+    long iterations = argc > 0 ? atol(argv[0]) : 20000;
+    double t0, t1;
+    long n;
+    int i;
+
+    for(i = 0; i < NUM_CHANNELS; i++)
+    {
+        emu_channel *ch = &channels[i];
+
+        if(emu_load_dat(dir, ch->indata, indata[i], MAX_VECTOR) != 2 * ch->length - 1 ||
+           emu_load_dat(dir, ch->expected, expected[i], MAX_VECTOR) != ch->length)
+        {
+            fprintf(stderr, "%s: unexpected test vector size in %s\n", ch->name, dir);
+            return 2;
+        }
+    }
+
+    emu_reset();
+    if(initBlockMemory(NUM_SAMPLES) != 0 || initFIR() != 0)
+        return 2;
+
+    for(i = 0; i < NUM_CHANNELS; i++)
+    {
+        emu_channel *ch = &channels[i];
+        const float *x = first_window(ch, indata[i]);
+        float *ib;
+
+        if(firChainIndex[i] < 0)
+            continue;
+
+        ch->tcb = FIR_Chain.tcb[firChainIndex[i]];
+        ib = (float *)ch->tcb[FIR_TCB_IB];
+        int il = (int)ch->tcb[FIR_TCB_IL];
+        int ii = (int)((float *)ch->tcb[FIR_TCB_II] - ib);
+
+        /* history and block from where the channel's input index points */
+        for(n = 0; n < NUM_SAMPLES + ch->taps - 1; n++)
+            ib[(ii + n) % il] = x[n];
+    }
+
+    run_chain();
+
+    if(verify())
+        return 1;
+
+    fir_accel_statistics.macs = 0;
+    t0 = emu_seconds();
+    for(n = 0; n < iterations; n++)
+        run_chain();
+    t1 = emu_seconds();
+
+    printf("%ld iterations of %d channels x %d samples in %.3f s\n",
+           iterations, firChainChannels, NUM_SAMPLES, t1 - t0);
+    printf("%.1f Msamples/s per channel, %.1f MMAC/s, %.0fx real time at 48 kHz\n",
+           iterations * (double)NUM_SAMPLES / (t1 - t0) * 1e-6,
+           fir_accel_statistics.macs / (t1 - t0) * 1e-6,
+           iterations * (double)NUM_SAMPLES / (t1 - t0) / 48000.0);
+
+    return 0;
+}
@@ -0,0 +1,164 @@
+/*
+ * NAME:     extmem_emu.c
+ * PURPOSE:  Functional model of external port DMA channel 0 and the SDRAM
+ *           behind it, with a configurable latency and bandwidth.
+ * USAGE:    Time advances one core cycle per emu_step(). Setting DMAEN in
+ *           DMAC0 starts the DMA: with CHEN it loads the TCB CPEP0 points at
+ *           and follows the chain until a CP of 0, otherwise it transfers
+ *           the register set once. A transfer takes extmem_emu_latency cycles
+ *           plus extmem_emu_cycles_per_word per word and moves its words when
+ *           it ends, from SDRAM into internal memory or with TRAN the other
+ *           way; with CBEN the external index wraps round EBEP0/ELEP0. DMAS is
+ *           set until the last transfer ended. SDRAM is plain host memory.
+ *
+ *           The default of 4 cycles per word is SDRAM at 133 MHz on the 16-bit
+ *           bus of the EZ-KIT, two SDCLK per word, under a 266 MHz core.
+ */
+
+#include <math.h>
+#include <string.h>
+#include "ADDS_21479_EzKit.h"
+#include "sharc_emu.h"
+
+extmem_emu_stats extmem_emu_statistics;
+unsigned int extmem_emu_latency = 20;
+double extmem_emu_cycles_per_word = 4.0;
+
+static struct {
+    int started;                /* DMAEN seen since it was last clear */
+    int busy;                   /* transfer in flight */
+    long long remaining;        /* cycles until it ends */
+} ep;
+
+void extmem_emu_reset(void)
+{
+    memset(&ep, 0, sizeof(ep));
+    memset(&extmem_emu_statistics, 0, sizeof(extmem_emu_statistics));
+}
+
+/* Loads the registers from the TCB at cp */
+static void load_tcb(fir_word *cp)
+{
+    emu_mmr[EMU_CPEP0] = EP_TCB_FIELD(cp, EP_TCB_CP);
+    emu_mmr[EMU_ELEP0] = EP_TCB_FIELD(cp, EP_TCB_EL);
+    emu_mmr[EMU_EBEP0] = EP_TCB_FIELD(cp, EP_TCB_EB);
+    emu_mmr[EMU_EMEP0] = EP_TCB_FIELD(cp, EP_TCB_EM);
+    emu_mmr[EMU_EIEP0] = EP_TCB_FIELD(cp, EP_TCB_EI);
+    emu_mmr[EMU_ICEP0] = EP_TCB_FIELD(cp, EP_TCB_IC);
+    emu_mmr[EMU_IMEP0] = EP_TCB_FIELD(cp, EP_TCB_IM);
+    emu_mmr[EMU_IIEP0] = EP_TCB_FIELD(cp, EP_TCB_II);
+}
+
+static void transfer_begin(void)
+{
+    long long words = (long long)emu_mmr[EMU_ICEP0];
+
+    ep.busy = 1;
+    ep.remaining = extmem_emu_latency + (long long)ceil(words * extmem_emu_cycles_per_word);
+    emu_mmr[EMU_DMAC0] |= DMAS;
+}
+
+/* Next TCB of the chain, or the end of the DMA */
+static void transfer_next(void)
+{
+    if((emu_mmr[EMU_DMAC0] & CHEN) && emu_mmr[EMU_CPEP0] != 0)
+    {
+        load_tcb((fir_word *)emu_mmr[EMU_CPEP0]);
+        transfer_begin();
+    }
+    else
+        emu_mmr[EMU_DMAC0] &= ~DMAS;
+}
+
+static void start(void)
+{
+    emu_reg dmac = emu_mmr[EMU_DMAC0];
+
+    if(!(dmac & DMAEN))
+    {
+        ep.started = 0;
+        ep.busy = 0;
+        emu_mmr[EMU_DMAC0] &= ~DMAS;
+        return;
+    }
+
+    if(ep.started)
+        return;
+
+    ep.started = 1;
+    extmem_emu_statistics.chains++;
+
+    if(dmac & CHEN)
+    {
+        emu_mmr[EMU_DMAC0] |= DMAS;
+        transfer_next();
+    }
+    else
+        transfer_begin();
+}
+
+volatile emu_reg *emu_ep_sync(int reg)
+{
+    start();
+    return &emu_mmr[reg];
+}
+
+/* Moves the words of the transfer and leaves the indices past them */
+static void transfer_end(void)
+{
+    int words = (int)emu_mmr[EMU_ICEP0];
+    int im = (int)emu_mmr[EMU_IMEP0];
+    int em = (int)emu_mmr[EMU_EMEP0];
+    int circular = (emu_mmr[EMU_DMAC0] & CBEN) != 0;
+    float *ii = (float *)emu_mmr[EMU_IIEP0];
+    float *eb = circular ? (float *)emu_mmr[EMU_EBEP0] : (float *)emu_mmr[EMU_EIEP0];
+    int el = (int)emu_mmr[EMU_ELEP0];
+    int ei = (int)((float *)emu_mmr[EMU_EIEP0] - eb);
+    int i;
+
+    for(i = 0; i < words; i++)
+    {
+        if(circular)
+        {
+            ei %= el;
+            if(ei < 0)
+                ei += el;
+        }
+
+        if(emu_mmr[EMU_DMAC0] & TRAN)
+            eb[ei] = *ii;
+        else
+            *ii = eb[ei];
+
+        ii += im;
+        ei += em;
+    }
+
+    emu_mmr[EMU_IIEP0] = (emu_reg)ii;
+    emu_mmr[EMU_EIEP0] = (emu_reg)(eb + ei);
+    emu_mmr[EMU_ICEP0] = 0;
+
+    extmem_emu_statistics.transfers++;
+    if(emu_mmr[EMU_DMAC0] & TRAN)
+        extmem_emu_statistics.write_words += words;
+    else
+        extmem_emu_statistics.read_words += words;
+
+    ep.busy = 0;
+}
+
+void extmem_emu_step(void)
+{
+    extmem_emu_statistics.cycles++;
+
+    start();
+    if(!ep.busy)
+        return;
+
+    extmem_emu_statistics.busy++;
+    if(--ep.remaining > 0)
+        return;
+
+    transfer_end();
+    transfer_next();
+}
@@ -0,0 +1,190 @@
+/*
+ * NAME:     fir_accel_emu.c
+ * PURPOSE:  Functional model of the FIR accelerator.
+ * USAGE:    Walks the TCB chain from CPFIR exactly as the accelerator DMA does:
+ *           FIRCTL2 taps, window and rate ratio, circular II/IB/IL input and
+ *           OI/OB/OL output addressing, CI/CM coefficient fetch, index
+ *           write-back at the end of each channel and the channel-complete
+ *           interrupt after the last one. Decimating channels compute only the
+ *           outputs they keep, interpolating ones run each polyphase branch.
+ *           A chain is filtered in the step that starts it; with
+ *           fir_accel_macs_per_cycle set, its completion is held back by the
+ *           cycles its MACs take at that rate.
+ */
+
+#include <math.h>
+#include "ADDS_21479_EzKit.h"
+#include "sharc_emu.h"
+
+fir_accel_stats fir_accel_statistics;
+
+void (*fir_accel_done_hook)(fir_word *cp) = NULL;
+
+/* Set once a chain is processed, cleared once FIRCTL1 is seen without FIR_EN,
+ * so each enable runs the chain exactly once. A restart from the completion
+ * interrupt has to disable and NOP() before it re-enables, as startFIR() does. */
+static int fir_accel_done = 0;
+
+double fir_accel_macs_per_cycle = 0.0;
+
+/* Cycles left of a timed pass, and its first TCB */
+static long long fir_accel_busy = 0;
+static fir_word *fir_accel_first;
+
+/* Coefficients of the current channel, one polyphase branch after the other,
+ * each in the order of the samples it is applied to, oldest first. A single
+ * rate channel has one branch in c(N-1)..c(0) fetch order. */
+static float fir_coeffs[FIRCTL2_TAPLEN_MASK + 1];
+
+static int circ(int index, int length)
+{
+    index %= length;
+    return index < 0 ? index + length : index;
+}
+
+void fir_accel_channel(fir_word *cp)
+{
+    int firctl2 = (int)FIR_TCB_FIELD(cp, FIR_TCB_FIRCTL2);
+    int taps = FIRCTL2_GET_TAPS(firctl2);
+    int window = FIRCTL2_GET_WINDOW(firctl2);
+    int ratio = FIRCTL2_GET_RATIO(firctl2);
+
+    /* Outputs per input sample and input samples per output */
+    int phases = (firctl2 & FIRCTL2_UPSAMP) ? ratio : 1;
+    int step = (firctl2 & FIRCTL2_UPSAMP) ? 1 : ratio;
+    int length = taps / phases;
+    int outputs = window * phases / step;
+
+    float *ib = (float *)FIR_TCB_FIELD(cp, FIR_TCB_IB);
+    int il = (int)FIR_TCB_FIELD(cp, FIR_TCB_IL);
+    int im = (int)FIR_TCB_FIELD(cp, FIR_TCB_IM);
+    int ii = (int)((float *)FIR_TCB_FIELD(cp, FIR_TCB_II) - ib);
+
+    float *ob = (float *)FIR_TCB_FIELD(cp, FIR_TCB_OB);
+    int ol = (int)FIR_TCB_FIELD(cp, FIR_TCB_OL);
+    int om = (int)FIR_TCB_FIELD(cp, FIR_TCB_OM);
+    int oi = (int)((float *)FIR_TCB_FIELD(cp, FIR_TCB_OI) - ob);
+
+    float *ci = (float *)FIR_TCB_FIELD(cp, FIR_TCB_CI);
+    int cm = (int)FIR_TCB_FIELD(cp, FIR_TCB_CM);
+
+    int j, k;
+
+    /* Fetch j is c(taps-1-j), tap j/phases of branch phases-1-j%phases */
+    for(j = 0; j < taps; j++)
+        fir_coeffs[(phases - 1 - j % phases) * length + j / phases] = ci[j * cm];
+
+    ii = circ(ii, il);
+    oi = circ(oi, ol);
+
+    /* Only the outputs that are kept are computed */
+    for(k = 0; k < outputs; k++)
+    {
+        const float *c = &fir_coeffs[(k % phases) * length];
+        float acc = 0.0f;
+        int start = circ(ii + (k / phases) * step * im, il);
+
+        if(im == 1 && start + length <= il)
+        {
+            const float *x = &ib[start];
+            for(j = 0; j < length; j++)
+                acc += c[j] * x[j];
+        }
+        else
+        {
+            for(j = 0; j < length; j++)
+                acc += c[j] * ib[circ(start + j * im, il)];
+        }
+
+        ob[circ(oi + k * om, ol)] = acc;
+    }
+
+    /* Write the advanced indices back so the next iteration continues */
+    FIR_TCB_FIELD(cp, FIR_TCB_II) = FIR_ADDR(&ib[circ(ii + window * im, il)]);
+    FIR_TCB_FIELD(cp, FIR_TCB_OI) = FIR_ADDR(&ob[circ(oi + outputs * om, ol)]);
+
+    fir_accel_statistics.channels++;
+    fir_accel_statistics.outputs += outputs;
+    fir_accel_statistics.macs += (unsigned long long)outputs * length;
+}
+
+/* End of a pass through the chain that started at first */
+static void fir_accel_complete(fir_word *first)
+{
+    emu_mmr[EMU_FIRDMASTAT] |= FIR_DMAACDONE;
+    fir_accel_statistics.iterations++;
+    fir_accel_done = 1;
+
+    if(fir_accel_done_hook != NULL)
+        fir_accel_done_hook(first);
+
+    if(emu_p0i_source() == EMU_SRC_FIRDMA)
+        emu_raise(ADI_CID_P0I);
+}
+
+void fir_accel_step(void)
+{
+    int enable = FIR_EN | FIR_DMAEN;
+    int channels, ch;
+    fir_word *first, *cp;
+    unsigned long long macs;
+
+    if(!(emu_mmr[EMU_PMCTL1] & FIRACCSEL))
+        return;
+
+    if((emu_mmr[EMU_FIRCTL1] & enable) != enable)
+    {
+        fir_accel_done = 0;
+        fir_accel_busy = 0;
+        return;
+    }
+
+    /* A timed pass ends once its cycles are up */
+    if(fir_accel_busy > 0)
+    {
+        if(--fir_accel_busy == 0)
+        {
+            fir_accel_complete(fir_accel_first);
+            if(emu_mmr[EMU_FIRCTL1] & FIR_CAI)
+                fir_accel_done = 0;
+        }
+        return;
+    }
+
+    if(fir_accel_done)
+        return;
+
+    do
+    {
+        channels = (int)((emu_mmr[EMU_FIRCTL1] & FIR_CH_MASK) >> FIR_CH_SHIFT) + 1;
+        first = cp = (fir_word *)emu_mmr[EMU_CPFIR];
+        macs = fir_accel_statistics.macs;
+
+        for(ch = 0; ch < channels; ch++)
+        {
+            emu_mmr[EMU_FIRCTL2] = FIR_TCB_FIELD(cp, FIR_TCB_FIRCTL2);
+            fir_accel_channel(cp);
+            cp = (fir_word *)FIR_TCB_FIELD(cp, FIR_TCB_CP);
+        }
+
+        emu_mmr[EMU_CPFIR] = FIR_ADDR(cp);
+
+        if(fir_accel_macs_per_cycle > 0.0)
+        {
+            fir_accel_busy = (long long)ceil((fir_accel_statistics.macs - macs) / fir_accel_macs_per_cycle);
+            if(fir_accel_busy > 0)
+            {
+                fir_accel_first = first;
+                fir_accel_done = 1;
+                return;
+            }
+        }
+
+        fir_accel_complete(first);
+
+    /* Channel auto iterate keeps going until the chain is disabled */
+    } while((emu_mmr[EMU_FIRCTL1] & FIR_CAI) && (emu_mmr[EMU_FIRCTL1] & enable) == enable);
+
+    if((emu_mmr[EMU_FIRCTL1] & enable) != enable)
+        fir_accel_done = 0;
+}
@@ -0,0 +1,123 @@
+/*
+ * NAME:     fir_emu.c
+ * PURPOSE:  Host emulation tool of the multichannel filter example.
+ * USAGE:    fir_emu [mode] [data directory] [mode arguments]
+ *
+ *           verify    [iterations]  TCB chain against reference vectors and
+ *                                   accelerator throughput (default mode)
+ *           pipeline  [blocks]      block processing driven through the SPORT
+ *                                   interrupt, checks output and schedule
+ *           stream                  whole input vectors streamed in blocks
+ *                                   against a one-shot convolution
+ *           fftconv   [blocks]      partitioned FFT convolution against the
+ *                                   direct form, 65 to 16384 taps
+ *           chain                   TCB chain builder: register values and
+ *                                   chains of 1 to 32 channels
+ *           convert   [blocks]      SPORT block conversion, per-slot against
+ *                                   single pass
+ *           profile   [blocks]      cycle statistics of the block processing
+ *                                   stages
+ *           deadline  [blocks]      overrun accounting of the SPORT interrupt
+ *                                   with injected late blocks
+ *           ring      [blocks] [us] SPORT DMA buffer ring with the interrupt
+ *                                   driven from a timer thread
+ *           blocksize [samples]     time per block and sample from 32 to 1024
+ *                                   samples per block
+ *           multirate               decimating and interpolating channels
+ *                                   against the direct form
+ *           iir       [blocks]      IIR accelerator biquad cascades and the EQ
+ *                                   channels time-shared with the FIR chain
+ *           hotswap   [blocks]      coefficient bank swaps and crossfades,
+ *                                   staged from a control thread
+ *           fixed     [blocks]      1.31 fixed-point channels bit for bit,
+ *                                   and against the float path
+ *           kernels   [blocks]      specialised core FIR kernels against the
+ *                                   generic loop, 65 to 1024 taps
+ *           hybrid    [blocks]      accelerator/core split of the channels,
+ *                                   plans and the decision log
+ *           engine    [samples] [threads]
+ *                                   work-stealing host FIR engine, scaling
+ *                                   from 1 thread to all cores
+ *           golden    [baseline] [record]
+ *                                   golden vectors through every filter
+ *                                   path and block size, with accuracy and
+ *                                   throughput gates against a baseline
+ *           bringup   [lock us]     AD1939 bring-up over the SPI model,
+ *                                   polled against batched, with faults
+ *           boot      [csv file]    boot timeline of main() to the first
+ *                                   block, optionally exported as CSV
+ *           tiles     [taps] [latency] [cycles per word]
+ *                                   SDRAM-resident filters tiled through the
+ *                                   accelerator, SDRAM bandwidth per block
+ *           route     [blocks]      routing matrix staged between blocks and
+ *                                   from a control thread, against copies
+ *           gate      [blocks]      silent channels left out of the chain,
+ *                                   against filtering every block
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "fir_emu.h"
+
+typedef struct {
+    const char *name;
+    int (*run)(const char *dir, int argc, char *argv[]);
+} emu_mode;
+
+static const emu_mode modes[] = {
+    { "verify",   emu_verify },
+    { "pipeline", emu_pipeline },
+    { "stream",   emu_stream },
+    { "fftconv",  emu_fftconv },
+    { "chain",    emu_chain },
+    { "convert",  emu_convert },
+    { "profile",  emu_profile },
+    { "deadline", emu_deadline },
+    { "ring",     emu_ring },
+    { "blocksize", emu_blocksize },
+    { "multirate", emu_multirate },
+    { "iir",      emu_iir },
+    { "hotswap",  emu_hotswap },
+    { "fixed",    emu_fixed },
+    { "kernels",  emu_kernels },
+    { "hybrid",   emu_hybrid },
+    { "engine",   emu_engine },
+    { "golden",   emu_golden },
+    { "bringup",  emu_bringup },
+    { "boot",     emu_boot },
+    { "tiles",    emu_tiles },
+    { "route",    emu_route },
+    { "gate",     emu_gate },
+};
+
+#define NUM_MODES (int)(sizeof(modes) / sizeof(modes[0]))
+
+int main(int argc, char *argv[])
+{
+    const emu_mode *mode = &modes[0];
+    const char *dir = "src";
+    int i;
+
+    if(argc > 1)
+    {
+        for(i = 0; i < NUM_MODES; i++)
+        {
+            if(strcmp(argv[1], modes[i].name) == 0)
+            {
+                mode = &modes[i];
+                argc--;
+                argv++;
+                break;
+            }
+        }
+    }
+
+    if(argc > 1)
+    {
+        dir = argv[1];
+        argc--;
+        argv++;
+    }
+
+    return mode->run(dir, argc - 1, argv + 1);
+}
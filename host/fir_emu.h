@@ -0,0 +1,34 @@
+/*
+ * NAME:     fir_emu.h
+ * PURPOSE:  Modes of the fir_emu host tool.
+ */
+#ifndef _fir_emu_H_
+#define _fir_emu_H_
+
+/* Each mode gets the data directory and the remaining arguments and returns
+ * the process exit status */
+int emu_verify(const char *dir, int argc, char *argv[]);
+int emu_pipeline(const char *dir, int argc, char *argv[]);
+int emu_stream(const char *dir, int argc, char *argv[]);
+int emu_fftconv(const char *dir, int argc, char *argv[]);
+int emu_chain(const char *dir, int argc, char *argv[]);
+int emu_convert(const char *dir, int argc, char *argv[]);
+int emu_profile(const char *dir, int argc, char *argv[]);
+int emu_deadline(const char *dir, int argc, char *argv[]);
+int emu_ring(const char *dir, int argc, char *argv[]);
+int emu_blocksize(const char *dir, int argc, char *argv[]);
+int emu_multirate(const char *dir, int argc, char *argv[]);
+int emu_iir(const char *dir, int argc, char *argv[]);
+int emu_hotswap(const char *dir, int argc, char *argv[]);
+int emu_fixed(const char *dir, int argc, char *argv[]);
+int emu_kernels(const char *dir, int argc, char *argv[]);
+int emu_hybrid(const char *dir, int argc, char *argv[]);
+int emu_engine(const char *dir, int argc, char *argv[]);
+int emu_golden(const char *dir, int argc, char *argv[]);
+int emu_bringup(const char *dir, int argc, char *argv[]);
+int emu_boot(const char *dir, int argc, char *argv[]);
+int emu_tiles(const char *dir, int argc, char *argv[]);
+int emu_route(const char *dir, int argc, char *argv[]);
+int emu_gate(const char *dir, int argc, char *argv[]);
+
+#endif /* _fir_emu_H_ */
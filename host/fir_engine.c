@@ -0,0 +1,303 @@
+/*
+ * NAME:     fir_engine.c
+ * PURPOSE:  Multi-threaded FIR engine for the host tools.
+ * USAGE:    See fir_engine.h. Every thread owns a deque of tasks behind its
+ *           own lock and takes them from the front, in the order of its
+ *           channels' ranges; thieves take from the back, the ranges furthest
+ *           from where the owner works. Tasks are large enough, a range of a
+ *           1024 tap channel is a million MACs, that a lock per task costs
+ *           nothing measurable. The ranges are filtered with coreFirBlock(),
+ *           the kernels the target uses on the core.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include "ADDS_21479_EzKit.h"
+#include "fir_engine.h"
+
+typedef struct {
+    int channel;
+    long start;
+} engine_task;
+
+/* One per thread, on cache lines of its own so that the locks and counters
+ * of neighbouring threads do not share a line */
+typedef struct {
+    pthread_mutex_t lock;
+    engine_task *tasks;         /* [head, tail) left to run */
+    long head;
+    long tail;
+    long capacity;
+    fir_engine_stats stats;
+    pthread_t thread;
+    struct fir_engine *engine;
+    int index;
+    unsigned int seed;
+} __attribute__((aligned(FIR_ENGINE_LINE))) engine_worker;
+
+struct fir_engine {
+    engine_worker worker[FIR_ENGINE_MAX_THREADS];
+    int threads;
+
+    /* The job of the current run */
+    const fir_engine_channel *channels;
+    long length;
+    int range;
+    long remaining;             /* tasks not finished yet */
+
+    /* Start and end of a run */
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    pthread_cond_t done;
+    unsigned int generation;
+    int active;                 /* threads still in the run */
+    int quit;
+};
+
+float *fir_engine_alloc(long count)
+{
+    void *p;
+
+    /* Rounded up to whole lines, so no other buffer shares the last one */
+    count = (count + FIR_ENGINE_LINE / sizeof(float) - 1) / (FIR_ENGINE_LINE / sizeof(float)) *
+            (FIR_ENGINE_LINE / sizeof(float));
+    if(posix_memalign(&p, FIR_ENGINE_LINE, count * sizeof(float)) != 0)
+        return NULL;
+    return p;
+}
+
+/*-------------------------------------------------------------------------------*/
+/* Tasks */
+
+static int pop(engine_worker *w, engine_task *t)
+{
+    int found = 0;
+
+    pthread_mutex_lock(&w->lock);
+    if(w->head < w->tail)
+    {
+        *t = w->tasks[w->head++];
+        found = 1;
+    }
+    pthread_mutex_unlock(&w->lock);
+    return found;
+}
+
+static int steal(engine_worker *victim, engine_task *t)
+{
+    int found = 0;
+
+    pthread_mutex_lock(&victim->lock);
+    if(victim->head < victim->tail)
+    {
+        *t = victim->tasks[--victim->tail];
+        found = 1;
+    }
+    pthread_mutex_unlock(&victim->lock);
+    return found;
+}
+
+static void run_task(fir_engine *e, const engine_task *t)
+{
+    const fir_engine_channel *c = &e->channels[t->channel];
+    long length = e->length - t->start < e->range ? e->length - t->start : e->range;
+
+    coreFirBlock(&c->x[t->start], c->coeffs, c->taps, &c->y[t->start], (int)length);
+}
+
+/* Own tasks first, then other threads' from a random one on, until every
+ * task of the run is finished */
+static void work(fir_engine *e, engine_worker *w)
+{
+    engine_task t;
+    int n, v;
+
+    while(__atomic_load_n(&e->remaining, __ATOMIC_ACQUIRE) > 0)
+    {
+        if(pop(w, &t))
+        {
+            run_task(e, &t);
+            w->stats.tasks++;
+            __atomic_sub_fetch(&e->remaining, 1, __ATOMIC_ACQ_REL);
+            continue;
+        }
+
+        w->seed = w->seed * 1664525u + 1013904223u;
+        v = (w->seed >> 16) % e->threads;
+        for(n = 0; n < e->threads; n++, v = (v + 1) % e->threads)
+        {
+            if(v != w->index && steal(&e->worker[v], &t))
+                break;
+        }
+
+        if(n < e->threads)
+        {
+            run_task(e, &t);
+            w->stats.tasks++;
+            w->stats.stolen++;
+            __atomic_sub_fetch(&e->remaining, 1, __ATOMIC_ACQ_REL);
+        }
+        else
+        {
+            /* The last tasks are running elsewhere */
+            sched_yield();
+        }
+    }
+}
+
+static void *worker_thread(void *arg)
+{
+    engine_worker *w = arg;
+    fir_engine *e = w->engine;
+    unsigned int generation = 0;
+
+    for(;;)
+    {
+        pthread_mutex_lock(&e->lock);
+        while(e->generation == generation && !e->quit)
+            pthread_cond_wait(&e->start, &e->lock);
+        generation = e->generation;
+        if(e->quit)
+        {
+            pthread_mutex_unlock(&e->lock);
+            return NULL;
+        }
+        pthread_mutex_unlock(&e->lock);
+
+        work(e, w);
+
+        pthread_mutex_lock(&e->lock);
+        if(--e->active == 0)
+            pthread_cond_signal(&e->done);
+        pthread_mutex_unlock(&e->lock);
+    }
+}
+
+/*-------------------------------------------------------------------------------*/
+/* Pool */
+
+fir_engine *fir_engine_create(int threads)
+{
+    fir_engine *e;
+    void *p;
+    int i;
+
+    if(threads < 1 || threads > FIR_ENGINE_MAX_THREADS ||
+       posix_memalign(&p, FIR_ENGINE_LINE, sizeof(fir_engine)) != 0)
+        return NULL;
+
+    e = p;
+    memset(e, 0, sizeof(*e));
+    e->threads = threads;
+    pthread_mutex_init(&e->lock, NULL);
+    pthread_cond_init(&e->start, NULL);
+    pthread_cond_init(&e->done, NULL);
+
+    for(i = 0; i < threads; i++)
+    {
+        engine_worker *w = &e->worker[i];
+
+        pthread_mutex_init(&w->lock, NULL);
+        w->engine = e;
+        w->index = i;
+        w->seed = 2 * i + 1;
+
+        /* The caller is thread 0 */
+        if(i > 0 && pthread_create(&w->thread, NULL, worker_thread, w) != 0)
+        {
+            e->threads = i;
+            fir_engine_destroy(e);
+            return NULL;
+        }
+    }
+
+    return e;
+}
+
+int fir_engine_run(fir_engine *e, const fir_engine_channel *channels, int count, long length, int range)
+{
+    long per_channel = (length + range - 1) / range, start;
+    int ch, i;
+
+    /* Every channel's tasks go to its home thread */
+    for(i = 0; i < e->threads; i++)
+    {
+        engine_worker *w = &e->worker[i];
+        long need = per_channel * ((count + e->threads - 1 - i) / e->threads);
+
+        if(need > w->capacity)
+        {
+            engine_task *tasks = realloc(w->tasks, need * sizeof(engine_task));
+
+            if(tasks == NULL)
+                return -1;
+            w->tasks = tasks;
+            w->capacity = need;
+        }
+        w->head = w->tail = 0;
+    }
+
+    for(ch = 0; ch < count; ch++)
+    {
+        engine_worker *w = &e->worker[ch % e->threads];
+
+        for(start = 0; start < length; start += range)
+        {
+            w->tasks[w->tail].channel = ch;
+            w->tasks[w->tail].start = start;
+            w->tail++;
+        }
+    }
+
+    e->channels = channels;
+    e->length = length;
+    e->range = range;
+    e->remaining = per_channel * count;
+
+    pthread_mutex_lock(&e->lock);
+    e->active = e->threads - 1;
+    e->generation++;
+    pthread_cond_broadcast(&e->start);
+    pthread_mutex_unlock(&e->lock);
+
+    work(e, &e->worker[0]);
+
+    /* No thread may still look at the deques when the next run fills them */
+    pthread_mutex_lock(&e->lock);
+    while(e->active > 0)
+        pthread_cond_wait(&e->done, &e->lock);
+    pthread_mutex_unlock(&e->lock);
+
+    return 0;
+}
+
+void fir_engine_statistics(const fir_engine *e, int n, fir_engine_stats *stats)
+{
+    *stats = e->worker[n].stats;
+}
+
+void fir_engine_destroy(fir_engine *e)
+{
+    int i;
+
+    pthread_mutex_lock(&e->lock);
+    e->quit = 1;
+    pthread_cond_broadcast(&e->start);
+    pthread_mutex_unlock(&e->lock);
+
+    for(i = 0; i < e->threads; i++)
+    {
+        if(i > 0)
+            pthread_join(e->worker[i].thread, NULL);
+        pthread_mutex_destroy(&e->worker[i].lock);
+        free(e->worker[i].tasks);
+    }
+
+    pthread_mutex_destroy(&e->lock);
+    pthread_cond_destroy(&e->start);
+    pthread_cond_destroy(&e->done);
+    free(e);
+}
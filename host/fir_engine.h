@@ -0,0 +1,59 @@
+/*
+ * NAME:     fir_engine.h
+ * PURPOSE:  Multi-threaded FIR engine for the host tools: spreads channel x
+ *           block-range tasks over a work-stealing pool of threads.
+ * USAGE:    fir_engine_create() starts the threads once; fir_engine_run()
+ *           filters a set of channels and returns when all are done;
+ *           fir_engine_destroy() joins the threads.
+ *
+ *           The outputs of a range only depend on the input of the range and
+ *           the taps-1 samples before it, so the ranges of a channel run in
+ *           any order and on any thread. Each channel has a home thread whose
+ *           deque gets all of its tasks; only a thread that runs out of work
+ *           steals from another's, so a channel's coefficients and buffers
+ *           stay in one core's cache unless the load is uneven.
+ */
+#ifndef _fir_engine_H_
+#define _fir_engine_H_
+
+/* Cache line the engine aligns its buffers and per-thread state to */
+#define FIR_ENGINE_LINE     64
+
+/* Most threads of a pool */
+#define FIR_ENGINE_MAX_THREADS  64
+
+/* One channel: y[k] = sum(c[j] * x[k+taps-1-j]) for k = 0..length-1, so x
+ * holds taps-1 samples of history before the first input sample */
+typedef struct {
+    const float *x;
+    const float *coeffs;
+    int taps;
+    float *y;
+} fir_engine_channel;
+
+typedef struct {
+    unsigned long long tasks;   /* tasks run */
+    unsigned long long stolen;  /* of which taken from another thread */
+} fir_engine_stats;
+
+typedef struct fir_engine fir_engine;
+
+/* Pool of threads, 1 to FIR_ENGINE_MAX_THREADS. Returns NULL on error. */
+fir_engine *fir_engine_create(int threads);
+
+/* Filters length samples of count channels in tasks of range samples, the
+ * last one shorter, on all threads of the pool including the caller.
+ * Ranges that are multiples of FIR_ENGINE_LINE/sizeof(float) keep two
+ * threads from writing into one cache line of an aligned output. Returns 0,
+ * or -1 when the deques cannot grow to hold the tasks. */
+int fir_engine_run(fir_engine *e, const fir_engine_channel *channels, int count, long length, int range);
+
+/* Counts of thread n since fir_engine_create() */
+void fir_engine_statistics(const fir_engine *e, int n, fir_engine_stats *stats);
+
+void fir_engine_destroy(fir_engine *e);
+
+/* Buffer of count floats aligned to a cache line, free() releases it */
+float *fir_engine_alloc(long count);
+
+#endif /* _fir_engine_H_ */
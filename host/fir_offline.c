@@ -0,0 +1,208 @@
+/*
+ * NAME:     fir_offline.c
+ * PURPOSE:  Streams recorded audio through the filter chain of the example
+ *           on a Linux host, as fast as the host runs it.
+ * USAGE:    fir_offline [options] input output
+ *
+ *           -b samples  samples per block, any size initBlockMemory()
+ *                       takes (default NUM_SAMPLES)
+ *           -f format   raw sample format: s16, s24, s32 or f32 (default s32)
+ *           -c channels raw input channels, 1 to NUM_RX_SLOTS (default 4)
+ *           -r rate     raw sample rate in Hz (default 48000)
+ *           -w          write a WAV header; the default when output ends in
+ *                       .wav or the input is a WAV file
+ *
+ *           The input channels are the RX TDM slots in order, AIN1L, AIN1R,
+ *           AIN2L and AIN2R; slots without an input channel get silence. The
+ *           output has the eight DAC channels of ad1939_float_data, Tx_L1,
+ *           Tx_R1 ... Tx_R4, in the format and at the rate of the input.
+ *           "-" reads stdin or writes stdout. Each block goes through the
+ *           SPORT interrupt and handleCodecData() as in fir_emu, so the
+ *           output is what the DACs would receive, with the pipeline delay
+ *           removed. Input is read in chunks of a few blocks, so the files can
+ *           be of any length. The throughput goes to stderr.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include "ADDS_21479_EzKit.h"
+#include "emu_util.h"
+#include "emu_codec.h"
+#include "audio_io.h"
+
+/* Blocks read from the input at a time */
+#define OFFLINE_CHUNK_BLOCKS    16
+
+/* ad1939_float_data order: SPORT0 A slots, then SPORT0 B slots */
+#define OFFLINE_OUT_CHANNELS    (2 * NUM_TX_SLOTS)
+
+static void usage(void)
+{
+    fprintf(stderr,
+            "usage: fir_offline [-b samples] [-f s16|s24|s32|f32] [-c channels] [-r rate] [-w]\n"
+            "                   input output\n");
+}
+
+static int has_suffix(const char *name, const char *suffix)
+{
+    size_t n = strlen(name), m = strlen(suffix);
+
+    return n >= m && strcasecmp(&name[n - m], suffix) == 0;
+}
+
+int main(int argc, char *argv[])
+{
+    static int rx[RX_BLOCK_MAX], txa[TX_BLOCK_MAX], txb[TX_BLOCK_MAX];
+    audio_file in, out;
+    int samples = NUM_SAMPLES, wav = 0;
+    int *frames, *output;
+    int length[EMU_CODEC_LATENCY + 1];
+    long long b = 0, last = 0;
+    double t0, t1;
+    int n, i, s, opt, flushing = 0, failed = 0;
+
+    in.format = AUDIO_S32;
+    in.channels = NUM_RX_SLOTS;
+    in.rate = 48000;
+
+    while((opt = getopt(argc, argv, "b:f:c:r:w")) != -1)
+    {
+        switch(opt)
+        {
+        case 'b':
+            samples = atoi(optarg);
+            break;
+        case 'f':
+            if((n = audio_parse_format(optarg)) < 0)
+            {
+                usage();
+                return 2;
+            }
+            in.format = (audio_format)n;
+            break;
+        case 'c':
+            in.channels = atoi(optarg);
+            break;
+        case 'r':
+            in.rate = atoi(optarg);
+            break;
+        case 'w':
+            wav = 1;
+            break;
+        default:
+            usage();
+            return 2;
+        }
+    }
+
+    if(argc - optind != 2)
+    {
+        usage();
+        return 2;
+    }
+
+    if(audio_open_read(&in, argv[optind]) != 0)
+        return 2;
+
+    if(in.channels < 1 || in.channels > NUM_RX_SLOTS)
+    {
+        fprintf(stderr, "%s: %d channels, the codec has %d inputs\n", argv[optind], in.channels,
+                NUM_RX_SLOTS);
+        return 2;
+    }
+
+    out.format = in.format;
+    out.channels = OFFLINE_OUT_CHANNELS;
+    out.rate = in.rate;
+    if(audio_open_write(&out, argv[optind + 1], wav || in.wav || has_suffix(argv[optind + 1], ".wav")) != 0)
+        return 2;
+
+    emu_codec_init(samples);
+
+    frames = malloc((size_t)OFFLINE_CHUNK_BLOCKS * samples * in.channels * sizeof(int));
+    output = malloc((size_t)samples * OFFLINE_OUT_CHANNELS * sizeof(int));
+    if(frames == NULL || output == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        return 2;
+    }
+
+    t0 = emu_seconds();
+
+    /* Block b comes out EMU_CODEC_LATENCY blocks later; silence flushes the
+     * last ones out after the input ends */
+    while(!flushing || b < last + EMU_CODEC_LATENCY)
+    {
+        n = 0;
+        if(!flushing)
+        {
+            n = audio_read(&in, frames, OFFLINE_CHUNK_BLOCKS * samples);
+            if(n < 0)
+            {
+                failed = 1;
+                break;
+            }
+            if(n == 0)
+            {
+                flushing = 1;
+                last = b;
+                continue;
+            }
+        }
+
+        for(s = 0; s < n || (flushing && s == 0); s += samples)
+        {
+            int count = n - s < samples ? n - s : samples;
+
+            for(i = 0; i < samples; i++)
+            {
+                int slot;
+
+                for(slot = 0; slot < NUM_RX_SLOTS; slot++)
+                    rx[NUM_RX_SLOTS*i + slot] = i < count && slot < in.channels ?
+                                                frames[(s + i) * in.channels + slot] : 0;
+            }
+
+            emu_codec_block(rx, txa, txb);
+
+            length[b % (EMU_CODEC_LATENCY + 1)] = count;
+            if(b >= EMU_CODEC_LATENCY)
+            {
+                count = length[(b - EMU_CODEC_LATENCY) % (EMU_CODEC_LATENCY + 1)];
+
+                for(i = 0; i < count; i++)
+                {
+                    memcpy(&output[OFFLINE_OUT_CHANNELS*i], &txa[NUM_TX_SLOTS*i], NUM_TX_SLOTS * sizeof(int));
+                    memcpy(&output[OFFLINE_OUT_CHANNELS*i + NUM_TX_SLOTS], &txb[NUM_TX_SLOTS*i],
+                           NUM_TX_SLOTS * sizeof(int));
+                }
+                if(audio_write(&out, output, count) != 0)
+                {
+                    failed = 1;
+                    break;
+                }
+            }
+            b++;
+        }
+        if(failed)
+            break;
+    }
+
+    t1 = emu_seconds();
+
+    failed |= audio_close(&out) != 0;
+    audio_close(&in);
+    free(frames);
+    free(output);
+
+    fprintf(stderr, "%lld frames of %d channels, %d samples per block, %.3f s: "
+            "%.2f Msamples/s per channel, %.0fx real time at %d Hz\n",
+            in.frames, in.channels, samples, t1 - t0,
+            t1 > t0 ? in.frames / (t1 - t0) * 1e-6 : 0.0,
+            t1 > t0 ? in.frames / (t1 - t0) / in.rate : 0.0, in.rate);
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,130 @@
+/*
+ * NAME:     iir_accel_emu.c
+ * PURPOSE:  Functional model of the IIR accelerator.
+ * USAGE:    Walks the TCB chain from CPIIR exactly as the accelerator DMA does:
+ *           IIRCTL2 biquads and window, circular II/IB/IL input and OI/OB/OL
+ *           output addressing, the CB coefficients and the SB states, which
+ *           are written back with the indices at the end of each channel, and
+ *           the channel-complete interrupt after the last one. It only runs
+ *           while PMCTL1 hands the engine to IIRACCSEL.
+ */
+
+#include "ADDS_21479_EzKit.h"
+#include "sharc_emu.h"
+
+iir_accel_stats iir_accel_statistics;
+
+/* Set once a chain is processed, cleared once IIRCTL1 is seen without
+ * IIR_EN, so each enable runs the chain exactly once */
+static int iir_accel_done = 0;
+
+static int circ(int index, int length)
+{
+    index %= length;
+    return index < 0 ? index + length : index;
+}
+
+void iir_accel_channel(fir_word *cp)
+{
+    int iirctl2 = (int)IIR_TCB_FIELD(cp, IIR_TCB_IIRCTL2);
+    int biquads = IIRCTL2_GET_BIQUADS(iirctl2);
+    int window = IIRCTL2_GET_WINDOW(iirctl2);
+
+    const float *cb = (const float *)IIR_TCB_FIELD(cp, IIR_TCB_CB);
+    float *sb = (float *)IIR_TCB_FIELD(cp, IIR_TCB_SB);
+
+    float *ib = (float *)IIR_TCB_FIELD(cp, IIR_TCB_IB);
+    int il = (int)IIR_TCB_FIELD(cp, IIR_TCB_IL);
+    int im = (int)IIR_TCB_FIELD(cp, IIR_TCB_IM);
+    int ii = (int)((float *)IIR_TCB_FIELD(cp, IIR_TCB_II) - ib);
+
+    float *ob = (float *)IIR_TCB_FIELD(cp, IIR_TCB_OB);
+    int ol = (int)IIR_TCB_FIELD(cp, IIR_TCB_OL);
+    int om = (int)IIR_TCB_FIELD(cp, IIR_TCB_OM);
+    int oi = (int)((float *)IIR_TCB_FIELD(cp, IIR_TCB_OI) - ob);
+
+    float d[IIR_MAX_BIQUADS][IIR_BIQUAD_STATES];
+    int j, k;
+
+    for(j = 0; j < biquads; j++)
+    {
+        d[j][0] = sb[j * IIR_BIQUAD_STATES];
+        d[j][1] = sb[j * IIR_BIQUAD_STATES + 1];
+    }
+
+    ii = circ(ii, il);
+    oi = circ(oi, ol);
+
+    /* Transposed direct form II, each biquad feeds the next */
+    for(k = 0; k < window; k++)
+    {
+        float x = ib[circ(ii + k * im, il)];
+
+        for(j = 0; j < biquads; j++)
+        {
+            const float *c = &cb[j * IIR_BIQUAD_COEFFS];
+            float y = c[0] * x + d[j][0];
+
+            d[j][0] = c[1] * x - c[3] * y + d[j][1];
+            d[j][1] = c[2] * x - c[4] * y;
+            x = y;
+        }
+
+        ob[circ(oi + k * om, ol)] = x;
+    }
+
+    /* Write the states and the advanced indices back so the next iteration
+     * continues */
+    for(j = 0; j < biquads; j++)
+    {
+        sb[j * IIR_BIQUAD_STATES] = d[j][0];
+        sb[j * IIR_BIQUAD_STATES + 1] = d[j][1];
+    }
+    IIR_TCB_FIELD(cp, IIR_TCB_II) = FIR_ADDR(&ib[circ(ii + window * im, il)]);
+    IIR_TCB_FIELD(cp, IIR_TCB_OI) = FIR_ADDR(&ob[circ(oi + window * om, ol)]);
+
+    iir_accel_statistics.channels++;
+    iir_accel_statistics.outputs += window;
+    iir_accel_statistics.biquads += (unsigned long long)window * biquads;
+}
+
+void iir_accel_step(void)
+{
+    int enable = IIR_EN | IIR_DMAEN;
+    int channels, ch;
+    fir_word *cp;
+
+    if(!(emu_mmr[EMU_PMCTL1] & IIRACCSEL))
+        return;
+
+    if((emu_mmr[EMU_IIRCTL1] & enable) != enable)
+    {
+        iir_accel_done = 0;
+        return;
+    }
+
+    if(iir_accel_done)
+        return;
+
+    channels = (int)((emu_mmr[EMU_IIRCTL1] & IIR_CH_MASK) >> IIR_CH_SHIFT) + 1;
+    cp = (fir_word *)emu_mmr[EMU_CPIIR];
+
+    for(ch = 0; ch < channels; ch++)
+    {
+        emu_mmr[EMU_IIRCTL2] = IIR_TCB_FIELD(cp, IIR_TCB_IIRCTL2);
+        iir_accel_channel(cp);
+        cp = (fir_word *)IIR_TCB_FIELD(cp, IIR_TCB_CP);
+    }
+
+    emu_mmr[EMU_CPIIR] = FIR_ADDR(cp);
+    emu_mmr[EMU_IIRDMASTAT] |= IIR_DMAACDONE;
+    iir_accel_statistics.iterations++;
+    iir_accel_done = 1;
+
+    /* The engine raises the same DMA interrupt for either accelerator */
+    if(emu_p0i_source() == EMU_SRC_FIRDMA)
+        emu_raise(ADI_CID_P0I);
+
+    if((emu_mmr[EMU_IIRCTL1] & enable) != enable)
+        iir_accel_done = 0;
+}
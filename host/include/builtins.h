@@ -0,0 +1,48 @@
+/*
+ * NAME:     builtins.h (host emulation)
+ * PURPOSE:  Stand-in for the SHARC compiler builtins used by the project sources.
+ * USAGE:    Only on the include path of the host emulation build.
+ */
+#ifndef _host_builtins_H_
+#define _host_builtins_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <limits.h>
+#include <math.h>
+
+/* The core idles in NOP loops while it waits for a peripheral. On the host
+ * this is where the emulated peripherals get to run. */
+void emu_nop(void);
+#define NOP()   emu_nop()
+
+/* 1.31 fractional to float */
+static inline float __builtin_conv_RtoF(int x)
+{
+    return (float)x * (1.0f / 2147483648.0f);
+}
+
+/* float to 1.31 fractional, saturating like the SHARC conversion */
+static inline int __builtin_conv_FtoR(float x)
+{
+    float r = x * 2147483648.0f;
+
+    if(r >= 2147483647.0f)
+        return INT_MAX;
+    if(r <= -2147483648.0f)
+        return INT_MIN;
+    return (int)lrintf(r);
+}
+
+/* System registers touched by the project sources. EMUCLK counts core
+ * cycles on the target, the host returns its time stamp counter. */
+extern volatile int emu_sysreg_MODE1;
+unsigned int emu_sysreg_EMUCLK(void);
+
+#define sysreg_MODE1                    emu_sysreg_MODE1
+#define sysreg_EMUCLK                   emu_sysreg_EMUCLK()
+#define sysreg_read(reg)                (reg)
+#define sysreg_bit_set(reg, bits)       ((reg) |= (bits))
+#define sysreg_bit_clr(reg, bits)       ((reg) &= ~(bits))
+
+#endif /* _host_builtins_H_ */
@@ -0,0 +1,289 @@
+/*
+ * NAME:     platform_include.h (host emulation)
+ * PURPOSE:  Memory-mapped registers of the ADSP-21479 that the project touches,
+ *           backed by the emulator's register file.
+ * USAGE:    Only on the include path of the host emulation build. Bit positions
+ *           are internal to the emulator, only the names match the target headers.
+ */
+#ifndef _host_platform_include_H_
+#define _host_platform_include_H_
+
+#include <stdint.h>
+
+/* Registers are wide enough to hold a host pointer, so chain pointers and
+ * index registers can be written exactly as on the target. */
+typedef intptr_t emu_reg;
+
+enum {
+    EMU_PMCTL1 = 0,
+    EMU_PICR0,
+
+    /* Core PLL and external port */
+    EMU_PMCTL,
+    EMU_SYSCTL,
+    EMU_EPCTL,
+    EMU_SDCTL,
+    EMU_SDRRC,
+    EMU_AMICTL1,
+    EMU_AMICTL3,
+
+    /* FIR accelerator */
+    EMU_FIRCTL1,
+    EMU_FIRCTL2,
+    EMU_FIRDMASTAT,
+    EMU_CPFIR,
+
+    /* IIR accelerator */
+    EMU_IIRCTL1,
+    EMU_IIRCTL2,
+    EMU_IIRDMASTAT,
+    EMU_CPIIR,
+
+    /* SPORT0 transmitter, SPORT1 receiver */
+    EMU_SPCTL0,
+    EMU_SPCTL1,
+    EMU_SPMCTL0,
+    EMU_SPMCTL1,
+    EMU_DIV0,
+    EMU_DIV1,
+    EMU_CPSP0A,
+    EMU_CPSP0B,
+    EMU_CPSP1A,
+    EMU_SP0CS0,
+    EMU_SP1CS0,
+    EMU_MT0CCS0,
+    EMU_MR1CCS0,
+
+    /* SPI port and its DMA channel */
+    EMU_SPICTL,
+    EMU_SPIFLG,
+    EMU_SPISTAT,
+    EMU_TXSPI,
+    EMU_RXSPI,
+    EMU_SPIBAUD,
+    EMU_SPIDMAC,
+    EMU_IISPI,
+    EMU_IMSPI,
+    EMU_CSPI,
+
+    /* External port DMA channel 0 */
+    EMU_DMAC0,
+    EMU_CPEP0,
+    EMU_IIEP0,
+    EMU_IMEP0,
+    EMU_ICEP0,
+    EMU_EIEP0,
+    EMU_EMEP0,
+    EMU_EBEP0,
+    EMU_ELEP0,
+
+    EMU_MMR_COUNT
+};
+
+extern volatile emu_reg emu_mmr[EMU_MMR_COUNT];
+
+#define pPMCTL1         (&emu_mmr[EMU_PMCTL1])
+#define pPICR0          (&emu_mmr[EMU_PICR0])
+
+#define pPMCTL          (&emu_mmr[EMU_PMCTL])
+#define pSYSCTL         (&emu_mmr[EMU_SYSCTL])
+#define pEPCTL          (&emu_mmr[EMU_EPCTL])
+#define pSDCTL          (&emu_mmr[EMU_SDCTL])
+#define pSDRRC          (&emu_mmr[EMU_SDRRC])
+#define pAMICTL1        (&emu_mmr[EMU_AMICTL1])
+#define pAMICTL3        (&emu_mmr[EMU_AMICTL3])
+
+#define pFIRCTL1        (&emu_mmr[EMU_FIRCTL1])
+#define pFIRCTL2        (&emu_mmr[EMU_FIRCTL2])
+#define pFIRDMASTAT     (&emu_mmr[EMU_FIRDMASTAT])
+#define pCPFIR          (&emu_mmr[EMU_CPFIR])
+
+#define pIIRCTL1        (&emu_mmr[EMU_IIRCTL1])
+#define pIIRCTL2        (&emu_mmr[EMU_IIRCTL2])
+#define pIIRDMASTAT     (&emu_mmr[EMU_IIRDMASTAT])
+#define pCPIIR          (&emu_mmr[EMU_CPIIR])
+
+#define pSPCTL0         (&emu_mmr[EMU_SPCTL0])
+#define pSPCTL1         (&emu_mmr[EMU_SPCTL1])
+#define pSPMCTL0        (&emu_mmr[EMU_SPMCTL0])
+#define pSPMCTL1        (&emu_mmr[EMU_SPMCTL1])
+#define pDIV0           (&emu_mmr[EMU_DIV0])
+#define pDIV1           (&emu_mmr[EMU_DIV1])
+#define pCPSP0A         (&emu_mmr[EMU_CPSP0A])
+#define pCPSP0B         (&emu_mmr[EMU_CPSP0B])
+#define pCPSP1A         (&emu_mmr[EMU_CPSP1A])
+#define pSP0CS0         (&emu_mmr[EMU_SP0CS0])
+#define pSP1CS0         (&emu_mmr[EMU_SP1CS0])
+#define pMT0CCS0        (&emu_mmr[EMU_MT0CCS0])
+#define pMR1CCS0        (&emu_mmr[EMU_MR1CCS0])
+
+/* The SPI model has to see a word written to TXSPI, a DMA started by
+ * SPIDMAC or a select toggled in SPIFLG before the core touches the port
+ * again, so these accesses first let it catch up with the register file */
+volatile emu_reg *emu_spi_sync(int reg);
+
+#define pSPICTL         (emu_spi_sync(EMU_SPICTL))
+#define pSPIFLG         (emu_spi_sync(EMU_SPIFLG))
+#define pSPISTAT        (emu_spi_sync(EMU_SPISTAT))
+#define pTXSPI          (&emu_mmr[EMU_TXSPI])
+#define pRXSPI          (emu_spi_sync(EMU_RXSPI))
+#define pSPIBAUD        (&emu_mmr[EMU_SPIBAUD])
+#define pSPIDMAC        (emu_spi_sync(EMU_SPIDMAC))
+#define pIISPI          (&emu_mmr[EMU_IISPI])
+#define pIMSPI          (&emu_mmr[EMU_IMSPI])
+#define pCSPI           (&emu_mmr[EMU_CSPI])
+
+/* Likewise the external port DMA model has to see a chain started by DMAC0
+ * before the core polls it */
+volatile emu_reg *emu_ep_sync(int reg);
+
+#define pDMAC0          (emu_ep_sync(EMU_DMAC0))
+#define pCPEP0          (&emu_mmr[EMU_CPEP0])
+#define pIIEP0          (&emu_mmr[EMU_IIEP0])
+#define pIMEP0          (&emu_mmr[EMU_IMEP0])
+#define pICEP0          (&emu_mmr[EMU_ICEP0])
+#define pEIEP0          (&emu_mmr[EMU_EIEP0])
+#define pEMEP0          (&emu_mmr[EMU_EMEP0])
+#define pEBEP0          (&emu_mmr[EMU_EBEP0])
+#define pELEP0          (&emu_mmr[EMU_ELEP0])
+
+#define BIT_17          (1 << 17)
+#define BIT_18          (1 << 18)
+
+/* PMCTL */
+#define PLLM16          (16 << 0)
+#define PLLM63          (63 << 0)
+#define PLLD2           (0 << 6)
+#define PLLD4           (1 << 6)
+#define PLLD16          (3 << 6)
+#define INDIV           (1 << 8)
+#define DIVEN           (1 << 9)
+#define SDCKR2          (0 << 18)
+#define PLLBP           (1 << 15)
+
+/* SYSCTL */
+#define MSEN            (1 << 12)
+#define EPDATA32        (3 << 15)
+
+/* EPCTL */
+#define B0SD            (1 << 0)
+#define B1SD            (1 << 1)
+#define B2SD            (1 << 2)
+#define B3SD            (1 << 3)
+
+/* SDCTL */
+#define SDCL3           (3 << 0)
+#define SDPSS           (1 << 2)
+#define SDCAW9          (1 << 3)
+#define SDRAW13         (4 << 5)
+#define SDTRAS6         (6 << 8)
+#define SDTRP3          (3 << 12)
+#define SDTWR2          (2 << 15)
+#define SDTRCD3         (3 << 17)
+#define X16DE           (1 << 20)
+
+/* SDRRC */
+#define SDROPT          (1 << 17)
+
+/* AMICTLx */
+#define AMIEN           (1 << 0)
+#define BW8             (1 << 1)
+#define BW16            (2 << 1)
+#define WS2             (2 << 6)
+#define WS31            (31 << 6)
+
+/* PMCTL1 accelerator selection */
+#define FIRACCSEL       BIT_17
+#define IIRACCSEL       BIT_18
+
+/* MODE1 */
+#define IRPTEN          (1 << 12)
+
+/* FIRCTL1 */
+#define FIR_EN          (1 << 0)
+#define FIR_DMAEN       (1 << 1)
+#define FIR_CH_SHIFT    (2)
+#define FIR_CH_MASK     (0x1F << FIR_CH_SHIFT)
+#define FIR_CH(n)       (((n) - 1) << FIR_CH_SHIFT)
+#define FIR_CH1         FIR_CH(1)
+#define FIR_CH2         FIR_CH(2)
+#define FIR_CH3         FIR_CH(3)
+#define FIR_CH4         FIR_CH(4)
+#define FIR_CH8         FIR_CH(8)
+#define FIR_CH16        FIR_CH(16)
+#define FIR_CH32        FIR_CH(32)
+#define FIR_CAI         (1 << 8)
+
+/* IIRCTL1 */
+#define IIR_EN          (1 << 0)
+#define IIR_DMAEN       (1 << 1)
+#define IIR_CH_SHIFT    (2)
+#define IIR_CH_MASK     (0x1F << IIR_CH_SHIFT)
+#define IIR_CH(n)       (((n) - 1) << IIR_CH_SHIFT)
+
+/* SPCTLx */
+#define SPEN_A          (1 << 0)
+#define SLEN32          (31 << 4)
+#define SCHEN_A         (1 << 19)
+#define SDEN_A          (1 << 18)
+#define SPTRAN          (1 << 25)
+#define SPEN_B          (1 << 24)
+#define SCHEN_B         (1 << 21)
+#define SDEN_B          (1 << 20)
+
+/* SPMCTLxy */
+#define MCEA            (1 << 0)
+#define MFD1            (1 << 1)
+#define NCH3            (3 << 7)
+#define MCEB            (1 << 23)
+
+/* SPICTL */
+#define TIMOD1          (1 << 0)    /* core write to TXSPI starts a word */
+#define TIMOD2          (1 << 1)    /* DMA starts the words */
+#define SPIEN           (1 << 2)
+#define SPIMS           (1 << 3)
+#define WL8             (0 << 4)
+#define WL16            (1 << 4)
+#define WL32            (2 << 4)
+#define WL_MASK         (3 << 4)
+#define MSBF            (1 << 6)
+#define GM              (1 << 7)
+#define CPHASE          (1 << 8)
+#define CLKPL           (1 << 9)
+#define SMLS            (1 << 10)
+#define TXFLSH          (1 << 11)
+#define RXFLSH          (1 << 12)
+
+/* SPIFLG: slave select enables, and the level of each select when CPHASE
+ * leaves it to software */
+#define DS0EN           (1 << 0)
+#define DS1EN           (1 << 1)
+#define DS2EN           (1 << 2)
+#define DS3EN           (1 << 3)
+#define SPIFLG0         (1 << 8)
+
+/* SPISTAT */
+#define SPIF            (1 << 0)    /* last word shifted */
+#define TXS             (1 << 3)    /* TXSPI full */
+#define RXS             (1 << 5)    /* RXSPI full */
+#define SPIFE           (1 << 6)    /* TXSPI and shift register empty */
+
+/* SPIDMAC */
+#define SPIDEN          (1 << 0)
+#define SPIRCV          (1 << 1)
+#define SPIDMAS         (1 << 12)   /* DMA in progress */
+
+/* DMAC0 */
+#define DMAEN           (1 << 0)
+#define TRAN            (1 << 1)    /* internal to external memory */
+#define CHEN            (1 << 4)    /* chained, TCBs from CPEP0 */
+#define CBEN            (1 << 9)    /* circular external buffer of EBEP0, ELEP0 */
+#define DMAS            (1 << 17)   /* DMA in progress */
+
+/* FIRDMASTAT */
+#define FIR_DMAACDONE   (1 << 0)
+
+/* IIRDMASTAT */
+#define IIR_DMAACDONE   (1 << 0)
+
+#endif /* _host_platform_include_H_ */
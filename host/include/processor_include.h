@@ -0,0 +1,5 @@
+/*
+ * NAME:     processor_include.h (host emulation)
+ * PURPOSE:  Stand-in for the processor header, see platform_include.h.
+ */
+#include <platform_include.h>
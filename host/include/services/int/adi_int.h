@@ -0,0 +1,30 @@
+/*
+ * NAME:     adi_int.h (host emulation)
+ * PURPOSE:  Interrupt handler API backed by the emulator's interrupt table.
+ */
+#ifndef _host_adi_int_H_
+#define _host_adi_int_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef void (*ADI_INT_HANDLER_PTR)(uint32_t iid, void *handlerArg);
+
+typedef enum {
+    ADI_INT_SUCCESS = 0,
+    ADI_INT_FAILURE
+} ADI_INT_STATUS;
+
+/* Programmable interrupts used by the project */
+enum {
+    ADI_CID_P0I = 0,
+    ADI_CID_P3I,
+    ADI_CID_P6I,
+    ADI_CID_P14I,
+    ADI_CID_COUNT
+};
+
+ADI_INT_STATUS adi_int_InstallHandler(uint32_t iid, ADI_INT_HANDLER_PTR pfHandler,
+                                      void *pCBParam, bool bEnable);
+
+#endif /* _host_adi_int_H_ */
@@ -0,0 +1,10 @@
+/*
+ * NAME:     sru.h (host emulation)
+ * PURPOSE:  The signal routing unit has no effect in the host emulation build.
+ */
+#ifndef _host_sru_H_
+#define _host_sru_H_
+
+#define SRU(from, to)   ((void)0)
+
+#endif /* _host_sru_H_ */
@@ -0,0 +1,114 @@
+/*
+ * NAME:     sharc_emu.c
+ * PURPOSE:  Register file, system registers and interrupt dispatch of the host
+ *           emulation build.
+ */
+
+#include <string.h>
+#include <time.h>
+#include "ADDS_21479_EzKit.h"
+#include "sharc_emu.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+volatile emu_reg emu_mmr[EMU_MMR_COUNT];
+volatile int emu_sysreg_MODE1;
+
+/* Wraps like EMUCLK, in time stamp counter ticks or nanoseconds */
+unsigned int emu_sysreg_EMUCLK(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return (unsigned int)__rdtsc();
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned int)(ts.tv_sec * 1000000000ull + ts.tv_nsec);
+#endif
+}
+
+typedef struct {
+    ADI_INT_HANDLER_PTR handler;
+    void *arg;
+    bool enabled;
+    bool pending;
+} emu_int_entry;
+
+static emu_int_entry emu_int_table[ADI_CID_COUNT];
+
+void emu_reset(void)
+{
+    int i;
+
+    for(i = 0; i < EMU_MMR_COUNT; i++)
+        emu_mmr[i] = 0;
+    emu_sysreg_MODE1 = 0;
+    memset(emu_int_table, 0, sizeof(emu_int_table));
+    memset(&fir_accel_statistics, 0, sizeof(fir_accel_statistics));
+    memset(&iir_accel_statistics, 0, sizeof(iir_accel_statistics));
+    ad1939_emu_reset();
+    extmem_emu_reset();
+}
+
+ADI_INT_STATUS adi_int_InstallHandler(uint32_t iid, ADI_INT_HANDLER_PTR pfHandler,
+                                      void *pCBParam, bool bEnable)
+{
+    if(iid >= ADI_CID_COUNT)
+        return ADI_INT_FAILURE;
+
+    emu_int_table[iid].handler = pfHandler;
+    emu_int_table[iid].arg = pCBParam;
+    emu_int_table[iid].enabled = bEnable;
+    return ADI_INT_SUCCESS;
+}
+
+int emu_raise(uint32_t iid)
+{
+    emu_int_entry *e;
+
+    if(iid >= ADI_CID_COUNT)
+        return 0;
+
+    e = &emu_int_table[iid];
+    if(e->handler == NULL)
+        return 0;
+
+    /* Latched while interrupts are masked, like the IRPTL bit */
+    if(!(emu_sysreg_MODE1 & IRPTEN) || !e->enabled)
+    {
+        e->pending = true;
+        return 0;
+    }
+
+    e->pending = false;
+    e->handler(iid, e->arg);
+    return 1;
+}
+
+int emu_p0i_source(void)
+{
+    return (int)(emu_mmr[EMU_PICR0] & 0x1F);
+}
+
+void emu_step(void)
+{
+    uint32_t iid;
+
+    for(iid = 0; iid < ADI_CID_COUNT; iid++)
+    {
+        if(emu_int_table[iid].pending)
+            emu_raise(iid);
+    }
+
+    fir_accel_step();
+    iir_accel_step();
+    ad1939_emu_step();
+    extmem_emu_step();
+}
+
+void emu_nop(void)
+{
+    emu_step();
+}
@@ -0,0 +1,141 @@
+/*
+ * NAME:     sharc_emu.h
+ * PURPOSE:  Host emulation of the ADSP-21479 peripherals used by the project.
+ * USAGE:    The project sources are compiled unchanged against host/include,
+ *           their register accesses land in the register file declared here and
+ *           the emulated peripherals run whenever the core idles in NOP().
+ */
+#ifndef _sharc_emu_H_
+#define _sharc_emu_H_
+
+#include <stdint.h>
+#include <platform_include.h>
+#include <services/int/adi_int.h>
+
+/* Peripheral interrupt source routed through PICR0 to P0I, shared by the FIR
+ * and IIR accelerators */
+#define EMU_SRC_FIRDMA      (27)
+
+/* Register file, system registers and interrupt table back to reset state */
+void emu_reset(void);
+
+/* Raise a programmable interrupt; runs the installed handler when the
+ * interrupt and IRPTEN are enabled, otherwise latches it until emu_step()
+ * finds them enabled. Returns 1 when the handler ran. */
+int emu_raise(uint32_t iid);
+
+/* Source routed to P0I by PICR0 */
+int emu_p0i_source(void);
+
+/* Let every emulated peripheral make progress */
+void emu_step(void);
+
+/*-------------------------------------------------------------------------------*/
+/* FIR accelerator */
+
+typedef struct {
+    unsigned long long iterations;  /* passes through the TCB chain */
+    unsigned long long channels;    /* TCBs processed */
+    unsigned long long outputs;     /* output samples written */
+    unsigned long long macs;        /* multiply-accumulates */
+} fir_accel_stats;
+
+extern fir_accel_stats fir_accel_statistics;
+
+/* Multiply-accumulates the accelerator does per emu_step(); 0, the default,
+ * finishes a chain in the step that starts it. Otherwise the completion is
+ * held back until the chain had the cycles its MACs take. */
+extern double fir_accel_macs_per_cycle;
+
+/* Optional hook called with the first TCB of a chain once all of its
+ * channels are filtered, before the completion interrupt is raised */
+extern void (*fir_accel_done_hook)(fir_word *cp);
+
+/* Runs the TCB chain when FIRCTL1 enables the accelerator */
+void fir_accel_step(void);
+
+/* Filters one channel described by the TCB the chain pointer addresses and
+ * writes the updated input and output indices back into the TCB. */
+void fir_accel_channel(fir_word *cp);
+
+/*-------------------------------------------------------------------------------*/
+/* IIR accelerator */
+
+typedef struct {
+    unsigned long long iterations;  /* passes through the TCB chain */
+    unsigned long long channels;    /* TCBs processed */
+    unsigned long long outputs;     /* output samples written */
+    unsigned long long biquads;     /* biquad sections run, 5 MACs each */
+} iir_accel_stats;
+
+extern iir_accel_stats iir_accel_statistics;
+
+/* Runs the TCB chain when PMCTL1 selects the IIR accelerator and IIRCTL1
+ * enables it */
+void iir_accel_step(void);
+
+/* Filters one channel described by the TCB the chain pointer addresses and
+ * writes the states and the updated indices back. */
+void iir_accel_channel(fir_word *cp);
+
+/*-------------------------------------------------------------------------------*/
+/* SPI port with an AD1939 on slave select 0 */
+
+/* Control registers of the AD1939, CLKCTRL0 to ADCCTRL2 */
+#define AD1939_EMU_REGS     (17)
+
+typedef struct {
+    unsigned long long cycles;      /* core cycles since reset, one per emu_step() */
+    unsigned long long words;       /* words shifted out */
+    unsigned long long bits;        /* SPI clocks */
+    unsigned long long dma_words;   /* of the words, fed by the DMA */
+    unsigned long long frames;      /* transactions: select asserted and released */
+    unsigned long long writes;      /* register writes latched */
+    unsigned long long reads;       /* register reads answered */
+    unsigned long long ignored;     /* frames too short or for another address */
+    unsigned long long power_cycle; /* cycle the PLL was powered up, 0 before */
+    unsigned long long lock_cycle;  /* cycle it locked, 0 before */
+} ad1939_emu_stats;
+
+extern ad1939_emu_stats ad1939_emu_statistics;
+
+/* Register file of the codec */
+extern unsigned char ad1939_emu_regs[AD1939_EMU_REGS];
+
+/* Cycles from the PLL power-up to its lock, ~0 for a PLL that never locks */
+extern unsigned long long ad1939_emu_lock_cycles;
+
+/* Register whose writes the codec loses, -1 for none */
+extern int ad1939_emu_fault_reg;
+
+/* Codec and SPI port back to reset state, keeps the lock time and fault */
+void ad1939_emu_reset(void);
+
+/* One core cycle of the SPI port, its DMA and the codec */
+void ad1939_emu_step(void);
+
+/*-------------------------------------------------------------------------------*/
+/* External port DMA channel 0 and the SDRAM behind it */
+
+typedef struct {
+    unsigned long long cycles;      /* core cycles since reset, one per emu_step() */
+    unsigned long long busy;        /* of them, with a transfer in flight */
+    unsigned long long chains;      /* DMAs started by DMAC0 */
+    unsigned long long transfers;   /* TCBs, or register sets, transferred */
+    unsigned long long read_words;  /* SDRAM to internal memory */
+    unsigned long long write_words; /* internal memory to SDRAM */
+} extmem_emu_stats;
+
+extern extmem_emu_stats extmem_emu_statistics;
+
+/* Core cycles from the start of a transfer to its first word, and per word */
+extern unsigned int extmem_emu_latency;
+extern double extmem_emu_cycles_per_word;
+
+/* Channel back to reset state, keeps the latency and bandwidth */
+void extmem_emu_reset(void);
+
+/* One core cycle of the channel */
+void extmem_emu_step(void);
+
+#endif /* _sharc_emu_H_ */
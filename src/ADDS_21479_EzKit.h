@@ -23,34 +23,536 @@
 #include "adi_initialize.h"
 #include <sru.h>
 #include "ad1939.h"
-/* Block Size per Audio Channel*/
+#include "fir_tcb.h"
+#include "iir_tcb.h"
+#include "ep_tcb.h"
+/* Block Size per Audio Channel, chosen at boot by initBlockMemory() and held
+ * in blockSamples. NUM_SAMPLES is the default; LOW_LATENCY_SAMPLES is the
+ * live monitoring profile, sizes up to MAX_BLOCK_SAMPLES trade latency for
+ * less overhead per sample. */
 #define NUM_SAMPLES 256
-
-#define TAPS1 64
-#define WINDOWS1 NUM_SAMPLES<<14
-
-#define TAPS2 64
-#define WINDOWS2 NUM_SAMPLES<<14
+#define LOW_LATENCY_SAMPLES 64
+#define MIN_BLOCK_SAMPLES 32
+#define MAX_BLOCK_SAMPLES 1024
 
 #define TAPSIZE1 65
 #define TAPSIZE2 65
 
-#define DMAIntrSource 27  /*FIR DMA interrupt source */
+/* Filtered channels, in RX slot order: AIN1L, AIN1R, AIN2L and AIN2R into
+ * AOUT1L, AOUT1R, AOUT3L and AOUT3R. The left inputs use the TAPSIZE1 filter,
+ * the right inputs the TAPSIZE2 filter. All of them run as one chain. */
+#define FIR_CHANNELS 4
+#define FIR_TOTAL_TAPS (2*(TAPSIZE1 + TAPSIZE2))
+
+/* EQ channels on the IIR accelerator, in RX slot order: the same inputs into
+ * AOUT2L, AOUT2R, AOUT4L and AOUT4R, EQ_BIQUADS biquads each. The engine runs
+ * them after the FIR chain of every block. */
+/* Each filtered channel has two coefficient banks of COEFF_BANK_TAPS, see
+ * coeffBank.c */
+#define COEFF_BANK_TAPS (TAPSIZE1 > TAPSIZE2 ? TAPSIZE1 : TAPSIZE2)
+
+#define IIR_CHANNELS 4
+#define EQ_BIQUADS 8
+
+#define DMAIntrSource 27  /*FIR and IIR DMA interrupt source */
+
+/* Long filters are convolved on the core by fftConvolve.c instead of on the
+ * FIR accelerator once FIR_TOTAL_TAPS, the taps of all channels, exceed
+ * FFT_CONV_THRESHOLD. The accelerator keeps up with about 11000 taps x
+ * channels at 48 kHz, the threshold leaves it headroom and is where the
+ * partitioned FFT already needs fewer operations per sample. */
+#ifndef FFT_CONV_THRESHOLD
+#define FFT_CONV_THRESHOLD 4096
+#endif
+
+#define FFT_CONVOLUTION (FIR_TOTAL_TAPS > FFT_CONV_THRESHOLD)
+
+/* Uniformly partitioned overlap-save: one partition per block of taps, each
+ * transformed with a real FFT of two blocks. Needs a power of two block. */
+#define FFT_CONV_SIZE (2*blockSamples)
+#define FFT_CONV_BINS (blockSamples+1)
+#define FFT_CONV_PARTITIONS(taps) (((taps)+blockSamples-1)/blockSamples)
+
+/* Floats of storage of a channel: the filter partitions and the
+ * frequency-domain delay line of the input, FFT_CONV_BINS complex each, and
+ * the previous input block */
+#define FFT_CONV_STORAGE(taps) (4*FFT_CONV_PARTITIONS(taps)*FFT_CONV_BINS + blockSamples)
+
+/* Upper bound of FFT_CONV_STORAGE() for blocks of n samples */
+#define FFT_CONV_STORAGE_BOUND(taps, n) (4*((taps)/(n)+1)*((n)+1) + (n))
+
+/* Filters too long for internal memory run from SDRAM, see sdramTiles.c:
+ * their coefficients and delay lines stay there and the accelerator filters
+ * them SDRAM_TILE_TAPS taps at a time out of internal scratch, which the
+ * external port DMA fills with the next tile while it filters the last. */
+#define SDRAM_TILE_TAPS FIR_MAX_TAPS
+#define SDRAM_TILES(taps) (((taps)+SDRAM_TILE_TAPS-1)/SDRAM_TILE_TAPS)
+
+/* Delay line of a tiled filter: taps-1 samples of history and the block */
+#define SDRAM_LINE_SIZE(taps, window) ((taps) - 1 + (window))
+
+/* SDRAM words a tiled filter moves per block of window samples: the block
+ * into the delay line, then for every tile its coefficients and the history
+ * of its taps, and for every tile but the first, whose window is the block
+ * itself, the window */
+#define SDRAM_BLOCK_WORDS(taps, window) (2*(taps) + SDRAM_TILES(taps)*((window) - 1))
+
+/* A window more than a tile back is in SDRAM before the pass reads it */
+#if MAX_BLOCK_SAMPLES > SDRAM_TILE_TAPS
+#error "SDRAM tiles have to be at least MAX_BLOCK_SAMPLES taps"
+#endif
+
+/* SDRAM the tiled filters share, 1 MB of the 32 MB on the EZ-KIT */
+#define SDRAM_POOL_WORDS 262144
+
+/* NOP() polls before sdramTiles.c gives up on an external port DMA: clearing
+ * all of SDRAM_POOL_WORDS at 16 cycles a word, far more than a tile takes */
+#ifndef SDRAM_EP_TIMEOUT
+#define SDRAM_EP_TIMEOUT (16 * SDRAM_POOL_WORDS)
+#endif
+
+/* Software pipelined block processing: the accelerator filters block N while
+ * the core converts block N+1 and writes back block N-1, which adds one block
+ * of latency. Set to 0 to start the accelerator and wait for it every block. */
+#ifndef PIPELINED_PROCESSING
+#define PIPELINED_PROCESSING 1
+#endif
+
+/* The FFT path filters on the core within the block, nothing to overlap */
+#if FFT_CONVOLUTION
+#undef PIPELINED_PROCESSING
+#define PIPELINED_PROCESSING 0
+#endif
+
+/* FIR channels, one bit each in RX slot order, that run as 1.31 fixed-point
+ * FIRs on the core, straight from their RX DMA slot into their TX DMA slot,
+ * instead of on the accelerator; see fixedFIR.c. For channels that need no
+ * more than 1.31 accuracy, e.g. 0x5 for AIN1L and AIN2L. The EQ channels of
+ * the same inputs still read the float delay lines. */
+#ifndef FIXED_POINT_CHANNELS
+#define FIXED_POINT_CHANNELS 0
+#endif
+
+#define FIXED_CHANNEL(ch) ((FIXED_POINT_CHANNELS >> (ch)) & 1)
 
+/* Float channels, one of which stays in the accelerator chain, which also
+ * starts the EQ cascades */
+#define FIR_FLOAT_CHANNELS (FIR_CHANNELS - FIXED_CHANNEL(0) - FIXED_CHANNEL(1) - \
+							FIXED_CHANNEL(2) - FIXED_CHANNEL(3))
 
+#if FIR_FLOAT_CHANNELS < 1
+#error "FIXED_POINT_CHANNELS has to leave at least one channel on the accelerator"
+#endif
+
+/* FIR channels, one bit each in RX slot order, whose coefficients and delay
+ * lines stay in SDRAM, see sdramTiles.c. initFIR() moves them there and
+ * leaves them out of the chain; every block the accelerator filters them
+ * tile by tile after the chain and before the EQ cascades, from
+ * ChannelscompISR. For filters too long for internal memory, e.g. 0x2 for
+ * AIN1R. Their coefficients cannot be swapped at run time. */
+#ifndef SDRAM_FIR_CHANNELS
+#define SDRAM_FIR_CHANNELS 0
+#endif
+
+#define SDRAM_CHANNEL(ch) ((SDRAM_FIR_CHANNELS >> (ch)) & 1)
+
+#if SDRAM_FIR_CHANNELS & FIXED_POINT_CHANNELS
+#error "a channel is either in SDRAM_FIR_CHANNELS or in FIXED_POINT_CHANNELS"
+#endif
+#if (SDRAM_FIR_CHANNELS | FIXED_POINT_CHANNELS) == (1 << FIR_CHANNELS) - 1
+#error "SDRAM_FIR_CHANNELS has to leave at least one channel in the accelerator chain"
+#endif
+#if SDRAM_FIR_CHANNELS && FFT_CONVOLUTION
+#error "the FFT convolution build filters every channel on the core"
+#endif
+
+/* Splits the float channels between the accelerator chain and the core, see
+ * hybridSchedule.c: at boot hybridPlan() moves the channels to the core that
+ * let both finish a block at about the same time, and the core filters them
+ * while the accelerator runs the rest. Set to 1 to enable. */
+#ifndef HYBRID_SCHEDULING
+#define HYBRID_SCHEDULING 0
+#endif
+
+/* The FFT path filters every channel on the core already */
+#if FFT_CONVOLUTION
+#undef HYBRID_SCHEDULING
+#define HYBRID_SCHEDULING 0
+#endif
+
+/* Blocks kept in the decision log of hybridStats */
+#define HYBRID_LOG_SIZE 64
+
+/* Mean square per input sample below which a block is silent, -100 dBFS; see
+ * silenceGate.c. silenceThreshold starts at this value, 0 filters every
+ * block. */
+#ifndef SILENCE_THRESHOLD
+#define SILENCE_THRESHOLD 1e-10f
+#endif
+
+/* Channel buffer sets, one per block in flight */
+#if PIPELINED_PROCESSING
+#define FIR_BUFFER_SETS 2
+#else
+#define FIR_BUFFER_SETS 1
+#endif
+
+
+
+/* Cycle counts of the block processing stages, kept in blockProfile for
+ * the debugger and the host tools. Compiled out of release builds. */
+#ifndef STAGE_PROFILING
+#ifdef NDEBUG
+#define STAGE_PROFILING 0
+#else
+#define STAGE_PROFILING 1
+#endif
+#endif
+
+#define STAGE_FLOAT		0	/* RX block to the delay lines */
+#define STAGE_PROCESS	1	/* process_audioBlocks(), hand over and wait */
+#define STAGE_FILTER	2	/* accelerator start to the last ChannelscompISR of the block */
+#define STAGE_FIX		3	/* fBlockA set to the TX blocks */
+#define STAGE_BLOCK		4	/* all of handleCodecData() */
+#define STAGE_COUNT		5
+
+/* Histogram bin n counts durations of 2^n to 2^(n+1)-1 cycles */
+#define STAGE_HISTOGRAM_BINS 32
 
 /* Number of stereo channels*/
 #define NUM_RX_SLOTS 4
 #define NUM_TX_SLOTS 4
 
-#define RX_BLOCK_SIZE (NUM_SAMPLES*NUM_RX_SLOTS)
-#define TX_BLOCK_SIZE (NUM_SAMPLES*NUM_TX_SLOTS)
+#define RX_BLOCK_SIZE (blockSamples*NUM_RX_SLOTS)
+#define TX_BLOCK_SIZE (blockSamples*NUM_TX_SLOTS)
+
+#define RX_BLOCK_MAX (MAX_BLOCK_SAMPLES*NUM_RX_SLOTS)
+#define TX_BLOCK_MAX (MAX_BLOCK_SAMPLES*NUM_TX_SLOTS)
+
+/* SPORT DMA buffers in the ring of each direction. A block has to be written
+ * back before the DMA comes round to its buffer again, SPORT_DMA_BUFFERS-1
+ * block periods after its interrupt, so each buffer beyond the ping-pong
+ * pair absorbs one more period of processing jitter at the cost of one more
+ * period of latency. */
+#ifndef SPORT_DMA_BUFFERS
+#define SPORT_DMA_BUFFERS 2
+#endif
+
+/* Single producer, single consumer queue of the completed RX blocks: block n
+ * is in buffer n % SPORT_DMA_BUFFERS. TalkThroughISR only writes head, the
+ * main loop only writes tail, so neither needs interrupts masked. */
+typedef struct{
+	volatile unsigned int head;		/* blocks completed by the SPORT DMA */
+	volatile unsigned int tail;		/* oldest block not yet written back */
+	unsigned int stamp[SPORT_DMA_BUFFERS];	/* EMUCLK at each block's interrupt */
+} block_ring;
+
+/* Words of the buffers initBlockMemory() carves for blocks of n samples, at
+ * most: the SPORT DMA rings, the fBlockA sets, the delay lines of the
+ * channels, which alternate between TAPSIZE1 and TAPSIZE2, their crossfade
+ * buffers, the delay lines of the fixed-point channels, the window the core
+ * copies a wrapped history into, the FFT storage and the mixing buffers and
+ * silent block of the routing matrix. Every term is linear or
+ * convex in n, so the region is sized by the larger of the two ends of the
+ * block size range. */
+#define BLOCK_MEMORY_WORDS(n) ( \
+	SPORT_DMA_BUFFERS*(NUM_RX_SLOTS + 2*NUM_TX_SLOTS)*(n) + \
+	FIR_BUFFER_SETS*AD1939_FLOAT_CHANNELS*(n) + \
+	(FIR_CHANNELS/2)*(FIR_DELAY_BOUND(TAPSIZE1, n) + FIR_DELAY_BOUND(TAPSIZE2, n)) + \
+	FIR_CHANNELS*(n) + \
+	(FIXED_POINT_CHANNELS ? (FIR_CHANNELS/2)*(FIXED_LINE_BOUND(TAPSIZE1, n) + \
+					FIXED_LINE_BOUND(TAPSIZE2, n)) : 0) + \
+	(HYBRID_SCHEDULING ? COEFF_BANK_TAPS - 1 + (n) : 0) + \
+	(ROUTE_OUTPUTS + 1)*(n) + \
+	(FFT_CONVOLUTION ? (FIR_CHANNELS/2)*(FFT_CONV_STORAGE_BOUND(TAPSIZE1, n) + \
+					FFT_CONV_STORAGE_BOUND(TAPSIZE2, n)) : 0))
+
+#define BLOCK_MEMORY_SIZE (BLOCK_MEMORY_WORDS(MIN_BLOCK_SAMPLES) > BLOCK_MEMORY_WORDS(MAX_BLOCK_SAMPLES) ? \
+	BLOCK_MEMORY_WORDS(MIN_BLOCK_SAMPLES) : BLOCK_MEMORY_WORDS(MAX_BLOCK_SAMPLES))
+
+/* Orders the buffer accesses around the ring indices. The ISR and the main
+ * loop share one core on the processor, so a compiler barrier keeps the
+ * stores in program order there; host tests run them as threads. */
+#ifdef HOST_EMULATION
+#define RING_BARRIER() __sync_synchronize()
+#else
+#define RING_BARRIER() asm volatile("" : : : "memory")
+#endif
+
+/* Each filtered input streams through a circular delay line of whole blocks
+ * that is the accelerator's input buffer: TAPSIZE-1 samples of history plus
+ * one block per block in flight, so the core never writes what is read. */
+#define FIR_DELAY_BLOCKS(taps) (((taps)+blockSamples-2)/blockSamples + FIR_BUFFER_SETS)
+#define FIR_DELAY_SIZE(taps) (FIR_DELAY_BLOCKS(taps)*blockSamples)
+
+/* Upper bound of FIR_DELAY_SIZE() for blocks of n samples */
+#define FIR_DELAY_BOUND(taps, n) ((taps) - 2 + (1 + FIR_BUFFER_SETS)*(n))
+
+/* Delay line of a fixed-point channel: TAPSIZE-1 samples of history and one
+ * block per block in flight, the outputs lag like those of the accelerator */
+#define FIXED_LINE_SIZE(taps) ((taps) - 1 + FIR_BUFFER_SETS*blockSamples)
+#define FIXED_LINE_BOUND(taps, n) ((taps) - 1 + FIR_BUFFER_SETS*(n))
+
+/* Number of floating-point DAC channels of the AD1939 */
+#define AD1939_FLOAT_CHANNELS 8
+
+/* Define a structure to represent buffers for the floating-point data
+ * channels of the AD1939, blockSamples each. The inputs are not here, they
+ * are converted straight into the filter delay lines of FIR_Channels. */
+typedef struct{
+	float *Tx_L1;
+	float *Tx_R1;
+	float *Tx_L2;
+	float *Tx_R2;
+	float *Tx_L3;
+	float *Tx_R3;
+	float *Tx_L4;
+	float *Tx_R4;
+
+} ad1939_float_data;
+
+/* Routing matrix of routeMatrix.c between the channels and the DAC: every
+ * AOUT channel of ad1939_float_data is a sum of the raw inputs of the RX
+ * slots and the filtered channels, in ad1939_float_data order, each with its
+ * own gain. By default each AOUT takes the filtered channel of its slot. */
+#define ROUTE_INPUT(slot) (slot)
+#define ROUTE_FILTERED(ch) (NUM_RX_SLOTS + (ch))
+#define ROUTE_SOURCES (NUM_RX_SLOTS + AD1939_FLOAT_CHANNELS)
+#define ROUTE_OUTPUTS AD1939_FLOAT_CHANNELS
+
+/* Sources summed per pass of the mixing kernel */
+#define ROUTE_PASS_SOURCES 4
+
+/* The cells of one AOUT channel that are not 0 */
+typedef struct{
+	int cells;
+	int source[ROUTE_SOURCES];
+	float gain[ROUTE_SOURCES];
+} route_row;
+
+typedef struct{
+	route_row row[ROUTE_OUTPUTS];
+	int cells;					/* of all rows */
+	int passes;					/* kernel passes over a block */
+} route_plan;
+
+typedef struct{
+	unsigned int swaps;			/* matrices made live by routeSwap() */
+	int cells;					/* of the live matrix */
+	int passes;					/* per block of the live matrix, 0 when every AOUT is one source as is */
+} route_stats;
+
+/* Cost model of hybridPlan() in core cycles, tunable from the debugger or
+ * from the decision log */
+typedef struct{
+	float acc_cycles_per_mac;		/* accelerator, per tap and output */
+	unsigned int acc_cycles_per_channel;	/* TCB load and pipeline fill */
+	float core_cycles_per_mac;		/* core kernels of coreFIR.c */
+	unsigned int core_cycles_per_channel;	/* kernel call and history copy */
+} hybrid_cost_model;
+
+/* One block of the decision log. Cycles are EMUCLK cycles; the accelerator
+ * is timed from startFIR() to the end of its FIR chain. */
+typedef struct{
+	unsigned int block;			/* blocks handed to process_audioBlocks(), from 0 */
+	unsigned int core_mask;		/* channels the core filtered */
+	unsigned int predicted_acc;
+	unsigned int predicted_core;
+	unsigned int acc_cycles;
+	unsigned int core_cycles;
+} hybrid_entry;
+
+typedef struct{
+	unsigned int core_mask;		/* plan: channel n on the core if bit n is set */
+	unsigned int predicted_acc;	/* cycles of the plan per block */
+	unsigned int predicted_core;
+	unsigned int blocks;		/* blocks filtered by the core */
+	unsigned int passes;		/* FIR chains completed by the accelerator */
+	unsigned int acc_start;		/* EMUCLK at the start of the running chain */
+	hybrid_entry log[HYBRID_LOG_SIZE];	/* block n at n % HYBRID_LOG_SIZE */
+} hybrid_stats;
+
+/* Silence gate of the FIR chain channels, kept in gateStats. Cycles are
+ * accelerator cycles of hybridModel. */
+typedef struct{
+	float energy[FIR_CHANNELS];			/* sum of squares of the last input block */
+	unsigned int quiet[FIR_CHANNELS];	/* input samples since the last block above the threshold */
+	unsigned int skipped[FIR_CHANNELS];	/* blocks left out of the chain */
+	unsigned int resumed[FIR_CHANNELS];	/* blocks filtered again after skipped ones */
+	unsigned long long saved[FIR_CHANNELS];	/* cycles of the skipped blocks */
+	unsigned int mask;					/* channels skipped in the last block */
+} gate_stats;
+
+/* A 1.31 FIR channel of fixedFIR.c */
+typedef struct{
+	int taps;
+	int lag;					/* blocks from an input block to its output block */
+	const int *coeffs;			/* c(0)..c(taps-1) in 1.31, c(0) applies to the newest sample */
+	int *line;					/* circular, taps-1 samples of history and lag+1 blocks */
+	int size;					/* words of line */
+	int next;					/* line index of the next input sample */
+} fixed_fir_channel;
+
+/* A kernel of coreFIR.c for one tap count and block size, and its entry in
+ * the dispatch table */
+typedef void (*core_fir_kernel)(const float *, const float *, float *);
+
+typedef struct{
+	int taps;
+	int length;
+	core_fir_kernel kernel;
+} core_fir_entry;
+
+#define CORE_FIR_KERNELS 9
+
+/* State of one channel of the FFT convolution engine */
+typedef struct{
+	int partitions;
+	int newest;					/* delay line slot of the latest input spectrum */
+	float *filter;				/* partition spectra, interleaved re/im */
+	float *spectra;				/* input spectra of the last partitions blocks */
+	float *last;				/* previous input block, first half of the frame */
+} fft_conv_channel;
+
+/* A filter of sdramTiles.c. Words are SDRAM words, cycles EMUCLK cycles. */
+typedef struct{
+	int taps;
+	int window;
+	int tiles;
+	float *coeffs;				/* c(0)..c(taps-1), in SDRAM */
+	float *line;				/* delay line of SDRAM_LINE_SIZE(), in SDRAM */
+	int newest;					/* line index of the next block */
+	const float *in;			/* block of the pass, in internal memory */
+	float *out;					/* its outputs */
+	unsigned int blocks;
+	unsigned int block_words;	/* read and written by the last block */
+	unsigned long long read_words;
+	unsigned long long write_words;
+	unsigned int stalls;		/* NOP() polls for tiles the DMA had not fetched yet */
+	unsigned int timeouts;		/* its DMA given up on after SDRAM_EP_TIMEOUT polls */
+	unsigned int cycles;		/* of the last pass, from sdramTilesStart() to its end */
+} sdram_fir_channel;
+
+/* Statistics of one stage, the mean is total / count */
+typedef struct{
+	unsigned int count;
+	unsigned int min;
+	unsigned int max;
+	unsigned long long total;
+	unsigned int histogram[STAGE_HISTOGRAM_BINS];
+} stage_stats;
+
+typedef struct{
+	stage_stats stage[STAGE_COUNT];
+	unsigned int begin[STAGE_COUNT];	/* EMUCLK at the start of a running stage */
+} block_profile;
+
+/* Frame deadline accounting of TalkThroughISR and handleCodecData, kept in
+ * deadlineStats in every build. Margins and lateness are EMUCLK cycles. */
+#define OVERRUN_LOG_SIZE 8
+
+typedef struct{
+	unsigned int block;			/* SPORT block index, counted from 0 */
+	unsigned int late;			/* cycles from the interrupt it overran to its end */
+} overrun_entry;
+
+typedef struct{
+	unsigned int blocks;		/* SPORT1 interrupts */
+	unsigned int overruns;		/* blocks processed while the DMA reused their buffers */
+	unsigned int skipped;		/* blocks overwritten before handleCodecData took them */
+	unsigned int period;		/* cycles between the last two interrupts */
+	unsigned int last_margin;	/* cycles to spare of the last block in time */
+	unsigned int min_margin;	/* smallest margin so far, ~0 before the first */
+	unsigned int max_late;		/* latest end of an overrun block */
+	overrun_entry log[OVERRUN_LOG_SIZE];	/* overrun n at n % OVERRUN_LOG_SIZE */
+} deadline_stats;
+
+/* Boot phases of main(), timed in bootTimeline in every build */
+#define BOOT_PLL			0	/* initPLL() */
+#define BOOT_EXTMEM			1	/* initExternalMemory() */
+#define BOOT_DAI			2	/* initDAI() */
+#define BOOT_CODEC			3	/* init1939viaSPI() */
+#define BOOT_MEMORY			4	/* initBlockMemory() */
+#define BOOT_SPORT			5	/* initSPORT() */
+#define BOOT_FILTERS		6	/* SPORT1 handler, initFIR() and initIIR() */
+#define BOOT_FIRST_BLOCK	7	/* end of the init to the end of the first handleCodecData() */
+#define BOOT_PHASES			8
+
+typedef struct{
+	unsigned int begin;			/* EMUCLK cycles from bootStart() to the start */
+	unsigned int cycles;		/* duration, 0 until it ended */
+} boot_phase;
+
+typedef struct{
+	unsigned int start;			/* EMUCLK at bootStart() */
+	unsigned int ended;			/* bit n set once phase n ended */
+	unsigned int fallback;		/* bit n set when phase n fell back to its slower path */
+	int halted;					/* phase main() stopped in for good, -1 while it boots */
+	unsigned int to_audio;		/* bootStart() to the end of the first block, 0 before */
+	int fast;					/* booted with FAST_BOOT */
+	boot_phase phase[BOOT_PHASES];
+} boot_timeline;
+
+#if STAGE_PROFILING
+#define STAGE_BEGIN(s)	(blockProfile.begin[s] = sysreg_read(sysreg_EMUCLK))
+#define STAGE_END(s)	stageRecord((s), sysreg_read(sysreg_EMUCLK) - blockProfile.begin[s])
+#else
+#define STAGE_BEGIN(s)
+#define STAGE_END(s)
+#endif
 
 #define SPIB_MODE (CPHASE | CLKPL)
 #define AD1939_CS DS0EN
 //#define AD1939_CS DS1EN
 #define CLEAR_DSXEN_BITS 0xF00
 
+/* Fast boot: initPLL() waits out the PLL lock and divider settling times on
+ * EMUCLK instead of in empty loops, whose length depends on the compiler,
+ * and the codec comes up the fast way below. Set to 1 to enable. */
+#ifndef FAST_BOOT
+#define FAST_BOOT 0
+#endif
+
+/* Core cycles initPLL() waits with FAST_BOOT: 4096 for the PLL to lock, at
+ * least 4096 CLKIN periods with the core in bypass mode, and 16 for the
+ * dividers. The waits end at their deadline, the PLL has no lock flag. */
+#define PLL_LOCK_CYCLES 4096
+#define PLL_DIVIDER_CYCLES 16
+
+/* Codec bring-up of init1939viaSPI.c. The fast one sends the register table
+ * in one SPI DMA block at the fastest clock the AD1939 takes and polls the
+ * PLL lock with a bounded backoff instead of a fixed delay per register.
+ * Set to 1 to enable, FAST_BOOT does by default. */
+#ifndef FAST_CODEC_BRINGUP
+#define FAST_CODEC_BRINGUP FAST_BOOT
+#endif
+
+/* Read every register back after the fast bring-up wrote it and fail on a
+ * difference. Always done by the original bring-up. */
+#ifndef CODEC_READBACK
+#ifdef NDEBUG
+#define CODEC_READBACK 0
+#else
+#define CODEC_READBACK 1
+#endif
+#endif
+
+/* SPI clock of PCLK/(4*SPIBAUD): 1.3 MHz for the original bring-up, 8.3 MHz
+ * for the fast one, below the 10 MHz the AD1939 control port takes */
+#define AD1939_SPIBAUD 25
+#define AD1939_SPIBAUD_FAST 4
+
+/* PLL lock wait of the fast bring-up, in Delay() iterations of at least a
+ * core cycle: the first wait between polls, the longest and the total
+ * before it gives up */
+#define CODEC_LOCK_BACKOFF_MIN 1024
+#define CODEC_LOCK_BACKOFF_MAX 16384
+#define CODEC_LOCK_TIMEOUT 5320000		/* 20 ms at 266 MHz */
+
+/* PLL lock polls of the original bring-up before it gives up, about
+ * CODEC_LOCK_TIMEOUT of 24-bit reads at AD1939_SPIBAUD */
+#define CODEC_POLLED_LOCK_POLLS (CODEC_LOCK_TIMEOUT / (24 * 8 * AD1939_SPIBAUD))
+
 #define SELECT_SPI_SLAVE(select) (*pSPIFLG &= ~(spiselect<<8))
 #define DESELECT_SPI_SLAVE(select) (*pSPIFLG |= (spiselect<<8))
 
@@ -58,21 +560,96 @@
 #define OFFSET 0x00080000
 #define OFFSET_MASK 0x7FFFF
 
+/* Word address of a DMA buffer or TCB as written to a chain pointer */
+#define SPORT_ADDR(p) ((unsigned int)(uintptr_t)(p))
+
 
 /* Function prototypes for this talk-through code*/
 void initPLL(void);
 void initExternalMemory(void);
 static void clearDAIpins(void);
 void initDAI(void);
-void init1939viaSPI(void);
+int init1939viaSPI(void);
+int init1939Polled(void);
+int init1939Batched(bool);
+int initBlockMemory(int);
 void initSPORT(void);
+int initFIR(void);
+void startFIR(int);
+float *firChannelOutput(int, int);
+void selectAccelerator(int);
+bool filterNextJob(void);
+void coeffBankInit(void);
+int coeffStage(int, const float *, int, bool);
+void coeffBankSwap(int);
+void coeffBankFade(int);
+int coeffBankFadeTcbs(fir_word **);
+const float *coeffBankCorePass(int, int, float *, const float **);
+void initIIR(void);
+void startIIR(int);
+int firChainCtl1(int, bool);
+int firChainCtl2(int, int, int, bool);
+int firChainBuild(fir_chain *, const fir_channel_config *, int, bool);
+void firChainSetOutput(fir_chain *, int, float *);
+void firChainLink(fir_chain *, fir_word * const *, int);
+void firChainStart(fir_chain *);
+int iirChainCtl1(int);
+int iirChainCtl2(int, int);
+int iirChainBuild(iir_chain *, const iir_channel_config *, int);
+void iirChainSetOutput(iir_chain *, int, float *);
+void iirChainStart(iir_chain *);
+
+void initRoute(void);
+int routeStage(const float (*)[ROUTE_SOURCES]);
+void routeSwap(void);
+void routeBlock(float * const *, float * const *, float **);
+
+void initSilenceGate(void);
+void silenceGateBlock(const float *);
+bool silenceGateSkip(int, fir_word *);
 
-static void ProccessingTooLong(void);
 void TalkThroughISR(uint32_t, void*);
+int blockRingNext(void);
+void blockRingRelease(void);
 void ClearSPORT(void);
 void handleCodecData(unsigned int);
+void stageRecord(int, unsigned int);
+void stageReset(void);
+void bootStart(void);
+void bootPhaseBegin(int);
+void bootPhaseEnd(int);
+void bootPhaseFallback(int);
+void bootHalt(int);
+void deinterleaveBlock(float * const *, const int *, int, int, float *);
+void interleaveBlock(int *, float * const *, int, int);
+void ChannelscompISR(uint32_t, void*);
+void firBlockComplete(void);
+int fixedCoeff(float);
+void fixedFirInit(fixed_fir_channel *, const int *, int, int *, int, int);
+void fixedFirBlock(fixed_fir_channel *, const int *, int, int *, int, int);
+void initFixedFIR(void);
+void fixedChannelsBlock(unsigned int);
+void coreFirGeneric(const float *, const float *, int, float *, int);
+core_fir_kernel coreFirSelect(int, int);
+void coreFirBlock(const float *, const float *, int, float *, int);
+unsigned int hybridAccCycles(const hybrid_cost_model *, const fir_channel_config *);
+unsigned int hybridPlan(const hybrid_cost_model *, unsigned int *, unsigned int *);
+void initHybrid(void);
+void hybridCoreBlock(int, const int *);
+void hybridAccBegin(void);
+void hybridAccEnd(void);
+void fftConvInit(fft_conv_channel *, const float *, int, float *);
+void fftConvBlock(fft_conv_channel *, const float *, float *);
+void initSdramTiles(void);
+int sdramFirInit(sdram_fir_channel *, const float *, int, int);
+void sdramTilesStart(sdram_fir_channel * const *, int);
+bool sdramTilesNext(void);
+bool sdramTileRunning(void);
+int initSdramChannels(void);
+void sdramChannelsStart(int);
 
-static void SetupSPI1939(unsigned int);
+static void SetupSPI1939(unsigned int, int);
+static void SetupSPI1939DMA(unsigned int);
 static void DisableSPI1939();
 static void Configure1939Register(unsigned char,unsigned char,unsigned char,unsigned int);
 static unsigned char Get1939Register(unsigned char,unsigned int);
@@ -82,6 +659,35 @@ static void Delay(int i);
 // Global Variables
 extern volatile int count;
 extern volatile int isProcessing;
-extern volatile int inputReady;
-extern volatile int buffer_cntr;
+extern block_ring blockRing;
+extern int blockSamples;
+extern int *RxBlock_A[SPORT_DMA_BUFFERS];
+extern int *TxBlock_A[SPORT_DMA_BUFFERS];
+extern int *TxBlock_B[SPORT_DMA_BUFFERS];
+extern ad1939_float_data fBlockA[FIR_BUFFER_SETS];
+extern fir_channel_config FIR_Channels[FIR_CHANNELS];
+extern fir_chain FIR_Chain;
+extern int firChainIndex[FIR_CHANNELS];
+extern int firChainChannels;
+extern int filterSet;
+extern sdram_fir_channel Sdram_Channels[FIR_CHANNELS];
+extern float *coeffFade[FIR_CHANNELS];
+extern const core_fir_entry Core_Fir_Kernels[CORE_FIR_KERNELS];
+extern iir_channel_config IIR_Channels[IIR_CHANNELS];
+extern iir_chain IIR_Chain;
+extern route_stats routeStats;
+extern gate_stats gateStats;
+extern float silenceThreshold;
+extern deadline_stats deadlineStats;
+extern boot_timeline bootTimeline;
+extern hybrid_cost_model hybridModel;
+extern hybrid_stats hybridStats;
+extern unsigned char ConfigParam1939[];
+extern const int ConfigEntries1939;
+extern unsigned char AD1938_Regs_Read[];
+extern int LockCount;
+extern unsigned int LockTest;
+#if STAGE_PROFILING
+extern block_profile blockProfile;
+#endif
 
@@ -0,0 +1,60 @@
+/*********************************************************************************
+
+ Copyright(c) 2012 Analog Devices, Inc. All Rights Reserved.
+
+ This software is proprietary and confidential.  By using this software you agree
+ to the terms of the associated Analog Devices License Agreement.
+
+ *********************************************************************************/
+/*
+ * NAME:     FIR_isr.c
+ * PURPOSE:  FIR accelerator DMA interrupt.
+ * USAGE:    This file contains the interrupt raised once the accelerator has
+ *           iterated through all channels of the TCB chain. The FIR and IIR
+ *           accelerators share the engine and the interrupt; a block is
+ *           filtered once filterNextJob() has nothing left to start.
+ */
+
+#include "ADDS_21479_EzKit.h"
+
+// this variable informs main flow that processing is done
+// it is volatile, because it is set in interrupt
+volatile bool iteration_done = false;
+
+void ChannelscompISR(uint32_t iid, void *handlerarg)
+{
+	// disable acc
+	if(*pPMCTL1 & IIRACCSEL)
+	{
+		*pIIRDMASTAT = 0;
+		*pIIRCTL1 = 0;
+	}
+	else
+	{
+		*pFIRDMASTAT = 0;
+		*pFIRCTL1 = 0;
+
+		// once per block, not after every tile of the SDRAM channels
+		if(!sdramTileRunning())
+		{
+			// coefficient sets staged during the pass go live with the next one
+			coeffBankSwap(filterSet);
+
+			if(HYBRID_SCHEDULING)
+				hybridAccEnd();
+		}
+	}
+
+	// the IIR cascades of the block follow its FIR chain
+	if(filterNextJob())
+		return;
+
+	STAGE_END(STAGE_FILTER);
+
+	iteration_done = true;
+
+#if PIPELINED_PROCESSING
+	// start the block that was queued while this one was filtered
+	firBlockComplete();
+#endif
+}
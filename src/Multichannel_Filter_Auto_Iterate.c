@@ -32,161 +32,97 @@
 extern void initPLL(void);
 extern void initExternalMemory(void);
 
-void ChannelscompISR(uint32_t iid, void *handlerarg);
-
-// this variable informs main flow that processing is done
-// it is volatile, because it is set in interrupt
-volatile bool iteration_done = false;
-
-float In_Buf1[NUM_SAMPLES+TAPSIZE1-1] = {0};
-float Coeff_Buf1[TAPSIZE1]={
-							#include "coeffs256.dat"
-						};
-float Out_Buf1[NUM_SAMPLES] = {0};
-
-float In_Buf2[NUM_SAMPLES+TAPSIZE2-1] = {0};
-float Coeff_Buf2[TAPSIZE2] = {
-							#include "coeffs1024.dat"	
-							};
-float Out_Buf2[NUM_SAMPLES] = {0};
-
-
-/* TCB (Transfer Control Block) Structure */
-/* TCB is a data structure that holds information about each channel */
-
-/*CP[18:0]          ---------------      FIRCTL2
-  CP[18:0] -0x1     ---------------      II ---- should point to x(n-N-1) ---- x(0)
-  CP[18:0] -0x2     ----------------     IM
-  CP[18:0] -0x3     -----------------    IL/IC  ---- input data count
-  CP[18:0] -0x4     -----------------    IB  ---- Base address for input circular buffer
-  CP[18:0] -0x5     -----------------    OI
-  CP[18:0] -0x6     -----------------    OM
-  CP[18:0] -0x7     -----------------    OL/OC  ---- output data count
-  CP[18:0] -0x8     -----------------    OB  ---- Base address for output circular buffer
-  CP[18:0] -0x9     -----------------    CI  --- Coefficient Index should point to c(N-1) 
-  CP[18:0] -0xA     -----------------    CM
-  CP[18:0] -0xB     -----------------    CBL ---- Coefficient buffer Length
-  CP[18:0] -0xC     -----------------    CP */
-
-int TCB_Buf1[13] = {
-		0,
-		TAPSIZE1,
-		-1,
-		(int)Coeff_Buf1+TAPS1,
-		(int)(Out_Buf1),
-		NUM_SAMPLES,
-		1,
-		(int)(Out_Buf1),
-		(int)(In_Buf1),
-		NUM_SAMPLES+TAPSIZE1-1,
-		1,
-		(int)(In_Buf1),
-		0
-};
-
-int TCB_Buf2[13] = {
-		0,
-		TAPSIZE2,
-		-1,
-		(int)Coeff_Buf2+TAPS2,
-		(int)Out_Buf2,
-		NUM_SAMPLES,
-		1,
-		(int)Out_Buf2,
-		(int)In_Buf2,
-		NUM_SAMPLES+TAPSIZE2-1,
-		1,
-		(int)In_Buf2,
-		0
-};
+
+/* Block size per channel at boot: LOW_LATENCY_SAMPLES for live monitoring,
+ * NUM_SAMPLES or more, up to MAX_BLOCK_SAMPLES, for throughput. Can be set
+ * from the debugger before the run; a size initBlockMemory() does not take
+ * boots with NUM_SAMPLES. */
+int bootBlockSamples = NUM_SAMPLES;
 
 
 int main( void )
 {
+	int buffer;
 	int temp;
-	int temp1;
+
 	/* Initialize managed drivers and/or services at the start of main(). */
 	adi_initComponents();
 
+	/* Time each phase of the boot in bootTimeline */
+	bootStart();
+
 	/* Initialize SHARC PLL*/
+	bootPhaseBegin(BOOT_PLL);
 	initPLL();
+	bootPhaseEnd(BOOT_PLL);
 
 	/* Initialize DDR2 SDRAM controller to access memory */
+	bootPhaseBegin(BOOT_EXTMEM);
 	initExternalMemory();
+	bootPhaseEnd(BOOT_EXTMEM);
 
 	/* Initialize DAI because the SPORT and SPI signals need to be routed*/
+	bootPhaseBegin(BOOT_DAI);
 	initDAI();
+	bootPhaseEnd(BOOT_DAI);
 
 	/* This function will configure the AD1939 codec on the 21469 EZ-KIT*/
-	init1939viaSPI();
+	bootPhaseBegin(BOOT_CODEC);
+	temp = init1939viaSPI();
+	if(temp != 0)
+	{
+		/* The fast bring-up timed out or read back wrong: retry with
+		 * init1939Polled(), which gives up on the PLL lock after
+		 * CODEC_POLLED_LOCK_POLLS polls, so a dead codec ends in bootHalt() */
+		bootPhaseFallback(BOOT_CODEC);
+		temp = init1939Polled();
+	}
+	if(temp != 0)
+		bootHalt(BOOT_CODEC);	// no codec, no audio
+	bootPhaseEnd(BOOT_CODEC);
+
+	/* Lay out the SPORT and filter buffers for the block size */
+	bootPhaseBegin(BOOT_MEMORY);
+	temp = initBlockMemory(bootBlockSamples);
+	if(temp != 0)
+	{
+		/* A block size set from the debugger that the layout does not take */
+		bootPhaseFallback(BOOT_MEMORY);
+		bootBlockSamples = NUM_SAMPLES;
+		temp = initBlockMemory(bootBlockSamples);
+	}
+	if(temp != 0)
+		bootHalt(BOOT_MEMORY);
+	bootPhaseEnd(BOOT_MEMORY);
 
 	/* Turn on SPORT0 TX and SPORT1 RX for Multichannel Operation*/
+	bootPhaseBegin(BOOT_SPORT);
 	initSPORT();
+	bootPhaseEnd(BOOT_SPORT);
 
     /* Install and enable a handler for the SPORT1 Receiver interrupt.*/
+	bootPhaseBegin(BOOT_FILTERS);
     adi_int_InstallHandler(ADI_CID_P3I,TalkThroughISR,0,true);//interrupt(SIG_SP1,TalkThroughISR);
 
-	/* Selecting FIR accelerator */
-	*pPMCTL1&=~(BIT_17|BIT_18);
-	*pPMCTL1|=FIRACCSEL;
-
-	//PMCTL1 effect latency
-	NOP();NOP();NOP();NOP();
-
-
-	sysreg_bit_set(sysreg_MODE1, IRPTEN);
-
-	// add interrupt that fires when accelerator finishes work
-	adi_int_InstallHandler (ADI_CID_P0I,ChannelscompISR,0,true);
-
-	// probably set interrupt priority
-	temp = *pPICR0;
-	temp1 = 0xFFFFFFE0; // interrupt mask
-	temp = temp & temp1;
-	temp1 = DMAIntrSource;
-	temp1 = temp | temp1;
-	*pPICR0 = temp1;
+	/* Select the FIR accelerator and link the channel TCBs */
+	temp = initFIR();
+	if(temp != 0)
+		bootHalt(BOOT_FILTERS);	// a channel the accelerator or SDRAM does not take
 
-    // prepare TCB1
-	temp = TAPS1|WINDOWS1;
-	TCB_Buf1[12]= temp; // Value of FIRCTL2 for TCB_Buf1;
+	/* Link the EQ cascades that follow the FIR chain on the accelerator */
+	initIIR();
+	bootPhaseEnd(BOOT_FILTERS);
 
-	// prepare TCB2
-	temp = TAPS2|WINDOWS2;
-	TCB_Buf2[12] = temp; // Value of FIRCTL2;
+	/* Until the first block is out of handleCodecData() */
+	bootPhaseBegin(BOOT_FIRST_BLOCK);
 
-	// link TCB1 with TCB2
-	temp = (int)TCB_Buf2+12;
-	TCB_Buf1[0] = temp; //channel 1 TCB points to channel 2 TCB
-
-	// link TCB2 with TCB1
-	temp = (int)TCB_Buf1+12;
-	TCB_Buf2[0] = temp; //channel 2 TCB points to channel 1 TCB
-
-	// pass TCBs to accelerator
-	temp = (int)TCB_Buf1+12;
-	*pCPFIR= temp;
-
-	/* Set the values for FIRCTL1 */
-	// two channels with interrupt enabled, no auto iterate
-//	temp = FIR_EN | FIR_DMAEN | FIR_CH2;
-//	*pFIRCTL1 |= temp;
-    /* Be in infinite loop and do nothing until done.*/
+    /* Be in infinite loop and process the SPORT blocks as they complete.*/
     while(1) {
-    		if(inputReady)
+    		buffer = blockRingNext();
+    		if(buffer >= 0)
     		{
-    			handleCodecData(buffer_cntr);
+    			handleCodecData(buffer);
     		}
     }
 }
 
-
-void ChannelscompISR(uint32_t iid, void *handlerarg)
-{
-	iteration_done = true;
-	*pFIRDMASTAT = 0;
-	// disable acc
-	*pFIRCTL1 = 0;
-}
-
-
@@ -9,8 +9,11 @@
 /*
  * NAME:     SPORT1_isr.c (Block-based Talkthrough for 192 kHz fs)
  * PURPOSE:  Talkthrough framework for sending and receiving samples to the AD1939.
- * USAGE:    This file contains SPORT1 Interrupt Service Routine. Four buffers are used
- * 		     for this example: Two input buffers, and two output buffers.
+ * USAGE:    This file contains SPORT1 Interrupt Service Routine and the ring of
+ * 		     SPORT_DMA_BUFFERS blocks it hands to the main loop: the ISR queues each
+ * 		     completed block, the main loop takes them with blockRingNext() and
+ * 		     gives them back with blockRingRelease(). It also keeps the frame
+ * 		     deadline accounting in deadlineStats.
 */
 
 
@@ -28,31 +31,112 @@
 #include "ADDS_21479_EzKit.h"
 
 
-/* Counter to choose which buffer to process */
-volatile int buffer_cntr = 1;
-/* Semaphore to indicate to main that a block is ready for processing */
-volatile int inputReady = 0;
+/* Completed RX blocks waiting for the main loop */
+block_ring blockRing;
+
 /* Semaphore to indicate to the isr that the processing has not completed before the
  * buffer will be overwritten.
  */
 volatile int isProcessing = 0;
 
-/* If the processing takes too long, the program will be stuck in this infinite loop. */
-void ProcessingTooLong(void)
+/* Overruns are counted instead of stopping the system, see deadline_stats */
+deadline_stats deadlineStats = { .min_margin = ~0u };
+
+static unsigned int isr_stamp;				/* EMUCLK at the last interrupt */
+static volatile unsigned int overrun_stamp;	/* EMUCLK at the interrupt that overran */
+static volatile unsigned int overrun_block;	/* block it overran */
+static volatile bool overrun_pending = false;
+
+void TalkThroughISR(uint32_t iid, void* handlerArg)
 {
-    while(1);
+    unsigned int now = sysreg_read(sysreg_EMUCLK);
+    unsigned int head = blockRing.head;
+    unsigned int tail = blockRing.tail;
+
+    if(deadlineStats.blocks != 0)
+        deadlineStats.period = now - isr_stamp;
+    isr_stamp = now;
+    deadlineStats.blocks++;
+
+    /* The block in processing misses its deadline, its DMA buffers are
+     * reused from this block on; blockRingRelease() counts the overrun */
+    if(isProcessing && head + 1 - tail == SPORT_DMA_BUFFERS)
+    {
+        overrun_stamp = now;
+        overrun_block = tail;
+        overrun_pending = true;
+    }
+
+    /* Queue the completed block, the DMA moves on to the buffer of block
+     * head + 1 - SPORT_DMA_BUFFERS. The overrun is marked before, so that
+     * blockRingNext() sees it with the new head. */
+    blockRing.stamp[head % SPORT_DMA_BUFFERS] = now;
+    RING_BARRIER();
+    blockRing.head = head + 1;
 }
 
-void TalkThroughISR(uint32_t iid, void* handlerArg)
+/* Takes the oldest block of the ring for handleCodecData and returns its DMA
+ * buffer index, -1 when there is none. Blocks whose buffers the DMA already
+ * reuses are dropped and counted as skipped, never as overruns. */
+int blockRingNext(void)
+{
+    unsigned int tail = blockRing.tail;
+
+    while(1)
+    {
+        while(blockRing.head - tail >= SPORT_DMA_BUFFERS)
+        {
+            if(overrun_pending && overrun_block == tail)
+                overrun_pending = false;
+            deadlineStats.skipped++;
+            tail++;
+        }
+        blockRing.tail = tail;
+
+        if(blockRing.head == tail)
+            return -1;
+
+        /* Claim the block, so that the ISR marks any overrun of it, then
+         * look at head again: an interrupt before the claim may have made
+         * it stale, one after it marked it */
+        isProcessing = 1;
+        RING_BARRIER();
+
+        if(blockRing.head - tail < SPORT_DMA_BUFFERS)
+            return tail % SPORT_DMA_BUFFERS;
+
+        isProcessing = 0;
+    }
+}
+
+/* Called by handleCodecData once the block is written back: logs how late an
+ * overrun block finished, or the margin left to its deadline, and hands the
+ * buffer back to the DMA */
+void blockRingRelease(void)
 {
-    int i;
-       
-//    if(isProcessing)
-//        ProcessingTooLong();
+    unsigned int now = sysreg_read(sysreg_EMUCLK);
+    unsigned int block = blockRing.tail;
+    unsigned int elapsed = now - blockRing.stamp[block % SPORT_DMA_BUFFERS];
+    unsigned int deadline = (SPORT_DMA_BUFFERS - 1) * deadlineStats.period;
+    overrun_entry *entry;
 
-    /*Increment the block pointer */
-    buffer_cntr++;
-    buffer_cntr %= 2;
-    inputReady = 1;
+    if(overrun_pending && overrun_block == block)
+    {
+        entry = &deadlineStats.log[deadlineStats.overruns++ % OVERRUN_LOG_SIZE];
+        entry->block = block;
+        entry->late = now - overrun_stamp;
+        if(entry->late > deadlineStats.max_late)
+            deadlineStats.max_late = entry->late;
+        overrun_pending = false;
+    }
+    else if(deadline != 0)
+    {
+        deadlineStats.last_margin = elapsed < deadline ? deadline - elapsed : 0;
+        if(deadlineStats.last_margin < deadlineStats.min_margin)
+            deadlineStats.min_margin = deadlineStats.last_margin;
+    }
 
+    RING_BARRIER();
+    blockRing.tail = block + 1;
+    isProcessing = 0;
 }
@@ -0,0 +1,118 @@
+/*********************************************************************************
+
+ Copyright(c) 2012 Analog Devices, Inc. All Rights Reserved.
+
+ This software is proprietary and confidential.  By using this software you agree
+ to the terms of the associated Analog Devices License Agreement.
+
+ *********************************************************************************/
+/*
+ * NAME:     blockMemory.c
+ * PURPOSE:  Buffers of the block size chosen at boot.
+ * USAGE:    initBlockMemory() takes the block size in samples per channel and
+ *           runs before initSPORT() and initFIR(). It carves the SPORT DMA
+ *           rings, the fBlockA sets, the filter delay lines, the crossfade
+ *           buffers, the fixed-point delay lines, the hybrid scratch window,
+ *           the FFT convolution storage and the mixing buffers of the routing
+ *           matrix out of one region that fits every size from
+ *           MIN_BLOCK_SAMPLES to MAX_BLOCK_SAMPLES, so no profile needs a
+ *           heap.
+ *           initSPORT() and initFIR() then derive the DMA counts and the FIR
+ *           windows from blockSamples.
+ */
+
+#include "ADDS_21479_EzKit.h"
+
+/* Samples per channel and block */
+int blockSamples = NUM_SAMPLES;
+
+/* SPORT words and floats share the region */
+typedef union{
+	int fixed;
+	float real;
+} block_word;
+
+static block_word blockMemory[BLOCK_MEMORY_SIZE];
+static int blockMemoryUsed;
+
+extern int *Fixed_Lines[FIR_CHANNELS];
+extern float *Hybrid_Scratch;
+extern float *Route_Mix[ROUTE_OUTPUTS];
+extern float *Route_Silence;
+
+#if FFT_CONVOLUTION
+extern float *FFT_Storage[FIR_CHANNELS];
+#endif
+
+
+/* Next words of the region, cleared */
+static block_word *carve(int words)
+{
+	block_word *p = &blockMemory[blockMemoryUsed];
+	int i;
+
+	for(i = 0; i < words; i++)
+		p[i].fixed = 0;
+
+	blockMemoryUsed += words;
+	return p;
+}
+
+
+/* Lays the buffers out for blocks of samples per channel. Returns -1 for a
+ * size out of range, or not a power of two with FFT_CONVOLUTION. */
+int initBlockMemory(int samples)
+{
+	float **outputs;
+	int i, set, ch;
+
+	if(samples < MIN_BLOCK_SAMPLES || samples > MAX_BLOCK_SAMPLES)
+		return -1;
+	if(FFT_CONVOLUTION && (samples & (samples - 1)) != 0)
+		return -1;
+	if(BLOCK_MEMORY_WORDS(samples) > BLOCK_MEMORY_SIZE)
+		return -1;
+
+	blockSamples = samples;
+	blockMemoryUsed = 0;
+
+	for(i = 0; i < SPORT_DMA_BUFFERS; i++)
+	{
+		RxBlock_A[i] = &carve(RX_BLOCK_SIZE)->fixed;
+		TxBlock_A[i] = &carve(TX_BLOCK_SIZE)->fixed;
+		TxBlock_B[i] = &carve(TX_BLOCK_SIZE)->fixed;
+	}
+
+	for(set = 0; set < FIR_BUFFER_SETS; set++)
+	{
+		outputs = &fBlockA[set].Tx_L1;
+		for(i = 0; i < AD1939_FLOAT_CHANNELS; i++)
+			outputs[i] = &carve(samples)->real;
+	}
+
+	for(ch = 0; ch < FIR_CHANNELS; ch++)
+	{
+		fir_channel_config *c = &FIR_Channels[ch];
+
+		c->window = samples;
+		// the delay line of an SDRAM channel is in SDRAM, only its blocks are here
+		c->in_length = FIR_DELAY_SIZE(SDRAM_CHANNEL(ch) ? 1 : c->taps);
+		c->in = &carve(c->in_length)->real;
+		coeffFade[ch] = &carve(samples)->real;
+		if(FIXED_CHANNEL(ch))
+			Fixed_Lines[ch] = &carve(FIXED_LINE_SIZE(c->taps))->fixed;
+#if FFT_CONVOLUTION
+		FFT_Storage[ch] = &carve(FFT_CONV_STORAGE(c->taps))->real;
+#endif
+	}
+
+	if(HYBRID_SCHEDULING)
+		Hybrid_Scratch = &carve(COEFF_BANK_TAPS - 1 + samples)->real;
+
+	for(i = 0; i < ROUTE_OUTPUTS; i++)
+		Route_Mix[i] = &carve(samples)->real;
+	Route_Silence = &carve(samples)->real;
+
+	assert(blockMemoryUsed <= BLOCK_MEMORY_SIZE);
+	return 0;
+}
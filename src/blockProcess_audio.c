@@ -9,131 +9,147 @@
 /*
  * NAME:     blockProcess_audio.c (Block-based Talk-through)
  * PURPOSE:  Process incoming AD1939 ADC data and prepare outgoing blocks for DAC.
- * USAGE:    This file contains the subroutines that float and fix the serial data,
- *        	 and copy from the inputs to the outputs.
+ * USAGE:    This file contains the subroutines that float and fix the serial data
+ *        	 with convertData.c and run the filters between the inputs and outputs.
  */
 
 #include "ADDS_21479_EzKit.h"
 
-/* Define a structure to represent buffers for all 12 floating-point
- * data channels of the AD1939 */
-typedef struct{
-	float Rx_L1[NUM_SAMPLES];
-	float Rx_R1[NUM_SAMPLES];
-	float Rx_L2[NUM_SAMPLES];
-	float Rx_R2[NUM_SAMPLES];
+/*  Structures to hold floating point data for each AD1939, one per block in
+ *  flight, laid out by initBlockMemory(). The FIR TCBs write them directly. */
+ad1939_float_data fBlockA[FIR_BUFFER_SETS];
 
-	float Tx_L1[NUM_SAMPLES];
-	float Tx_R1[NUM_SAMPLES];
-	float Tx_L2[NUM_SAMPLES];
-	float Tx_R2[NUM_SAMPLES];
-	float Tx_L3[NUM_SAMPLES];
-	float Tx_R3[NUM_SAMPLES];
-	float Tx_L4[NUM_SAMPLES];
-	float Tx_R4[NUM_SAMPLES];
-	
-} ad1939_float_data;
+/* Positions of the next block in the filter delay lines of FIR_Channels, the
+ * accelerator's input index follows TAPSIZE-1 samples behind */
+static int delay_pos[FIR_CHANNELS];
 
-/* SPORT Ping/Pong Data buffers */
-extern int RxBlock_A0[];
-extern int RxBlock_A1[];
+static ad1939_float_data *process_audioBlocks(void);
 
-extern int TxBlock_A0[];
-extern int TxBlock_A1[];
+/*
+ * Audio Block Processing Algorithm for 192 kHz 4 IN x 4 OUT Audio System
+ * The inputs are held in the delay lines of FIR_Channels, the outputs in a
+ * structure for the AD1939: fBlockA holds stereo output (AOUT) channels 0-7
+ *
+ * With PIPELINED_PROCESSING the outputs lag the inputs by one block.
+ *
+ * This function filters all four inputs in one pass of the FIR chain
+ * AOUT1L <- AIN1L
+ * AOUT1R <- AIN1R
+ * AOUT3L <- AIN2L
+ * AOUT3R <- AIN2R
+ * and through the EQ cascades of the IIR chain that follows it
+ * AOUT2L <- AIN1L
+ * AOUT2R <- AIN1R
+ * AOUT4L <- AIN2L
+ * AOUT4R <- AIN2R
+ * The routing matrix then maps these and the raw inputs onto the AOUT
+ * channels, one to one as above unless routeStage() staged another matrix.
+ */
 
-extern int TxBlock_B0[];
-extern int TxBlock_B1[];
+extern volatile bool iteration_done;
 
+#if FFT_CONVOLUTION
 
-/* Pointer to the blocks */
-int *rxA_block_pointer[2] = {RxBlock_A0, RxBlock_A1};
-int *txA_block_pointer[2] = {TxBlock_A0, TxBlock_A1};
-int *txB_block_pointer[2] = {TxBlock_B0, TxBlock_B1};
+extern fft_conv_channel FFT_Conv[FIR_CHANNELS];
 
+/* Long filters: the core convolves the new block of each delay line, the
+ * engine only runs the IIR cascades */
+static ad1939_float_data *process_audioBlocks(void)
+{
+	int ch;
 
-/*  Structures to hold floating point data for each AD1939 */
-ad1939_float_data fBlockA;
+	STAGE_BEGIN(STAGE_FILTER);
+	startIIR(0);
 
-static void process_audioBlocks(void);
+	for(ch = 0; ch < FIR_CHANNELS; ch++)
+	{
+		if(!FIXED_CHANNEL(ch))
+			fftConvBlock(&FFT_Conv[ch], &FIR_Channels[ch].in[delay_pos[ch]], FIR_Channels[ch].out);
+	}
 
-/* Unoptimized function to convert the incoming fixed-point data to 32-bit
-* floating-point format. This function assumes that the incoming fixed point
-* data is in 1.31 format
-*/
-static void floatData(float *output, int *input, unsigned int instep, unsigned int length)
-{
-    int i;
+	// ChannelscompISR ends the stage
+	while(!iteration_done){
+		NOP();
+	}
+	iteration_done = false;
 
-    for(i = 0; i < length; i++)
-    {
-        output[i] = __builtin_conv_RtoF(input[instep*i]);
-    }
+	return &fBlockA[0];
 }
 
+#elif PIPELINED_PROCESSING
 
-/* Unoptimized function to convert the outgoing floating-point data
- * to 1.31 fixed-point format.*/
-static void fixData(int *output, float *input, unsigned int outstep, unsigned int length)
+/* Set the next block is filtered into. It alternates every block, kept by
+ * the pipeline rather than derived from the SPORT buffer so that a skipped
+ * SPORT block cannot hand the accelerator's set back to the core. */
+static int fir_set = 0;
+
+/* Pipeline state shared with ChannelscompISR */
+static volatile int fir_running = -1;			/* buffer set on the accelerator, -1 when idle */
+static volatile int fir_queued = -1;			/* buffer set waiting for the accelerator */
+static volatile unsigned int fir_completed = 0;	/* blocks filtered so far */
+static unsigned int fir_submitted = 0;			/* blocks handed to the accelerator */
+
+/* Called from ChannelscompISR: moves the pipeline forward by starting the
+ * block that the core queued while the previous one was being filtered */
+void firBlockComplete(void)
 {
-    int i;
+	fir_completed++;
+	fir_running = fir_queued;
+	fir_queued = -1;
 
-    for(i = 0; i < length; i++)
-    {
-        output[outstep*i] = __builtin_conv_FtoR(input[i]);
-    }
+	if(fir_running >= 0)
+		startFIR(fir_running);
 }
 
-
-/* Unoptimized function to copy from one floating-point buffer to another */
-static void memcopy(float *input, float *output, unsigned int number)
+/* Returns the channel buffers to write back, NULL before the first block */
+static ad1939_float_data *process_audioBlocks(void)
 {
-    int i;
-    
-    for(i = 0; i < number; i++)
-    {
-        output[i] = input[i];
-    }
-}
+	int set = fir_set;
+	int prev = set ^ 1;
+	unsigned int previous = fir_submitted;
+
+	// hand the block over, ChannelscompISR starts it if the accelerator is busy
+	sysreg_bit_clr(sysreg_MODE1, IRPTEN);
+	if(fir_running < 0)
+	{
+		fir_running = set;
+		startFIR(set);
+	}
+	else
+	{
+		fir_queued = set;
+	}
+	sysreg_bit_set(sysreg_MODE1, IRPTEN);
 
+	fir_submitted++;
+	fir_set = prev;
 
+	// the core's share of the block, while the accelerator is busy
+	if(HYBRID_SCHEDULING)
+		hybridCoreBlock(set, delay_pos);
 
-/*
- * Audio Block Processing Algorithm for 192 kHz 4 IN x 4 OUT Audio System
- * The inputs and outputs are held in a structure for the AD1939
- * fBlockA holds stereo input (AIN) channels 0-3 and stereo output (AOUT) channels 0-7
- *
- * This function copies the data without any processing as follows
- * AOUT1L <- AIN1L
- * AOUT1R <- AIN1R
- * AOUT2L <- AIN1L
- * AOUT2R <- AIN1R
- *
- * AOUT3L <- AIN2L
- * AOUT3R <- AIN2R
- * AOUT4L <- AIN2L
- * AOUT4R <- AIN2R
- */
+	// nothing to write back before the first block is through
+	if(previous == 0)
+		return NULL;
 
-extern float In_Buf1[NUM_SAMPLES+TAPSIZE1-1];
-extern float In_Buf2[NUM_SAMPLES+TAPSIZE2-1];
+	// wait for the previous block only, this one keeps the accelerator busy
+	while(fir_completed < previous){
+		NOP();
+	}
 
-extern float Out_Buf1[NUM_SAMPLES];
-extern float Out_Buf2[NUM_SAMPLES];
+	return &fBlockA[prev];
+}
 
-extern volatile bool iteration_done;
+#else
 
-static void process_audioBlocks(void)
+static ad1939_float_data *process_audioBlocks(void)
 {
-	int temp;
-
-	// populate input buffers
-	memcopy(fBlockA.Rx_L1, &In_Buf1[TAPSIZE1-1], NUM_SAMPLES);
-	memcopy(fBlockA.Rx_R1, &In_Buf2[TAPSIZE1-1], NUM_SAMPLES);
-
-//	// enable accelerator
-	temp = FIR_EN | FIR_DMAEN | FIR_CH2;
-	*pFIRCTL1 = temp;
+	// enable accelerator
+	startFIR(0);
 
+	// the core's share of the block, while the accelerator is busy
+	if(HYBRID_SCHEDULING)
+		hybridCoreBlock(0, delay_pos);
 
 	// wait until processing is done
 	while(!iteration_done){
@@ -143,50 +159,91 @@ static void process_audioBlocks(void)
 	// reset flag
 	iteration_done = false;
 
-	// copy output data to final buffers
-	memcopy(Out_Buf1, fBlockA.Tx_L1, NUM_SAMPLES);
-	memcopy(Out_Buf2, fBlockA.Tx_R1, NUM_SAMPLES);
+	return &fBlockA[0];
 }
 
+#endif /* FFT_CONVOLUTION */
 
 
 
 /*
- * This function handles the Codec data in the following 3 steps...
- *    1. Converts all ADC data to 32-bit floating-point, and copies this
- *       from the current RX DMA buffer into fBlockA & fBlockB
+ * This function handles the Codec data in the following 4 steps...
+ *    1. Converts all ADC data to 32-bit floating-point, straight from the
+ *       current RX DMA buffer into the filter delay lines, and gates the
+ *       silent channels with silenceGate.c
  *    2. Calls the audio processing function (processBlocks)
- *    3. Converts all DAC to 1.31 fixed point, and copies this from
- *       fBlockA & fBlockB into the current TX DMA buffer
+ *    3. Mixes the AOUT channels through the routing matrix of routeMatrix.c
+ *       and converts them to 1.31 fixed point into the current TX DMA
+ *       buffer, by default straight from the fBlockA set the FIR TCBs wrote
+ *    4. Filters the channels of FIXED_POINT_CHANNELS in 1.31 from the RX DMA
+ *       buffer into their slots of the TX DMA buffer
+ * blockIndex is the SPORT DMA buffer blockRingNext() returned.
  */
 
 void handleCodecData(unsigned int blockIndex)
 {
-/* Clear the Block Ready Semaphore */
-    inputReady = 0;
+    ad1939_float_data *out;
+    float *rx[NUM_RX_SLOTS];
+    float *routeIn[NUM_RX_SLOTS];
+    float energy[NUM_RX_SLOTS];
+    int ch;
+
+	STAGE_BEGIN(STAGE_BLOCK);
+
+/* Float ADC data from AD1939, RX slot n into the delay line of channel n */
+	STAGE_BEGIN(STAGE_FLOAT);
+	for(ch = 0; ch < FIR_CHANNELS; ch++)
+		rx[ch] = &FIR_Channels[ch].in[delay_pos[ch]];
 
-/* Set the Processing Active Semaphore before starting processing */
-    isProcessing = 1;
+	deinterleaveBlock(rx, RxBlock_A[blockIndex], NUM_RX_SLOTS, blockSamples, energy);
 
-/* Float ADC data from AD1939 */
-	floatData(fBlockA.Rx_L1, rxA_block_pointer[blockIndex]+0, NUM_RX_SLOTS, NUM_SAMPLES);
-	floatData(fBlockA.Rx_R1, rxA_block_pointer[blockIndex]+1, NUM_RX_SLOTS, NUM_SAMPLES);
-	floatData(fBlockA.Rx_L2, rxA_block_pointer[blockIndex]+2, NUM_RX_SLOTS, NUM_SAMPLES);
-	floatData(fBlockA.Rx_R2, rxA_block_pointer[blockIndex]+3, NUM_RX_SLOTS, NUM_SAMPLES);
+	// the channels that have been silent long enough are left out of the chain
+	silenceGateBlock(energy);
+	STAGE_END(STAGE_FLOAT);
 
 /* Place the audio processing algorithm here. */
-	process_audioBlocks();
+	STAGE_BEGIN(STAGE_PROCESS);
+	out = process_audioBlocks();
+	STAGE_END(STAGE_PROCESS);
+
+	// the inputs of the outputs out holds, which lag them by a block when pipelined
+	for(ch = 0; ch < FIR_CHANNELS; ch++)
+	{
+		routeIn[ch] = &FIR_Channels[ch].in[(delay_pos[ch] - (FIR_BUFFER_SETS-1)*blockSamples +
+				FIR_Channels[ch].in_length) % FIR_Channels[ch].in_length];
+		delay_pos[ch] = (delay_pos[ch] + blockSamples) % FIR_Channels[ch].in_length;
+	}
 
 /* Fix DAC data for AD1939 */
-	fixData(txA_block_pointer[blockIndex]+0, fBlockA.Tx_L1, NUM_TX_SLOTS, NUM_SAMPLES);
-	fixData(txA_block_pointer[blockIndex]+1, fBlockA.Tx_R1, NUM_TX_SLOTS, NUM_SAMPLES);
-	fixData(txA_block_pointer[blockIndex]+2, fBlockA.Tx_L2, NUM_TX_SLOTS, NUM_SAMPLES);
-	fixData(txA_block_pointer[blockIndex]+3, fBlockA.Tx_R2, NUM_TX_SLOTS, NUM_SAMPLES);
-	fixData(txB_block_pointer[blockIndex]+0, fBlockA.Tx_L3, NUM_TX_SLOTS, NUM_SAMPLES);
-	fixData(txB_block_pointer[blockIndex]+1, fBlockA.Tx_R3, NUM_TX_SLOTS, NUM_SAMPLES);
-	fixData(txB_block_pointer[blockIndex]+2, fBlockA.Tx_L4, NUM_TX_SLOTS, NUM_SAMPLES);
-	fixData(txB_block_pointer[blockIndex]+3, fBlockA.Tx_R4, NUM_TX_SLOTS, NUM_SAMPLES);
-
-/* Clear the Processing Active Semaphore after processing is complete*/
-    isProcessing = 0;
+	if(out != NULL)
+	{
+		float *tx[ROUTE_OUTPUTS];
+
+		// ramp the channels whose coefficients were swapped with a crossfade
+		coeffBankFade(out - fBlockA);
+
+		STAGE_BEGIN(STAGE_FIX);
+		// a matrix staged since the last block goes live, then the AOUT channels are mixed
+		routeSwap();
+		routeBlock(routeIn, &out->Tx_L1, tx);
+
+		// AOUT1L..AOUT2R into the TX DMA buffer of SPORT A, AOUT3L..AOUT4R into that of SPORT B
+		interleaveBlock(TxBlock_A[blockIndex], &tx[0], NUM_TX_SLOTS, blockSamples);
+		interleaveBlock(TxBlock_B[blockIndex], &tx[NUM_TX_SLOTS], NUM_TX_SLOTS, blockSamples);
+		STAGE_END(STAGE_FIX);
+	}
+
+/* The fixed-point channels, straight from the RX slots into the TX slots */
+	if(FIXED_POINT_CHANNELS)
+		fixedChannelsBlock(blockIndex);
+
+	STAGE_END(STAGE_BLOCK);
+
+/* The first block out ends the boot timeline */
+	if(!(bootTimeline.ended & (1 << BOOT_FIRST_BLOCK)))
+		bootPhaseEnd(BOOT_FIRST_BLOCK);
+
+/* Hand the buffers back to the SPORT DMA, this clears the Processing Active
+ * Semaphore blockRingNext() set */
+    blockRingRelease();
 }
@@ -0,0 +1,76 @@
+/*********************************************************************************
+
+ Copyright(c) 2012 Analog Devices, Inc. All Rights Reserved.
+
+ This software is proprietary and confidential.  By using this software you agree
+ to the terms of the associated Analog Devices License Agreement.
+
+ *********************************************************************************/
+/*
+ * NAME:     blockProfile.c
+ * PURPOSE:  Cycle statistics of the block processing stages.
+ * USAGE:    STAGE_BEGIN()/STAGE_END() around a stage read EMUCLK and record the
+ *           difference here. blockProfile is a fixed-size structure: watch it in
+ *           the debugger, or read it from the host tools. Recording takes the
+ *           same few dozen cycles for any duration. With STAGE_PROFILING 0, the
+ *           default in release builds, the macros and this file are empty.
+ */
+
+#include "ADDS_21479_EzKit.h"
+
+#if STAGE_PROFILING
+
+block_profile blockProfile;
+
+
+/* Index of the highest set bit in five fixed steps */
+static int histogramBin(unsigned int cycles)
+{
+	int bin = 0;
+
+	if(cycles >> 16) { bin += 16; cycles >>= 16; }
+	if(cycles >> 8)  { bin += 8;  cycles >>= 8; }
+	if(cycles >> 4)  { bin += 4;  cycles >>= 4; }
+	if(cycles >> 2)  { bin += 2;  cycles >>= 2; }
+	if(cycles >> 1)  { bin += 1; }
+
+	return bin;
+}
+
+
+/* Adds one duration to the statistics of a stage. Called from the core and
+ * from ChannelscompISR, which never record the same stage. */
+void stageRecord(int stage, unsigned int cycles)
+{
+	stage_stats *s = &blockProfile.stage[stage];
+
+	if(s->count == 0 || cycles < s->min)
+		s->min = cycles;
+	if(cycles > s->max)
+		s->max = cycles;
+
+	s->total += cycles;
+	s->histogram[histogramBin(cycles)]++;
+	s->count++;
+}
+
+
+/* Clears the statistics of all stages */
+void stageReset(void)
+{
+	int stage, bin;
+
+	for(stage = 0; stage < STAGE_COUNT; stage++)
+	{
+		stage_stats *s = &blockProfile.stage[stage];
+
+		s->count = 0;
+		s->min = 0;
+		s->max = 0;
+		s->total = 0;
+		for(bin = 0; bin < STAGE_HISTOGRAM_BINS; bin++)
+			s->histogram[bin] = 0;
+	}
+}
+
+#endif /* STAGE_PROFILING */
@@ -0,0 +1,84 @@
+/*********************************************************************************
+
+ Copyright(c) 2012 Analog Devices, Inc. All Rights Reserved.
+
+ This software is proprietary and confidential.  By using this software you agree
+ to the terms of the associated Analog Devices License Agreement.
+
+ *********************************************************************************/
+/*
+ * NAME:     bootTimeline.c
+ * PURPOSE:  Start and duration of each boot phase, up to the first block of
+ *           audio.
+ * USAGE:    main() calls bootStart() first, then bootPhaseBegin() and
+ *           bootPhaseEnd() around each init routine; handleCodecData() ends
+ *           BOOT_FIRST_BLOCK. A phase whose init failed and was done again
+ *           the slower way is marked by bootPhaseFallback(); one that could
+ *           not be done at all ends the boot in bootHalt(). Times are EMUCLK
+ *           cycles from bootStart(), so initPLL() counts cycles of the clocks
+ *           it switches between. Watch bootTimeline in the debugger after the
+ *           first block, or export it with the boot mode of the host tool.
+ */
+
+#include "ADDS_21479_EzKit.h"
+
+boot_timeline bootTimeline;
+
+
+/* Clears the timeline and starts its clock */
+void bootStart(void)
+{
+	int p;
+
+	bootTimeline.start = sysreg_read(sysreg_EMUCLK);
+	bootTimeline.ended = 0;
+	bootTimeline.fallback = 0;
+	bootTimeline.halted = -1;
+	bootTimeline.to_audio = 0;
+	bootTimeline.fast = FAST_BOOT;
+	for(p = 0; p < BOOT_PHASES; p++)
+	{
+		bootTimeline.phase[p].begin = 0;
+		bootTimeline.phase[p].cycles = 0;
+	}
+}
+
+
+void bootPhaseBegin(int p)
+{
+	bootTimeline.phase[p].begin = sysreg_read(sysreg_EMUCLK) - bootTimeline.start;
+}
+
+
+/* Only the first end of a phase counts, the first block ends the boot */
+void bootPhaseEnd(int p)
+{
+	unsigned int now = sysreg_read(sysreg_EMUCLK) - bootTimeline.start;
+
+	if(bootTimeline.ended & (1 << p))
+		return;
+
+	bootTimeline.phase[p].cycles = now - bootTimeline.phase[p].begin;
+	bootTimeline.ended |= 1 << p;
+
+	if(p == BOOT_FIRST_BLOCK)
+		bootTimeline.to_audio = now;
+}
+
+
+/* Phase p failed its first try and is done again its slower way */
+void bootPhaseFallback(int p)
+{
+	bootTimeline.fallback |= 1 << p;
+}
+
+
+/* Phase p cannot be done: stops the boot there for good, with the phase in
+ * bootTimeline.halted for the debugger */
+void bootHalt(int p)
+{
+	bootTimeline.halted = p;
+
+	while(1)
+		NOP();
+}
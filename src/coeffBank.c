@@ -0,0 +1,222 @@
+/*********************************************************************************
+
+ Copyright(c) 2012 Analog Devices, Inc. All Rights Reserved.
+
+ This software is proprietary and confidential.  By using this software you agree
+ to the terms of the associated Analog Devices License Agreement.
+
+ *********************************************************************************/
+/*
+ * NAME:     coeffBank.c
+ * PURPOSE:  Double-buffered coefficient banks of the FIR channels.
+ * USAGE:    Every channel of FIR_Chain filters with one of its two banks.
+ *           coeffStage() copies a new set into the other bank and returns at
+ *           once; ChannelscompISR calls coeffBankSwap() between two passes of
+ *           the chain, which re-points the CI word of the channel's TCB at the
+ *           new bank, so a block is always filtered with one whole set.
+ *
+ *           With a crossfade the next pass also runs the old bank, from a copy
+ *           of the channel's TCB startFIR() appends to the chain through
+ *           coeffBankFadeTcbs(), into coeffFade[], and
+ *           handleCodecData() ramps from that output to the new one over the
+ *           block with coeffBankFade(). Only then can the channel be staged
+ *           again.
+ *
+ *           The FFT convolution build keeps its partitions and the channels of
+ *           FIXED_POINT_CHANNELS their 1.31 coefficients, and the channels of
+ *           SDRAM_FIR_CHANNELS theirs in SDRAM, the banks are not used there.
+ */
+
+#include "ADDS_21479_EzKit.h"
+
+/* Life of a staged set. Each step has one writer: coeffStage() sets
+ * COEFF_STAGED, coeffBankSwap() COEFF_FADING and COEFF_MIXING, and
+ * coeffBankFade() or coeffBankSwap() COEFF_IDLE again. The channels the core
+ * filters for hybridSchedule.c go from COEFF_STAGED to COEFF_MIXING or
+ * COEFF_IDLE in coeffBankCorePass() instead. */
+#define COEFF_IDLE		0	/* the inactive bank is free */
+#define COEFF_STAGED	1	/* the inactive bank holds the next set */
+#define COEFF_FADING	2	/* the next pass runs both banks */
+#define COEFF_MIXING	3	/* the pass ran, its output waits for the ramp */
+
+static float Coeff_Bank[FIR_CHANNELS][2][COEFF_BANK_TAPS];
+
+static int bank_active[FIR_CHANNELS];
+static volatile int bank_state[FIR_CHANNELS];
+static bool bank_crossfade[FIR_CHANNELS];
+
+/* Old bank TCBs of the crossfading channels, linked behind the last channel */
+static fir_word fade_tcb[FIR_CHANNELS][FIR_TCB_SIZE];
+static int fade_tcbs;
+
+static int fade_set[FIR_CHANNELS];		/* fBlockA set of the crossfade pass */
+static float *fade_out[FIR_CHANNELS];	/* its output of the new bank */
+
+/* Output of the old bank during a crossfade, carved by initBlockMemory() */
+float *coeffFade[FIR_CHANNELS];
+
+
+/* Copies the compiled coefficients of every channel into its first bank and
+ * points the channel at it. Runs in initFIR() before the chain is built. */
+void coeffBankInit(void)
+{
+	int ch, i;
+
+	for(ch = 0; ch < FIR_CHANNELS; ch++)
+	{
+		fir_channel_config *c = &FIR_Channels[ch];
+
+		for(i = 0; i < COEFF_BANK_TAPS; i++)
+			Coeff_Bank[ch][0][i] = i < c->taps ? c->coeffs[i] : 0.0f;
+
+		c->coeffs = Coeff_Bank[ch][0];
+		bank_active[ch] = 0;
+		bank_state[ch] = COEFF_IDLE;
+	}
+	fade_tcbs = 0;
+}
+
+
+/* Stages taps coefficients c(0)..c(taps-1) for channel, padded with zeros to
+ * the channel's tap count, to go live at the next block boundary. Never
+ * waits: returns -1 when the channel has no such taps or its previous set is
+ * still on its way, 0 once staged. */
+int coeffStage(int channel, const float *coeffs, int taps, bool crossfade)
+{
+	float *bank;
+	int i;
+
+	if(FFT_CONVOLUTION || channel < 0 || channel >= FIR_CHANNELS || FIXED_CHANNEL(channel) ||
+			SDRAM_CHANNEL(channel))
+		return -1;
+	if(taps < 1 || taps > FIR_Channels[channel].taps)
+		return -1;
+	if(bank_state[channel] != COEFF_IDLE)
+		return -1;
+
+	bank = Coeff_Bank[channel][bank_active[channel] ^ 1];
+	for(i = 0; i < FIR_Channels[channel].taps; i++)
+		bank[i] = i < taps ? coeffs[i] : 0.0f;
+
+	bank_crossfade[channel] = crossfade;
+
+	// the bank is complete before the ISR can see it
+	RING_BARRIER();
+	bank_state[channel] = COEFF_STAGED;
+
+	return 0;
+}
+
+
+/* Called from ChannelscompISR once the FIR pass of set is through and before
+ * the next one starts. Hands the crossfades of that pass over to
+ * coeffBankFade(), makes the staged banks live and keeps the old bank TCBs
+ * of new crossfades for the next pass. */
+void coeffBankSwap(int set)
+{
+	fir_word *tcb;
+	int ch, i, fades = 0;
+
+	for(ch = 0; ch < FIR_CHANNELS; ch++)
+	{
+		if(bank_state[ch] == COEFF_FADING)
+		{
+			fade_set[ch] = set;
+			fade_out[ch] = (float *)FIR_Chain.tcb[firChainIndex[ch]][FIR_TCB_OB];
+			bank_state[ch] = COEFF_MIXING;
+		}
+	}
+
+	for(ch = 0; ch < FIR_CHANNELS; ch++)
+	{
+		if(bank_state[ch] != COEFF_STAGED || firChainIndex[ch] < 0)
+			continue;
+
+		tcb = FIR_Chain.tcb[firChainIndex[ch]];
+
+		if(bank_crossfade[ch])
+		{
+			// same input window and old CI, its own output
+			for(i = 0; i < FIR_TCB_SIZE; i++)
+				fade_tcb[fades][i] = tcb[i];
+			fade_tcb[fades][FIR_TCB_OB] = FIR_ADDR(coeffFade[ch]);
+			fade_tcb[fades][FIR_TCB_OI] = FIR_ADDR(coeffFade[ch]);
+			fades++;
+		}
+
+		bank_active[ch] ^= 1;
+		tcb[FIR_TCB_CI] = FIR_ADDR(&Coeff_Bank[ch][bank_active[ch]][FIR_Channels[ch].taps - 1]);
+
+		// the new bank is live before coeffStage() can see the old one free
+		RING_BARRIER();
+		bank_state[ch] = bank_crossfade[ch] ? COEFF_FADING : COEFF_IDLE;
+	}
+
+	fade_tcbs = fades;
+}
+
+
+/* Stores the old bank TCBs the next pass runs behind the channels in tcbs,
+ * returns how many */
+int coeffBankFadeTcbs(fir_word **tcbs)
+{
+	int i;
+
+	for(i = 0; i < fade_tcbs; i++)
+		tcbs[i] = fade_tcb[i];
+	return fade_tcbs;
+}
+
+
+/* The core's pass of a channel hybridSchedule.c took off the chain, the steps
+ * of coeffBankSwap() for one channel: makes a staged set live for the block
+ * the core filters into out of set next and returns the coefficients to
+ * filter with. With a crossfade *fade is the old bank, to filter into
+ * coeffFade[], which coeffBankFade() ramps out of when set is written back;
+ * NULL otherwise. */
+const float *coeffBankCorePass(int channel, int set, float *out, const float **fade)
+{
+	*fade = NULL;
+
+	if(bank_state[channel] == COEFF_STAGED)
+	{
+		if(bank_crossfade[channel])
+		{
+			*fade = Coeff_Bank[channel][bank_active[channel]];
+			fade_set[channel] = set;
+			fade_out[channel] = out;
+		}
+
+		bank_active[channel] ^= 1;
+
+		// the new bank is live before coeffStage() can see the old one free
+		RING_BARRIER();
+		bank_state[channel] = bank_crossfade[channel] ? COEFF_MIXING : COEFF_IDLE;
+	}
+
+	return Coeff_Bank[channel][bank_active[channel]];
+}
+
+
+/* Called by handleCodecData with the fBlockA set it writes back: ramps the
+ * channels that crossfaded in that set from the old bank to the new one */
+void coeffBankFade(int set)
+{
+	float g, step = 1.0f / blockSamples;
+	int ch, i;
+
+	for(ch = 0; ch < FIR_CHANNELS; ch++)
+	{
+		if(bank_state[ch] != COEFF_MIXING || fade_set[ch] != set)
+			continue;
+
+		g = step;
+		for(i = 0; i < blockSamples; i++)
+		{
+			fade_out[ch][i] = coeffFade[ch][i] + g * (fade_out[ch][i] - coeffFade[ch][i]);
+			g += step;
+		}
+
+		bank_state[ch] = COEFF_IDLE;
+	}
+}
@@ -0,0 +1,235 @@
+/*********************************************************************************
+
+ Copyright(c) 2012 Analog Devices, Inc. All Rights Reserved.
+
+ This software is proprietary and confidential.  By using this software you agree
+ to the terms of the associated Analog Devices License Agreement.
+
+ *********************************************************************************/
+/*
+ * NAME:     convertData.c
+ * PURPOSE:  Conversion between the interleaved 1.31 TDM blocks of the SPORTs and
+ *           the per-channel floating-point buffers.
+ * USAGE:    deinterleaveBlock() floats every slot of an RX DMA block in one pass,
+ *           interleaveBlock() fixes every slot of a TX DMA block in one pass, so
+ *           each DMA block is walked once in address order instead of once per
+ *           slot. Fixing saturates to 1.31 like __builtin_conv_FtoR().
+ *           Floating can sum the energy of every slot on the way, for
+ *           silenceGate.c.
+ *
+ *           On the SHARC the frame loops are independent and marked for SIMD, the
+ *           compiler runs pairs of samples on PEx and PEy. The host emulation
+ *           build uses SSE2 for blocks of four slots: four frames are converted
+ *           as four vectors and transposed.
+ */
+
+#include "ADDS_21479_EzKit.h"
+
+#if defined(HOST_EMULATION) && defined(__SSE2__)
+#include <emmintrin.h>
+#define CONVERT_SSE2 1
+#else
+#define CONVERT_SSE2 0
+#endif
+
+
+#if CONVERT_SSE2
+
+/* 1.31 to float scale and the float of 2^31, the first positive overflow */
+#define SSE_RTOF_SCALE  (1.0f / 2147483648.0f)
+#define SSE_FTOR_SCALE  (2147483648.0f)
+
+/* Four frames of four slots per iteration, with the sums of squares of the
+ * slots in energy when not NULL */
+static int deinterleave4(float * const *outputs, const int *input, int length, float *energy)
+{
+	const __m128 scale = _mm_set1_ps(SSE_RTOF_SCALE);
+	__m128 e0 = _mm_setzero_ps(), e1 = e0, e2 = e0, e3 = e0;
+	int i;
+
+	for(i = 0; i + 4 <= length; i += 4)
+	{
+		__m128 f0 = _mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *)&input[4*i+0])), scale);
+		__m128 f1 = _mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *)&input[4*i+4])), scale);
+		__m128 f2 = _mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *)&input[4*i+8])), scale);
+		__m128 f3 = _mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *)&input[4*i+12])), scale);
+
+		// frames to slots
+		_MM_TRANSPOSE4_PS(f0, f1, f2, f3);
+
+		_mm_storeu_ps(&outputs[0][i], f0);
+		_mm_storeu_ps(&outputs[1][i], f1);
+		_mm_storeu_ps(&outputs[2][i], f2);
+		_mm_storeu_ps(&outputs[3][i], f3);
+
+		if(energy != NULL)
+		{
+			e0 = _mm_add_ps(e0, _mm_mul_ps(f0, f0));
+			e1 = _mm_add_ps(e1, _mm_mul_ps(f1, f1));
+			e2 = _mm_add_ps(e2, _mm_mul_ps(f2, f2));
+			e3 = _mm_add_ps(e3, _mm_mul_ps(f3, f3));
+		}
+	}
+
+	if(energy != NULL)
+	{
+		// lanes to slots, then the four partial sums of every slot added
+		_MM_TRANSPOSE4_PS(e0, e1, e2, e3);
+		_mm_storeu_ps(energy, _mm_add_ps(_mm_add_ps(e0, e1), _mm_add_ps(e2, e3)));
+	}
+
+	return i;
+}
+
+/* Round to nearest; the conversion returns 0x80000000 for both overflows,
+ * positive ones are flipped to 0x7FFFFFFF */
+static __m128i fixVector(__m128 f)
+{
+	const __m128 scale = _mm_set1_ps(SSE_FTOR_SCALE);
+	__m128 r = _mm_mul_ps(f, scale);
+	__m128i positive = _mm_castps_si128(_mm_cmpge_ps(r, scale));
+
+	return _mm_xor_si128(_mm_cvtps_epi32(r), positive);
+}
+
+static int interleave4(int *output, float * const *inputs, int length)
+{
+	int i;
+
+	for(i = 0; i + 4 <= length; i += 4)
+	{
+		__m128 s0 = _mm_loadu_ps(&inputs[0][i]);
+		__m128 s1 = _mm_loadu_ps(&inputs[1][i]);
+		__m128 s2 = _mm_loadu_ps(&inputs[2][i]);
+		__m128 s3 = _mm_loadu_ps(&inputs[3][i]);
+
+		// slots to frames
+		_MM_TRANSPOSE4_PS(s0, s1, s2, s3);
+
+		_mm_storeu_si128((__m128i *)&output[4*i+0], fixVector(s0));
+		_mm_storeu_si128((__m128i *)&output[4*i+4], fixVector(s1));
+		_mm_storeu_si128((__m128i *)&output[4*i+8], fixVector(s2));
+		_mm_storeu_si128((__m128i *)&output[4*i+12], fixVector(s3));
+	}
+
+	return i;
+}
+
+#endif /* CONVERT_SSE2 */
+
+
+/* Sum of the squares of length samples. The two partial sums take the even
+ * and the odd samples, so the compiler can keep one on PEx and one on PEy;
+ * they are folded after the loop. */
+static float slotEnergy(const float *x, int length)
+{
+	float e0 = 0.0f, e1 = 0.0f;
+	int i;
+
+	for(i = 0; i + 2 <= length; i += 2)
+	{
+		e0 += x[i] * x[i];
+		e1 += x[i+1] * x[i+1];
+	}
+	if(i < length)
+		e0 += x[i] * x[i];
+
+	return e0 + e1;
+}
+
+
+/* Floats length frames of slots interleaved 1.31 samples into one buffer
+ * per slot. With energy not NULL, energy[s] is the sum of the squares of the
+ * samples of slot s, summed in a pass over the floated slot after the
+ * conversion so the converting loop stays a SIMD one. */
+void deinterleaveBlock(float * const *outputs, const int *input, int slots, int length, float *energy)
+{
+	int i = 0;
+	int summed = 0;		// frames deinterleave4() summed the energy of
+	int s;
+
+	if(energy != NULL)
+	{
+		for(s = 0; s < slots; s++)
+			energy[s] = 0.0f;
+	}
+
+#if CONVERT_SSE2
+	if(slots == 4)
+		summed = i = deinterleave4(outputs, input, length, energy);
+#endif
+
+	// the SPORT layout, unrolled so the slot buffers stay in registers
+	if(slots == 4)
+	{
+		float *out0 = outputs[0];
+		float *out1 = outputs[1];
+		float *out2 = outputs[2];
+		float *out3 = outputs[3];
+
+#ifndef HOST_EMULATION
+#pragma SIMD_for
+#endif
+		for(; i < length; i++)
+		{
+			out0[i] = __builtin_conv_RtoF(input[4*i+0]);
+			out1[i] = __builtin_conv_RtoF(input[4*i+1]);
+			out2[i] = __builtin_conv_RtoF(input[4*i+2]);
+			out3[i] = __builtin_conv_RtoF(input[4*i+3]);
+		}
+	}
+	else
+	{
+		for(; i < length; i++)
+		{
+			for(s = 0; s < slots; s++)
+				outputs[s][i] = __builtin_conv_RtoF(input[slots*i + s]);
+		}
+	}
+
+	if(energy != NULL)
+	{
+		for(s = 0; s < slots; s++)
+			energy[s] += slotEnergy(&outputs[s][summed], length - summed);
+	}
+}
+
+
+/* Fixes one buffer per slot into length frames of slots interleaved 1.31
+ * samples, saturating */
+void interleaveBlock(int *output, float * const *inputs, int slots, int length)
+{
+	int i = 0;
+	int s;
+
+#if CONVERT_SSE2
+	if(slots == 4)
+		i = interleave4(output, inputs, length);
+#endif
+
+	if(slots == 4)
+	{
+		const float *in0 = inputs[0];
+		const float *in1 = inputs[1];
+		const float *in2 = inputs[2];
+		const float *in3 = inputs[3];
+
+#ifndef HOST_EMULATION
+#pragma SIMD_for
+#endif
+		for(; i < length; i++)
+		{
+			output[4*i+0] = __builtin_conv_FtoR(in0[i]);
+			output[4*i+1] = __builtin_conv_FtoR(in1[i]);
+			output[4*i+2] = __builtin_conv_FtoR(in2[i]);
+			output[4*i+3] = __builtin_conv_FtoR(in3[i]);
+		}
+		return;
+	}
+
+	for(; i < length; i++)
+	{
+		for(s = 0; s < slots; s++)
+			output[slots*i + s] = __builtin_conv_FtoR(inputs[s][i]);
+	}
+}
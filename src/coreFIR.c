@@ -0,0 +1,176 @@
+/*********************************************************************************
+
+ Copyright(c) 2012 Analog Devices, Inc. All Rights Reserved.
+
+ This software is proprietary and confidential.  By using this software you agree
+ to the terms of the associated Analog Devices License Agreement.
+
+ *********************************************************************************/
+/*
+ * NAME:     coreFIR.c
+ * PURPOSE:  Direct-form FIR kernels on the core, for channels the accelerator
+ *           cannot take.
+ * USAGE:    coreFirBlock() filters one block like a FIR accelerator channel:
+ *           y[k] = sum(c[j] * x[k+taps-1-j]), where x starts taps-1 samples of
+ *           history before the block. coreFirSelect() looks the kernel up once
+ *           for a channel; it returns NULL when there is no specialised one.
+ *
+ *           CORE_FIR_KERNEL() compiles one kernel per pair of tap count and
+ *           block size in Core_Fir_Kernels[], with both as constants, so the
+ *           compiler knows every trip count and unrolls the tap loop. Each
+ *           pass of the kernel keeps CORE_FIR_OUTPUTS outputs in registers and
+ *           loads every coefficient once for all of them. On the SHARC the
+ *           output loop runs pairs of outputs on PEx and PEy; the host
+ *           emulation build uses SSE, four outputs per vector. Every output
+ *           adds its products in the same order as coreFirGeneric().
+ */
+
+#include "ADDS_21479_EzKit.h"
+
+#if defined(HOST_EMULATION) && defined(__SSE__)
+#include <xmmintrin.h>
+#define CORE_FIR_SSE 1
+#else
+#define CORE_FIR_SSE 0
+#endif
+
+/* Outputs held in registers per pass, every block size is a multiple */
+#if CORE_FIR_SSE
+#define CORE_FIR_OUTPUTS 16
+#else
+#define CORE_FIR_OUTPUTS 4
+#endif
+
+#ifdef HOST_EMULATION
+#define CORE_FIR_UNROLL _Pragma("GCC unroll 8")
+#define CORE_FIR_SIMD_FOR
+#else
+#define CORE_FIR_UNROLL
+#define CORE_FIR_SIMD_FOR _Pragma("SIMD_for")
+#endif
+
+
+/* Any tap count and block size */
+void coreFirGeneric(const float *x, const float *c, int taps, float *y, int length)
+{
+	int k, j;
+
+	for(k = 0; k < length; k++)
+	{
+		const float *xk = &x[k + taps - 1];
+		float acc = 0.0f;
+
+		for(j = 0; j < taps; j++)
+			acc += c[j] * xk[-j];
+		y[k] = acc;
+	}
+}
+
+
+#if CORE_FIR_SSE
+
+/* Four vectors of four consecutive outputs */
+#define CORE_FIR_KERNEL(taps, block) \
+static void coreFir_##taps##_##block(const float *x, const float *c, float *y) \
+{ \
+	int k, j; \
+	for(k = 0; k < (block); k += CORE_FIR_OUTPUTS) \
+	{ \
+		const float *xk = &x[k + (taps) - 1]; \
+		__m128 a0 = _mm_setzero_ps(), a1 = _mm_setzero_ps(); \
+		__m128 a2 = _mm_setzero_ps(), a3 = _mm_setzero_ps(); \
+		CORE_FIR_UNROLL \
+		for(j = 0; j < (taps); j++) \
+		{ \
+			__m128 cj = _mm_set1_ps(c[j]); \
+			a0 = _mm_add_ps(a0, _mm_mul_ps(cj, _mm_loadu_ps(&xk[0 - j]))); \
+			a1 = _mm_add_ps(a1, _mm_mul_ps(cj, _mm_loadu_ps(&xk[4 - j]))); \
+			a2 = _mm_add_ps(a2, _mm_mul_ps(cj, _mm_loadu_ps(&xk[8 - j]))); \
+			a3 = _mm_add_ps(a3, _mm_mul_ps(cj, _mm_loadu_ps(&xk[12 - j]))); \
+		} \
+		_mm_storeu_ps(&y[k + 0], a0); \
+		_mm_storeu_ps(&y[k + 4], a1); \
+		_mm_storeu_ps(&y[k + 8], a2); \
+		_mm_storeu_ps(&y[k + 12], a3); \
+	} \
+}
+
+#else
+
+#define CORE_FIR_KERNEL(taps, block) \
+static void coreFir_##taps##_##block(const float *x, const float *c, float *y) \
+{ \
+	int k, j; \
+	CORE_FIR_SIMD_FOR \
+	for(k = 0; k < (block); k += CORE_FIR_OUTPUTS) \
+	{ \
+		const float *xk = &x[k + (taps) - 1]; \
+		float a0 = 0.0f, a1 = 0.0f, a2 = 0.0f, a3 = 0.0f; \
+		for(j = 0; j < (taps); j++) \
+		{ \
+			float cj = c[j]; \
+			a0 += cj * xk[0 - j]; \
+			a1 += cj * xk[1 - j]; \
+			a2 += cj * xk[2 - j]; \
+			a3 += cj * xk[3 - j]; \
+		} \
+		y[k + 0] = a0; \
+		y[k + 1] = a1; \
+		y[k + 2] = a2; \
+		y[k + 3] = a3; \
+	} \
+}
+
+#endif /* CORE_FIR_SSE */
+
+
+/* The channel length of this project and the lengths the indata*.dat
+ * vectors were made for, at the low latency, default and largest block size */
+CORE_FIR_KERNEL(65, 64)
+CORE_FIR_KERNEL(65, 256)
+CORE_FIR_KERNEL(65, 1024)
+CORE_FIR_KERNEL(256, 64)
+CORE_FIR_KERNEL(256, 256)
+CORE_FIR_KERNEL(256, 1024)
+CORE_FIR_KERNEL(1024, 64)
+CORE_FIR_KERNEL(1024, 256)
+CORE_FIR_KERNEL(1024, 1024)
+
+const core_fir_entry Core_Fir_Kernels[CORE_FIR_KERNELS] = {
+	{ 65,   64,   coreFir_65_64 },
+	{ 65,   256,  coreFir_65_256 },
+	{ 65,   1024, coreFir_65_1024 },
+	{ 256,  64,   coreFir_256_64 },
+	{ 256,  256,  coreFir_256_256 },
+	{ 256,  1024, coreFir_256_1024 },
+	{ 1024, 64,   coreFir_1024_64 },
+	{ 1024, 256,  coreFir_1024_256 },
+	{ 1024, 1024, coreFir_1024_1024 },
+};
+
+
+/* Specialised kernel of taps and blocks of length samples, NULL if none */
+core_fir_kernel coreFirSelect(int taps, int length)
+{
+	int i;
+
+	for(i = 0; i < CORE_FIR_KERNELS; i++)
+	{
+		if(Core_Fir_Kernels[i].taps == taps && Core_Fir_Kernels[i].length == length)
+			return Core_Fir_Kernels[i].kernel;
+	}
+
+	return NULL;
+}
+
+
+/* Filters length samples with the specialised kernel, or the generic loop */
+void coreFirBlock(const float *x, const float *c, int taps, float *y, int length)
+{
+	core_fir_kernel kernel = coreFirSelect(taps, length);
+
+	if(kernel != NULL)
+		kernel(x, c, y);
+	else
+		coreFirGeneric(x, c, taps, y, length);
+}
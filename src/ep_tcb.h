@@ -0,0 +1,40 @@
+/*********************************************************************************
+
+ Copyright(c) 2012 Analog Devices, Inc. All Rights Reserved.
+
+ This software is proprietary and confidential.  By using this software you agree
+ to the terms of the associated Analog Devices License Agreement.
+
+ *********************************************************************************/
+/*
+ * NAME:     ep_tcb.h
+ * PURPOSE:  Layout of the external port DMA Transfer Control Block (TCB) for
+ *           chained transfers with a circular external buffer. Shared by
+ *           sdramTiles.c and the host emulator.
+ */
+#ifndef _ep_tcb_H_
+#define _ep_tcb_H_
+
+#include "fir_tcb.h"
+
+/* TCB words are fir_word like those of the accelerators, an address or a
+ * count. CPEP0 and the CP word of the previous TCB point at the II word, the
+ * DMA fetches the rest at descending addresses; a CP of 0 ends the chain. */
+#define EP_TCB_CP           (0)     /* Chain pointer to the next TCB*/
+#define EP_TCB_EL           (1)     /* External circular buffer length*/
+#define EP_TCB_EB           (2)     /* External circular buffer base*/
+#define EP_TCB_EM           (3)     /* External modifier*/
+#define EP_TCB_EI           (4)     /* External index*/
+#define EP_TCB_IC           (5)     /* Word count*/
+#define EP_TCB_IM           (6)     /* Internal modifier*/
+#define EP_TCB_II           (7)     /* Internal index*/
+
+#define EP_TCB_SIZE         (8)
+
+/* Access a TCB field through the address the chain pointer holds */
+#define EP_TCB_FIELD(cp, field)     ((cp)[(field) - EP_TCB_II])
+
+/* Value written to a CP word or to CPEP0 to reach a TCB */
+#define EP_TCB_LINK(tcb)            FIR_ADDR(&(tcb)[EP_TCB_II])
+
+#endif /* _ep_tcb_H_ */
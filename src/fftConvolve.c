@@ -0,0 +1,255 @@
+/*********************************************************************************
+
+ Copyright(c) 2012 Analog Devices, Inc. All Rights Reserved.
+
+ This software is proprietary and confidential.  By using this software you agree
+ to the terms of the associated Analog Devices License Agreement.
+
+ *********************************************************************************/
+/*
+ * NAME:     fftConvolve.c
+ * PURPOSE:  Uniformly partitioned overlap-save convolution for long filters.
+ * USAGE:    fftConvInit() splits the coefficients into partitions of blockSamples
+ *           taps and keeps their spectra; the block size must be a power of two
+ *           and stay fixed afterwards. fftConvBlock() then filters one block
+ *           per call: the block and the one before it are transformed, the last
+ *           FFT_CONV_PARTITIONS(taps) input spectra are multiplied with the
+ *           partition spectra, and the second half of the inverse transform is
+ *           the filtered block. The cost per sample grows with the number of
+ *           partitions instead of the number of taps.
+ */
+
+#include <math.h>
+#include "ADDS_21479_EzKit.h"
+
+#define FFT_PI 3.14159265358979323846
+
+/* e^(-j*2*pi*k/FFT_CONV_SIZE) for k = 0..blockSamples, interleaved re/im */
+static float twiddle[2*(MAX_BLOCK_SAMPLES+1)];
+
+/* Bit reversed order of the blockSamples point complex FFT */
+static short bitrev[MAX_BLOCK_SAMPLES];
+
+/* Block size the tables were built for */
+static int table_samples = 0;
+
+/* Work buffers shared by all channels, the core filters one channel at a time */
+static float frame[2*MAX_BLOCK_SAMPLES];
+static float accum[2*(MAX_BLOCK_SAMPLES+1)];
+
+
+static void initTables(void)
+{
+	int bits = 0;
+	int i, b, r;
+
+	for(i = 0; i <= blockSamples; i++)
+	{
+		twiddle[2*i] = (float)cos(-2.0*FFT_PI*i/FFT_CONV_SIZE);
+		twiddle[2*i+1] = (float)sin(-2.0*FFT_PI*i/FFT_CONV_SIZE);
+	}
+
+	while((1 << bits) < blockSamples)
+		bits++;
+
+	for(i = 0; i < blockSamples; i++)
+	{
+		r = 0;
+		for(b = 0; b < bits; b++)
+		{
+			if(i & (1 << b))
+				r |= 1 << (bits - 1 - b);
+		}
+		bitrev[i] = r;
+	}
+
+	table_samples = blockSamples;
+}
+
+
+/* In-place radix-2 FFT of blockSamples complex values, unscaled in both
+ * directions */
+static void complexFFT(float *z, int inverse)
+{
+	float sign = inverse ? -1.0f : 1.0f;
+	int i, j, k, len, half, step;
+	float t;
+
+	for(i = 0; i < blockSamples; i++)
+	{
+		j = bitrev[i];
+		if(j > i)
+		{
+			t = z[2*i];   z[2*i] = z[2*j];     z[2*j] = t;
+			t = z[2*i+1]; z[2*i+1] = z[2*j+1]; z[2*j+1] = t;
+		}
+	}
+
+	for(len = 2; len <= blockSamples; len <<= 1)
+	{
+		half = len >> 1;
+		step = FFT_CONV_SIZE / len;
+
+		for(k = 0; k < half; k++)
+		{
+			float wr = twiddle[2*k*step];
+			float wi = sign * twiddle[2*k*step+1];
+
+			for(i = k; i < blockSamples; i += len)
+			{
+				float *a = &z[2*i];
+				float *b = &z[2*(i+half)];
+				float tr = b[0]*wr - b[1]*wi;
+				float ti = b[0]*wi + b[1]*wr;
+
+				b[0] = a[0] - tr;
+				b[1] = a[1] - ti;
+				a[0] += tr;
+				a[1] += ti;
+			}
+		}
+	}
+}
+
+
+/* Spectrum bins 0..blockSamples of FFT_CONV_SIZE real samples. The samples are
+ * transformed as blockSamples complex values, even samples real, odd samples
+ * imaginary, and the two halves separated afterwards. x is overwritten. */
+static void realFFT(float *x, float *X)
+{
+	int k, m;
+
+	complexFFT(x, 0);
+
+	for(k = 0; k <= blockSamples; k++)
+	{
+		const float *zk = &x[2*(k == blockSamples ? 0 : k)];
+		const float *zm = &x[2*(k == 0 ? 0 : blockSamples - k)];
+		float wr = twiddle[2*k];
+		float wi = twiddle[2*k+1];
+
+		/* even samples (Z[k] + Z*[M-k])/2, odd samples (Z[k] - Z*[M-k])/2j */
+		float evr = 0.5f*(zk[0] + zm[0]);
+		float evi = 0.5f*(zk[1] - zm[1]);
+		float odr = 0.5f*(zk[1] + zm[1]);
+		float odi = -0.5f*(zk[0] - zm[0]);
+
+		m = 2*k;
+		X[m] = evr + wr*odr - wi*odi;
+		X[m+1] = evi + wr*odi + wi*odr;
+	}
+}
+
+
+/* FFT_CONV_SIZE real samples of the spectrum bins 0..blockSamples, scaled
+ * by FFT_CONV_SIZE. Inverse of realFFT(). */
+static void realIFFT(const float *X, float *x)
+{
+	int k;
+
+	for(k = 0; k < blockSamples; k++)
+	{
+		const float *xk = &X[2*k];
+		const float *xm = &X[2*(blockSamples - k)];
+		float wr = twiddle[2*k];
+		float wi = twiddle[2*k+1];
+
+		/* even part X[k] + X*[M-k], odd part (X[k] - X*[M-k]) e^(j*2*pi*k/N) */
+		float ar = xk[0] + xm[0];
+		float ai = xk[1] - xm[1];
+		float dr = xk[0] - xm[0];
+		float di = xk[1] + xm[1];
+		float pr = dr*wr + di*wi;
+		float pi = di*wr - dr*wi;
+
+		x[2*k] = ar - pi;
+		x[2*k+1] = ai + pr;
+	}
+
+	complexFFT(x, 1);
+}
+
+
+/* Prepares a channel for coefficients c[0..taps-1], c[0] applying to the
+ * newest sample. storage holds FFT_CONV_STORAGE(taps) floats and belongs to
+ * the channel from now on. */
+void fftConvInit(fft_conv_channel *ch, const float *coeffs, int taps, float *storage)
+{
+	int p, n, first;
+	float scale = 1.0f / FFT_CONV_SIZE;
+
+	if(table_samples != blockSamples)
+		initTables();
+
+	ch->partitions = FFT_CONV_PARTITIONS(taps);
+	ch->newest = 0;
+	ch->filter = storage;
+	ch->spectra = storage + 2*FFT_CONV_BINS*ch->partitions;
+	ch->last = ch->spectra + 2*FFT_CONV_BINS*ch->partitions;
+
+	for(n = 0; n < 2*FFT_CONV_BINS*ch->partitions; n++)
+		ch->spectra[n] = 0.0f;
+
+	for(n = 0; n < blockSamples; n++)
+		ch->last[n] = 0.0f;
+
+	/* Each partition zero padded to the frame, the inverse transform's
+	 * scaling folded into the spectrum */
+	for(p = 0; p < ch->partitions; p++)
+	{
+		float *H = &ch->filter[2*FFT_CONV_BINS*p];
+
+		first = p*blockSamples;
+		for(n = 0; n < FFT_CONV_SIZE; n++)
+			frame[n] = (n < blockSamples && first + n < taps) ? coeffs[first + n] : 0.0f;
+
+		realFFT(frame, H);
+
+		for(n = 0; n < 2*FFT_CONV_BINS; n++)
+			H[n] *= scale;
+	}
+}
+
+
+/* Filters blockSamples samples from in to out. in may be a filter delay line,
+ * it is only read. */
+void fftConvBlock(fft_conv_channel *ch, const float *in, float *out)
+{
+	int p, k, slot;
+
+	for(k = 0; k < blockSamples; k++)
+	{
+		frame[k] = ch->last[k];
+		frame[blockSamples + k] = in[k];
+		ch->last[k] = in[k];
+	}
+
+	// the oldest spectrum makes room for the new one
+	ch->newest = (ch->newest + 1 == ch->partitions) ? 0 : ch->newest + 1;
+	realFFT(frame, &ch->spectra[2*FFT_CONV_BINS*ch->newest]);
+
+	for(k = 0; k < 2*FFT_CONV_BINS; k++)
+		accum[k] = 0.0f;
+
+	// partition p meets the input spectrum of p blocks ago
+	slot = ch->newest;
+	for(p = 0; p < ch->partitions; p++)
+	{
+		const float *X = &ch->spectra[2*FFT_CONV_BINS*slot];
+		const float *H = &ch->filter[2*FFT_CONV_BINS*p];
+
+		for(k = 0; k < 2*FFT_CONV_BINS; k += 2)
+		{
+			accum[k] += X[k]*H[k] - X[k+1]*H[k+1];
+			accum[k+1] += X[k]*H[k+1] + X[k+1]*H[k];
+		}
+
+		slot = (slot == 0) ? ch->partitions - 1 : slot - 1;
+	}
+
+	// the first half of the frame wrapped around, the second half is linear
+	realIFFT(accum, frame);
+
+	for(k = 0; k < blockSamples; k++)
+		out[k] = frame[blockSamples + k];
+}
@@ -0,0 +1,166 @@
+/*********************************************************************************
+
+ Copyright(c) 2012 Analog Devices, Inc. All Rights Reserved.
+
+ This software is proprietary and confidential.  By using this software you agree
+ to the terms of the associated Analog Devices License Agreement.
+
+ *********************************************************************************/
+/*
+ * NAME:     firChain.c
+ * PURPOSE:  Builds FIR accelerator TCB chains of 1 to FIR_MAX_CHANNELS channels.
+ * USAGE:    firChainBuild() turns a list of channel descriptions into TCBs, links
+ *           them in a ring and computes FIRCTL1. firChainStart() hands the chain
+ *           to the accelerator, which filters one window of every channel and
+ *           raises the DMA interrupt, or keeps iterating with FIR_CAI.
+ *           firChainLink() relinks the ring through some of the TCBs, and
+ *           copies of them, for the next start.
+ */
+
+#include "ADDS_21479_EzKit.h"
+
+
+/* FIRCTL2 value of a channel, -1 when the accelerator cannot run it. A ratio
+ * above 1 decimates, or interpolates with upsample. Decimation keeps whole
+ * output phases, so the window is a multiple of the ratio; interpolation
+ * splits the taps into ratio polyphase branches of equal length. */
+int firChainCtl2(int taps, int window, int ratio, bool upsample)
+{
+	int temp;
+
+	if(taps < 1 || taps > FIR_MAX_TAPS || window < 1 || window > FIR_MAX_WINDOW)
+		return -1;
+	if(ratio < 1 || ratio > FIR_MAX_RATIO)
+		return -1;
+	if(upsample ? taps % ratio != 0 : window % ratio != 0)
+		return -1;
+
+	temp = FIRCTL2_TAPS(taps) | FIRCTL2_WINDOW(window) | FIRCTL2_RATIO(ratio);
+	if(upsample && ratio > 1)
+		temp |= FIRCTL2_UPSAMP;
+
+	return temp;
+}
+
+
+/* FIRCTL1 value that runs a chain of channels once, or continuously with
+ * autoIterate, -1 when the accelerator cannot run that many channels. */
+int firChainCtl1(int channels, bool autoIterate)
+{
+	int temp;
+
+	if(channels < 1 || channels > FIR_MAX_CHANNELS)
+		return -1;
+
+	temp = FIR_EN | FIR_DMAEN | FIR_CH(channels);
+	if(autoIterate)
+		temp |= FIR_CAI;
+
+	return temp;
+}
+
+
+/* TCB (Transfer Control Block) Structure */
+/* TCB is a data structure that holds information about each channel */
+
+/*CP[18:0]          ---------------      FIRCTL2
+  CP[18:0] -0x1     ---------------      II ---- should point to x(n-N-1) ---- x(0)
+  CP[18:0] -0x2     ----------------     IM
+  CP[18:0] -0x3     -----------------    IL/IC  ---- input data count
+  CP[18:0] -0x4     -----------------    IB  ---- Base address for input circular buffer
+  CP[18:0] -0x5     -----------------    OI
+  CP[18:0] -0x6     -----------------    OM
+  CP[18:0] -0x7     -----------------    OL/OC  ---- output data count
+  CP[18:0] -0x8     -----------------    OB  ---- Base address for output circular buffer
+  CP[18:0] -0x9     -----------------    CI  --- Coefficient Index should point to c(N-1)
+  CP[18:0] -0xA     -----------------    CM
+  CP[18:0] -0xB     -----------------    CBL ---- Coefficient buffer Length
+  CP[18:0] -0xC     -----------------    CP */
+
+/* Fills chain with one TCB per entry of config. Returns 0, or -1 without
+ * touching the chain when a channel does not fit the accelerator. */
+int firChainBuild(fir_chain *chain, const fir_channel_config *config, int channels, bool autoIterate)
+{
+	int ch;
+
+	if(firChainCtl1(channels, autoIterate) < 0)
+		return -1;
+
+	for(ch = 0; ch < channels; ch++)
+	{
+		const fir_channel_config *c = &config[ch];
+
+		if(firChainCtl2(c->taps, c->window, c->ratio, c->upsample) < 0 ||
+				c->in_length < FIR_HISTORY(c) + c->window)
+			return -1;
+	}
+
+	for(ch = 0; ch < channels; ch++)
+	{
+		const fir_channel_config *c = &config[ch];
+		fir_word *tcb = chain->tcb[ch];
+
+		tcb[FIR_TCB_CBL] = c->taps;
+		tcb[FIR_TCB_CM] = -1;
+		tcb[FIR_TCB_CI] = FIR_ADDR(c->coeffs + c->taps - 1);
+
+		tcb[FIR_TCB_OB] = FIR_ADDR(c->out);
+		tcb[FIR_TCB_OL] = FIR_OUTPUTS(c);
+		tcb[FIR_TCB_OM] = 1;
+		tcb[FIR_TCB_OI] = FIR_ADDR(c->out);
+
+		// the history wraps to the end of the input buffer
+		tcb[FIR_TCB_IB] = FIR_ADDR(c->in);
+		tcb[FIR_TCB_IL] = c->in_length;
+		tcb[FIR_TCB_IM] = 1;
+		tcb[FIR_TCB_II] = FIR_ADDR(c->in + (c->in_length - FIR_HISTORY(c)) % c->in_length);
+
+		tcb[FIR_TCB_FIRCTL2] = firChainCtl2(c->taps, c->window, c->ratio, c->upsample);
+
+		// the last channel links back to the first
+		tcb[FIR_TCB_CP] = FIR_TCB_LINK(chain->tcb[(ch + 1) % channels]);
+	}
+
+	chain->channels = channels;
+	chain->firctl1 = firChainCtl1(channels, autoIterate);
+	chain->first = chain->tcb[0];
+
+	return 0;
+}
+
+
+/* Points the output of a channel at another buffer, with the accelerator idle */
+void firChainSetOutput(fir_chain *chain, int channel, float *out)
+{
+	chain->tcb[channel][FIR_TCB_OB] = FIR_ADDR(out);
+	chain->tcb[channel][FIR_TCB_OI] = FIR_ADDR(out);
+}
+
+
+/* Links count TCBs, of the chain or copies of them, in that order into the
+ * ring the next firChainStart() runs. Called with the accelerator idle, count
+ * from 1 to FIR_MAX_CHANNELS. */
+void firChainLink(fir_chain *chain, fir_word * const *tcbs, int count)
+{
+	int i;
+
+	for(i = 0; i < count; i++)
+		tcbs[i][FIR_TCB_CP] = FIR_TCB_LINK(tcbs[(i + 1) % count]);
+
+	chain->channels = count;
+	chain->firctl1 = firChainCtl1(count, (chain->firctl1 & FIR_CAI) != 0);
+	chain->first = tcbs[0];
+}
+
+
+/* Starts the chain at its first channel. Called with the accelerator idle,
+ * from the core or from ChannelscompISR. */
+void firChainStart(fir_chain *chain)
+{
+	// the disable has to take effect before the chain is reloaded
+	*pFIRCTL1 = 0;
+	NOP();
+
+	*pCPFIR = FIR_TCB_LINK(chain->first);
+	*pFIRCTL1 = chain->firctl1;
+}
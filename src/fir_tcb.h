@@ -0,0 +1,114 @@
+/*********************************************************************************
+
+ Copyright(c) 2012 Analog Devices, Inc. All Rights Reserved.
+
+ This software is proprietary and confidential.  By using this software you agree
+ to the terms of the associated Analog Devices License Agreement.
+
+ *********************************************************************************/
+/*
+ * NAME:     fir_tcb.h
+ * PURPOSE:  Layout of the FIR accelerator Transfer Control Block (TCB) and of the
+ *           FIRCTL2 register fields. Shared by the TCB setup code and the host
+ *           emulator so that both walk exactly the same 13-word chain.
+ */
+#ifndef _fir_tcb_H_
+#define _fir_tcb_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* A TCB word holds either a count or an address. On the SHARC an address is a
+ * 32-bit word address, on a 64-bit host it is a native pointer. */
+#ifdef HOST_EMULATION
+typedef intptr_t fir_word;
+#else
+typedef int fir_word;
+#endif
+
+/* Address of a buffer element as stored in a TCB word */
+#define FIR_ADDR(p)         ((fir_word)(p))
+
+/*-------------------------------------------------------------------------------*/
+/* Word offsets inside a TCB. CPFIR and the CP word of the previous TCB point at
+ * the FIRCTL2 word, the accelerator fetches the rest at descending addresses.*/
+#define FIR_TCB_CP          (0)     /* Chain pointer to the next TCB*/
+#define FIR_TCB_CBL         (1)     /* Coefficient buffer length*/
+#define FIR_TCB_CM          (2)     /* Coefficient modifier*/
+#define FIR_TCB_CI          (3)     /* Coefficient index, points to c(N-1)*/
+#define FIR_TCB_OB          (4)     /* Output circular buffer base*/
+#define FIR_TCB_OL          (5)     /* Output buffer length*/
+#define FIR_TCB_OM          (6)     /* Output modifier*/
+#define FIR_TCB_OI          (7)     /* Output index*/
+#define FIR_TCB_IB          (8)     /* Input circular buffer base*/
+#define FIR_TCB_IL          (9)     /* Input buffer length*/
+#define FIR_TCB_IM          (10)    /* Input modifier*/
+#define FIR_TCB_II          (11)    /* Input index, points to x(n-N+1)*/
+#define FIR_TCB_FIRCTL2     (12)    /* FIRCTL2 value for this channel*/
+
+#define FIR_TCB_SIZE        (13)
+
+/* Access a TCB field through the address the chain pointer holds */
+#define FIR_TCB_FIELD(cp, field)    ((cp)[(field) - FIR_TCB_FIRCTL2])
+
+/* Value written to a CP word or to CPFIR to reach a TCB */
+#define FIR_TCB_LINK(tcb)           FIR_ADDR(&(tcb)[FIR_TCB_FIRCTL2])
+
+/*-------------------------------------------------------------------------------*/
+/* FIRCTL2 fields. The tap length, the window size and the rate ratio are all
+ * programmed as (value - 1). The window always counts input samples: a
+ * decimating channel writes window/ratio outputs, an interpolating (UPSAMP)
+ * one window*ratio. */
+#define FIRCTL2_TAPLEN_MASK     (0x3FFF)
+#define FIRCTL2_WINDOW_SHIFT    (14)
+#define FIRCTL2_WINDOW_MASK     (0x3FF)
+#define FIRCTL2_RATIO_SHIFT     (24)
+#define FIRCTL2_RATIO_MASK      (0xF)
+#define FIRCTL2_UPSAMP          (1 << 28)
+
+#define FIRCTL2_TAPS(n)         (((n) - 1) & FIRCTL2_TAPLEN_MASK)
+#define FIRCTL2_WINDOW(n)       ((((n) - 1) & FIRCTL2_WINDOW_MASK) << FIRCTL2_WINDOW_SHIFT)
+#define FIRCTL2_RATIO(n)        ((((n) - 1) & FIRCTL2_RATIO_MASK) << FIRCTL2_RATIO_SHIFT)
+
+#define FIRCTL2_GET_TAPS(v)     (((v) & FIRCTL2_TAPLEN_MASK) + 1)
+#define FIRCTL2_GET_WINDOW(v)   ((((v) >> FIRCTL2_WINDOW_SHIFT) & FIRCTL2_WINDOW_MASK) + 1)
+#define FIRCTL2_GET_RATIO(v)    ((((v) >> FIRCTL2_RATIO_SHIFT) & FIRCTL2_RATIO_MASK) + 1)
+
+/*-------------------------------------------------------------------------------*/
+/* Chain limits: FIRCTL1 counts up to 32 channels, the window field holds 1024
+ * and the coefficient memory 1024 taps */
+#define FIR_MAX_CHANNELS    (32)
+#define FIR_MAX_WINDOW      (1024)
+#define FIR_MAX_TAPS        (1024)
+#define FIR_MAX_RATIO       (FIRCTL2_RATIO_MASK + 1)
+
+/* One channel of a chain, as passed to firChainBuild(). The input is a
+ * circular buffer whose first window starts at in, with the history at its
+ * end: taps-1 samples, or taps/ratio-1 for an interpolating channel, whose
+ * taps are ratio polyphase branches of c(p), c(p+ratio), c(p+2*ratio)...
+ * A decimating channel keeps every ratio-th output of the first window
+ * sample on and only computes those. */
+typedef struct {
+	int taps;
+	int window;
+	const float *coeffs;    /* c(0)..c(taps-1), c(0) applies to the newest sample */
+	float *in;
+	int in_length;          /* at least history + window */
+	float *out;             /* FIR_OUTPUTS() samples per iteration */
+	int ratio;              /* 1, or the decimation or interpolation factor */
+	bool upsample;          /* interpolate by ratio instead of decimating */
+} fir_channel_config;
+
+/* Input history and outputs per window of a channel */
+#define FIR_HISTORY(c)      ((c)->upsample ? (c)->taps/(c)->ratio - 1 : (c)->taps - 1)
+#define FIR_OUTPUTS(c)      ((c)->upsample ? (c)->window*(c)->ratio : (c)->window/(c)->ratio)
+
+/* TCBs of a chain, linked in a ring, and the FIRCTL1 value that runs it */
+typedef struct {
+	int channels;
+	int firctl1;
+	fir_word *first;        /* TCB the ring starts at, tcb[0] unless relinked */
+	fir_word tcb[FIR_MAX_CHANNELS][FIR_TCB_SIZE];
+} fir_chain;
+
+#endif /* _fir_tcb_H_ */
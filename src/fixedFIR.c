@@ -0,0 +1,187 @@
+/*********************************************************************************
+
+ Copyright(c) 2012 Analog Devices, Inc. All Rights Reserved.
+
+ This software is proprietary and confidential.  By using this software you agree
+ to the terms of the associated Analog Devices License Agreement.
+
+ *********************************************************************************/
+/*
+ * NAME:     fixedFIR.c
+ * PURPOSE:  1.31 fixed-point FIR channels on the core.
+ * USAGE:    The FIR channels set in FIXED_POINT_CHANNELS leave the accelerator
+ *           chain. handleCodecData() calls fixedChannelsBlock() once per block,
+ *           which filters them straight from their RX DMA slot into their TX
+ *           DMA slot, with no float conversion on either side.
+ *
+ *           The delay line is a circular buffer, so a block goes in with no
+ *           copying of the history. On the processor the taps run as native
+ *           fract products summed into an accum, the 80-bit MR register, which
+ *           is exact for any tap count here, and the sum is rounded and
+ *           saturated to 1.31 once at the end. The host emulation keeps the
+ *           same sum in plain integer C as the bit-exact reference: every
+ *           1.31 x 1.31 product is split into its upper bits and its low 16
+ *           bits, which are summed apart, so a sum of up to 2^17 taps cannot
+ *           overflow or lose a bit. Right shifts of negative values are
+ *           arithmetic on the host compilers.
+ */
+
+#include "ADDS_21479_EzKit.h"
+
+#ifdef HOST_EMULATION
+#define FIXED_CIRC(i, step, size) (((i) + (step) + (size)) % (size))
+#else
+#include <stdfix.h>
+#define FIXED_CIRC(i, step, size) circindex(i, step, size)
+#endif
+
+/* Core state and 1.31 coefficients of the fixed-point channels */
+fixed_fir_channel Fixed_Channels[FIR_CHANNELS];
+static int Fixed_Coeffs[FIR_CHANNELS][COEFF_BANK_TAPS];
+
+/* Delay lines of the fixed-point channels, carved by initBlockMemory() */
+int *Fixed_Lines[FIR_CHANNELS];
+
+
+/* Float coefficient to 1.31. The scaling by 2^31 is exact and the C
+ * conversion truncates toward zero, so every compiler gets the same value. */
+int fixedCoeff(float c)
+{
+	float r = c * 2147483648.0f;
+
+	if(r >= 2147483647.0f)
+		return 0x7FFFFFFF;
+	if(r <= -2147483648.0f)
+		return (int)0x80000000;
+	return (int)r;
+}
+
+
+/* Sets up a channel of taps 1.31 coefficients in coeffs and a cleared delay
+ * line of FIXED_LINE_SIZE() words for blocks of length samples. Its outputs
+ * follow its inputs by lag blocks. */
+void fixedFirInit(fixed_fir_channel *f, const int *coeffs, int taps, int *line, int length, int lag)
+{
+	int i;
+
+	f->taps = taps;
+	f->lag = lag;
+	f->coeffs = coeffs;
+	f->line = line;
+	f->size = taps - 1 + (lag + 1) * length;
+	f->next = 0;
+
+	for(i = 0; i < f->size; i++)
+		line[i] = 0;
+}
+
+
+/*   line, from next on:  | taps-1 history | lag blocks | new block |
+ * The new block overwrites the oldest samples. The outputs of a block are
+ * those of the first block after the history, which ends lag blocks and one
+ * sample before the new block, and c(k) applies k samples further back. */
+
+/* Filters length 1.31 samples, input[inStride*i], into output[outStride*i],
+ * rounding to nearest and saturating */
+void fixedFirBlock(fixed_fir_channel *f, const int *input, int inStride, int *output, int outStride, int length)
+{
+	const int *line = f->line;
+	int size = f->size;
+	int first = FIXED_CIRC(f->next, -f->lag * length, size);
+	int i, j, k;
+#ifdef HOST_EMULATION
+	const int *c = f->coeffs;
+	long long hi, lo, p;
+#else
+	const fract *c = (const fract *)f->coeffs;
+	const fract *x = (const fract *)line;
+	accum acc;
+#endif
+
+	for(i = 0; i < length; i++)
+	{
+		f->line[f->next] = input[inStride*i];
+		f->next = FIXED_CIRC(f->next, 1, size);
+	}
+
+	for(i = 0; i < length; i++)
+	{
+		j = FIXED_CIRC(first, i, size);
+
+#ifdef HOST_EMULATION
+		// half an output LSB, 2^30, in units of 2^16
+		hi = 1LL << 14;
+		lo = 0;
+
+		for(k = 0; k < f->taps; k++)
+		{
+			p = (long long)c[k] * line[j];
+			hi += p >> 16;
+			lo += p & 0xFFFF;
+			j = FIXED_CIRC(j, -1, size);
+		}
+
+		// (sum + 2^30) >> 31
+		hi = (hi + (lo >> 16)) >> 15;
+
+		if(hi > 0x7FFFFFFFLL)
+			hi = 0x7FFFFFFFLL;
+		else if(hi < -0x80000000LL)
+			hi = -0x80000000LL;
+
+		output[outStride*i] = (int)hi;
+#else
+		// fractional MACs into MR, one rounding and saturation to 1.31
+		acc = 0;
+		for(k = 0; k < f->taps; k++)
+		{
+			acc += (accum)c[k] * x[j];
+			j = circindex(j, -1, size);
+		}
+
+		output[outStride*i] = bitsr((sat fract)acc);
+#endif
+	}
+}
+
+
+/* Runs after initBlockMemory(): quantises the coefficients of the channels in
+ * FIXED_POINT_CHANNELS. Their outputs keep the latency of the accelerator
+ * channels, one block with PIPELINED_PROCESSING. */
+void initFixedFIR(void)
+{
+	int ch, i;
+
+	for(ch = 0; ch < FIR_CHANNELS; ch++)
+	{
+		const fir_channel_config *c = &FIR_Channels[ch];
+
+		if(!FIXED_CHANNEL(ch))
+			continue;
+
+		for(i = 0; i < c->taps; i++)
+			Fixed_Coeffs[ch][i] = fixedCoeff(c->coeffs[i]);
+
+		fixedFirInit(&Fixed_Channels[ch], Fixed_Coeffs[ch], c->taps, Fixed_Lines[ch],
+					 blockSamples, FIR_BUFFER_SETS - 1);
+	}
+}
+
+
+/* Filters the fixed-point channels of the SPORT DMA buffer blockIndex, RX
+ * slot n into the TX slot of FIR channel n */
+void fixedChannelsBlock(unsigned int blockIndex)
+{
+	int * const tx[FIR_CHANNELS] = {
+		&TxBlock_A[blockIndex][0], &TxBlock_A[blockIndex][1],
+		&TxBlock_B[blockIndex][0], &TxBlock_B[blockIndex][1]
+	};
+	int ch;
+
+	for(ch = 0; ch < FIR_CHANNELS; ch++)
+	{
+		if(FIXED_CHANNEL(ch))
+			fixedFirBlock(&Fixed_Channels[ch], &RxBlock_A[blockIndex][ch], NUM_RX_SLOTS,
+						  tx[ch], NUM_TX_SLOTS, blockSamples);
+	}
+}
@@ -0,0 +1,197 @@
+/*********************************************************************************
+
+ Copyright(c) 2012 Analog Devices, Inc. All Rights Reserved.
+
+ This software is proprietary and confidential.  By using this software you agree
+ to the terms of the associated Analog Devices License Agreement.
+
+ *********************************************************************************/
+/*
+ * NAME:     hybridSchedule.c
+ * PURPOSE:  Splits the FIR channels between the accelerator and the core.
+ * USAGE:    With HYBRID_SCHEDULING, initFIR() calls initHybrid(), which
+ *           estimates the cycles of every channel on either side from its taps
+ *           and window with hybridModel and leaves the channels hybridPlan()
+ *           picks out of the TCB chain. process_audioBlocks() calls
+ *           hybridCoreBlock() once the chain of a block is started or queued,
+ *           so the core filters its channels with coreFIR.c instead of idling
+ *           until ChannelscompISR.
+ *
+ *           Every block goes into the decision log of hybridStats with the
+ *           cycles the model predicted and the cycles both sides took, for the
+ *           debugger and fir_emu hybrid to check and tune the model against.
+ */
+
+#include "ADDS_21479_EzKit.h"
+
+/* Starting points, to be tuned from hybridStats.log */
+hybrid_cost_model hybridModel = { 0.5f, 200, 1.0f, 300 };
+
+hybrid_stats hybridStats;
+
+/* Window the core copies the history of a channel into when it wraps round
+ * the end of the delay line, carved by initBlockMemory() */
+float *Hybrid_Scratch;
+
+
+/* Cycles of a channel on either side per block. silenceGate.c counts those
+ * of the accelerator as saved for every block it leaves a channel out. */
+unsigned int hybridAccCycles(const hybrid_cost_model *m, const fir_channel_config *c)
+{
+	return (unsigned int)(m->acc_cycles_per_mac * c->taps * FIR_OUTPUTS(c)) + m->acc_cycles_per_channel;
+}
+
+static unsigned int coreCycles(const hybrid_cost_model *m, const fir_channel_config *c)
+{
+	return (unsigned int)(m->core_cycles_per_mac * c->taps * c->window) + m->core_cycles_per_channel;
+}
+
+static int channelCount(unsigned int mask)
+{
+	int n = 0;
+
+	for(; mask != 0; mask >>= 1)
+		n += mask & 1;
+	return n;
+}
+
+
+/* Channels of FIR_Channels to filter on the core, as a mask, so that the
+ * later of both sides finishes as early as possible; the fewest channels on
+ * the core when splits tie. FIR_CHANNELS is small enough to try every split.
+ * The fixed-point channels, the SDRAM channels and multirate channels stay
+ * where they are, and one channel stays in the chain. Returns the predicted cycles per block of
+ * both sides in acc and core. */
+unsigned int hybridPlan(const hybrid_cost_model *m, unsigned int *acc, unsigned int *core)
+{
+	unsigned int all = (1u << FIR_CHANNELS) - 1;
+	unsigned int mask, best = 0, bestCost = ~0u, a, k, cost;
+	int ch;
+
+	*acc = *core = 0;
+
+	for(mask = 0; mask <= all; mask++)
+	{
+		if((mask & (FIXED_POINT_CHANNELS | SDRAM_FIR_CHANNELS)) != 0 ||
+				(mask | FIXED_POINT_CHANNELS | SDRAM_FIR_CHANNELS) == all)
+			continue;
+
+		a = k = 0;
+		for(ch = 0; ch < FIR_CHANNELS; ch++)
+		{
+			const fir_channel_config *c = &FIR_Channels[ch];
+
+			if(FIXED_CHANNEL(ch) || SDRAM_CHANNEL(ch))
+				continue;
+
+			if((mask >> ch) & 1)
+			{
+				if(c->ratio != 1)
+					break;
+				k += coreCycles(m, c);
+			}
+			else
+			{
+				a += hybridAccCycles(m, c);
+			}
+		}
+		if(ch < FIR_CHANNELS)
+			continue;
+
+		cost = a > k ? a : k;
+		if(cost < bestCost || (cost == bestCost && channelCount(mask) < channelCount(best)))
+		{
+			best = mask;
+			bestCost = cost;
+			*acc = a;
+			*core = k;
+		}
+	}
+
+	return best;
+}
+
+
+/* Runs in initFIR() before the chain is built: plans the split for the
+ * block size of initBlockMemory() and clears the log */
+void initHybrid(void)
+{
+	int i;
+
+	hybridStats.core_mask = 0;
+	hybridStats.predicted_acc = 0;
+	hybridStats.predicted_core = 0;
+	hybridStats.blocks = 0;
+	hybridStats.passes = 0;
+	for(i = 0; i < HYBRID_LOG_SIZE; i++)
+		hybridStats.log[i].acc_cycles = 0;
+
+	if(HYBRID_SCHEDULING)
+		hybridStats.core_mask = hybridPlan(&hybridModel, &hybridStats.predicted_acc,
+										   &hybridStats.predicted_core);
+}
+
+
+/* Filters the core's channels of the block whose new samples are at delayPos
+ * in the delay lines into the fBlockA set, while the accelerator filters the
+ * others, and logs the block */
+void hybridCoreBlock(int set, const int *delayPos)
+{
+	unsigned int start = sysreg_read(sysreg_EMUCLK);
+	hybrid_entry *e;
+	int ch, i;
+
+	for(ch = 0; ch < FIR_CHANNELS; ch++)
+	{
+		const fir_channel_config *c = &FIR_Channels[ch];
+		int history = c->taps - 1;
+		int first = delayPos[ch] - history;
+		float *out = firChannelOutput(set, ch);
+		const float *x, *coeffs, *fade;
+
+		if(!((hybridStats.core_mask >> ch) & 1))
+			continue;
+
+		// the blocks never wrap, the history before the first one does
+		if(first >= 0)
+		{
+			x = &c->in[first];
+		}
+		else
+		{
+			for(i = 0; i < history + blockSamples; i++)
+				Hybrid_Scratch[i] = c->in[(first + c->in_length + i) % c->in_length];
+			x = Hybrid_Scratch;
+		}
+
+		coeffs = coeffBankCorePass(ch, set, out, &fade);
+		coreFirBlock(x, coeffs, c->taps, out, blockSamples);
+		if(fade != NULL)
+			coreFirBlock(x, fade, c->taps, coeffFade[ch], blockSamples);
+	}
+
+	// hybridAccEnd() fills in the accelerator cycles of the same block
+	e = &hybridStats.log[hybridStats.blocks % HYBRID_LOG_SIZE];
+	e->block = hybridStats.blocks;
+	e->core_mask = hybridStats.core_mask;
+	e->predicted_acc = hybridStats.predicted_acc;
+	e->predicted_core = hybridStats.predicted_core;
+	e->core_cycles = sysreg_read(sysreg_EMUCLK) - start;
+
+	hybridStats.blocks++;
+}
+
+
+/* startFIR() and ChannelscompISR time the chain of every block; the
+ * accelerator takes the blocks in the order they were handed over */
+void hybridAccBegin(void)
+{
+	hybridStats.acc_start = sysreg_read(sysreg_EMUCLK);
+}
+
+void hybridAccEnd(void)
+{
+	hybridStats.log[hybridStats.passes % HYBRID_LOG_SIZE].acc_cycles =
+		sysreg_read(sysreg_EMUCLK) - hybridStats.acc_start;
+	hybridStats.passes++;
+}
@@ -0,0 +1,126 @@
+/*********************************************************************************
+
+ Copyright(c) 2012 Analog Devices, Inc. All Rights Reserved.
+
+ This software is proprietary and confidential.  By using this software you agree
+ to the terms of the associated Analog Devices License Agreement.
+
+ *********************************************************************************/
+/*
+ * NAME:     iirChain.c
+ * PURPOSE:  Builds IIR accelerator TCB chains of 1 to IIR_MAX_CHANNELS biquad
+ *           cascades.
+ * USAGE:    iirChainBuild() turns a list of channel descriptions into TCBs,
+ *           links them in a ring and computes IIRCTL1. iirChainStart() hands
+ *           the chain to the accelerator, which has to be selected in PMCTL1
+ *           first, see selectAccelerator() in initFIR.c.
+ */
+
+#include "ADDS_21479_EzKit.h"
+
+
+/* IIRCTL2 value of a channel, -1 when the accelerator cannot run it */
+int iirChainCtl2(int biquads, int window)
+{
+	if(biquads < 1 || biquads > IIR_MAX_BIQUADS || window < 1 || window > IIR_MAX_WINDOW)
+		return -1;
+
+	return IIRCTL2_BIQUADS(biquads) | IIRCTL2_WINDOW(window);
+}
+
+
+/* IIRCTL1 value that runs a chain of channels once, -1 when the accelerator
+ * cannot run that many channels. */
+int iirChainCtl1(int channels)
+{
+	if(channels < 1 || channels > IIR_MAX_CHANNELS)
+		return -1;
+
+	return IIR_EN | IIR_DMAEN | IIR_CH(channels);
+}
+
+
+/*CP[18:0]          ---------------      IIRCTL2
+  CP[18:0] -0x1     ---------------      II ---- first new input sample
+  CP[18:0] -0x2     ----------------     IM
+  CP[18:0] -0x3     -----------------    IL  ---- input buffer length
+  CP[18:0] -0x4     -----------------    IB  ---- Base address for input circular buffer
+  CP[18:0] -0x5     -----------------    OI
+  CP[18:0] -0x6     -----------------    OM
+  CP[18:0] -0x7     -----------------    OL  ---- output buffer length
+  CP[18:0] -0x8     -----------------    OB  ---- Base address for output circular buffer
+  CP[18:0] -0x9     -----------------    SB  ---- d1, d2 of every biquad, written back
+  CP[18:0] -0xA     -----------------    CB  ---- b0, b1, b2, a1, a2 of every biquad
+  CP[18:0] -0xB     -----------------    CP */
+
+/* Fills chain with one TCB per entry of config and clears the states.
+ * Returns 0, or -1 without touching the chain when a channel does not fit
+ * the accelerator. */
+int iirChainBuild(iir_chain *chain, const iir_channel_config *config, int channels)
+{
+	int ch, i;
+
+	if(iirChainCtl1(channels) < 0)
+		return -1;
+
+	for(ch = 0; ch < channels; ch++)
+	{
+		const iir_channel_config *c = &config[ch];
+
+		if(iirChainCtl2(c->biquads, c->window) < 0 || c->in_length < c->window)
+			return -1;
+	}
+
+	for(ch = 0; ch < channels; ch++)
+	{
+		const iir_channel_config *c = &config[ch];
+		fir_word *tcb = chain->tcb[ch];
+
+		for(i = 0; i < c->biquads * IIR_BIQUAD_STATES; i++)
+			c->state[i] = 0.0f;
+
+		tcb[IIR_TCB_CB] = FIR_ADDR(c->coeffs);
+		tcb[IIR_TCB_SB] = FIR_ADDR(c->state);
+
+		tcb[IIR_TCB_OB] = FIR_ADDR(c->out);
+		tcb[IIR_TCB_OL] = c->window;
+		tcb[IIR_TCB_OM] = 1;
+		tcb[IIR_TCB_OI] = FIR_ADDR(c->out);
+
+		tcb[IIR_TCB_IB] = FIR_ADDR(c->in);
+		tcb[IIR_TCB_IL] = c->in_length;
+		tcb[IIR_TCB_IM] = 1;
+		tcb[IIR_TCB_II] = FIR_ADDR(c->in);
+
+		tcb[IIR_TCB_IIRCTL2] = iirChainCtl2(c->biquads, c->window);
+
+		// the last channel links back to the first
+		tcb[IIR_TCB_CP] = IIR_TCB_LINK(chain->tcb[(ch + 1) % channels]);
+	}
+
+	chain->channels = channels;
+	chain->iirctl1 = iirChainCtl1(channels);
+
+	return 0;
+}
+
+
+/* Points the output of a channel at another buffer, with the accelerator idle */
+void iirChainSetOutput(iir_chain *chain, int channel, float *out)
+{
+	chain->tcb[channel][IIR_TCB_OB] = FIR_ADDR(out);
+	chain->tcb[channel][IIR_TCB_OI] = FIR_ADDR(out);
+}
+
+
+/* Starts the chain at its first channel. Called with the IIR accelerator
+ * selected and idle, from the core or from ChannelscompISR. */
+void iirChainStart(iir_chain *chain)
+{
+	// the disable has to take effect before the chain is reloaded
+	*pIIRCTL1 = 0;
+	NOP();
+
+	*pCPIIR = IIR_TCB_LINK(chain->tcb[0]);
+	*pIIRCTL1 = chain->iirctl1;
+}
@@ -0,0 +1,90 @@
+/*********************************************************************************
+
+ Copyright(c) 2012 Analog Devices, Inc. All Rights Reserved.
+
+ This software is proprietary and confidential.  By using this software you agree
+ to the terms of the associated Analog Devices License Agreement.
+
+ *********************************************************************************/
+/*
+ * NAME:     iir_tcb.h
+ * PURPOSE:  Layout of the IIR accelerator Transfer Control Block (TCB) and of the
+ *           IIRCTL2 register fields. Shared by the TCB setup code and the host
+ *           emulator so that both walk exactly the same 12-word chain.
+ */
+#ifndef _iir_tcb_H_
+#define _iir_tcb_H_
+
+#include "fir_tcb.h"
+
+/*-------------------------------------------------------------------------------*/
+/* Word offsets inside a TCB. CPIIR and the CP word of the previous TCB point at
+ * the IIRCTL2 word, the accelerator fetches the rest at descending addresses.*/
+#define IIR_TCB_CP          (0)     /* Chain pointer to the next TCB*/
+#define IIR_TCB_CB          (1)     /* Coefficient base, IIR_BIQUAD_COEFFS per biquad*/
+#define IIR_TCB_SB          (2)     /* State base, IIR_BIQUAD_STATES per biquad*/
+#define IIR_TCB_OB          (3)     /* Output circular buffer base*/
+#define IIR_TCB_OL          (4)     /* Output buffer length*/
+#define IIR_TCB_OM          (5)     /* Output modifier*/
+#define IIR_TCB_OI          (6)     /* Output index*/
+#define IIR_TCB_IB          (7)     /* Input circular buffer base*/
+#define IIR_TCB_IL          (8)     /* Input buffer length*/
+#define IIR_TCB_IM          (9)     /* Input modifier*/
+#define IIR_TCB_II          (10)    /* Input index, points to the first new sample*/
+#define IIR_TCB_IIRCTL2     (11)    /* IIRCTL2 value for this channel*/
+
+#define IIR_TCB_SIZE        (12)
+
+/* Access a TCB field through the address the chain pointer holds */
+#define IIR_TCB_FIELD(cp, field)    ((cp)[(field) - IIR_TCB_IIRCTL2])
+
+/* Value written to a CP word or to CPIIR to reach a TCB */
+#define IIR_TCB_LINK(tcb)           FIR_ADDR(&(tcb)[IIR_TCB_IIRCTL2])
+
+/*-------------------------------------------------------------------------------*/
+/* IIRCTL2 fields. The biquad count and the window size are both programmed as
+ * (value - 1).*/
+#define IIRCTL2_NBIQUADS_MASK   (0xF)
+#define IIRCTL2_WINDOW_SHIFT    (14)
+#define IIRCTL2_WINDOW_MASK     (0x3FF)
+
+#define IIRCTL2_BIQUADS(n)      (((n) - 1) & IIRCTL2_NBIQUADS_MASK)
+#define IIRCTL2_WINDOW(n)       ((((n) - 1) & IIRCTL2_WINDOW_MASK) << IIRCTL2_WINDOW_SHIFT)
+
+#define IIRCTL2_GET_BIQUADS(v)  (((v) & IIRCTL2_NBIQUADS_MASK) + 1)
+#define IIRCTL2_GET_WINDOW(v)   ((((v) >> IIRCTL2_WINDOW_SHIFT) & IIRCTL2_WINDOW_MASK) + 1)
+
+/*-------------------------------------------------------------------------------*/
+/* Chain limits: IIRCTL1 counts up to 24 channels of up to 12 biquads */
+#define IIR_MAX_CHANNELS    (24)
+#define IIR_MAX_WINDOW      (1024)
+#define IIR_MAX_BIQUADS     (12)
+
+/* A biquad is b0, b1, b2, a1, a2 of
+ *   H(z) = (b0 + b1 z^-1 + b2 z^-2) / (1 + a1 z^-1 + a2 z^-2)
+ * run in transposed direct form II, which keeps two states d1, d2 */
+#define IIR_BIQUAD_COEFFS   (5)
+#define IIR_BIQUAD_STATES   (2)
+
+/* One channel of a chain, as passed to iirChainBuild(). The input is a
+ * circular buffer read from in on, one window per iteration; the history
+ * lives in the states, which the accelerator writes back after every
+ * window. */
+typedef struct {
+	int biquads;
+	int window;
+	const float *coeffs;    /* IIR_BIQUAD_COEFFS per biquad, first biquad first */
+	float *state;           /* IIR_BIQUAD_STATES per biquad */
+	const float *in;
+	int in_length;          /* at least window */
+	float *out;             /* window samples per iteration */
+} iir_channel_config;
+
+/* TCBs of a chain, linked in a ring, and the IIRCTL1 value that runs it */
+typedef struct {
+	int channels;
+	int iirctl1;
+	fir_word tcb[IIR_MAX_CHANNELS][IIR_TCB_SIZE];
+} iir_chain;
+
+#endif /* _iir_tcb_H_ */
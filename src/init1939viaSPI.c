@@ -11,6 +11,8 @@
  *PURPOSE:  Programs the control registers on the AD1939 via SPI accesses.
  *USAGE:    This file contains the subroutines for accessing the AD1939 control
  *          registers via SPI, and sets up the AD1939s for TDM serial communication.
+ *          init1939viaSPI() runs init1939Batched() with FAST_CODEC_BRINGUP, or
+ *          the original init1939Polled() otherwise.
  */
 
 
@@ -47,24 +49,33 @@ unsigned char ConfigParam1939 [] = {
             (AD1939_ADDR), DACMUTE, 0x00,
             }; 
 
+const int ConfigEntries1939 = sizeof(ConfigParam1939) / 3;
+
 unsigned char AD1938_Regs_Read[sizeof(ConfigParam1939) / 3];
 
+/* Number of table entries written after the PLL locked */
+#define CONFIG_AFTER_LOCK 2
+
+/* SPI DMA buffer of the fast bring-up, a 32-bit word per register written
+ * before the PLL locked */
+static int ConfigWords1939[sizeof(ConfigParam1939) / 3 - CONFIG_AFTER_LOCK];
+
 volatile int spiFlag ;
 
 /* Set up the SPI port to access the AD1939
  *  Call with SPI flag to use */
 
 
-static void SetupSPI1939(unsigned int SPI_Flag)
+static void SetupSPI1939(unsigned int SPI_Flag, int baud)
 {
 /* Configure the SPI Control registers */
 /* First clear a few registers */
     *pSPICTL = (TXFLSH | RXFLSH) ;
     *pSPIFLG = 0;
 
-/* Setup the baud rate to 1MHz */
+/* Setup the baud rate */
     //*pSPIBAUD = 100;
-    *pSPIBAUD = 25;
+    *pSPIBAUD = baud;
 
 /* Setup the SPI Flag register using the Flag specified in the call */
     *pSPIFLG = (CLEAR_DSXEN_BITS|SPI_Flag);
@@ -76,6 +87,28 @@ static void SetupSPI1939(unsigned int SPI_Flag)
 }
 
 
+/* Set up the SPI port to send a DMA block to the AD1939, one register per
+ * 32-bit word. With CPHASE clear the port drives the select itself and
+ * releases it after every word, which makes the AD1939 latch the last 24
+ * bits it received: the leading zero byte of each word just passes through
+ * its shift register. CLKPL clear keeps the AD1939 sampling on the rising
+ * edge of the clock. */
+
+
+static void SetupSPI1939DMA(unsigned int SPI_Flag)
+{
+    *pSPICTL = (TXFLSH | RXFLSH) ;
+    *pSPIFLG = 0;
+    *pSPIDMAC = 0;
+
+    *pSPIBAUD = AD1939_SPIBAUD_FAST;
+
+    *pSPIFLG = (CLEAR_DSXEN_BITS|SPI_Flag);
+
+    *pSPICTL = (SPIEN | SPIMS | WL32 | MSBF | TIMOD2);
+}
+
+
 /* Disable the SPI Port */
 
 
@@ -179,18 +212,35 @@ unsigned int LockTest;
 /* Set up all AD1939 registers via SPI */
 
 
-void init1939viaSPI(void)
+int init1939viaSPI(void)
+{
+#if FAST_CODEC_BRINGUP
+    return init1939Batched(CODEC_READBACK);
+#else
+    return init1939Polled();
+#endif
+}
+
+
+
+/* Original bring-up: every register written and read back one byte at a
+ * time with fixed delays, then the PLL lock polled until it comes. Returns
+ * 0, or -1 when it has not come after CODEC_POLLED_LOCK_POLLS polls. */
+
+
+int init1939Polled(void)
 {
     int configSize = sizeof(ConfigParam1939);
     int i,j=0 ;
+    int polls = 0;
     unsigned char tmpA[sizeof(ConfigParam1939) / 3];
     
 
 /* Set up AD1939 */
-    SetupSPI1939(AD1939_CS);
+    SetupSPI1939(AD1939_CS, AD1939_SPIBAUD);
 
 /* Write register settings*/
-    for(i = 0; i < configSize-6; i+=3)
+    for(i = 0; i < configSize-3*CONFIG_AFTER_LOCK; i+=3)
     {
         Configure1939Register(ConfigParam1939[i], ConfigParam1939[i+1], ConfigParam1939[i+2], AD1939_CS);
         Delay(272);
@@ -205,11 +255,16 @@ void init1939viaSPI(void)
     LockTest = Get1939Register(0x1, AD1939_CS);
     while (!(LockTest & AD1938_PLL_LOCK))
     {
+        if(polls++ >= CODEC_POLLED_LOCK_POLLS)
+        {
+            DisableSPI1939();
+            return -1;
+        }
     	LockTest = Get1939Register(CLKCTRL1, AD1939_CS);
     LockCount++;
     }
     
-    for(i = configSize-6; i < configSize; i+=3)
+    for(i = configSize-3*CONFIG_AFTER_LOCK; i < configSize; i+=3)
     {
         Configure1939Register(ConfigParam1939[i], ConfigParam1939[i+1], ConfigParam1939[i+2], AD1939_CS);
         Delay(272);
@@ -221,6 +276,121 @@ void init1939viaSPI(void)
 
 
     DisableSPI1939();
+
+    return 0;
+}
+
+
+
+/* Reads the register of table entry i back into AD1938_Regs_Read and
+ * compares it with the last value that table entries 0 to entries-1 wrote
+ * to it. The lock bit of CLKCTRL1 is read-only. Returns 0 or -1. */
+
+
+static int Verify1939Register(int i, int entries)
+{
+    unsigned char reg = ConfigParam1939[3*i+1];
+    unsigned char expected = 0, mask = 0xFF;
+    int k;
+
+    for(k = 0; k < entries; k++)
+    {
+        if(ConfigParam1939[3*k+1] == reg)
+            expected = ConfigParam1939[3*k+2];
+    }
+    if(reg == CLKCTRL1)
+        mask &= ~AD1938_PLL_LOCK;
+
+    AD1938_Regs_Read[i] = Get1939Register(reg, AD1939_CS);
+
+    return ((AD1938_Regs_Read[i] ^ expected) & mask) ? -1 : 0;
+}
+
+
+
+/* Fast bring-up: the table up to the PLL power-up goes out in one DMA
+ * block, the PLL lock is polled with a backoff that doubles from
+ * CODEC_LOCK_BACKOFF_MIN to CODEC_LOCK_BACKOFF_MAX and gives up after
+ * CODEC_LOCK_TIMEOUT, and the registers are only read back when verify is
+ * set. Returns 0, or -1 when the PLL did not lock or a register read back
+ * wrong. */
+
+
+int init1939Batched(bool verify)
+{
+    int entries = sizeof(ConfigParam1939) / 3;
+    int before = entries - CONFIG_AFTER_LOCK;
+    int i, backoff, waited;
+
+    for(i = 0; i < before; i++)
+        ConfigWords1939[i] = (WR(ConfigParam1939[3*i]) << 16) | (ConfigParam1939[3*i+1] << 8) |
+                             ConfigParam1939[3*i+2];
+
+    SetupSPI1939DMA(AD1939_CS);
+
+    *pIISPI = FIR_ADDR(ConfigWords1939);
+    *pIMSPI = 1;
+    *pCSPI = before;
+    *pSPIDMAC = SPIDEN;
+
+/* Wait for the DMA to hand over the last word and the port to send it */
+    while (*pSPIDMAC & SPIDMAS)
+    {NOP();}
+    while (!(*pSPISTAT & SPIFE))
+    {NOP();}
+
+    *pSPIDMAC = 0;
+
+/* Register reads need the select held over three bytes */
+    SetupSPI1939(AD1939_CS, AD1939_SPIBAUD_FAST);
+
+    if(verify)
+    {
+        for(i = 0; i < before; i++)
+        {
+            if(Verify1939Register(i, before) != 0)
+            {
+                DisableSPI1939();
+                return -1;
+            }
+        }
+    }
+
+/*  Make sure the PLL is locked before enabling the CODEC.*/
+    backoff = CODEC_LOCK_BACKOFF_MIN;
+    waited = 0;
+    LockTest = Get1939Register(CLKCTRL1, AD1939_CS);
+    while (!(LockTest & AD1938_PLL_LOCK))
+    {
+        if(waited >= CODEC_LOCK_TIMEOUT)
+        {
+            DisableSPI1939();
+            return -1;
+        }
+
+        Delay(backoff);
+        waited += backoff;
+        if(backoff < CODEC_LOCK_BACKOFF_MAX)
+            backoff *= 2;
+
+        LockTest = Get1939Register(CLKCTRL1, AD1939_CS);
+        LockCount++;
+    }
+
+    for(i = before; i < entries; i++)
+    {
+        Configure1939Register(ConfigParam1939[3*i], ConfigParam1939[3*i+1], ConfigParam1939[3*i+2], AD1939_CS);
+
+        if(verify && Verify1939Register(i, entries) != 0)
+        {
+            DisableSPI1939();
+            return -1;
+        }
+    }
+
+    DisableSPI1939();
+
+    return 0;
 }
 
 
@@ -0,0 +1,225 @@
+/*********************************************************************************
+
+ Copyright(c) 2012 Analog Devices, Inc. All Rights Reserved.
+
+ This software is proprietary and confidential.  By using this software you agree
+ to the terms of the associated Analog Devices License Agreement.
+
+ *********************************************************************************/
+/*
+ * NAME:     initFIR.c
+ * PURPOSE:  Filter buffers and TCB chain of the FIR accelerator.
+ * USAGE:    This file selects the FIR accelerator, routes its DMA interrupt and
+ *           builds the chain of FIR_Channels with firChain.c, after
+ *           initBlockMemory(). The channels of FIXED_POINT_CHANNELS are left
+ *           out of the chain and set up for fixedFIR.c instead, as are the
+ *           channels hybridSchedule.c gives the core; those of
+ *           SDRAM_FIR_CHANNELS run as tiles from sdramTiles.c after the chain.
+ *           The same code runs in the host emulation build.
+ */
+
+#include "ADDS_21479_EzKit.h"
+
+float Coeff_Buf1[TAPSIZE1]={
+							#include "coeffs256.dat"
+						};
+
+float Coeff_Buf2[TAPSIZE2] = {
+							#include "coeffs1024.dat"
+							};
+
+/* Channels in RX slot order. initBlockMemory() gives them their windows and
+ * filter delay lines, the input circular buffers of the chain. The
+ * accelerator writes II back advanced by one window after every block, so the
+ * history carries over without being copied. The outputs are retargeted per
+ * block by startFIR(). */
+fir_channel_config FIR_Channels[FIR_CHANNELS] = {
+	{ TAPSIZE1, 0, Coeff_Buf1, NULL, 0, NULL, 1, false },
+	{ TAPSIZE2, 0, Coeff_Buf2, NULL, 0, NULL, 1, false },
+	{ TAPSIZE1, 0, Coeff_Buf1, NULL, 0, NULL, 1, false },
+	{ TAPSIZE2, 0, Coeff_Buf2, NULL, 0, NULL, 1, false },
+};
+
+fir_chain FIR_Chain;
+
+/* TCB of each channel in FIR_Chain, -1 for the channels the core filters,
+ * those of FIXED_POINT_CHANNELS and those hybridPlan() moved, and for those of
+ * SDRAM_FIR_CHANNELS */
+int firChainIndex[FIR_CHANNELS];
+int firChainChannels;
+
+#if FFT_CONVOLUTION
+/* Partition and input spectra of the FFT convolution channels, carved by
+ * initBlockMemory() */
+float *FFT_Storage[FIR_CHANNELS];
+
+fft_conv_channel FFT_Conv[FIR_CHANNELS];
+#endif
+
+
+/* fBlockA set of the block on the accelerator */
+int filterSet;
+
+
+/* DAC buffer of a channel in an fBlockA set */
+float *firChannelOutput(int set, int ch)
+{
+	ad1939_float_data *b = &fBlockA[set];
+	float * const outputs[FIR_CHANNELS] = { b->Tx_L1, b->Tx_R1, b->Tx_L3, b->Tx_R3 };
+
+	return outputs[ch];
+}
+
+
+/* Hands the accelerator engine to FIRACCSEL or IIRACCSEL. Called with the
+ * engine idle. */
+void selectAccelerator(int accsel)
+{
+	*pPMCTL1&=~(BIT_17|BIT_18);
+	*pPMCTL1|=accsel;
+
+	//PMCTL1 effect latency
+	NOP();NOP();NOP();NOP();
+}
+
+
+/* Selects the FIR accelerator and sets up every channel. Returns 0, or -1
+ * when a channel does not fit the accelerator or SDRAM. */
+int initFIR(void)
+{
+	fir_channel_config chain[FIR_CHANNELS];
+	int temp;
+	int temp1;
+
+	/* Selecting FIR accelerator */
+	selectAccelerator(FIRACCSEL);
+
+
+	sysreg_bit_set(sysreg_MODE1, IRPTEN);
+
+	// add interrupt that fires when accelerator finishes work
+	adi_int_InstallHandler (ADI_CID_P0I,ChannelscompISR,0,true);
+
+	// probably set interrupt priority
+	temp = *pPICR0;
+	temp1 = 0xFFFFFFE0; // interrupt mask
+	temp = temp & temp1;
+	temp1 = DMAIntrSource;
+	temp1 = temp | temp1;
+	*pPICR0 = temp1;
+
+	// filter from the first coefficient bank of every channel
+	coeffBankInit();
+
+	// the channels the core takes off the accelerator
+	initHybrid();
+
+	// one TCB per accelerator channel, run once per block, into the first set
+	temp1 = 0;
+	for(temp = 0; temp < FIR_CHANNELS; temp++)
+	{
+		FIR_Channels[temp].out = firChannelOutput(0, temp);
+
+		if(FIXED_CHANNEL(temp) || SDRAM_CHANNEL(temp) || ((hybridStats.core_mask >> temp) & 1))
+		{
+			firChainIndex[temp] = -1;
+			continue;
+		}
+		firChainIndex[temp] = temp1;
+		chain[temp1++] = FIR_Channels[temp];
+	}
+	firChainChannels = temp1;
+
+	if(firChainBuild(&FIR_Chain, chain, firChainChannels, false) != 0)
+		return -1;
+
+	// the 1.31 channels on the core
+	initFixedFIR();
+
+	// the channels too long for internal memory into SDRAM
+	if(SDRAM_FIR_CHANNELS && initSdramChannels() != 0)
+		return -1;
+
+	// every filtered channel to its own AOUT channel
+	initRoute();
+
+	// no channel is gated before it has had a silent tail
+	initSilenceGate();
+
+	// pass TCBs to accelerator
+	*pCPFIR = FIR_TCB_LINK(FIR_Chain.tcb[0]);
+
+#if FFT_CONVOLUTION
+	// the core filters the channels, the chain above stays idle
+	for(temp = 0; temp < FIR_CHANNELS; temp++)
+	{
+		if(!FIXED_CHANNEL(temp))
+			fftConvInit(&FFT_Conv[temp], FIR_Channels[temp].coeffs, FIR_Channels[temp].taps, FFT_Storage[temp]);
+	}
+#endif
+
+	return 0;
+}
+
+
+/* Point the channel outputs at one fBlockA set and start the chain. The input
+ * indices are left where the accelerator wrote them back. The chain is
+ * relinked through the channels silenceGate.c does not gate and the crossfade
+ * TCBs of coeffBank.c; with none of either the pass ends at once. The first
+ * tile of the SDRAM channels is fetched while the chain runs. Called with the
+ * accelerator idle, from the core or from ChannelscompISR.
+ */
+void startFIR(int set)
+{
+	fir_word *tcbs[FIR_MAX_CHANNELS];
+	int ch, n = 0;
+
+	filterSet = set;
+	for(ch = 0; ch < FIR_CHANNELS; ch++)
+	{
+		if(firChainIndex[ch] < 0)
+			continue;
+
+		firChainSetOutput(&FIR_Chain, firChainIndex[ch], firChannelOutput(set, ch));
+		if(!silenceGateSkip(ch, FIR_Chain.tcb[firChainIndex[ch]]))
+			tcbs[n++] = FIR_Chain.tcb[firChainIndex[ch]];
+	}
+	n += coeffBankFadeTcbs(&tcbs[n]);
+
+	if(SDRAM_FIR_CHANNELS)
+		sdramChannelsStart(set);
+
+	STAGE_BEGIN(STAGE_FILTER);
+	if(HYBRID_SCHEDULING)
+		hybridAccBegin();
+	selectAccelerator(FIRACCSEL);
+
+	if(n == 0)
+	{
+		ChannelscompISR(ADI_CID_P0I, NULL);
+		return;
+	}
+
+	firChainLink(&FIR_Chain, tcbs, n);
+	firChainStart(&FIR_Chain);
+}
+
+
+/* Called from ChannelscompISR with the accelerator that finished disabled.
+ * The FIR chain of a block is followed by the tiles of its SDRAM channels and
+ * then by its IIR cascades on the same engine: returns true when the next job
+ * was started, false once the block is filtered. */
+bool filterNextJob(void)
+{
+	if(!(*pPMCTL1 & FIRACCSEL))
+		return false;
+
+	if(SDRAM_FIR_CHANNELS && sdramTilesNext())
+		return true;
+
+	if(IIR_Chain.channels == 0)
+		return false;
+
+	startIIR(filterSet);
+	return true;
+}
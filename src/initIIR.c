@@ -0,0 +1,82 @@
+/*********************************************************************************
+
+ Copyright(c) 2012 Analog Devices, Inc. All Rights Reserved.
+
+ This software is proprietary and confidential.  By using this software you agree
+ to the terms of the associated Analog Devices License Agreement.
+
+ *********************************************************************************/
+/*
+ * NAME:     initIIR.c
+ * PURPOSE:  Biquad cascades of the IIR accelerator and their TCB chain.
+ * USAGE:    initIIR() runs after initBlockMemory() and initFIR() and builds the
+ *           chain of IIR_Channels with iirChain.c. The IIR and FIR
+ *           accelerators share one engine that PMCTL1 selects, so the cascades
+ *           of a block run after its FIR chain, started by ChannelscompISR
+ *           through filterNextJob(). The same code runs in the host emulation
+ *           build.
+ */
+
+#include "ADDS_21479_EzKit.h"
+
+/* Tone shaping EQ at 48 kHz: low shelf 80 Hz +4 dB, peaks at 200 Hz -2 dB,
+ * 500 Hz +2 dB, 1 kHz -3 dB, 2.5 kHz +3 dB, 5 kHz -2 dB and 10 kHz +2 dB,
+ * high shelf 12 kHz -3 dB. b0, b1, b2, a1, a2 per biquad. */
+float EQ_Biquads[EQ_BIQUADS*IIR_BIQUAD_COEFFS] = {
+							#include "eqBiquads.dat"
+						};
+
+static float IIR_State[IIR_CHANNELS][EQ_BIQUADS*IIR_BIQUAD_STATES];
+
+/* Channels in RX slot order. They read the filter delay lines of
+ * FIR_Channels, from the same window the FIR chain filters; the states carry
+ * the history, so they need none of the delay line behind it. */
+iir_channel_config IIR_Channels[IIR_CHANNELS] = {
+	{ EQ_BIQUADS, 0, EQ_Biquads, IIR_State[0], NULL, 0, NULL },
+	{ EQ_BIQUADS, 0, EQ_Biquads, IIR_State[1], NULL, 0, NULL },
+	{ EQ_BIQUADS, 0, EQ_Biquads, IIR_State[2], NULL, 0, NULL },
+	{ EQ_BIQUADS, 0, EQ_Biquads, IIR_State[3], NULL, 0, NULL },
+};
+
+iir_chain IIR_Chain;
+
+
+/* DAC buffer of a channel in an fBlockA set */
+static float *channelOutput(int set, int ch)
+{
+	ad1939_float_data *b = &fBlockA[set];
+	float * const outputs[IIR_CHANNELS] = { b->Tx_L2, b->Tx_R2, b->Tx_L4, b->Tx_R4 };
+
+	return outputs[ch];
+}
+
+
+void initIIR(void)
+{
+	int temp;
+
+	for(temp = 0; temp < IIR_CHANNELS; temp++)
+	{
+		IIR_Channels[temp].window = blockSamples;
+		IIR_Channels[temp].in = FIR_Channels[temp].in;
+		IIR_Channels[temp].in_length = FIR_Channels[temp].in_length;
+		IIR_Channels[temp].out = channelOutput(0, temp);
+	}
+
+	temp = iirChainBuild(&IIR_Chain, IIR_Channels, IIR_CHANNELS);
+	assert(temp == 0);
+}
+
+
+/* Point the channel outputs at one fBlockA set, hand the engine to the IIR
+ * accelerator and start the chain. Called with the engine idle. */
+void startIIR(int set)
+{
+	int ch;
+
+	for(ch = 0; ch < IIR_CHANNELS; ch++)
+		iirChainSetOutput(&IIR_Chain, ch, channelOutput(set, ch));
+
+	selectAccelerator(IIRACCSEL);
+	iirChainStart(&IIR_Chain);
+}
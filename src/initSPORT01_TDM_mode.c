@@ -9,7 +9,8 @@
 /*
  * NAME:     initSPORT01_TDM_mode.c (Block-based Talkthrough)
  * PURPOSE:  Talkthrough framework for sending and receiving samples to the AD1939.
- * USAGE:    This file initializes the SPORTs for DMA Chaining
+ * USAGE:    This file initializes the SPORTs for DMA Chaining through rings of
+ *           SPORT_DMA_BUFFERS blocks
  */
 
 
@@ -25,16 +26,13 @@
  *  DSP -> DAC4 : SPORT0B : TDM Channel 2,3
  */
 
-/* SPORT RX DMA destination buffers */
- 	 int RxBlock_A0[RX_BLOCK_SIZE];
- 	 int RxBlock_A1[RX_BLOCK_SIZE];
+/* SPORT RX DMA destination buffers, carved by initBlockMemory() */
+ 	 int *RxBlock_A[SPORT_DMA_BUFFERS];
 
 /* SPORT Tx DMA source buffers */
- 	 int TxBlock_A0[TX_BLOCK_SIZE];
- 	 int TxBlock_A1[TX_BLOCK_SIZE];
+ 	 int *TxBlock_A[SPORT_DMA_BUFFERS];
 
- 	 int TxBlock_B0[TX_BLOCK_SIZE];
- 	 int TxBlock_B1[TX_BLOCK_SIZE];
+ 	 int *TxBlock_B[SPORT_DMA_BUFFERS];
 
 
 /* TCB blocks for Chaining
@@ -43,57 +41,41 @@
  * Processing filled data
  */
 
-/* Set up the TCBs to rotate automatically */
-int TCB_RxBlock_A0[4] = { 0, RX_BLOCK_SIZE, 1, 0};
-int TCB_RxBlock_A1[4] = { 0, RX_BLOCK_SIZE, 1, 0};
+/* TCBs of each ring: chain pointer, count, modifier and index */
+int TCB_RxBlock_A[SPORT_DMA_BUFFERS][4];
 
-int TCB_TxBlock_A0[4] = { 0, TX_BLOCK_SIZE, 1, 0};
-int TCB_TxBlock_A1[4] = { 0, TX_BLOCK_SIZE, 1, 0};
+int TCB_TxBlock_A[SPORT_DMA_BUFFERS][4];
 
-int TCB_TxBlock_B0[4] = { 0, TX_BLOCK_SIZE, 1, 0};
-int TCB_TxBlock_B1[4] = { 0, TX_BLOCK_SIZE, 1, 0};
+int TCB_TxBlock_B[SPORT_DMA_BUFFERS][4];
 
 
-void initSPORT(void)
+/* Points a TCB at its buffer and at the TCB of the next buffer */
+static void linkTCB(int *tcb, int *next, int *buffer, int size, unsigned int pci)
 {
+/* Extract 19-bits of the next TCB address, with the PCI bit for an interrupt */
+    tcb[0] = ((SPORT_ADDR(next) + 3)& OFFSET_MASK)|pci ;
+    tcb[1] = size;
+    tcb[2] = 1;
+/*  Extract 19-bits of the buffer address */
+    tcb[3] = SPORT_ADDR(buffer)& OFFSET_MASK ;
+}
 
-/* Set up "ping-pong" chained DMAs for AD1939 */
 
-/*Proceed from Block A0 to Block A1 */
-/* Extract 19-bits of the receive buffer A1 address with setting PCI bit */
-    TCB_RxBlock_A0[0] = (((unsigned int) TCB_RxBlock_A1 + 3)& OFFSET_MASK)|PCI ;
-/*  Extract 19-bits of the receive buffer A0 address */
-    TCB_RxBlock_A0[3] = ((int) RxBlock_A0)& OFFSET_MASK ;
+void initSPORT(void)
+{
+	int i, next;
 
-/* Proceed from Block A0 to Block A1*/
-/* Extract 19-bits of the transmit buffer A1 address */
-    TCB_TxBlock_A0[0] = ((unsigned int) TCB_TxBlock_A1 + 3)& OFFSET_MASK ;
-/*  Extract 19-bits of the transmit buffer A0 address */
-    TCB_TxBlock_A0[3] = ((int) TxBlock_A0)& OFFSET_MASK ;
-    
-/* Proceed from Block B0 to Block B1 */
-/* Extract 19-bits of the transmit buffer B1 address */
-    TCB_TxBlock_B0[0] = ((unsigned int) TCB_TxBlock_B1 + 3)& OFFSET_MASK ;
-/*  Extract 19-bits of the transmit buffer B0 address */
-    TCB_TxBlock_B0[3] = ((int) TxBlock_B0)& OFFSET_MASK ;
-
-/* Proceed from Block A1 to Block A0 */
-/* Extract 19-bits of the receive buffer A0 address with setting PCI bit */
-    TCB_RxBlock_A1[0] = (((unsigned int) TCB_RxBlock_A0 + 3)& OFFSET_MASK)|PCI ;
-/*  Extract 19-bits of the receive buffer A1 address  */
-    TCB_RxBlock_A1[3] = ((int) RxBlock_A1)& OFFSET_MASK ;
-
-/* Proceed from Block A1 to Block A0 */
-/* Extract 19-bits of the transmit buffer A0 address */
-    TCB_TxBlock_A1[0] = ((unsigned int) TCB_TxBlock_A0 + 3)& OFFSET_MASK ;
-/*  Extract 19-bits of the transmit buffer A1 address */
-    TCB_TxBlock_A1[3] = ((int) TxBlock_A1)& OFFSET_MASK ;
-    
-/* Proceed from Block AB to Block B0 */
-/* Extract 19-bits of the transmit buffer B0 address */
-    TCB_TxBlock_B1[0] = ((unsigned int) TCB_TxBlock_B0 + 3)& OFFSET_MASK ;
-/*  Extract 19-bits of the transmit buffer B1 address */
-    TCB_TxBlock_B1[3] = ((int) TxBlock_B1)& OFFSET_MASK ;
+/* Set up the chained DMAs for AD1939 to rotate through SPORT_DMA_BUFFERS
+ * blocks, "ping-pong" with the default two. Only the receiver interrupts,
+ * once per block of blockSamples frames. */
+	for(i = 0; i < SPORT_DMA_BUFFERS; i++)
+	{
+		next = (i + 1) % SPORT_DMA_BUFFERS;
+
+		linkTCB(TCB_RxBlock_A[i], TCB_RxBlock_A[next], RxBlock_A[i], RX_BLOCK_SIZE, PCI);
+		linkTCB(TCB_TxBlock_A[i], TCB_TxBlock_A[next], TxBlock_A[i], TX_BLOCK_SIZE, 0);
+		linkTCB(TCB_TxBlock_B[i], TCB_TxBlock_B[next], TxBlock_B[i], TX_BLOCK_SIZE, 0);
+	}
 
     
 /*Clear out SPORT 0/1 registers */
@@ -116,10 +98,10 @@ void initSPORT(void)
 /* Enabling DMA Chaining for SPORT0 TX/SPORT1 RX */
 /* Block 1 will be filled first */
     /* Initialize the chain pointer for the transmitter with PCI bit set to enable the interrupts after every TCB */
-    *pCPSP0A = (unsigned int)TCB_TxBlock_A0 - OFFSET + 3 + PCI;
+    *pCPSP0A = SPORT_ADDR(TCB_TxBlock_A[0]) - OFFSET + 3 + PCI;
     /* Initialize the chain pointers for transmitters */
-    *pCPSP0B = (unsigned int)TCB_TxBlock_B0 - OFFSET + 3;
-    *pCPSP1A = (unsigned int)TCB_RxBlock_A0 - OFFSET + 3;
+    *pCPSP0B = SPORT_ADDR(TCB_TxBlock_B[0]) - OFFSET + 3;
+    *pCPSP1A = SPORT_ADDR(TCB_RxBlock_A[0]) - OFFSET + 3;
     
 	
 /* sport1 control register set up as a receiver in MCM
@@ -16,6 +16,25 @@
 #include <platform_include.h>      /* System and IOP register bit and address definitions. */
 #include <processor_include.h>
 #include <builtins.h>  /* Get definitions of compiler builtin functions */
+#include "ADDS_21479_EzKit.h"
+
+/* Waits for the PLL or its dividers: the empty loop of the original, or with
+ * FAST_BOOT until EMUCLK has counted the cycles */
+static void pllSettle(int loops, unsigned int cycles)
+{
+#if FAST_BOOT
+	unsigned int start = sysreg_read(sysreg_EMUCLK);
+
+	(void)loops;
+	while(sysreg_read(sysreg_EMUCLK) - start < cycles)
+		NOP();
+#else
+	int i;
+
+	(void)cycles;
+	for(i=0;i<loops;i++);
+#endif
+}
 
 void initPLL()
 {
@@ -23,7 +42,7 @@ void initPLL()
 /********************************************************************************************/
 
 
- int temp,i;
+ int temp;
 
  //Step 1 - change the PLLD to 4
  temp=*pPMCTL;
@@ -32,7 +51,7 @@ void initPLL()
  *pPMCTL = temp;
 
  //Step 2 - wait for dividers to stabilize
- for(i=0;i<16;i++);
+ pllSettle(16, PLL_DIVIDER_CYCLES);
 
  //Step 3 - set INDIV bit now to bring down the VCO speed and enter the bypass mode
  temp&=~DIVEN;
@@ -40,7 +59,7 @@ void initPLL()
  *pPMCTL = temp;
 
  //Step 4 - wait for the PLL to lock
- for(i=0;i<4096;i++);
+ pllSettle(4096, PLL_LOCK_CYCLES);
 
  //Step 5 - come out of the bypass mode
  temp=*pPMCTL;
@@ -48,7 +67,7 @@ void initPLL()
  *pPMCTL = temp;
 
   //Step 6 - wait for dividers to stabilize
- for(i=0;i<16;i++);
+ pllSettle(16, PLL_DIVIDER_CYCLES);
 
   //Step 7 - set the required PLLM and INDIV values here  and enter the bypass mode
  //PLLM=18, INDIV=0,  fVCO=2*PLLM*CLKIN = 2*18*16.625 = 532 MHz
@@ -58,7 +77,7 @@ void initPLL()
  *pPMCTL = temp;
 
  //Step 8 - wait for the PLL to lock
- for(i=0;i<4096;i++);
+ pllSettle(4096, PLL_LOCK_CYCLES);
 
  //Step 9 - come out of the bypass mode
  temp = *pPMCTL;
@@ -66,7 +85,7 @@ void initPLL()
  *pPMCTL=temp;
 
  //Step 10 - wait for dividers to stabilize
- for(i=0;i<16;i++);
+ pllSettle(16, PLL_DIVIDER_CYCLES);
 
  //Step 11 - set the required values of PLLD(=2) and SDCKR (=2.5) here
 // fCCLK = fVCO/PLLD = 532/2 = 266 MHz, fSDCLK = fCCLK/SDCKR = 266/2 = 133 MHz
@@ -76,7 +95,7 @@ void initPLL()
  *pPMCTL=temp;
 
  //Step 12 - wait for the dividers to stabilize
- for(i=0;i<16;i++);
+ pllSettle(16, PLL_DIVIDER_CYCLES);
 }
 
 void initExternalMemory(void)
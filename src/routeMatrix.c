@@ -0,0 +1,287 @@
+/*********************************************************************************
+
+ Copyright(c) 2012 Analog Devices, Inc. All Rights Reserved.
+
+ This software is proprietary and confidential.  By using this software you agree
+ to the terms of the associated Analog Devices License Agreement.
+
+ *********************************************************************************/
+/*
+ * NAME:     routeMatrix.c
+ * PURPOSE:  Routing and mixing matrix between the channels and the DAC.
+ * USAGE:    initFIR() calls initRoute(), which routes every filtered channel
+ *           to its own AOUT channel as the accelerators write them. A new
+ *           matrix of ROUTE_OUTPUTS rows by ROUTE_SOURCES gains goes to
+ *           routeStage(), from one thread, which returns at once; the next
+ *           handleCodecData() makes it live with routeSwap() before it mixes,
+ *           so every block is mixed with one whole matrix.
+ *
+ *           The matrix is kept as the cells of each row that are not 0.
+ *           routeBlock() hands a row of a single source at unity gain to
+ *           the TX interleave as that source's buffer and a row of none as a
+ *           silent block, without touching a sample, so the default matrix
+ *           and any other permutation cost nothing. The other rows are mixed
+ *           into their own buffer, ROUTE_PASS_SOURCES sources per pass, with
+ *           SIMD_for loops on the SHARC and SSE in the host emulation build.
+ *
+ *           AOUT channels of FIXED_POINT_CHANNELS slots are written by
+ *           fixedChannelsBlock() after the mix, and the filtered channels of
+ *           those slots are never written, so they are no source either.
+ */
+
+#include "ADDS_21479_EzKit.h"
+
+#if defined(HOST_EMULATION) && defined(__SSE__)
+#include <xmmintrin.h>
+#define ROUTE_SSE 1
+#else
+#define ROUTE_SSE 0
+#endif
+
+#ifdef HOST_EMULATION
+#define ROUTE_SIMD_FOR
+#else
+#define ROUTE_SIMD_FOR _Pragma("SIMD_for")
+#endif
+
+/* Life of a staged matrix: routeStage() sets ROUTE_STAGED, routeSwap()
+ * ROUTE_IDLE again */
+#define ROUTE_IDLE		0	/* the inactive plan is free */
+#define ROUTE_STAGED	1	/* the inactive plan holds the next matrix */
+
+static route_plan Route_Plan[2];
+static int route_active;
+static volatile int route_state;
+
+route_stats routeStats;
+
+/* Mixed AOUT channels and a block of silence, carved by initBlockMemory() */
+float *Route_Mix[ROUTE_OUTPUTS];
+float *Route_Silence;
+
+
+/* Terms of a pass of k sources */
+#define ROUTE_TERMS_1(T) T(0)
+#define ROUTE_TERMS_2(T) T(0) T(1)
+#define ROUTE_TERMS_3(T) T(0) T(1) T(2)
+#define ROUTE_TERMS_4(T) T(0) T(1) T(2) T(3)
+
+/* The gains and sources of a pass in registers: y is a float like the
+ * gains, so every store would reload them otherwise */
+#define ROUTE_LOAD(j)	const float g##j = g[j]; const float * const x##j = x[j];
+#define ROUTE_SCALAR(j)	+ g##j * x##j[i]
+
+#if ROUTE_SSE
+
+#define ROUTE_SPLAT(j)	const __m128 v##j = _mm_set1_ps(g##j);
+#define ROUTE_VECTOR(j) \
+	lo = _mm_add_ps(lo, _mm_mul_ps(v##j, _mm_loadu_ps(&x##j[i]))); \
+	hi = _mm_add_ps(hi, _mm_mul_ps(v##j, _mm_loadu_ps(&x##j[i + 4])));
+
+/* y = g[0]*x[0] + .. + g[k-1]*x[k-1], or y += that, two vectors of four
+ * samples at a time */
+#define ROUTE_PASS_SSE(k, y0, y1) \
+	for(i = 0; i + 8 <= length; i += 8) \
+	{ \
+		__m128 lo = y0, hi = y1; \
+		ROUTE_TERMS_##k(ROUTE_VECTOR) \
+		_mm_storeu_ps(&y[i], lo); \
+		_mm_storeu_ps(&y[i + 4], hi); \
+	}
+
+#define ROUTE_PASS(k) \
+static void routePass##k(float *y, float * const *x, const float *g, bool accumulate, int length) \
+{ \
+	ROUTE_TERMS_##k(ROUTE_LOAD) \
+	ROUTE_TERMS_##k(ROUTE_SPLAT) \
+	int i; \
+	if(accumulate) \
+	{ \
+		ROUTE_PASS_SSE(k, _mm_loadu_ps(&y[i]), _mm_loadu_ps(&y[i + 4])) \
+	} \
+	else \
+	{ \
+		ROUTE_PASS_SSE(k, _mm_setzero_ps(), _mm_setzero_ps()) \
+	} \
+	for(; i < length; i++) \
+		y[i] = (accumulate ? y[i] : 0.0f) ROUTE_TERMS_##k(ROUTE_SCALAR); \
+}
+
+#else
+
+#define ROUTE_PASS(k) \
+static void routePass##k(float *y, float * const *x, const float *g, bool accumulate, int length) \
+{ \
+	ROUTE_TERMS_##k(ROUTE_LOAD) \
+	int i; \
+	if(accumulate) \
+	{ \
+		ROUTE_SIMD_FOR \
+		for(i = 0; i < length; i++) \
+			y[i] = y[i] ROUTE_TERMS_##k(ROUTE_SCALAR); \
+	} \
+	else \
+	{ \
+		ROUTE_SIMD_FOR \
+		for(i = 0; i < length; i++) \
+			y[i] = 0.0f ROUTE_TERMS_##k(ROUTE_SCALAR); \
+	} \
+}
+
+#endif /* ROUTE_SSE */
+
+ROUTE_PASS(1)
+ROUTE_PASS(2)
+ROUTE_PASS(3)
+ROUTE_PASS(4)
+
+
+/* A row passed on as the buffer of its source, or as silence */
+static bool routeAsIs(const route_row *r)
+{
+	return r->cells == 0 || (r->cells == 1 && r->gain[0] == 1.0f);
+}
+
+static void routeCompile(route_plan *p, const float (*gains)[ROUTE_SOURCES])
+{
+	int out, src;
+
+	p->cells = 0;
+	p->passes = 0;
+
+	for(out = 0; out < ROUTE_OUTPUTS; out++)
+	{
+		route_row *r = &p->row[out];
+
+		r->cells = 0;
+		for(src = 0; src < ROUTE_SOURCES; src++)
+		{
+			if(gains[out][src] != 0.0f)
+			{
+				r->source[r->cells] = src;
+				r->gain[r->cells] = gains[out][src];
+				r->cells++;
+			}
+		}
+
+		p->cells += r->cells;
+		if(!routeAsIs(r))
+			p->passes += (r->cells + ROUTE_PASS_SOURCES - 1) / ROUTE_PASS_SOURCES;
+	}
+}
+
+
+/* Each filtered channel to its own AOUT channel */
+void initRoute(void)
+{
+	float gains[ROUTE_OUTPUTS][ROUTE_SOURCES];
+	int out, src;
+
+	for(out = 0; out < ROUTE_OUTPUTS; out++)
+	{
+		for(src = 0; src < ROUTE_SOURCES; src++)
+			gains[out][src] = src == ROUTE_FILTERED(out) ? 1.0f : 0.0f;
+	}
+
+	routeCompile(&Route_Plan[0], gains);
+	route_active = 0;
+	route_state = ROUTE_IDLE;
+
+	routeStats.swaps = 0;
+	routeStats.cells = Route_Plan[0].cells;
+	routeStats.passes = Route_Plan[0].passes;
+}
+
+
+/* Stages gains[out][src], the gain from source src, ROUTE_INPUT() or
+ * ROUTE_FILTERED(), to AOUT channel out, to go live at the next block
+ * boundary. Never waits: returns -1 while the previous matrix is still on
+ * its way, 0 once staged. Called from one thread at a time, the caller
+ * counts the refusals. */
+int routeStage(const float (*gains)[ROUTE_SOURCES])
+{
+	if(route_state != ROUTE_IDLE)
+		return -1;
+
+	routeCompile(&Route_Plan[route_active ^ 1], gains);
+
+	// the plan is complete before the block loop can see it
+	RING_BARRIER();
+	route_state = ROUTE_STAGED;
+
+	return 0;
+}
+
+
+/* Called by handleCodecData() before it mixes a block: makes a staged matrix
+ * live */
+void routeSwap(void)
+{
+	if(route_state != ROUTE_STAGED)
+		return;
+
+	route_active ^= 1;
+	routeStats.swaps++;
+	routeStats.cells = Route_Plan[route_active].cells;
+	routeStats.passes = Route_Plan[route_active].passes;
+
+	// the old plan is out of use before routeStage() can see it free
+	RING_BARRIER();
+	route_state = ROUTE_IDLE;
+}
+
+
+/* Points tx[out] at the block of every AOUT channel, mixed from the raw
+ * inputs of the RX slots and the filtered channels, blockSamples each */
+void routeBlock(float * const *inputs, float * const *filtered, float **tx)
+{
+	const route_plan *p = &Route_Plan[route_active];
+	float *src[ROUTE_SOURCES];
+	float *x[ROUTE_PASS_SOURCES];
+	int out, i, c, k;
+
+	for(i = 0; i < NUM_RX_SLOTS; i++)
+		src[ROUTE_INPUT(i)] = inputs[i];
+	for(i = 0; i < AD1939_FLOAT_CHANNELS; i++)
+		src[ROUTE_FILTERED(i)] = filtered[i];
+
+	for(out = 0; out < ROUTE_OUTPUTS; out++)
+	{
+		const route_row *r = &p->row[out];
+
+		if(r->cells == 0)
+		{
+			tx[out] = Route_Silence;
+			continue;
+		}
+		if(routeAsIs(r))
+		{
+			tx[out] = src[r->source[0]];
+			continue;
+		}
+
+		for(c = 0; c < r->cells; c += k)
+		{
+			k = r->cells - c < ROUTE_PASS_SOURCES ? r->cells - c : ROUTE_PASS_SOURCES;
+			for(i = 0; i < k; i++)
+				x[i] = src[r->source[c + i]];
+
+			switch(k)
+			{
+			case 1:
+				routePass1(Route_Mix[out], x, &r->gain[c], c > 0, blockSamples);
+				break;
+			case 2:
+				routePass2(Route_Mix[out], x, &r->gain[c], c > 0, blockSamples);
+				break;
+			case 3:
+				routePass3(Route_Mix[out], x, &r->gain[c], c > 0, blockSamples);
+				break;
+			default:
+				routePass4(Route_Mix[out], x, &r->gain[c], c > 0, blockSamples);
+				break;
+			}
+		}
+		tx[out] = Route_Mix[out];
+	}
+}
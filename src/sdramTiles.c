@@ -0,0 +1,445 @@
+/*********************************************************************************
+
+ Copyright(c) 2012 Analog Devices, Inc. All Rights Reserved.
+
+ This software is proprietary and confidential.  By using this software you agree
+ to the terms of the associated Analog Devices License Agreement.
+
+ *********************************************************************************/
+/*
+ * NAME:     sdramTiles.c
+ * PURPOSE:  FIR filters longer than internal memory holds, with their
+ *           coefficients and delay lines in SDRAM.
+ * USAGE:    initSdramTiles() hands out the SDRAM pool, after
+ *           initExternalMemory(). sdramFirInit() copies the coefficients of a
+ *           filter into SDRAM and clears its delay line there.
+ *           sdramTilesStart() then sets up a pass of one block of window
+ *           samples through a list of filters, from internal memory into
+ *           internal memory, and sdramTilesNext() runs it one tile at a time
+ *           on the FIR accelerator: the owner of the accelerator interrupt
+ *           calls it once to start the pass and again every time a tile is
+ *           through, until it returns false.
+ *
+ *           With SDRAM_FIR_CHANNELS, initFIR() calls initSdramChannels() and
+ *           startFIR() sdramChannelsStart(), and filterNextJob() runs the
+ *           tiles of the channels from ChannelscompISR after the chain of
+ *           every block.
+ *
+ *           Every filter is cut into tiles of SDRAM_TILE_TAPS taps, the most
+ *           the accelerator takes; a chained DMA fetches the coefficients of
+ *           a tile and the samples they apply to, the window and the
+ *           history, into one of two scratch buffers. The window of the first
+ *           tile is the block itself, which the core copies in. The
+ *           accelerator filters the tile in one buffer while the DMA fetches
+ *           the next, of the same filter or of the next one, into the other,
+ *           and the core adds up the partial outputs of the tile before. The
+ *           block goes into the delay lines while the last tile runs. The
+ *           outputs equal those of one filter of all taps, up to the float
+ *           rounding of the partial sums.
+ *
+ *           Each filter counts the SDRAM words its last block moved, which is
+ *           SDRAM_BLOCK_WORDS(); times 4 bytes and blocks per second that is
+ *           the SDRAM bandwidth it takes. Polls for a tile the DMA had not
+ *           fetched when the accelerator was done with the last count as
+ *           stalls: SDRAM bandwidth, not the accelerator, limits such a
+ *           filter. The waits run in ChannelscompISR, so a DMA that is not
+ *           through after SDRAM_EP_TIMEOUT polls is stopped and counted in
+ *           timeouts instead of hanging the interrupt.
+ */
+
+#include "ADDS_21479_EzKit.h"
+
+/* SDRAM of the filters, handed out by sdramFirInit() */
+#ifndef HOST_EMULATION
+#pragma section("seg_sdram", NO_INIT)
+#endif
+static float sdramPool[SDRAM_POOL_WORDS];
+static int sdramPoolUsed;
+
+/* Double-buffered tiles: coefficients, then the window and the history as
+ * the accelerator takes its input, and the partial outputs of two tiles */
+static float Tile_Scratch[2][2*SDRAM_TILE_TAPS - 1 + MAX_BLOCK_SAMPLES];
+static float Tile_Partial[2][MAX_BLOCK_SAMPLES];
+
+/* DMA chains that fetch either scratch buffer, and the one that writes the
+ * blocks of a pass into SDRAM */
+static fir_word Tile_Dma[2][3][EP_TCB_SIZE];
+static fir_word Write_Dma[FIR_CHANNELS][EP_TCB_SIZE];
+
+static fir_chain Tile_Chain;
+
+/* The pass: its filters, 0 once it has ended, and the SDRAM words they had
+ * counted before it */
+static sdram_fir_channel *Tile_Pass[FIR_CHANNELS];
+static unsigned long long passWords[FIR_CHANNELS];
+static int passFilters;
+static unsigned int passStart;
+
+/* Filter and tile fetched into Tile_Scratch[nextBuf], to run next */
+static int nextFilter, nextTile, nextBuf;
+
+/* Partial outputs of the running tile, added once the next one runs */
+static float *addOut;
+static float *addPartial;
+static int addWindow;
+
+static volatile bool tileRunning;
+
+/* Filters of SDRAM_FIR_CHANNELS, the pass list of them, and the positions
+ * of their next blocks in the input buffers of FIR_Channels */
+sdram_fir_channel Sdram_Channels[FIR_CHANNELS];
+static sdram_fir_channel *sdramList[FIR_CHANNELS];
+static int sdramListed;
+static int sdramPos[FIR_CHANNELS];
+
+/* Cleared delay lines are filled from it */
+static const float zeroWord = 0.0f;
+
+
+void initSdramTiles(void)
+{
+	*pDMAC0 = 0;
+	sdramPoolUsed = 0;
+	passFilters = 0;
+	tileRunning = false;
+}
+
+
+/* One transfer of count words between internal memory at in and SDRAM from
+ * ext on, in the circular buffer of length words at base, linked to next or
+ * ending the chain */
+static void epTcb(fir_word *tcb, float *ext, float *base, int length, const float *in, int count,
+				  int im, fir_word *next)
+{
+	tcb[EP_TCB_CP] = next != NULL ? EP_TCB_LINK(next) : 0;
+	tcb[EP_TCB_EL] = length;
+	tcb[EP_TCB_EB] = FIR_ADDR(base);
+	tcb[EP_TCB_EM] = 1;
+	tcb[EP_TCB_EI] = FIR_ADDR(ext);
+	tcb[EP_TCB_IC] = count;
+	tcb[EP_TCB_IM] = im;
+	tcb[EP_TCB_II] = FIR_ADDR(in);
+}
+
+/* Starts a chain into internal memory, or with TRAN into SDRAM */
+static void epStart(fir_word *tcb, int tran)
+{
+	// the disable has to take effect before the chain is reloaded
+	*pDMAC0 = 0;
+	NOP();
+
+	*pCPEP0 = EP_TCB_LINK(tcb);
+	*pDMAC0 = DMAEN | CHEN | CBEN | tran;
+}
+
+/* Waits for the chain, returns the polls it took, or -1 once it stopped a
+ * chain that was not through after SDRAM_EP_TIMEOUT polls */
+static int epWait(void)
+{
+	int polls = 0;
+
+	while(*pDMAC0 & DMAS)
+	{
+		if(polls == SDRAM_EP_TIMEOUT)
+		{
+			*pDMAC0 = 0;
+			return -1;
+		}
+		NOP();
+		polls++;
+	}
+	return polls;
+}
+
+
+/* Sets a filter of taps up for blocks of window samples. Returns 0, or -1
+ * for a window the accelerator does not take, when SDRAM is used up or when
+ * the DMA that clears it times out. Called with no pass running. */
+int sdramFirInit(sdram_fir_channel *f, const float *coeffs, int taps, int window)
+{
+	int length = SDRAM_LINE_SIZE(taps, window);
+
+	if(taps < 1 || window < 1 || window > MAX_BLOCK_SAMPLES || firChainCtl2(1, window, 1, false) < 0 ||
+			sdramPoolUsed + taps + length > SDRAM_POOL_WORDS)
+		return -1;
+
+	f->taps = taps;
+	f->window = window;
+	f->tiles = SDRAM_TILES(taps);
+	f->coeffs = &sdramPool[sdramPoolUsed];
+	f->line = &sdramPool[sdramPoolUsed + taps];
+	f->newest = 0;
+	f->in = NULL;
+	f->out = NULL;
+	f->blocks = 0;
+	f->block_words = 0;
+	f->read_words = 0;
+	f->write_words = 0;
+	f->stalls = 0;
+	f->timeouts = 0;
+	f->cycles = 0;
+	sdramPoolUsed += taps + length;
+
+	// the coefficients, then the same zero into every word of the delay line
+	epTcb(Write_Dma[0], f->coeffs, f->coeffs, taps, coeffs, taps, 1, Write_Dma[1]);
+	epTcb(Write_Dma[1], f->line, f->line, length, &zeroWord, length, 0, NULL);
+	epStart(Write_Dma[0], TRAN);
+	if(epWait() < 0)
+		return -1;
+
+	return 0;
+}
+
+
+static int tileTaps(const sdram_fir_channel *f, int t)
+{
+	int taps = f->taps - t*SDRAM_TILE_TAPS;
+
+	return taps < SDRAM_TILE_TAPS ? taps : SDRAM_TILE_TAPS;
+}
+
+/* Starts the DMA of tile t into scratch buffer buf: the coefficients c(tK)
+ * on, the window that many samples before the newest block and the history
+ * of the tile before that. Tile 0 leaves the window, the block, to tileRun(). */
+static void tileFetch(sdram_fir_channel *f, int t, int buf)
+{
+	fir_word (*dma)[EP_TCB_SIZE] = Tile_Dma[buf];
+	float *coeffs = Tile_Scratch[buf];
+	float *in = coeffs + SDRAM_TILE_TAPS;
+	int first = t*SDRAM_TILE_TAPS;
+	int taps = tileTaps(f, t);
+	int length = SDRAM_LINE_SIZE(f->taps, f->window);
+	int window = (f->newest - first + length) % length;
+	int history = (f->newest - first - (taps - 1) + length) % length;
+	fir_word *next = taps > 1 ? dma[2] : NULL;
+
+	epTcb(dma[0], f->coeffs + first, f->coeffs, f->taps, coeffs, taps, 1, t > 0 ? dma[1] : next);
+	epTcb(dma[1], f->line + window, f->line, length, in, f->window, 1, next);
+	epTcb(dma[2], f->line + history, f->line, length, in + f->window, taps - 1, 1, NULL);
+	epStart(dma[0], 0);
+
+	f->read_words += taps + (t > 0 ? f->window : 0) + taps - 1;
+}
+
+/* Starts the accelerator on tile t, fetched into scratch buffer buf. Returns
+ * 0, or -1 without starting it for a tile the accelerator does not take,
+ * which sdramFirInit() leaves none of. */
+static int tileRun(const sdram_fir_channel *f, int t, int buf, float *out)
+{
+	fir_channel_config c;
+	int i;
+
+	c.taps = tileTaps(f, t);
+	c.window = f->window;
+	c.coeffs = Tile_Scratch[buf];
+	c.in = Tile_Scratch[buf] + SDRAM_TILE_TAPS;
+	c.in_length = c.window + c.taps - 1;
+	c.out = out;
+	c.ratio = 1;
+	c.upsample = false;
+
+	if(t == 0)
+	{
+		for(i = 0; i < c.window; i++)
+			c.in[i] = f->in[i];
+	}
+
+	if(firChainBuild(&Tile_Chain, &c, 1, false) != 0)
+		return -1;
+
+	tileRunning = true;
+	firChainStart(&Tile_Chain);
+	return 0;
+}
+
+static void tileAdd(float *out, const float *partial, int window)
+{
+	int i;
+
+	for(i = 0; i < window; i++)
+		out[i] += partial[i];
+}
+
+
+/* Sets up a pass of the n filters over their blocks at in into out, and
+ * fetches the first tile. Called with the EP DMA of any pass before
+ * through, the accelerator may still be busy. */
+void sdramTilesStart(sdram_fir_channel * const *filters, int n)
+{
+	int k, timedOut;
+
+	assert(n <= FIR_CHANNELS);
+
+	timedOut = epWait() < 0;
+
+	passStart = sysreg_read(sysreg_EMUCLK);
+	for(k = 0; k < n; k++)
+	{
+		Tile_Pass[k] = filters[k];
+		passWords[k] = filters[k]->read_words + filters[k]->write_words;
+		filters[k]->timeouts += timedOut;
+	}
+	passFilters = n;
+
+	nextFilter = 0;
+	nextTile = 0;
+	nextBuf = 0;
+	addPartial = NULL;
+
+	if(n > 0)
+		tileFetch(Tile_Pass[0], 0, 0);
+}
+
+
+/* Called with the accelerator idle: starts the next tile of the pass and
+ * returns true, or, once the last one is through, ends the pass and returns
+ * false. The tile is started last, so that its interrupt finds the pass
+ * ready for the next one. */
+bool sdramTilesNext(void)
+{
+	sdram_fir_channel *f;
+	float *out = addOut, *partial = addPartial;
+	int window = addWindow;
+	int t, buf, length, k, polls;
+
+	if(passFilters == 0)
+		return false;
+
+	if(nextFilter == passFilters)
+	{
+		// the last partial outputs, and the blocks into the delay lines
+		if(partial != NULL)
+			tileAdd(out, partial, window);
+		polls = epWait();
+
+		for(k = 0; k < passFilters; k++)
+		{
+			f = Tile_Pass[k];
+			length = SDRAM_LINE_SIZE(f->taps, f->window);
+
+			if(polls < 0)
+				f->timeouts++;
+
+			f->newest = (f->newest + f->window) % length;
+			f->blocks++;
+			f->block_words = (unsigned int)(f->read_words + f->write_words - passWords[k]);
+			f->cycles = sysreg_read(sysreg_EMUCLK) - passStart;
+		}
+
+		passFilters = 0;
+		tileRunning = false;
+		return false;
+	}
+
+	f = Tile_Pass[nextFilter];
+	polls = epWait();
+	if(polls < 0)
+		f->timeouts++;
+	else
+		f->stalls += polls;
+
+	t = nextTile;
+	buf = nextBuf;
+	addOut = f->out;
+	addPartial = t == 0 ? NULL : Tile_Partial[buf];
+	addWindow = f->window;
+
+	if(++nextTile == f->tiles)
+	{
+		nextTile = 0;
+		nextFilter++;
+	}
+	nextBuf ^= 1;
+
+	// the next tile comes in while this one runs, after the last the blocks go out
+	if(nextFilter < passFilters)
+	{
+		tileFetch(Tile_Pass[nextFilter], nextTile, nextBuf);
+	}
+	else
+	{
+		for(k = 0; k < passFilters; k++)
+		{
+			sdram_fir_channel *w = Tile_Pass[k];
+
+			length = SDRAM_LINE_SIZE(w->taps, w->window);
+			epTcb(Write_Dma[k], w->line + w->newest, w->line, length, w->in, w->window, 1,
+				  k + 1 < passFilters ? Write_Dma[k + 1] : NULL);
+			w->write_words += w->window;
+		}
+		epStart(Write_Dma[0], TRAN);
+	}
+
+	if(tileRun(f, t, buf, t == 0 ? f->out : Tile_Partial[buf]) != 0)
+	{
+		// the pass ends with the tiles so far
+		passFilters = 0;
+		tileRunning = false;
+		return false;
+	}
+
+	// and the core adds up the tile before
+	if(partial != NULL)
+		tileAdd(out, partial, window);
+
+	return true;
+}
+
+
+/* True from the first tile of a pass until sdramTilesNext() ends it, so the
+ * completion interrupt can tell a tile from the pass of the chain */
+bool sdramTileRunning(void)
+{
+	return tileRunning;
+}
+
+
+/* Moves the channels of SDRAM_FIR_CHANNELS into SDRAM. Runs in initFIR(),
+ * after initBlockMemory() and coeffBankInit(). Returns 0, or -1 for a
+ * channel sdramFirInit() does not take. */
+int initSdramChannels(void)
+{
+	int ch;
+
+	initSdramTiles();
+	sdramListed = 0;
+
+	for(ch = 0; ch < FIR_CHANNELS; ch++)
+	{
+		const fir_channel_config *c = &FIR_Channels[ch];
+
+		if(!SDRAM_CHANNEL(ch))
+			continue;
+
+		if(c->ratio != 1 || c->upsample ||
+				sdramFirInit(&Sdram_Channels[ch], c->coeffs, c->taps, c->window) != 0)
+			return -1;
+		sdramPos[ch] = 0;
+		sdramList[sdramListed++] = &Sdram_Channels[ch];
+	}
+
+	return 0;
+}
+
+
+/* Called by startFIR(): points the SDRAM channels at their next block and
+ * the outputs of set, and fetches the first tile while the chain runs */
+void sdramChannelsStart(int set)
+{
+	int ch;
+
+	for(ch = 0; ch < FIR_CHANNELS; ch++)
+	{
+		const fir_channel_config *c = &FIR_Channels[ch];
+		sdram_fir_channel *f = &Sdram_Channels[ch];
+
+		if(!SDRAM_CHANNEL(ch))
+			continue;
+
+		f->in = &c->in[sdramPos[ch]];
+		f->out = firChannelOutput(set, ch);
+		sdramPos[ch] = (sdramPos[ch] + c->window) % c->in_length;
+	}
+
+	sdramTilesStart(sdramList, sdramListed);
+}
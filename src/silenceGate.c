@@ -0,0 +1,136 @@
+/*********************************************************************************
+
+ Copyright(c) 2012 Analog Devices, Inc. All Rights Reserved.
+
+ This software is proprietary and confidential.  By using this software you agree
+ to the terms of the associated Analog Devices License Agreement.
+
+ *********************************************************************************/
+/*
+ * NAME:     silenceGate.c
+ * PURPOSE:  Leaves idle channels out of the FIR chain.
+ * USAGE:    initFIR() calls initSilenceGate(). deinterleaveBlock() sums the
+ *           squares of every RX slot while it floats them, and
+ *           handleCodecData() hands those energies to silenceGateBlock().
+ *           A block is silent when its mean square is below
+ *           silenceThreshold. Once a channel of FIR_Chain has had taps - 1 +
+ *           window silent input samples, its delay line holds nothing but
+ *           silence and its filter tail has decayed, and the channel is
+ *           gated.
+ *
+ *           startFIR() asks silenceGateSkip() for every chain channel and
+ *           links only the others into the next pass. A gated channel's
+ *           input index is advanced by one window, as the accelerator would
+ *           have written it back, and its outputs are cleared. Its delay line
+ *           keeps taking the input, so the first block above the threshold
+ *           is filtered over its real history and the channel resumes where
+ *           it would have been without a discontinuity. The outputs of a
+ *           gated channel differ from the filtered ones only by the filtered
+ *           silence below the threshold; with digital silence they are equal.
+ *           A pass with every channel gated is not started at all.
+ *
+ *           gateStats counts the skipped and resumed blocks of every channel
+ *           and the accelerator cycles hybridModel gives the skipped ones.
+ *           The channels the core filters, those of FIXED_POINT_CHANNELS and
+ *           of hybridSchedule.c, the SDRAM channels, the FFT convolution build
+ *           and the IIR cascades are never gated.
+ */
+
+#include "ADDS_21479_EzKit.h"
+
+/* Mean square per input sample of a silent block, 0 gates nothing */
+float silenceThreshold = SILENCE_THRESHOLD;
+
+gate_stats gateStats;
+
+/* Channels gated from the next startFIR() on, written on the core between
+ * blocks, read by startFIR() from the core or from ChannelscompISR */
+static volatile unsigned int gate_mask;
+
+/* Channels silenceGateSkip() skipped in the last pass */
+static unsigned int gate_skipped;
+
+
+void initSilenceGate(void)
+{
+	int ch;
+
+	for(ch = 0; ch < FIR_CHANNELS; ch++)
+	{
+		gateStats.energy[ch] = 0.0f;
+		gateStats.quiet[ch] = 0;
+		gateStats.skipped[ch] = 0;
+		gateStats.resumed[ch] = 0;
+		gateStats.saved[ch] = 0;
+	}
+	gateStats.mask = 0;
+	gate_mask = 0;
+	gate_skipped = 0;
+}
+
+
+/* Called by handleCodecData() with the sum of squares of the block every
+ * channel's delay line just took, before the block is filtered */
+void silenceGateBlock(const float *energy)
+{
+	unsigned int mask = 0;
+	int ch;
+
+	for(ch = 0; ch < FIR_CHANNELS; ch++)
+	{
+		const fir_channel_config *c = &FIR_Channels[ch];
+		unsigned int tail = c->taps - 1 + c->window;
+
+		gateStats.energy[ch] = energy[ch];
+
+		if(energy[ch] < silenceThreshold * blockSamples)
+		{
+			if(gateStats.quiet[ch] < tail)
+				gateStats.quiet[ch] += blockSamples;
+		}
+		else
+			gateStats.quiet[ch] = 0;
+
+		if(!FFT_CONVOLUTION && firChainIndex[ch] >= 0 && gateStats.quiet[ch] >= tail)
+			mask |= 1u << ch;
+	}
+
+	gateStats.mask = mask;
+	gate_mask = mask;
+}
+
+
+/* Called by startFIR() for every channel of FIR_Chain, with its TCB pointed
+ * at the outputs of the pass. Returns false when the channel is to be
+ * filtered, true when it is gated: its outputs are cleared and its input
+ * index is left where the pass would have written it back. */
+bool silenceGateSkip(int ch, fir_word *tcb)
+{
+	const fir_channel_config *c = &FIR_Channels[ch];
+	unsigned int bit = 1u << ch;
+	float *ib, *out;
+	int ii, il, i;
+
+	if(!(gate_mask & bit))
+	{
+		if(gate_skipped & bit)
+			gateStats.resumed[ch]++;
+		gate_skipped &= ~bit;
+		return false;
+	}
+
+	ib = (float *)tcb[FIR_TCB_IB];
+	il = (int)tcb[FIR_TCB_IL];
+	ii = (int)((float *)tcb[FIR_TCB_II] - ib);
+	tcb[FIR_TCB_II] = FIR_ADDR(&ib[(ii + c->window * (int)tcb[FIR_TCB_IM]) % il]);
+
+	out = (float *)tcb[FIR_TCB_OB];
+	for(i = 0; i < FIR_OUTPUTS(c); i++)
+		out[i] = 0.0f;
+
+	gate_skipped |= bit;
+	gateStats.skipped[ch]++;
+	gateStats.saved[ch] += hybridAccCycles(&hybridModel, c);
+
+	return true;
+}